@@ -34,13 +34,19 @@
 // IP_Address=127.0.0.1
 // MachineName=ADMIN
 //
+#ifdef _WIN32
 #include "stdafx.h"
+#endif
 #include <vector>
 #include <string>
 #include <ctype.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <fstream>
+#include <filesystem>
 #include <float.h>
 
 #ifdef WIN32
@@ -48,6 +54,7 @@
 #endif
 
 #include "CDataFile.h"
+#include "MappedFile.h"
 
 // Compatibility Defines ////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////
@@ -55,6 +62,53 @@
   #define snprintf  _snprintf
   #define vsnprintf _vsnprintf
 #endif
+#ifndef _WIN32
+  // the msvc secure variants, for the linux tools
+  #define _snprintf_s(buf, count, ...)       snprintf(buf, count, __VA_ARGS__)
+  #define _vsnprintf_s(buf, count, fmt, args) vsnprintf(buf, count, fmt, args)
+#endif
+
+
+// FindKey
+// Looks up a key in the given section through its index. Returns NULL if the
+// section has no such key.
+static t_Key* FindKey(t_Section& Section, std::string_view szKey)
+{
+	NameIndex::const_iterator k_pos = Section.KeyIndex.find(szKey);
+
+	if ( k_pos == Section.KeyIndex.end() )
+		return NULL;
+
+	return &Section.Keys[k_pos->second];
+}
+
+// TrimView
+// Like Trim, on a view: returns the view without the whitespace and equal
+// indicators at both ends.
+static const t_Str TrimChars = WhiteSpace + EqualIndicators;
+
+static t_StrView TrimView(t_StrView szStr)
+{
+	const size_t nFirst = szStr.find_first_not_of(TrimChars);
+
+	if ( nFirst == t_StrView::npos )
+		return t_StrView();
+
+	const size_t nLast = szStr.find_last_not_of(TrimChars);
+	return szStr.substr(nFirst, nLast - nFirst + 1);
+}
+
+// CopyValue
+// Copies a key's value to a NUL terminated buffer for the C conversion
+// functions. A number never comes close to the buffer size.
+static const char* CopyValue(const t_Key& Key, char (&szBuffer)[64])
+{
+	const size_t nLength = Key.szValue.size() < sizeof(szBuffer) - 1 ? Key.szValue.size() : sizeof(szBuffer) - 1;
+
+	memcpy(szBuffer, Key.szValue.data(), nLength);
+	szBuffer[nLength] = '\0';
+	return szBuffer;
+}
 
 
 // CDataFile
@@ -65,7 +119,7 @@ CDataFile::CDataFile(t_Str szFileName)
 	m_bDirty = false;
 	m_szFileName = szFileName;
 	m_Flags = (AUTOCREATE_SECTIONS | AUTOCREATE_KEYS);
-	m_Sections.push_back( *(new t_Section) );
+	AddSection(t_StrView(), t_StrView());
 
 	Load(m_szFileName);
 }
@@ -74,7 +128,7 @@ CDataFile::CDataFile()
 {
 	Clear();
 	m_Flags = (AUTOCREATE_SECTIONS | AUTOCREATE_KEYS);
-	m_Sections.push_back( *(new t_Section) );
+	AddSection(t_StrView(), t_StrView());
 }
 
 // ~CDataFile
@@ -92,6 +146,8 @@ void CDataFile::Clear()
 	m_bDirty = false;
 	m_szFileName = t_Str("");
 	m_Sections.clear();
+	m_SectionIndex.clear();
+	m_Strings.clear();
 }
 
 // SetFileName
@@ -114,82 +170,105 @@ void CDataFile::SetFileName(t_Str szFileName)
 // Attempts to load in the text file. If successful it will populate the 
 // Section list with the key/value pairs found in the file. Note that comments
 // are saved so that they can be rewritten to the file later.
+// The file is mapped and copied once into m_Strings, the sections and keys are
+// views on that copy: apart from comments, nothing is allocated per line. The
+// map itself isn't kept, Save has to be able to rewrite the file.
 bool CDataFile::Load(t_Str szFileName)
 {
 	// We dont want to create a new file here.  If it doesn't exist, just
 	// return false and report the failure.
-	fstream File(szFileName.c_str(), ios::in);
+	ShaderToggler::MappedFile File;
 
-	if ( File.is_open() )
+	if ( !File.open(szFileName) )
 	{
-		bool bDone = false;
-		bool bAutoKey = (m_Flags & AUTOCREATE_KEYS) == AUTOCREATE_KEYS;
-		bool bAutoSec = (m_Flags & AUTOCREATE_SECTIONS) == AUTOCREATE_SECTIONS;
-		
-		t_Str szLine;
-		t_Str szComment;
-		char buffer[MAX_BUFFER_LEN]; 
-		t_Section* pSection = GetSection("");
+		Report(E_INFO, "[CDataFile::Load] Unable to open file. Does it exist?");
+		return false;
+	}
 
-		// These need to be set, we'll restore the original values later.
-		m_Flags |= AUTOCREATE_KEYS;
-		m_Flags |= AUTOCREATE_SECTIONS;
+	if ( File.size() > 0 )
+	{
+		m_Strings.emplace_back(reinterpret_cast<const char*>(File.data()), File.size());
+		File.close();
+		ParseText(m_Strings.back());
+	}
 
-		while ( !bDone )
-		{
-			memset(buffer, 0, MAX_BUFFER_LEN);
-			File.getline(buffer, MAX_BUFFER_LEN);
+	return true;
+}
 
-			szLine = buffer;
-			Trim(szLine);
+// ParseText
+// Splits the text in lines and adds the sections and keys found. The same
+// rules as the line by line reader this replaced: lines are trimmed, comments
+// collect till the next section or key, a key without a value is skipped, a
+// key which is already in the section gets the new value.
+void CDataFile::ParseText(t_StrView szText)
+{
+	t_Str szComment;
+	t_Section* pSection = GetSection("");
+	size_t nPos = 0;
 
-			bDone = ( File.eof() || File.bad() || File.fail() );
+	while ( nPos < szText.size() )
+	{
+		size_t nEnd = szText.find('\n', nPos);
 
-			if ( szLine.find_first_of(CommentIndicators) == 0 )
-			{
-				szComment += "\n";
-				szComment += szLine;
-			}
-			else
-			if ( szLine.find_first_of('[') == 0 ) // new section
-			{
-				szLine.erase( 0, 1 );
-				szLine.erase( szLine.find_last_of(']'), 1 );
+		if ( nEnd == t_StrView::npos )
+			nEnd = szText.size();
 
-				CreateSection(szLine, szComment);
-				pSection = GetSection(szLine);
-				szComment = t_Str("");
-			}
-			else 
-			if ( szLine.size() > 0 ) // we have a key, add this key/value pair
-			{
-				t_Str szKey = GetNextWord(szLine);
-				t_Str szValue = szLine;
+		const t_StrView szLine = TrimView(szText.substr(nPos, nEnd - nPos));
+		nPos = nEnd + 1;
 
-				if ( szKey.size() > 0 && szValue.size() > 0 )
-				{
-					SetValue(szKey, szValue, szComment, pSection->szName);
-					szComment = t_Str("");
-				}
-			}
+		if ( szLine.size() == 0 )
+			continue;
+
+		if ( CommentIndicators.find(szLine[0]) != t_Str::npos )
+		{
+			szComment += "\n";
+			szComment += szLine;
 		}
+		else
+		if ( szLine[0] == '[' ) // new section
+		{
+			t_StrView szName = szLine.substr(1);
+			const size_t nClose = szName.find_last_of(']');
 
-		// Restore the original flag values.
-		if ( !bAutoKey )
-			m_Flags &= ~AUTOCREATE_KEYS;
+			if ( nClose != t_StrView::npos )
+				szName = szName.substr(0, nClose);
 
-		if ( !bAutoSec )
-			m_Flags &= ~AUTOCREATE_SECTIONS;
-	}
-	else
-	{
-		Report(E_INFO, "[CDataFile::Load] Unable to open file. Does it exist?");
-		return false;
-	}
+			// a section which is in the file twice gets the keys of both.
+			pSection = GetSection(szName);
 
-	File.close();
+			if ( pSection == NULL )
+				pSection = AddSection(szName, StoreString(szComment));
 
-	return true;
+			szComment.clear();
+		}
+		else // we have a key, add this key/value pair
+		{
+			const size_t nEqual = szLine.find_first_of(EqualIndicators);
+
+			if ( nEqual == t_StrView::npos )
+				continue;
+
+			const t_StrView szKey = TrimView(szLine.substr(0, nEqual));
+			const t_StrView szValue = szLine.substr(nEqual + 1);
+
+			if ( szKey.size() == 0 || szValue.size() == 0 )
+				continue;
+
+			// Clear() removes the default section, keys before the first
+			// section header need it back.
+			if ( pSection == NULL )
+				pSection = AddSection(t_StrView(), t_StrView());
+
+			t_Key* pKey = FindKey(*pSection, szKey);
+
+			if ( pKey == NULL )
+				pKey = AddKey(*pSection, szKey, szValue, t_StrView());
+
+			pKey->szValue = szValue;
+			pKey->szComment = StoreString(szComment);
+			szComment.clear();
+		}
+	}
 }
 
 
@@ -197,6 +276,8 @@ bool CDataFile::Load(t_Str szFileName)
 // Attempts to save the Section list and keys to the file. Note that if Load
 // was never called (the CDataFile object was created manually), then you
 // must set the m_szFileName variable before calling save.
+// The file is written to <filename>.tmp, which then replaces the file: a
+// crash or a full disk halfway leaves the previous file intact.
 bool CDataFile::Save()
 {
 	if ( KeyCount() == 0 && SectionCount() == 0 )
@@ -212,46 +293,41 @@ bool CDataFile::Save()
 		return false;
 	}
 
-	fstream File(m_szFileName.c_str(), ios::out|ios::trunc);
+	const t_Str szTempFileName = m_szFileName + ".tmp";
+	fstream File(szTempFileName.c_str(), ios::out|ios::trunc);
 
 	if ( File.is_open() )
 	{
 		SectionItor s_pos;
-		KeyItor k_pos;
-		t_Section Section;
-		t_Key Key;
 
 		for (s_pos = m_Sections.begin(); s_pos != m_Sections.end(); s_pos++)
 		{
-			Section = (*s_pos);
+			const t_Section& Section = (*s_pos);
 			bool bWroteComment = false;
 
+			// written directly instead of through WriteLn: the strings are
+			// views, and can be longer than WriteLn's buffer.
 			if ( Section.szComment.size() > 0 )
 			{
 				bWroteComment = true;
-				WriteLn(File, "\n%s", CommentStr(Section.szComment).c_str());
+				File << '\n' << CommentStr(t_Str(Section.szComment)) << '\n';
 			}
 
 			if ( Section.szName.size() > 0 )
 			{
-				WriteLn(File, "%s[%s]", 
-						bWroteComment ? "" : "\n", 
-						Section.szName.c_str());
+				File << (bWroteComment ? "" : "\n") << '[' << Section.szName << "]\n";
 			}
 
-			for (k_pos = Section.Keys.begin(); k_pos != Section.Keys.end(); k_pos++)
+			for (KeyList::const_iterator k_pos = Section.Keys.begin(); k_pos != Section.Keys.end(); k_pos++)
 			{
-				Key = (*k_pos);
+				const t_Key& Key = (*k_pos);
 
 				if ( Key.szKey.size() > 0 && Key.szValue.size() > 0 )
 				{
-					WriteLn(File, "%s%s%s%s%c%s", 
-						Key.szComment.size() > 0 ? "\n" : "",
-						CommentStr(Key.szComment).c_str(),
-						Key.szComment.size() > 0 ? "\n" : "",
-						Key.szKey.c_str(),
-						EqualIndicators[0],
-						Key.szValue.c_str());
+					if ( Key.szComment.size() > 0 )
+						File << '\n' << CommentStr(t_Str(Key.szComment)) << '\n';
+
+					File << Key.szKey << EqualIndicators[0] << Key.szValue << '\n';
 				}
 			}
 		}
@@ -263,11 +339,31 @@ bool CDataFile::Save()
 		return false;
 	}
 
-	m_bDirty = false;
-	
 	File.flush();
+
+	const bool bWritten = File.good();
 	File.close();
 
+	std::error_code ec;
+
+	if ( !bWritten )
+	{
+		Report(E_ERROR, "[CDataFile::Save] Unable to write <%s>.", szTempFileName.c_str());
+		std::filesystem::remove(szTempFileName, ec);
+		return false;
+	}
+
+	std::filesystem::rename(szTempFileName, m_szFileName, ec);
+
+	if ( ec )
+	{
+		Report(E_ERROR, "[CDataFile::Save] Unable to replace <%s>.", m_szFileName.c_str());
+		std::filesystem::remove(szTempFileName, ec);
+		return false;
+	}
+
+	m_bDirty = false;
+
 	return true;
 }
 
@@ -275,24 +371,14 @@ bool CDataFile::Save()
 // Set the comment of a given key. Returns true if the key is not found.
 bool CDataFile::SetKeyComment(t_Str szKey, t_Str szComment, t_Str szSection)
 {
-	KeyItor k_pos;
-	t_Section* pSection;
+	t_Key* pKey = GetKey(szKey, szSection);
 
-	if ( (pSection = GetSection(szSection)) == NULL )
+	if ( pKey == NULL )
 		return false;
 
-	for (k_pos = pSection->Keys.begin(); k_pos != pSection->Keys.end(); k_pos++)
-	{
-		if ( CompareNoCase( (*k_pos).szKey, szKey ) == 0 )
-		{
-			(*k_pos).szComment = szComment;
-			m_bDirty = true;
-			return true;
-		}
-	}
-
-	return false;
-
+	pKey->szComment = StoreString(szComment);
+	m_bDirty = true;
+	return true;
 }
 
 // SetSectionComment
@@ -300,19 +386,14 @@ bool CDataFile::SetKeyComment(t_Str szKey, t_Str szComment, t_Str szSection)
 // was not found.
 bool CDataFile::SetSectionComment(t_Str szSection, t_Str szComment)
 {
-	SectionItor s_pos;
+	t_Section* pSection = GetSection(szSection);
 
-	for (s_pos = m_Sections.begin(); s_pos != m_Sections.end(); s_pos++)
-	{
-		if ( CompareNoCase( (*s_pos).szName, szSection ) == 0 ) 
-		{
-		    (*s_pos).szComment = szComment;
-			m_bDirty = true;
-			return true;
-		}
-	}
+	if ( pSection == NULL )
+		return false;
 
-	return false;
+	pSection->szComment = StoreString(szComment);
+	m_bDirty = true;
+	return true;
 }
 
 
@@ -323,7 +404,6 @@ bool CDataFile::SetSectionComment(t_Str szSection, t_Str szComment)
 // the proper value and place it in the section requested.
 bool CDataFile::SetValue(t_Str szKey, t_Str szValue, t_Str szComment, t_Str szSection)
 {
-	t_Key* pKey = GetKey(szKey, szSection);
 	t_Section* pSection = GetSection(szSection);
 
 	if (pSection == NULL)
@@ -338,27 +418,23 @@ bool CDataFile::SetValue(t_Str szKey, t_Str szValue, t_Str szComment, t_Str szSe
 	if ( pSection == NULL )
 		return false;
 
+	t_Key* pKey = FindKey(*pSection, szKey);
+
 	// if the key does not exist in that section, and the value passed 
 	// is not t_Str("") then add the new key.
 	if ( pKey == NULL && szValue.size() > 0 && (m_Flags & AUTOCREATE_KEYS))
 	{
-		pKey = new t_Key;
-
-		pKey->szKey = szKey;
-		pKey->szValue = szValue;
-		pKey->szComment = szComment;
+		AddKey(*pSection, StoreString(szKey), StoreString(szValue), StoreString(szComment));
 		
 		m_bDirty = true;
-		
-		pSection->Keys.push_back(*pKey);
 
 		return true;
 	}
 
 	if ( pKey != NULL )
 	{
-		pKey->szValue = szValue;
-		pKey->szComment = szComment;
+		pKey->szValue = StoreString(szValue);
+		pKey->szComment = StoreString(szComment);
 
 		m_bDirty = true;
 		
@@ -417,17 +493,17 @@ bool CDataFile::SetBool(t_Str szKey, bool bValue, t_Str szComment, t_Str szSecti
 // GetValue
 // Returns the key value as a t_Str object. A return value of
 // t_Str("") indicates that the key could not be found.
-t_Str CDataFile::GetValue(t_Str szKey, t_Str szSection) 
+t_Str CDataFile::GetValue(std::string_view szKey, std::string_view szSection) 
 {
 	t_Key* pKey = GetKey(szKey, szSection);
 
-	return (pKey == NULL) ? t_Str("") : pKey->szValue;
+	return (pKey == NULL) ? t_Str("") : t_Str(pKey->szValue);
 }
 
 // GetString
 // Returns the key value as a t_Str object. A return value of
 // t_Str("") indicates that the key could not be found.
-t_Str CDataFile::GetString(t_Str szKey, t_Str szSection)
+t_Str CDataFile::GetString(std::string_view szKey, std::string_view szSection)
 {
 	return GetValue(szKey, szSection);
 }
@@ -435,49 +511,57 @@ t_Str CDataFile::GetString(t_Str szKey, t_Str szSection)
 // GetFloat
 // Returns the key value as a float type. Returns FLT_MIN if the key is
 // not found.
-float CDataFile::GetFloat(t_Str szKey, t_Str szSection)
+float CDataFile::GetFloat(std::string_view szKey, std::string_view szSection)
 {
-	t_Str szValue = GetValue(szKey, szSection);
+	t_Key* pKey = GetKey(szKey, szSection);
+	char szBuffer[64];
 
-	if ( szValue.size() == 0 )
+	if ( pKey == NULL || pKey->szValue.size() == 0 )
 		return FLT_MIN;
 
-	return (float)atof( szValue.c_str() );
+	return (float)atof( CopyValue(*pKey, szBuffer) );
 }
 
 // GetInt
 // Returns the key value as an integer type. Returns INT_MIN if the key is
 // not found.
-int	CDataFile::GetInt(t_Str szKey, t_Str szSection)
+int	CDataFile::GetInt(std::string_view szKey, std::string_view szSection)
 {
-	t_Str szValue = GetValue(szKey, szSection);
+	t_Key* pKey = GetKey(szKey, szSection);
+	char szBuffer[64];
 
-	if ( szValue.size() == 0 )
+	if ( pKey == NULL || pKey->szValue.size() == 0 )
 		return INT_MIN;
 
-	return atoi( szValue.c_str() );
+	return atoi( CopyValue(*pKey, szBuffer) );
 }
 
 // GetUInt
 // Returns the key value as an integer type. Returns UINT_MAX if the key is
 // not found.
-uint32_t CDataFile::GetUInt(t_Str szKey, t_Str szSection)
+uint32_t CDataFile::GetUInt(std::string_view szKey, std::string_view szSection)
 {
-	t_Str szValue = GetValue(szKey, szSection);
+	t_Key* pKey = GetKey(szKey, szSection);
+	char szBuffer[64];
 
-	if ( szValue.size() == 0 )
+	if ( pKey == NULL || pKey->szValue.size() == 0 )
 		return UINT_MAX;
 
-	return static_cast<uint32_t>(atoll( szValue.c_str() ));
+	return static_cast<uint32_t>(atoll( CopyValue(*pKey, szBuffer) ));
 }
 
 // GetBool
 // Returns the key value as a bool type. Returns false if the key is
 // not found.
-bool CDataFile::GetBool(t_Str szKey, t_Str szSection)
+bool CDataFile::GetBool(std::string_view szKey, std::string_view szSection)
 {
 	bool bValue = false;
-	t_Str szValue = GetValue(szKey, szSection);
+	t_Key* pKey = GetKey(szKey, szSection);
+
+	if ( pKey == NULL )
+		return bValue;
+
+	const t_StrView szValue = pKey->szValue;
 
 	if ( szValue.find("1") == 0 
 		|| CompareNoCase(szValue, "true") == 0
@@ -494,18 +578,14 @@ bool CDataFile::GetBool(t_Str szKey, t_Str szSection)
 // found or true when sucessfully deleted.
 bool CDataFile::DeleteSection(t_Str szSection)
 {
-	SectionItor s_pos;
+	NameIndex::const_iterator s_pos = m_SectionIndex.find(std::string_view(szSection));
 
-	for (s_pos = m_Sections.begin(); s_pos != m_Sections.end(); s_pos++)
-	{
-		if ( CompareNoCase( (*s_pos).szName, szSection ) == 0 ) 
-		{
-			m_Sections.erase(s_pos);
-			return true;
-		}
-	}
+	if ( s_pos == m_SectionIndex.end() )
+		return false;
 
-	return false;
+	m_Sections.erase(m_Sections.begin() + s_pos->second);
+	ReindexSections();
+	return true;
 }
 
 // DeleteKey
@@ -513,22 +593,19 @@ bool CDataFile::DeleteSection(t_Str szSection)
 // cannot be found or true when sucessfully deleted.
 bool CDataFile::DeleteKey(t_Str szKey, t_Str szFromSection)
 {
-	KeyItor k_pos;
 	t_Section* pSection;
 
 	if ( (pSection = GetSection(szFromSection)) == NULL )
 		return false;
 
-	for (k_pos = pSection->Keys.begin(); k_pos != pSection->Keys.end(); k_pos++)
-	{
-		if ( CompareNoCase( (*k_pos).szKey, szKey ) == 0 )
-		{
-			pSection->Keys.erase(k_pos);
-			return true;
-		}
-	}
+	NameIndex::const_iterator k_pos = pSection->KeyIndex.find(std::string_view(szKey));
 
-	return false;
+	if ( k_pos == pSection->KeyIndex.end() )
+		return false;
+
+	pSection->Keys.erase(pSection->Keys.begin() + k_pos->second);
+	ReindexKeys(*pSection);
+	return true;
 }
 
 // CreateKey
@@ -567,11 +644,7 @@ bool CDataFile::CreateSection(t_Str szSection, t_Str szComment)
 		return false;
 	}
 
-	pSection = new t_Section;
-
-	pSection->szName = szSection;
-	pSection->szComment = szComment;
-	m_Sections.push_back(*pSection);
+	AddSection(StoreString(szSection), StoreString(szComment));
 	m_bDirty = true;
 
 	return true;
@@ -595,18 +668,9 @@ bool CDataFile::CreateSection(t_Str szSection, t_Str szComment, KeyList Keys)
 
 	KeyItor k_pos;
 
-	pSection->szName = szSection;
 	for (k_pos = Keys.begin(); k_pos != Keys.end(); k_pos++)
-	{
-		t_Key* pKey = new t_Key;
-		pKey->szComment = (*k_pos).szComment;
-		pKey->szKey = (*k_pos).szKey;
-		pKey->szValue = (*k_pos).szValue;
+		AddKey(*pSection, StoreString((*k_pos).szKey), StoreString((*k_pos).szValue), StoreString((*k_pos).szComment));
 
-		pSection->Keys.push_back(*pKey);
-	}
-
-	m_Sections.push_back(*pSection);
 	m_bDirty = true;
 
 	return true;
@@ -639,9 +703,8 @@ int CDataFile::KeyCount()
 // GetKey
 // Given a key and section name, looks up the key and if found, returns a
 // pointer to that key, otherwise returns NULL.
-t_Key*	CDataFile::GetKey(t_Str szKey, t_Str szSection)
+t_Key*	CDataFile::GetKey(std::string_view szKey, std::string_view szSection)
 {
-	KeyItor k_pos;
 	t_Section* pSection;
 
 	// Since our default section has a name value of t_Str("") this should
@@ -650,29 +713,83 @@ t_Key*	CDataFile::GetKey(t_Str szKey, t_Str szSection)
 	if ( (pSection = GetSection(szSection)) == NULL )
 		return NULL;
 
-	for (k_pos = pSection->Keys.begin(); k_pos != pSection->Keys.end(); k_pos++)
-	{
-		if ( CompareNoCase( (*k_pos).szKey, szKey ) == 0 )
-			return (t_Key*)&(*k_pos);
-	}
-
-	return NULL;
+	return FindKey(*pSection, szKey);
 }
 
 // GetSection
 // Given a section name, locates that section in the list and returns a pointer
 // to it. If the section was not found, returns NULL
-t_Section* CDataFile::GetSection(t_Str szSection)
+t_Section* CDataFile::GetSection(std::string_view szSection)
 {
-	SectionItor s_pos;
+	NameIndex::const_iterator s_pos = m_SectionIndex.find(szSection);
 
-	for (s_pos = m_Sections.begin(); s_pos != m_Sections.end(); s_pos++)
-	{
-		if ( CompareNoCase( (*s_pos).szName, szSection ) == 0 ) 
-			return (t_Section*)&(*s_pos);
-	}
+	if ( s_pos == m_SectionIndex.end() )
+		return NULL;
+
+	return &m_Sections[s_pos->second];
+}
+
+// AddSection
+// Appends a new section to the list and indexes it. Doesn't check whether the
+// section exists, that's up to the caller. If a section with the same name
+// exists, lookups keep returning the first one, like the list scan did.
+t_Section* CDataFile::AddSection(t_StrView szSection, t_StrView szComment)
+{
+	m_Sections.emplace_back();
 
-	return NULL;
+	t_Section& Section = m_Sections.back();
+	Section.szName = szSection;
+	Section.szComment = szComment;
+	m_SectionIndex.emplace(szSection, m_Sections.size() - 1);
+
+	return &Section;
+}
+
+// AddKey
+// Appends a new key to the section's key list and indexes it. Like AddSection,
+// a duplicate name is kept in the list but lookups return the first one.
+t_Key* CDataFile::AddKey(t_Section& Section, t_StrView szKey, t_StrView szValue, t_StrView szComment)
+{
+	Section.Keys.emplace_back();
+
+	t_Key& Key = Section.Keys.back();
+	Key.szKey = szKey;
+	Key.szValue = szValue;
+	Key.szComment = szComment;
+	Section.KeyIndex.emplace(szKey, Section.Keys.size() - 1);
+
+	return &Key;
+}
+
+// StoreString
+// Keeps a copy of the string passed in for as long as the views on it can be
+// used, see m_Strings. Empty strings aren't stored.
+t_StrView CDataFile::StoreString(t_StrView szStr)
+{
+	if ( szStr.size() == 0 )
+		return t_StrView();
+
+	return m_Strings.emplace_back(szStr);
+}
+
+// ReindexSections
+// Rebuilds the section index from the list.
+void CDataFile::ReindexSections()
+{
+	m_SectionIndex.clear();
+
+	for (size_t nPos = 0; nPos < m_Sections.size(); nPos++)
+		m_SectionIndex.emplace(m_Sections[nPos].szName, nPos);
+}
+
+// ReindexKeys
+// Rebuilds the key index of a section from its key list.
+void CDataFile::ReindexKeys(t_Section& Section)
+{
+	Section.KeyIndex.clear();
+
+	for (size_t nPos = 0; nPos < Section.Keys.size(); nPos++)
+		Section.KeyIndex.emplace(Section.Keys[nPos].szKey, nPos);
 }
 
 
@@ -729,14 +846,46 @@ t_Str GetNextWord(t_Str& CommandLine)
 // CompareNoCase
 // it's amazing what features std::string lacks.  This function simply
 // does a lowercase compare against the two strings, returning 0 if they
-// match.
-int CompareNoCase(t_Str str1, t_Str str2)
+// match. Like _stricmp, but on views so the callers don't have to copy.
+int CompareNoCase(std::string_view str1, std::string_view str2)
 {
-#ifdef WIN32
-	return _stricmp(str1.c_str(), str2.c_str());
-#else
-	return strcasecmp(str1.c_str(), str2.c_str());
-#endif
+	const size_t nLength = str1.size() < str2.size() ? str1.size() : str2.size();
+
+	for (size_t nPos = 0; nPos < nLength; nPos++)
+	{
+		const int c1 = tolower(static_cast<unsigned char>(str1[nPos]));
+		const int c2 = tolower(static_cast<unsigned char>(str2[nPos]));
+
+		if ( c1 != c2 )
+			return c1 - c2;
+	}
+
+	if ( str1.size() == str2.size() )
+		return 0;
+
+	return str1.size() < str2.size() ? -1 : 1;
+}
+
+// NoCaseHash
+// FNV-1a over the lowercased characters, so names differing only in case
+// hash the same.
+size_t NoCaseHash::operator()(std::string_view szStr) const noexcept
+{
+	uint64_t nHash = 14695981039346656037ull;
+
+	for (const char c : szStr)
+	{
+		nHash ^= static_cast<uint64_t>(tolower(static_cast<unsigned char>(c)));
+		nHash *= 1099511628211ull;
+	}
+
+	return static_cast<size_t>(nHash);
+}
+
+// NoCaseEqual
+bool NoCaseEqual::operator()(std::string_view szStr1, std::string_view szStr2) const noexcept
+{
+	return szStr1.size() == szStr2.size() && CompareNoCase(szStr1, szStr2) == 0;
 }
 
 // Trim
@@ -13,10 +13,16 @@
 //
 #pragma once
 
+#ifdef _WIN32
 #include "stdafx.h"
+#endif
+#include <cstdint>
 #include <vector>
+#include <deque>
 #include <fstream>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 using namespace std;
 
@@ -35,8 +41,8 @@ using namespace std;
 
 // MAX_BUFFER_LEN
 // Used simply as a max size of some internal buffers. Determines the maximum
-// length of a line that will be read from or written to the file or the
-// report output.
+// length of a section header or comment written to the file, or of the report
+// output. Lines read and key/value lines written have no limit.
 #define MAX_BUFFER_LEN				512
 
 
@@ -69,6 +75,7 @@ enum e_DebugLevel
 
 
 typedef std::string t_Str;
+typedef std::string_view t_StrView;
 
 // CommentIndicators
 // This constant contains the characters that we check for to determine if a 
@@ -91,22 +98,40 @@ const t_Str EqualIndicators   = t_Str("=:");
 // the head and tail of strings.
 const t_Str WhiteSpace = t_Str(" \t\n\r");
 
+// NoCaseHash / NoCaseEqual
+// Case insensitive (ASCII) hash and compare, used to index the sections and
+// keys by name. Both are transparent, so the indexes can be searched with a
+// std::string_view without building a t_Str first.
+struct NoCaseHash
+{
+	using is_transparent = void;
+	size_t operator()(std::string_view szStr) const noexcept;
+};
+
+struct NoCaseEqual
+{
+	using is_transparent = void;
+	bool operator()(std::string_view szStr1, std::string_view szStr2) const noexcept;
+};
+
+// NameIndex
+// Maps a section or key name to its position in the SectionList / KeyList.
+// The lists keep the file order, the index only speeds up the lookups. The
+// names are views on the same text as the section / key they index.
+typedef std::unordered_map<t_StrView, size_t, NoCaseHash, NoCaseEqual> NameIndex;
+
 // st_key
 // This structure stores the definition of a key. A key is a named identifier
 // that is associated with a value. It may or may not have a comment.  All comments
 // must PRECEDE the key on the line in the config file.
+// The strings are views on text owned by the CDataFile the key belongs to (the
+// loaded file, or the strings passed to the Set/Create methods), they stay
+// valid as long as that CDataFile.
 typedef struct st_key
 {
-	t_Str		szKey;
-	t_Str		szValue;
-	t_Str		szComment;
-
-	st_key()
-	{
-		szKey = t_Str("");
-		szValue = t_Str("");
-		szComment = t_Str("");
-	}
+	t_StrView	szKey;
+	t_StrView	szValue;
+	t_StrView	szComment;
 
 } t_Key;
 
@@ -116,19 +141,13 @@ typedef KeyList::iterator KeyItor;
 // st_section
 // This structure stores the definition of a section. A section contains any number
 // of keys (see st_keys), and may or may not have a comment. Like keys, all
-// comments must precede the section.
+// comments must precede the section. Like keys, the strings are views.
 typedef struct st_section
 {
-	t_Str		szName;
-	t_Str		szComment;
+	t_StrView	szName;
+	t_StrView	szComment;
 	KeyList		Keys;
-
-	st_section()
-	{
-		szName = t_Str("");
-		szComment = t_Str("");
-		Keys.clear();
-	}
+	NameIndex	KeyIndex;		// key name -> position in Keys
 
 } t_Section;
 
@@ -141,7 +160,7 @@ typedef SectionList::iterator SectionItor;
 /////////////////////////////////////////////////////////////////////////////////
 void	Report(e_DebugLevel DebugLevel, const char *fmt, ...);
 t_Str	GetNextWord(t_Str& CommandLine);
-int		CompareNoCase(t_Str str1, t_Str str2);
+int		CompareNoCase(std::string_view str1, std::string_view str2);
 void	Trim(t_Str& szStr);
 int		WriteLn(fstream& stream, const char* fmt, ...);
 
@@ -160,6 +179,10 @@ public:
 				CDataFile();
 				CDataFile(t_Str szFileName);
 	virtual		~CDataFile();
+				// Not copyable: the sections and keys are views on text owned
+				// by the instance.
+				CDataFile(const CDataFile&) = delete;
+	CDataFile&	operator=(const CDataFile&) = delete;
 
 				// File handling methods
 				/////////////////////////////////////////////////////////////////
@@ -171,17 +194,17 @@ public:
 
 				// GetValue: Our default access method. Returns the raw t_Str value
 				// Note that this returns keys specific to the given section only.
-	t_Str		GetValue(t_Str szKey, t_Str szSection = t_Str("")); 
+	t_Str		GetValue(std::string_view szKey, std::string_view szSection = std::string_view()); 
 				// GetString: Returns the value as a t_Str
-	t_Str		GetString(t_Str szKey, t_Str szSection = t_Str("")); 
+	t_Str		GetString(std::string_view szKey, std::string_view szSection = std::string_view()); 
 				// GetFloat: Return the value as a float
-	float		GetFloat(t_Str szKey, t_Str szSection = t_Str(""));
+	float		GetFloat(std::string_view szKey, std::string_view szSection = std::string_view());
 				// GetInt: Return the value as an int
-	int			GetInt(t_Str szKey, t_Str szSection = t_Str(""));
+	int			GetInt(std::string_view szKey, std::string_view szSection = std::string_view());
 				// GetUInt: Return the value as an int
-	uint32_t	GetUInt(t_Str szKey, t_Str szSection = t_Str(""));
+	uint32_t	GetUInt(std::string_view szKey, std::string_view szSection = std::string_view());
 				// GetBool: Return the value as a bool
-	bool		GetBool(t_Str szKey, t_Str szSection = t_Str(""));
+	bool		GetBool(std::string_view szKey, std::string_view szSection = std::string_view());
 
 				// SetValue: Sets the value of a given key. Will create the
 				// key if it is not found and AUTOCREATE_KEYS is active.
@@ -262,10 +285,25 @@ protected:
 				// think carefully before changing this.
 
 				// GetKey: Returns the requested key (if found) from the requested
-				// Section. Returns NULL otherwise.
-	t_Key*		GetKey(t_Str szKey, t_Str szSection);
+				// Section. Returns NULL otherwise. Doesn't allocate.
+	t_Key*		GetKey(std::string_view szKey, std::string_view szSection);
 				// GetSection: Returns the requested section (if found), NULL otherwise.
-	t_Section*	GetSection(t_Str szSection);
+				// Doesn't allocate.
+	t_Section*	GetSection(std::string_view szSection);
+				// AddSection / AddKey: Appends to the lists and their indexes. The
+				// views have to be on text owned by this instance (see StoreString).
+	t_Section*	AddSection(t_StrView szSection, t_StrView szComment);
+	t_Key*		AddKey(t_Section& Section, t_StrView szKey, t_StrView szValue, t_StrView szComment);
+				// StoreString: Copies a string passed in by the caller into
+				// m_Strings and returns a view on the copy.
+	t_StrView	StoreString(t_StrView szStr);
+				// ParseText: Tokenizes the text of a loaded file into sections and
+				// keys. The text has to be owned by this instance.
+	void		ParseText(t_StrView szText);
+				// ReindexSections / ReindexKeys: Rebuild the indexes after an erase
+				// moved the entries behind it.
+	void		ReindexSections();
+	static void	ReindexKeys(t_Section& Section);
 
 
 // Data
@@ -274,6 +312,11 @@ public:
 
 protected:
 	SectionList	m_Sections;		// Our list of sections
+	NameIndex	m_SectionIndex;	// section name -> position in m_Sections
+	std::deque<t_Str>	m_Strings;	// The text the sections and keys are views on: the
+								// loaded file(s) and every string set through the
+								// API. Only freed by Clear, so setting the same key
+								// over and over keeps the old values around.
 	t_Str		m_szFileName;	// The filename to write to
 	bool		m_bDirty;		// Tracks whether or not data has changed.
 };
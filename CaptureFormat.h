@@ -0,0 +1,143 @@
+/// fixed size event records of the frame capture (F1) and the binary capture file they're written to, see FrameCapture
+
+#pragma once
+
+#include <cstdint>
+
+namespace ShaderToggler
+{
+	constexpr uint32_t CAPTURE_FILE_MAGIC = 0x46435453;		// 'STCF'
+	constexpr uint32_t CAPTURE_FILE_VERSION = 2;
+
+	/// <summary>
+	/// The hook an event was recorded in. Values are stored in the capture file, only append new ones. The comments list the args.
+	/// </summary>
+	enum class CaptureEventId : uint16_t
+	{
+		FrameBegin = 1,				// frame index
+		FrameEnd,					// frame index, frame time in ns (present to present)
+		BindPipeline,				// pipeline_stage, shader hash (compute, else vertex, else pixel), pipeline, pixel shader hash, vertex shader hash
+		PipelineReplaced,			// pipeline replaced by its constant color clone
+		InjectPushConstants,		// pipeline_layout
+		Draw,						// vertex_count, instance_count, first_vertex, first_instance
+		DrawIndexed,				// index_count, instance_count, first_index, vertex_offset (int32), first_instance
+		DrawOrDispatchIndirect,		// indirect_command, buffer, offset, draw_count, stride
+		PushDescriptors,			// shader_stage, pipeline_layout, param_index, descriptor_type, binding << 32 | count
+		BindRenderTargets,			// count, dsv, rtv 0, rtv 1, rtv 2
+		BindRenderTargetsContinued,	// index of the first rtv, rtv index, rtv index + 1, rtv index + 2, rtv index + 3 (0 past count)
+		BindViewports,				// first, count
+		ClearRenderTargetView,		// rtv, color[0] | color[1] << 32, color[2] | color[3] << 32 (float bits)
+		ClearDepthStencilView,		// dsv, has depth << 32 | depth (float bits), has stencil << 32 | stencil
+		BindPipelineState,			// dynamic_state, value
+		BindVertexBuffer,			// slot, buffer, offset, stride
+		BindIndexBuffer,			// buffer, offset, index_size
+		Dispatch,					// group_count_x, group_count_y, group_count_z
+		BeginRenderPass,			// count | cleared render targets << 32 | depth stencil cleared << 40, dsv, rtv 0, rtv 1, rtv 2. Continued like BindRenderTargets.
+		EndRenderPass,
+		ReadViews,					// shader_stage | first binding << 32 | descriptor_type << 56 | view count (1 to 4) << 60, view 0, view 1, view 2, view 3
+		ViewAlias,					// view, resource of the view. Recorded per frame and thread before the first event using the view.
+	};
+
+
+	// reshade::api::pipeline_stage bits of BindPipeline, for the tools reading captures without the reshade headers
+	constexpr uint64_t CAPTURE_STAGE_VERTEX_SHADER = 0x8;
+	constexpr uint64_t CAPTURE_STAGE_PIXEL_SHADER = 0x80;
+	constexpr uint64_t CAPTURE_STAGE_COMPUTE_SHADER = 0x800;
+
+
+	/// <summary>
+	/// What started a capture. Values are stored in the capture file, only append new ones.
+	/// </summary>
+	enum class CaptureTrigger : uint16_t
+	{
+		None = 0,
+		Key,				// the capture key
+		FrameTimeSpike,		// a frame took longer than the threshold
+		ShaderBind,			// the first bind of the trigger shader hash
+	};
+
+
+	/// <summary>
+	/// A single captured hook call. 64 bytes, so a record is one cache line and the ring buffers are plain arrays of them.
+	/// </summary>
+	struct CaptureEvent
+	{
+		int64_t timestamp;			// std::chrono::steady_clock ticks, see CaptureFileHeader::ticksPerSecond
+		uint64_t commandList;		// command_list pointer, 0 for the frame markers
+		CaptureEventId eventId;
+		uint16_t reserved;
+		uint32_t threadIndex;		// index of the recording thread's ring, stable for the session
+		uint64_t args[5];			// see CaptureEventId
+	};
+
+
+	/// <summary>
+	/// Header of a .stcap file. Followed by eventCount CaptureEvents sorted by timestamp: the frames kept before the trigger, then the
+	///	frames captured after it. Version 1 files have no trigger and frame counts (0).
+	/// </summary>
+	struct CaptureFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t ticksPerSecond;
+		uint64_t eventCount;
+		uint64_t droppedEventCount;		// events lost because a ring was full or there were too many threads
+		uint32_t captureIndex;			// number of the capture in this session, starting at 0
+		uint32_t threadCount;
+		CaptureTrigger trigger;
+		uint16_t preTriggerFrameCount;	// frames in the file which ended before the trigger, the last one is the frame which triggered a spike
+		uint32_t frameCount;			// frames captured from the trigger on
+	};
+
+	/// <summary>
+	/// Name of the hook of an event, for the exported traces and the capture tools.
+	/// </summary>
+	inline const char* getCaptureEventName(CaptureEventId eventId)
+	{
+		switch(eventId)
+		{
+		case CaptureEventId::FrameBegin: return "frame_begin";
+		case CaptureEventId::FrameEnd: return "frame_end";
+		case CaptureEventId::BindPipeline: return "bind_pipeline";
+		case CaptureEventId::PipelineReplaced: return "pipeline_replaced";
+		case CaptureEventId::InjectPushConstants: return "inject_push_constants";
+		case CaptureEventId::Draw: return "draw";
+		case CaptureEventId::DrawIndexed: return "draw_indexed";
+		case CaptureEventId::DrawOrDispatchIndirect: return "draw_or_dispatch_indirect";
+		case CaptureEventId::PushDescriptors: return "push_descriptors";
+		case CaptureEventId::BindRenderTargets: return "bind_render_targets_and_depth_stencil";
+		case CaptureEventId::BindRenderTargetsContinued: return "bind_render_targets_continued";
+		case CaptureEventId::BindViewports: return "bind_viewports";
+		case CaptureEventId::ClearRenderTargetView: return "clear_render_target_view";
+		case CaptureEventId::ClearDepthStencilView: return "clear_depth_stencil_view";
+		case CaptureEventId::BindPipelineState: return "bind_pipeline_states";
+		case CaptureEventId::BindVertexBuffer: return "bind_vertex_buffers";
+		case CaptureEventId::BindIndexBuffer: return "bind_index_buffer";
+		case CaptureEventId::Dispatch: return "dispatch";
+		case CaptureEventId::BeginRenderPass: return "begin_render_pass";
+		case CaptureEventId::EndRenderPass: return "end_render_pass";
+		case CaptureEventId::ReadViews: return "read_views";
+		case CaptureEventId::ViewAlias: return "view_alias";
+		default: return "unknown";
+		}
+	}
+
+
+	/// <summary>
+	/// Name of a trigger for the log, the overlay and the exported traces.
+	/// </summary>
+	inline const char* getCaptureTriggerName(CaptureTrigger trigger)
+	{
+		switch(trigger)
+		{
+		case CaptureTrigger::Key: return "capture key";
+		case CaptureTrigger::FrameTimeSpike: return "frame time spike";
+		case CaptureTrigger::ShaderBind: return "shader bind";
+		default: return "none";
+		}
+	}
+
+
+	static_assert(sizeof(CaptureEvent) == 64, "CaptureEvent is part of the file format");
+	static_assert(sizeof(CaptureFileHeader) == 48, "CaptureFileHeader is part of the file format");
+}
@@ -2,7 +2,7 @@
 
 #include <reshade.hpp>
 #include "config.hpp"
-#include <sstream>
+#include "Logger.h"
 #include <vector>
 #include <string>
 #include <unordered_map>
@@ -27,8 +27,6 @@ static void clone_pipeline(
         void* data = nullptr;
         size_t size = 0;
     };
-    std::stringstream s;
-
     // flag to know if a code replacement has been done
     bool code_replace = false;
 
@@ -43,12 +41,7 @@ static void clone_pipeline(
     if (PScheck)
     {
         //log beginning of copy
-        s << "CLONING PIPELINE("
-            << reinterpret_cast<void*>(pipeline.handle)
-            << ") Layout : " << reinterpret_cast<void*>(layout.handle)
-            << ", subobjects counts: " << (subobjectCount)
-            << " )";
-       // reshade::log_message(reshade::log_level::info, s.str().c_str());
+        LOG_DEBUG("CLONING PIPELINE(0x%llx) Layout : 0x%llx, subobjects counts: %u )", pipeline.handle, layout.handle, subobjectCount);
 
         // clone subobjects
         reshade::api::pipeline_subobject* newSubobjects = new reshade::api::pipeline_subobject[subobjectCount];
@@ -84,11 +77,7 @@ static void clone_pipeline(
                 code_replace = true;
 
                 //log operation
-                s << "pipeline_subobject Pixel cloned with code replacement ("
-                    << ", object Number: " << std::to_string(i)
-                    << ", pipeline: " << reinterpret_cast<void*>(pipeline.handle)
-                    << ")";
-                // reshade::log_message(reshade::log_level::info, s.str().c_str());
+                LOG_DEBUG("pipeline_subobject Pixel cloned with code replacement (object Number: %u, pipeline: 0x%llx)", i, pipeline.handle);
             }
 
         }
@@ -106,19 +95,12 @@ static void clone_pipeline(
             // Add cloned Pipeline to pipelineCloneMap
             pipelineCloneMap.emplace(pipeline.handle, pipelineClone);
 
-            s << "pipeline  cloned  ("
-                << ", orig pipeline: " << reinterpret_cast<void*>(pipeline.handle)
-                << ", cloned pipeline: " << reinterpret_cast<void*>(pipelineClone.handle)
-                << ")";
-            // reshade::log_message(reshade::log_level::info, s.str().c_str());
+            LOG_DEBUG("pipeline  cloned  (orig pipeline: 0x%llx, cloned pipeline: 0x%llx)", pipeline.handle, pipelineClone.handle);
         }
         else
         {
             // log error
-            s << "********** Error : pipeline not cloned !! ("
-                << ", orig pipeline: " << reinterpret_cast<void*>(pipeline.handle)
-                << ")";
-            reshade::log_message(reshade::log_level::info, s.str().c_str());
+            LOG_WARNING("********** Error : pipeline not cloned !! (orig pipeline: 0x%llx)", pipeline.handle);
         }
     }
 }
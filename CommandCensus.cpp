@@ -0,0 +1,158 @@
+/// per frame counts of the commands the game submits, by kind, per queue, with rolling averages and peaks for the overlay
+
+#include "CommandCensus.h"
+
+namespace ShaderToggler
+{
+	uint32_t CommandCounts::getTotal() const
+	{
+		uint32_t total = 0;
+		for(const uint32_t count : counts)
+		{
+			total += count;
+		}
+		return total;
+	}
+
+
+	uint32_t CommandCensus::registerQueue(uint32_t type)
+	{
+		std::unique_lock lock(_slotMutex);
+		uint32_t queueIndex = 0;
+		while(queueIndex < OverflowQueueIndex && _slotQueueCounts[queueIndex] > 0)
+		{
+			++queueIndex;
+		}
+		QueueCounters& counters = _counters[queueIndex];
+		if(_slotQueueCounts[queueIndex]++ == 0)
+		{
+			// the slot starts over. Nothing executes on it: the queue before was destroyed, this one isn't returned yet.
+			for(auto& count : counters.counts)
+			{
+				count.store(0, std::memory_order_relaxed);
+			}
+			counters.commandLists.store(0, std::memory_order_relaxed);
+			counters.largestCommandList.store(0, std::memory_order_relaxed);
+			counters.type.store(0, std::memory_order_relaxed);
+			_isSlotStartedOver[queueIndex] = true;
+		}
+		counters.type.fetch_or(type, std::memory_order_relaxed);
+		return queueIndex;
+	}
+
+
+	void CommandCensus::unregisterQueue(uint32_t queueIndex)
+	{
+		std::unique_lock lock(_slotMutex);
+		if(queueIndex < SlotCount && _slotQueueCounts[queueIndex] > 0)
+		{
+			--_slotQueueCounts[queueIndex];
+		}
+	}
+
+
+	void CommandCensus::onExecute(uint32_t queueIndex, const CommandCounts& counts)
+	{
+		QueueCounters& counters = _counters[std::min(queueIndex, OverflowQueueIndex)];
+		for(size_t i = 0; i < KindCount; ++i)
+		{
+			if(counts.counts[i] != 0)
+			{
+				counters.counts[i].fetch_add(counts.counts[i], std::memory_order_relaxed);
+			}
+		}
+		counters.commandLists.fetch_add(1, std::memory_order_relaxed);
+		const uint32_t total = counts.getTotal();
+		uint32_t largest = counters.largestCommandList.load(std::memory_order_relaxed);
+		while(total > largest && !counters.largestCommandList.compare_exchange_weak(largest, total, std::memory_order_relaxed))
+		{
+		}
+	}
+
+
+	void CommandCensus::onPresent()
+	{
+		++_frameCount;
+		std::unique_lock lock(_slotMutex);
+		for(uint32_t queueIndex = 0; queueIndex < SlotCount; ++queueIndex)
+		{
+			QueueCounters& counters = _counters[queueIndex];
+			QueueCensus& census = _census[queueIndex];
+			FrameCounts& lastCounts = _lastCounts[queueIndex];
+			FrameCounts& windowSums = _windowSums[queueIndex];
+			if(_isSlotStartedOver[queueIndex])
+			{
+				// a new queue, the counters were cleared: drop the frames, averages and peaks of the queue before
+				_isSlotStartedOver[queueIndex] = false;
+				lastCounts = FrameCounts();
+				windowSums = FrameCounts();
+				_window[queueIndex].fill(FrameCounts());
+				_slotFrameCounts[queueIndex] = 0;
+				census = QueueCensus();
+			}
+			if(_slotQueueCounts[queueIndex] == 0)
+			{
+				// destroyed, or never used
+				census = QueueCensus();
+				continue;
+			}
+			FrameCounts& oldest = _window[queueIndex][_windowIndex];
+			const double windowFrames = static_cast<double>(std::min<uint64_t>(++_slotFrameCounts[queueIndex], WindowFrameCount));
+
+			// the counters only grow, the frame is the difference to the present before
+			FrameCounts frame;
+			for(size_t i = 0; i < KindCount; ++i)
+			{
+				const uint64_t count = counters.counts[i].load(std::memory_order_relaxed);
+				frame.counts[i] = count - lastCounts.counts[i];
+				lastCounts.counts[i] = count;
+				windowSums.counts[i] += frame.counts[i] - oldest.counts[i];
+				census.lastFrame[i] = frame.counts[i];
+				census.average[i] = static_cast<double>(windowSums.counts[i]) / windowFrames;
+				census.peak[i] = std::max(census.peak[i], frame.counts[i]);
+			}
+			const uint64_t commandLists = counters.commandLists.load(std::memory_order_relaxed);
+			frame.commandLists = commandLists - lastCounts.commandLists;
+			lastCounts.commandLists = commandLists;
+			windowSums.commandLists += frame.commandLists - oldest.commandLists;
+			census.lastFrameCommandLists = frame.commandLists;
+			census.averageCommandLists = static_cast<double>(windowSums.commandLists) / windowFrames;
+			census.lastFrameLargestCommandList = counters.largestCommandList.exchange(0, std::memory_order_relaxed);
+			census.type = counters.type.load(std::memory_order_relaxed);
+			census.isActive |= commandLists > 0;
+			oldest = frame;
+		}
+		_windowIndex = (_windowIndex + 1) % WindowFrameCount;
+	}
+
+
+	const char* getCommandKindName(CommandKind kind)
+	{
+		switch(kind)
+		{
+		case CommandKind::Draw:
+			return "Draws";
+		case CommandKind::DrawIndexed:
+			return "Indexed draws";
+		case CommandKind::DrawIndirect:
+			return "Indirect draws";
+		case CommandKind::Dispatch:
+			return "Dispatches";
+		case CommandKind::Barrier:
+			return "Barriers";
+		case CommandKind::Clear:
+			return "Clears";
+		case CommandKind::Copy:
+			return "Copies";
+		case CommandKind::PipelineBind:
+			return "Pipeline binds";
+		case CommandKind::DescriptorBind:
+			return "Descriptor binds";
+		case CommandKind::RenderPassBegin:
+			return "Render passes";
+		case CommandKind::Count:
+			break;
+		}
+		return "?";
+	}
+}
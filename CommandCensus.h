@@ -0,0 +1,139 @@
+/// per frame counts of the commands the game submits, by kind, per queue, with rolling averages and peaks for the overlay
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace ShaderToggler
+{
+	enum class CommandKind : uint32_t
+	{
+		Draw = 0,
+		DrawIndexed,
+		DrawIndirect,			// draw_or_dispatch_indirect of draws, indirect dispatches are counted as Dispatch
+		Dispatch,
+		Barrier,
+		Clear,					// render target, depth stencil and unordered access view clears
+		Copy,					// the copy_* events
+		PipelineBind,
+		DescriptorBind,			// bind_descriptor_tables and push_descriptors
+		RenderPassBegin,
+		Count,
+	};
+
+
+	/// <summary>
+	/// The commands recorded on a command list since it was reset. Lives in the CommandListDataContainer of the list, a command list is only
+	///	recorded by one thread at a time so the counts are plain.
+	/// </summary>
+	struct CommandCounts
+	{
+		std::array<uint32_t, static_cast<size_t>(CommandKind::Count)> counts = {};
+
+		void add(CommandKind kind) { ++counts[static_cast<size_t>(kind)]; }
+		uint32_t get(CommandKind kind) const { return counts[static_cast<size_t>(kind)]; }
+		uint32_t getTotal() const;
+		void reset() { counts = {}; }
+	};
+
+
+	/// <summary>
+	/// What a queue submitted, as of the last present.
+	/// </summary>
+	struct QueueCensus
+	{
+		uint32_t type = 0;										// reshade::api::command_queue_type bits
+		bool isActive = false;									// submitted something since the queue got the slot
+		std::array<uint64_t, static_cast<size_t>(CommandKind::Count)> lastFrame = {};
+		std::array<double, static_cast<size_t>(CommandKind::Count)> average = {};		// per frame, over the last WindowFrameCount frames
+		std::array<uint64_t, static_cast<size_t>(CommandKind::Count)> peak = {};		// the most in a frame since the queue got the slot
+		uint64_t lastFrameCommandLists = 0;
+		double averageCommandLists = 0.0;
+		uint32_t lastFrameLargestCommandList = 0;				// commands in the largest list executed in the last frame
+	};
+
+
+	/// <summary>
+	/// Census of the commands the game submits. The hooks count into the CommandCounts of the command list, without atomics. The counts are added
+	///	to the counters of the queue when the list is executed, and for the immediate command list of D3D9/10/11 and OpenGL at present. The present
+	///	thread turns the counters of the queues into the counts of the last frame, a rolling average over WindowFrameCount frames and the peaks.
+	///
+	///	A queue gets one of MaxQueueCount slots and gives it back when it's destroyed, the next queue starts the slot over: games which create
+	///	their devices or queues again, and every D3D11 device reset, reuse the slots. Queues past MaxQueueCount are counted together in the
+	///	overflow slot, OverflowQueueIndex.
+	/// </summary>
+	class CommandCensus
+	{
+	public:
+		static constexpr uint32_t MaxQueueCount = 8;
+		static constexpr uint32_t OverflowQueueIndex = MaxQueueCount;
+		static constexpr uint32_t WindowFrameCount = 120;
+
+		/// <summary>
+		/// Returns the index the queue's commands are counted with: a free slot, or OverflowQueueIndex if there's none. Thread safe.
+		/// </summary>
+		/// <param name="type">reshade::api::command_queue_type bits, for the overlay</param>
+		/// <returns></returns>
+		uint32_t registerQueue(uint32_t type);
+		/// <summary>
+		/// Gives the slot of a destroyed queue back. It's shown as inactive from the next present on. Thread safe.
+		/// </summary>
+		/// <param name="queueIndex">the index registerQueue returned for the queue</param>
+		void unregisterQueue(uint32_t queueIndex);
+		/// <summary>
+		/// Adds the counts of an executed command list to the queue. Thread safe.
+		/// </summary>
+		/// <param name="queueIndex"></param>
+		/// <param name="counts"></param>
+		void onExecute(uint32_t queueIndex, const CommandCounts& counts);
+		/// <summary>
+		/// Present thread only, like getQueue().
+		/// </summary>
+		void onPresent();
+
+		/// <summary>
+		/// The slots, the overflow slot last. The ones without a queue aren't active.
+		/// </summary>
+		uint32_t getQueueCount() const { return SlotCount; }
+		const QueueCensus& getQueue(uint32_t queueIndex) const { return _census[queueIndex]; }
+		uint64_t getFrameCount() const { return _frameCount; }
+
+	private:
+		static constexpr size_t KindCount = static_cast<size_t>(CommandKind::Count);
+		static constexpr uint32_t SlotCount = MaxQueueCount + 1;
+
+		struct alignas(64) QueueCounters
+		{
+			std::array<std::atomic<uint64_t>, KindCount> counts = {};		// since the queue got the slot
+			std::atomic<uint64_t> commandLists = 0;
+			std::atomic<uint32_t> largestCommandList = 0;				// since the present before
+			std::atomic<uint32_t> type = 0;
+		};
+
+		struct FrameCounts
+		{
+			std::array<uint64_t, KindCount> counts = {};
+			uint64_t commandLists = 0;
+		};
+
+		std::array<QueueCounters, SlotCount> _counters;
+		std::mutex _slotMutex;										// the slot use, and the counters while a slot starts over
+		std::array<uint32_t, SlotCount> _slotQueueCounts = {};			// queues counted in the slot: 0 or 1, any number for the overflow slot
+		std::array<bool, SlotCount> _isSlotStartedOver = {};			// a queue got the slot since the present before
+
+		// present thread
+		std::array<QueueCensus, SlotCount> _census;
+		std::array<FrameCounts, SlotCount> _lastCounts;				// the counters at the present before
+		std::array<FrameCounts, SlotCount> _windowSums;
+		std::array<std::array<FrameCounts, WindowFrameCount>, SlotCount> _window;
+		std::array<uint64_t, SlotCount> _slotFrameCounts = {};			// presents since the queue got the slot
+		uint32_t _windowIndex = 0;
+		uint64_t _frameCount = 0;
+	};
+
+	const char* getCommandKindName(CommandKind kind);
+}
@@ -0,0 +1,111 @@
+/// background writer for ShaderToggler.ini, so saving the toggle groups doesn't stall the present thread
+
+#include "ConfigSaver.h"
+#include <chrono>
+#include <exception>
+
+namespace ShaderToggler
+{
+	ConfigSaver::~ConfigSaver()
+	{
+		// runs at dll unload, under the loader lock: the thread can't be joined here. stop() should have been called before.
+		if(_worker.joinable())
+		{
+			{
+				std::unique_lock lock(_saveMutex);
+				_stopRequested = true;
+			}
+			_saveCondition.notify_all();
+			_worker.detach();
+		}
+	}
+
+
+	void ConfigSaver::requestSave(SaveFunction saveFunction)
+	{
+		{
+			std::unique_lock lock(_saveMutex);
+			_pendingSave = std::move(saveFunction);
+			_status.state = ConfigSaveState::Saving;
+			if(!_isRunning)
+			{
+				// stop() joined the thread it stopped, _worker is empty.
+				_stopRequested = false;
+				_isRunning = true;
+				_worker = std::thread(&ConfigSaver::workerLoop, this);
+			}
+		}
+		_saveCondition.notify_all();
+	}
+
+
+	void ConfigSaver::stop()
+	{
+		std::thread worker;
+		{
+			std::unique_lock lock(_saveMutex);
+			if(!_isRunning)
+			{
+				return;
+			}
+			_stopRequested = true;
+			// taken under the lock: the worker clears _isRunning when it exits, a save requested after that starts a new worker in _worker.
+			worker = std::move(_worker);
+		}
+		_saveCondition.notify_all();
+		if(worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+
+	ConfigSaveStatus ConfigSaver::getStatus()
+	{
+		std::unique_lock lock(_saveMutex);
+		return _status;
+	}
+
+
+	void ConfigSaver::workerLoop()
+	{
+		while(true)
+		{
+			SaveFunction saveFunction;
+			{
+				std::unique_lock lock(_saveMutex);
+				_saveCondition.wait(lock, [this] { return _stopRequested || _pendingSave; });
+				if(!_pendingSave)
+				{
+					// stop requested and everything is written. Decided under the lock, a later requestSave starts a new worker.
+					_isRunning = false;
+					return;
+				}
+				saveFunction = std::move(_pendingSave);
+				_pendingSave = nullptr;
+			}
+
+			std::string error;
+			bool saved = false;
+			const auto startTime = std::chrono::steady_clock::now();
+			try
+			{
+				saved = saveFunction(error);
+			}
+			catch(const std::exception& e)
+			{
+				error = e.what();
+			}
+			const double durationMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+			std::unique_lock lock(_saveMutex);
+			_status.durationMilliseconds = durationMilliseconds;
+			_status.error = saved ? std::string() : (error.empty() ? std::string("unknown error") : error);
+			// a newer request came in while saving: it's still Saving till that one is done.
+			if(!_pendingSave)
+			{
+				_status.state = saved ? ConfigSaveState::Saved : ConfigSaveState::Failed;
+			}
+		}
+	}
+}
@@ -0,0 +1,71 @@
+/// background writer for ShaderToggler.ini, so saving the toggle groups doesn't stall the present thread
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// State of the last save requested, for the UI.
+	/// </summary>
+	enum class ConfigSaveState : int
+	{
+		Idle = 0,		// nothing saved yet this session
+		Saving,			// a save is running or waiting for the thread
+		Saved,
+		Failed,
+	};
+
+
+	struct ConfigSaveStatus
+	{
+		ConfigSaveState state = ConfigSaveState::Idle;
+		double durationMilliseconds = 0.0;		// of the last finished save, serialization included
+		std::string error;						// set when state is Failed
+	};
+
+
+	/// <summary>
+	/// Runs config saves on a background thread. The caller takes a snapshot of what has to be saved on its own thread and passes a function
+	///	which serializes and writes that snapshot. Only the newest request is kept: a request made while another one is still waiting replaces
+	///	it, as it's a newer snapshot of the same file. The thread is started by the first request.
+	/// </summary>
+	class ConfigSaver
+	{
+	public:
+		/// <summary>
+		/// Serializes and writes a snapshot. Runs on the save thread. Returns false and sets error if the file couldn't be written.
+		/// </summary>
+		using SaveFunction = std::function<bool(std::string& error)>;
+
+		~ConfigSaver();
+
+		/// <summary>
+		/// Queues saveFunction to run on the save thread, replacing a request which hasn't started yet. Starts the thread if it's not running.
+		/// </summary>
+		/// <param name="saveFunction"></param>
+		void requestSave(SaveFunction saveFunction);
+		/// <summary>
+		/// Waits till the running and the queued save are done, then stops the save thread. Must not be called from DllMain, as the thread exit
+		///	needs the loader lock. A later requestSave starts the thread again.
+		/// </summary>
+		void stop();
+		ConfigSaveStatus getStatus();
+
+	private:
+		void workerLoop();
+
+		std::mutex _saveMutex;
+		std::condition_variable _saveCondition;
+		std::thread _worker;
+		SaveFunction _pendingSave;		// newest request not picked up by the thread yet
+		bool _isRunning = false;			// cleared by the worker under _saveMutex when it exits
+		bool _stopRequested = false;
+		ConfigSaveStatus _status;
+	};
+}
@@ -0,0 +1,188 @@
+/// binary snapshot of the groups and settings loaded from ShaderToggler.ini, so a start with an unchanged ini doesn't parse it again
+
+#include "ConfigSnapshot.h"
+#include "MappedFile.h"
+#include "crc32_hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		constexpr size_t alignTo4(size_t size)
+		{
+			return (size + 3) & ~static_cast<size_t>(3);
+		}
+
+		template<typename T>
+		void appendBytes(std::vector<uint8_t>& bytes, const T* data, size_t count)
+		{
+			const uint8_t* first = reinterpret_cast<const uint8_t*>(data);
+			bytes.insert(bytes.end(), first, first + count * sizeof(T));
+		}
+	}
+
+
+	bool readIniFileStamp(const std::filesystem::path& iniFileName, IniFileStamp& stamp)
+	{
+		std::error_code ec;
+		const auto writeTime = std::filesystem::last_write_time(iniFileName, ec);
+		if(ec)
+		{
+			return false;
+		}
+		MappedFile iniFile;
+		if(!iniFile.open(iniFileName))
+		{
+			return false;
+		}
+		stamp.size = iniFile.size();
+		stamp.writeTime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+		stamp.contentHash = iniFile.size() > 0 ? compute_crc32(iniFile.data(), iniFile.size()) : 0;
+		return true;
+	}
+
+
+	bool saveConfigSnapshot(const std::filesystem::path& fileName, const IniFileStamp& iniStamp, const ShaderTogglerSettings& settings, std::vector<ToggleGroupSnapshot>& groups)
+	{
+		ConfigSnapshotHeader header = {};
+		header.magic = CONFIG_SNAPSHOT_MAGIC;
+		header.version = CONFIG_SNAPSHOT_VERSION;
+		header.iniSize = iniStamp.size;
+		header.iniWriteTime = iniStamp.writeTime;
+		header.iniContentHash = iniStamp.contentHash;
+		header.groupCount = static_cast<uint32_t>(groups.size());
+		header.shaderDumpLayout = settings.shaderDumpLayout;
+		header.shaderDumpPolicy = settings.shaderDumpPolicy;
+		header.shaderDumpCompressed = settings.shaderDumpCompressed ? 1 : 0;
+		header.writeLegacyHashKeys = settings.writeLegacyHashKeys ? 1 : 0;
+		header.savedJournalId = settings.savedJournalId;
+		header.savedJournalSequence = settings.savedJournalSequence;
+
+		std::vector<uint8_t> bytes;
+		appendBytes(bytes, &header, 1);
+		appendBytes(bytes, settings.commandKeys.data(), settings.commandKeys.size());
+		for(auto& group : groups)
+		{
+			std::sort(group.vertexShaderHashes.begin(), group.vertexShaderHashes.end());
+			std::sort(group.pixelShaderHashes.begin(), group.pixelShaderHashes.end());
+			std::sort(group.computeShaderHashes.begin(), group.computeShaderHashes.end());
+			ConfigSnapshotGroupHeader groupHeader = {};
+			groupHeader.toggleKey = group.toggleKey;
+			groupHeader.isActiveAtStartup = group.isActiveAtStartup ? 1 : 0;
+			groupHeader.nameLength = static_cast<uint16_t>(std::min<size_t>(group.name.size(), UINT16_MAX));
+			groupHeader.vertexShaderHashCount = static_cast<uint32_t>(group.vertexShaderHashes.size());
+			groupHeader.pixelShaderHashCount = static_cast<uint32_t>(group.pixelShaderHashes.size());
+			groupHeader.computeShaderHashCount = static_cast<uint32_t>(group.computeShaderHashes.size());
+			appendBytes(bytes, &groupHeader, 1);
+			appendBytes(bytes, group.name.data(), groupHeader.nameLength);
+			bytes.resize(alignTo4(bytes.size()), 0);
+			appendBytes(bytes, group.vertexShaderHashes.data(), group.vertexShaderHashes.size());
+			appendBytes(bytes, group.pixelShaderHashes.data(), group.pixelShaderHashes.size());
+			appendBytes(bytes, group.computeShaderHashes.data(), group.computeShaderHashes.size());
+		}
+		const uint32_t crc = compute_crc32(bytes.data(), bytes.size());
+		appendBytes(bytes, &crc, 1);
+
+		std::filesystem::path tempFileName = fileName;
+		tempFileName += ".tmp";
+		{
+			std::ofstream snapshotFile(tempFileName, std::ios::binary | std::ios::trunc);
+			if(!snapshotFile.is_open())
+			{
+				return false;
+			}
+			snapshotFile.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+			if(!snapshotFile.good())
+			{
+				snapshotFile.close();
+				std::error_code ec;
+				std::filesystem::remove(tempFileName, ec);
+				return false;
+			}
+		}
+		std::error_code ec;
+		std::filesystem::rename(tempFileName, fileName, ec);
+		if(ec)
+		{
+			std::filesystem::remove(tempFileName, ec);
+			return false;
+		}
+		return true;
+	}
+
+
+	bool loadConfigSnapshot(const std::filesystem::path& fileName, const IniFileStamp& iniStamp, ShaderTogglerSettings& settings, std::vector<ToggleGroup>& groups)
+	{
+		MappedFile snapshotFile;
+		constexpr size_t commandKeysSize = KEY_COMMAND_COUNT * sizeof(uint32_t);
+		if(!snapshotFile.open(fileName) || snapshotFile.size() < sizeof(ConfigSnapshotHeader) + commandKeysSize + sizeof(uint32_t))
+		{
+			return false;
+		}
+		const uint8_t* data = snapshotFile.data();
+		const size_t size = snapshotFile.size() - sizeof(uint32_t);
+		ConfigSnapshotHeader header;
+		std::memcpy(&header, data, sizeof(header));
+		const IniFileStamp snapshotStamp = { header.iniSize, header.iniWriteTime, header.iniContentHash };
+		if(header.magic != CONFIG_SNAPSHOT_MAGIC || header.version != CONFIG_SNAPSHOT_VERSION || snapshotStamp != iniStamp)
+		{
+			return false;
+		}
+		uint32_t crc;
+		std::memcpy(&crc, data + size, sizeof(crc));
+		if(compute_crc32(data, size) != crc)
+		{
+			return false;
+		}
+
+		// the mapping is page aligned and every hash array starts at a multiple of 4, the hashes are read in place.
+		std::vector<ToggleGroup> loadedGroups;
+		loadedGroups.reserve(header.groupCount);
+		std::array<uint32_t, KEY_COMMAND_COUNT> commandKeys;
+		std::memcpy(commandKeys.data(), data + sizeof(ConfigSnapshotHeader), commandKeysSize);
+		size_t offset = sizeof(ConfigSnapshotHeader) + commandKeysSize;
+		for(uint32_t groupIndex = 0; groupIndex < header.groupCount; ++groupIndex)
+		{
+			if(offset + sizeof(ConfigSnapshotGroupHeader) > size)
+			{
+				return false;
+			}
+			ConfigSnapshotGroupHeader groupHeader;
+			std::memcpy(&groupHeader, data + offset, sizeof(groupHeader));
+			offset += sizeof(groupHeader);
+			const size_t hashCount = static_cast<size_t>(groupHeader.vertexShaderHashCount) + groupHeader.pixelShaderHashCount + groupHeader.computeShaderHashCount;
+			const size_t namePaddedLength = alignTo4(groupHeader.nameLength);
+			if(offset + namePaddedLength > size || hashCount > (size - offset - namePaddedLength) / sizeof(uint32_t))
+			{
+				return false;
+			}
+			ToggleGroup& group = loadedGroups.emplace_back("", ToggleGroup::getNewGroupId());
+			group.restoreState(std::string(reinterpret_cast<const char*>(data + offset), groupHeader.nameLength), groupHeader.toggleKey, groupHeader.isActiveAtStartup != 0);
+			offset += namePaddedLength;
+			const uint32_t* hashes = reinterpret_cast<const uint32_t*>(data + offset);
+			group.setShaderHashes(ShaderStage::Vertex, hashes, groupHeader.vertexShaderHashCount);
+			hashes += groupHeader.vertexShaderHashCount;
+			group.setShaderHashes(ShaderStage::Pixel, hashes, groupHeader.pixelShaderHashCount);
+			hashes += groupHeader.pixelShaderHashCount;
+			group.setShaderHashes(ShaderStage::Compute, hashes, groupHeader.computeShaderHashCount);
+			offset += hashCount * sizeof(uint32_t);
+		}
+		if(offset != size)
+		{
+			return false;
+		}
+
+		settings.shaderDumpLayout = header.shaderDumpLayout;
+		settings.shaderDumpPolicy = header.shaderDumpPolicy;
+		settings.shaderDumpCompressed = header.shaderDumpCompressed != 0;
+		settings.writeLegacyHashKeys = header.writeLegacyHashKeys != 0;
+		settings.savedJournalId = header.savedJournalId;
+		settings.savedJournalSequence = header.savedJournalSequence;
+		settings.commandKeys = commandKeys;
+		groups.insert(groups.end(), std::make_move_iterator(loadedGroups.begin()), std::make_move_iterator(loadedGroups.end()));
+		return true;
+	}
+}
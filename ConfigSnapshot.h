@@ -0,0 +1,121 @@
+/// binary snapshot of the groups and settings loaded from ShaderToggler.ini, so a start with an unchanged ini doesn't parse it again
+
+#pragma once
+
+#include "KeyBindings.h"
+#include "ToggleGroup.h"
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace ShaderToggler
+{
+	constexpr uint32_t CONFIG_SNAPSHOT_MAGIC = 0x53435453;		// 'STCS'
+	constexpr uint32_t CONFIG_SNAPSHOT_VERSION = 2;
+
+	/// <summary>
+	/// Identifies the ini a snapshot was made from: it's only used if the ini still has the same size, modification time and content.
+	/// </summary>
+	struct IniFileStamp
+	{
+		uint64_t size = 0;
+		int64_t writeTime = 0;			// std::filesystem::file_time_type ticks
+		uint32_t contentHash = 0;		// crc32 of the file
+
+		bool operator==(const IniFileStamp&) const = default;
+	};
+
+
+	/// <summary>
+	/// The General and KeyBindings sections of the ini.
+	/// </summary>
+	struct ShaderTogglerSettings
+	{
+		int32_t shaderDumpLayout = INT_MIN;		// INT_MIN if not in the ini
+		int32_t shaderDumpPolicy = INT_MIN;
+		bool shaderDumpCompressed = false;
+		bool writeLegacyHashKeys = false;
+		uint64_t savedJournalId = 0;			// id of the edit journal the ini was saved with, 0 if none
+		uint64_t savedJournalSequence = 0;		// sequence of the last journaled edit the ini contains
+		std::array<uint32_t, KEY_COMMAND_COUNT> commandKeys = getDefaultCommandKeys();		// per KeyCommand, in the ini format
+
+		static std::array<uint32_t, KEY_COMMAND_COUNT> getDefaultCommandKeys()
+		{
+			std::array<uint32_t, KEY_COMMAND_COUNT> keys;
+			for(size_t i = 0; i < KEY_COMMAND_COUNT; ++i)
+			{
+				keys[i] = KEY_COMMANDS[i].defaultKey;
+			}
+			return keys;
+		}
+	};
+
+
+	/// <summary>
+	/// Header at the start of the snapshot. Followed by the KEY_COMMAND_COUNT command keys and groupCount groups, each a ConfigSnapshotGroupHeader, the name padded to 4 bytes and
+	///	the sorted vertex, pixel and compute shader hashes. The file ends with the crc32 of everything before it.
+	/// </summary>
+	struct ConfigSnapshotHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t iniSize;
+		int64_t iniWriteTime;
+		uint32_t iniContentHash;
+		uint32_t groupCount;
+		int32_t shaderDumpLayout;
+		int32_t shaderDumpPolicy;
+		uint8_t shaderDumpCompressed;
+		uint8_t writeLegacyHashKeys;
+		uint16_t reserved1;
+		uint32_t reserved2;
+		uint64_t savedJournalId;
+		uint64_t savedJournalSequence;
+	};
+
+
+	struct ConfigSnapshotGroupHeader
+	{
+		uint32_t toggleKey;					// KeyData::getKeyForIniFile
+		uint8_t isActiveAtStartup;
+		uint8_t reserved;
+		uint16_t nameLength;
+		uint32_t vertexShaderHashCount;
+		uint32_t pixelShaderHashCount;
+		uint32_t computeShaderHashCount;
+	};
+
+	static_assert(sizeof(ConfigSnapshotHeader) == 64, "ConfigSnapshotHeader is part of the file format");
+	static_assert(sizeof(ConfigSnapshotGroupHeader) == 20, "ConfigSnapshotGroupHeader is part of the file format");
+
+	/// <summary>
+	/// Fills stamp for the ini passed in. Reads the whole file for the content hash, which is still far cheaper than parsing it. Returns false
+	///	if the file can't be read.
+	/// </summary>
+	/// <param name="iniFileName"></param>
+	/// <param name="stamp"></param>
+	/// <returns></returns>
+	bool readIniFileStamp(const std::filesystem::path& iniFileName, IniFileStamp& stamp);
+	/// <summary>
+	/// Writes the groups and settings as a snapshot of the ini with the stamp passed in. Written to a temporary file which replaces the
+	///	snapshot, so a reader never sees half a snapshot. The hash vectors of the groups are sorted in place.
+	/// </summary>
+	/// <param name="fileName"></param>
+	/// <param name="iniStamp"></param>
+	/// <param name="settings"></param>
+	/// <param name="groups"></param>
+	/// <returns></returns>
+	bool saveConfigSnapshot(const std::filesystem::path& fileName, const IniFileStamp& iniStamp, const ShaderTogglerSettings& settings, std::vector<ToggleGroupSnapshot>& groups);
+	/// <summary>
+	/// Maps the snapshot and, if it was made from the ini with the stamp passed in and isn't damaged, appends its groups to groups and fills settings.
+	///	Returns false and leaves both untouched otherwise, the ini has to be parsed then.
+	/// </summary>
+	/// <param name="fileName"></param>
+	/// <param name="iniStamp"></param>
+	/// <param name="settings"></param>
+	/// <param name="groups"></param>
+	/// <returns></returns>
+	bool loadConfigSnapshot(const std::filesystem::path& fileName, const IniFileStamp& iniStamp, ShaderTogglerSettings& settings, std::vector<ToggleGroup>& groups);
+}
@@ -0,0 +1,414 @@
+/// append-only journal of the toggle group edits, so edits made since the last save of ShaderToggler.ini survive a crash
+
+#include "EditJournal.h"
+#include "MappedFile.h"
+#include "crc32_hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		// file layout (little endian):
+		//	header: "STJR", uint32 version, uint64 journal id
+		//	records: uint32 payload size, uint32 crc32 of the payload, payload
+		//	payload: uint64 sequence, uint8 operation, uint8 stage, uint16 0, uint32 group index, uint32 value, text (rest of the payload)
+		constexpr char JournalMagic[4] = { 'S', 'T', 'J', 'R' };
+		constexpr uint32_t JournalVersion = 1;
+		constexpr size_t HeaderSize = 16;
+		constexpr size_t RecordHeaderSize = 8;
+		constexpr size_t PayloadFixedSize = 20;
+		constexpr size_t MaxTextSize = 4096;
+
+		template<typename T>
+		void writeValue(std::vector<uint8_t>& bytes, T value)
+		{
+			const size_t offset = bytes.size();
+			bytes.resize(offset + sizeof(T));
+			std::memcpy(bytes.data() + offset, &value, sizeof(T));
+		}
+
+		template<typename T>
+		T readValue(const uint8_t* data)
+		{
+			T value;
+			std::memcpy(&value, data, sizeof(T));
+			return value;
+		}
+
+		std::FILE* openFile(const std::filesystem::path& fileName, bool append)
+		{
+#ifdef _WIN32
+			return _wfopen(fileName.c_str(), append ? L"ab" : L"wb");
+#else
+			return std::fopen(fileName.c_str(), append ? "ab" : "wb");
+#endif
+		}
+
+		bool syncFile(std::FILE* file)
+		{
+			if(std::fflush(file) != 0)
+			{
+				return false;
+			}
+#ifdef _WIN32
+			return _commit(_fileno(file)) == 0;
+#else
+			return fsync(fileno(file)) == 0;
+#endif
+		}
+	}
+
+
+	EditJournal::~EditJournal()
+	{
+		// runs at dll unload, under the loader lock: the thread can't be joined here. stop() should have been called before.
+		if(_worker.joinable())
+		{
+			{
+				std::unique_lock lock(_journalMutex);
+				_stopRequested = true;
+			}
+			_journalCondition.notify_all();
+			_worker.detach();
+		}
+		else
+		{
+			closeFile();
+		}
+	}
+
+
+	std::vector<JournalRecord> EditJournal::open(const std::filesystem::path& fileName, uint64_t savedJournalId, uint64_t savedSequence)
+	{
+		std::vector<JournalRecord> toReplay;
+		_fileName = fileName;
+		_records.clear();
+		_rewriteRequired = false;
+		_journalId = 0;
+
+		MappedFile file;
+		size_t validSize = 0;
+		size_t fileSize = 0;
+		uint64_t lastSequence = 0;
+		if(file.open(fileName) && file.size() >= HeaderSize && std::memcmp(file.data(), JournalMagic, sizeof(JournalMagic)) == 0 &&
+		   readValue<uint32_t>(file.data() + 4) == JournalVersion)
+		{
+			_journalId = readValue<uint64_t>(file.data() + 8);
+			fileSize = file.size();
+			validSize = HeaderSize;
+		}
+		if(_journalId != 0 && savedJournalId != 0 && _journalId != savedJournalId)
+		{
+			// the ini was saved with another journal (e.g. restored from a backup): these records weren't made on top of it.
+			_journalId = 0;
+		}
+		if(_journalId != 0)
+		{
+			const uint8_t* data = file.data();
+			while(validSize + RecordHeaderSize <= fileSize)
+			{
+				const uint32_t payloadSize = readValue<uint32_t>(data + validSize);
+				const uint32_t crc = readValue<uint32_t>(data + validSize + 4);
+				if(payloadSize < PayloadFixedSize || payloadSize > PayloadFixedSize + MaxTextSize || validSize + RecordHeaderSize + payloadSize > fileSize)
+				{
+					break;
+				}
+				const uint8_t* payload = data + validSize + RecordHeaderSize;
+				if(compute_crc32(payload, payloadSize) != crc)
+				{
+					break;
+				}
+				JournalRecord record;
+				record.sequence = readValue<uint64_t>(payload);
+				if(record.sequence <= lastSequence)
+				{
+					break;
+				}
+				record.operation = static_cast<JournalOperation>(payload[8]);
+				record.stage = static_cast<ShaderStage>(payload[9]);
+				record.groupIndex = readValue<uint32_t>(payload + 12);
+				record.value = readValue<uint32_t>(payload + 16);
+				record.text.assign(reinterpret_cast<const char*>(payload + PayloadFixedSize), payloadSize - PayloadFixedSize);
+				lastSequence = record.sequence;
+
+				const size_t recordSize = RecordHeaderSize + payloadSize;
+				if(savedJournalId == 0 || record.sequence > savedSequence)
+				{
+					_records.push_back({ record.sequence, std::vector<uint8_t>(data + validSize, data + validSize + recordSize) });
+					toReplay.push_back(std::move(record));
+				}
+				else
+				{
+					// already in the ini, a crash came between saving the ini and compacting the journal.
+					_rewriteRequired = true;
+				}
+				validSize += recordSize;
+			}
+			if(validSize != fileSize)
+			{
+				// torn or corrupt tail: the records before it are kept, the file is rewritten without it before anything is appended.
+				_rewriteRequired = true;
+			}
+		}
+		else
+		{
+			_journalId = createJournalId();
+			_rewriteRequired = true;
+		}
+		file.close();
+
+		std::unique_lock lock(_journalMutex);
+		_lastSequence = (savedJournalId == _journalId) ? std::max(lastSequence, savedSequence) : lastSequence;
+		_savedSequence = (savedJournalId == _journalId) ? savedSequence : 0;
+		_saveRequestedSequence = _savedSequence;
+		_lastAppendTime = std::chrono::steady_clock::now();
+		return toReplay;
+	}
+
+
+	void EditJournal::append(JournalRecord record)
+	{
+		{
+			std::unique_lock lock(_journalMutex);
+			record.sequence = ++_lastSequence;
+			if(record.text.size() > MaxTextSize)
+			{
+				record.text.resize(MaxTextSize);
+			}
+			_pendingRecords.push_back(encodeRecord(record));
+			_lastAppendTime = std::chrono::steady_clock::now();
+			startWorker();
+		}
+		_journalCondition.notify_all();
+	}
+
+
+	bool EditJournal::isIdleWithUnsavedEdits(std::chrono::steady_clock::duration idleTime)
+	{
+		std::unique_lock lock(_journalMutex);
+		return _lastSequence > _saveRequestedSequence && std::chrono::steady_clock::now() - _lastAppendTime >= idleTime;
+	}
+
+
+	uint64_t EditJournal::beginSave()
+	{
+		std::unique_lock lock(_journalMutex);
+		_saveRequestedSequence = _lastSequence;
+		return _lastSequence;
+	}
+
+
+	void EditJournal::compact(uint64_t savedSequence)
+	{
+		{
+			std::unique_lock lock(_journalMutex);
+			if(savedSequence <= _savedSequence)
+			{
+				return;
+			}
+			_savedSequence = savedSequence;
+			_compactRequested = true;
+			startWorker();
+		}
+		_journalCondition.notify_all();
+	}
+
+
+	void EditJournal::stop()
+	{
+		std::thread worker;
+		{
+			std::unique_lock lock(_journalMutex);
+			if(!_isRunning)
+			{
+				return;
+			}
+			_stopRequested = true;
+			// taken under the lock: the worker clears _isRunning when it exits, an edit recorded after that starts a new worker in _worker.
+			worker = std::move(_worker);
+		}
+		_journalCondition.notify_all();
+		if(worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+
+	EditJournal::EncodedRecord EditJournal::encodeRecord(const JournalRecord& record)
+	{
+		EncodedRecord encoded;
+		encoded.sequence = record.sequence;
+		std::vector<uint8_t>& bytes = encoded.bytes;
+		const uint32_t payloadSize = static_cast<uint32_t>(PayloadFixedSize + record.text.size());
+		bytes.reserve(RecordHeaderSize + payloadSize);
+		writeValue<uint32_t>(bytes, payloadSize);
+		writeValue<uint32_t>(bytes, 0);		// crc, set below
+		writeValue<uint64_t>(bytes, record.sequence);
+		writeValue<uint8_t>(bytes, static_cast<uint8_t>(record.operation));
+		writeValue<uint8_t>(bytes, static_cast<uint8_t>(record.stage));
+		writeValue<uint16_t>(bytes, 0);
+		writeValue<uint32_t>(bytes, record.groupIndex);
+		writeValue<uint32_t>(bytes, record.value);
+		bytes.insert(bytes.end(), record.text.begin(), record.text.end());
+		const uint32_t crc = compute_crc32(bytes.data() + RecordHeaderSize, payloadSize);
+		std::memcpy(bytes.data() + 4, &crc, sizeof(crc));
+		return encoded;
+	}
+
+
+	uint64_t EditJournal::createJournalId()
+	{
+		std::random_device random;
+		uint64_t journalId = 0;
+		while(journalId == 0)
+		{
+			journalId = (static_cast<uint64_t>(random()) << 32) ^ random();
+		}
+		return journalId;
+	}
+
+
+	void EditJournal::startWorker()
+	{
+		// _journalMutex is held by the caller
+		if(_isRunning)
+		{
+			return;
+		}
+		// stop() joined the thread it stopped, _worker is empty.
+		_stopRequested = false;
+		_isRunning = true;
+		_worker = std::thread(&EditJournal::workerLoop, this);
+	}
+
+
+	void EditJournal::workerLoop()
+	{
+		std::unique_lock lock(_journalMutex);
+		while(true)
+		{
+			_journalCondition.wait(lock, [this] { return _stopRequested || _compactRequested || !_pendingRecords.empty(); });
+			if(!_stopRequested && !_compactRequested)
+			{
+				// batch: the edits made in the next SyncInterval are written with the same sync.
+				_journalCondition.wait_for(lock, SyncInterval, [this] { return _stopRequested || _compactRequested; });
+			}
+			if(_pendingRecords.empty() && !_compactRequested)
+			{
+				// stop requested and everything is written. Decided under the lock, a later edit starts a new worker, which opens the
+				// file again.
+				closeFile();
+				_isRunning = false;
+				return;
+			}
+			std::vector<EncodedRecord> toWrite = std::move(_pendingRecords);
+			_pendingRecords.clear();
+			const bool compactRequested = _compactRequested;
+			const uint64_t savedSequence = _savedSequence;
+			_compactRequested = false;
+			lock.unlock();
+
+			if(compactRequested)
+			{
+				std::erase_if(_records, [savedSequence](const EncodedRecord& record) { return record.sequence <= savedSequence; });
+				_rewriteRequired = true;
+			}
+			if(!_rewriteRequired && !appendToFile(toWrite))
+			{
+				// the file is in an unknown state after a failed write, the next batch rewrites it from _records.
+				_rewriteRequired = true;
+			}
+			for(auto& record : toWrite)
+			{
+				if(record.sequence > savedSequence)
+				{
+					_records.push_back(std::move(record));
+				}
+			}
+			if(_rewriteRequired)
+			{
+				_rewriteRequired = !rewriteFile();
+			}
+			lock.lock();
+		}
+	}
+
+
+	bool EditJournal::appendToFile(const std::vector<EncodedRecord>& records)
+	{
+		if(nullptr == _file)
+		{
+			_file = openFile(_fileName, true);
+			if(nullptr == _file)
+			{
+				return false;
+			}
+		}
+		bool written = true;
+		for(const auto& record : records)
+		{
+			written = written && std::fwrite(record.bytes.data(), 1, record.bytes.size(), _file) == record.bytes.size();
+		}
+		if(!written || !syncFile(_file))
+		{
+			closeFile();
+			return false;
+		}
+		return true;
+	}
+
+
+	bool EditJournal::rewriteFile()
+	{
+		closeFile();
+		std::filesystem::path tempFileName = _fileName;
+		tempFileName += ".tmp";
+		std::FILE* file = openFile(tempFileName, false);
+		if(nullptr == file)
+		{
+			return false;
+		}
+		std::vector<uint8_t> header;
+		header.insert(header.end(), std::begin(JournalMagic), std::end(JournalMagic));
+		writeValue<uint32_t>(header, JournalVersion);
+		writeValue<uint64_t>(header, _journalId);
+		bool written = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+		for(const auto& record : _records)
+		{
+			written = written && std::fwrite(record.bytes.data(), 1, record.bytes.size(), file) == record.bytes.size();
+		}
+		written = syncFile(file) && written;
+		std::fclose(file);
+		std::error_code errorCode;
+		if(written)
+		{
+			std::filesystem::rename(tempFileName, _fileName, errorCode);
+		}
+		if(!written || errorCode)
+		{
+			std::filesystem::remove(tempFileName, errorCode);
+			return false;
+		}
+		return true;
+	}
+
+
+	void EditJournal::closeFile()
+	{
+		if(nullptr != _file)
+		{
+			std::fclose(_file);
+			_file = nullptr;
+		}
+	}
+}
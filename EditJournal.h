@@ -0,0 +1,141 @@
+/// append-only journal of the toggle group edits, so edits made since the last save of ShaderToggler.ini survive a crash
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ToggleGroup.h"
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// Edit operations stored in the journal. Values are stored in the file, only append new ones.
+	/// </summary>
+	enum class JournalOperation : uint8_t
+	{
+		CreateGroup = 1,		// a default group is appended, see addDefaultGroup
+		DeleteGroup,
+		Rename,					// text: the new name
+		Rebind,					// value: the new toggle key, as stored in the ini (KeyData::getKeyForIniFile)
+		SetActiveAtStartup,		// value: 0 or 1
+		Mark,					// stage, value: the shader hash added to the group
+		Unmark,					// stage, value: the shader hash removed from the group
+	};
+
+
+	/// <summary>
+	/// A single edit of the toggle groups. The group is identified by its position in the list of groups at the moment of the edit: the ids
+	///	of the groups aren't stored in the ini, and replaying the edits in order on the groups of the ini gives the same positions again.
+	/// </summary>
+	struct JournalRecord
+	{
+		uint64_t sequence = 0;		// set by EditJournal::append, increasing over the lifetime of the journal file
+		JournalOperation operation = JournalOperation::CreateGroup;
+		ShaderStage stage = ShaderStage::None;
+		uint32_t groupIndex = 0;
+		uint32_t value = 0;
+		std::string text;
+	};
+
+
+	/// <summary>
+	/// Writes the edits to the toggle groups to an append-only binary file, so they don't have to wait for the full ini to be saved. Appending
+	///	only queues the record, a background thread writes the queued records and syncs the file to disk once per batch, at most every
+	///	SyncInterval. Each record carries a crc32, a record torn by a crash is dropped when the journal is read back.
+	///
+	///	The ini stores the id of the journal and the sequence of the last record it contains. Once the ini is saved, the records up to that
+	///	sequence are dropped from the journal (compaction). At startup the records after it are replayed on the groups loaded from the ini.
+	///	The thread is started by the first write, so open() can run from DllMain.
+	/// </summary>
+	class EditJournal
+	{
+	public:
+		static constexpr std::chrono::milliseconds SyncInterval = std::chrono::milliseconds(250);
+
+		~EditJournal();
+
+		/// <summary>
+		/// Reads the journal file and returns the records the ini doesn't contain yet, in the order they were made. savedJournalId and
+		///	savedSequence are the values stored in the ini: if the ini was saved with another journal, the records in the file are dropped and a new
+		///	journal is started. If the ini doesn't know a journal (0), all records are returned. A missing or unreadable file starts a new journal.
+		/// </summary>
+		/// <param name="fileName"></param>
+		/// <param name="savedJournalId"></param>
+		/// <param name="savedSequence"></param>
+		/// <returns></returns>
+		std::vector<JournalRecord> open(const std::filesystem::path& fileName, uint64_t savedJournalId, uint64_t savedSequence);
+		/// <summary>
+		/// Assigns the next sequence to the record and queues it for the journal thread. Starts the thread if it's not running.
+		/// </summary>
+		/// <param name="record"></param>
+		void append(JournalRecord record);
+		/// <summary>
+		/// Returns true if there are edits the ini doesn't contain, the last one made at least idleTime ago, and no save was requested for them yet.
+		/// </summary>
+		/// <param name="idleTime"></param>
+		/// <returns></returns>
+		bool isIdleWithUnsavedEdits(std::chrono::steady_clock::duration idleTime);
+		/// <summary>
+		/// Called when the snapshot of the groups for the ini is taken: returns the sequence of the last record, which is the one the ini has to store.
+		/// </summary>
+		/// <returns></returns>
+		uint64_t beginSave();
+		/// <summary>
+		/// Called once the ini containing everything up to savedSequence is written: the journal thread drops these records from the file.
+		///	Can be called from any thread.
+		/// </summary>
+		/// <param name="savedSequence"></param>
+		void compact(uint64_t savedSequence);
+		/// <summary>
+		/// Writes and syncs the queued records, then stops the journal thread. Must not be called from DllMain, see ConfigSaver::stop.
+		/// </summary>
+		void stop();
+		uint64_t getJournalId() const { return _journalId; }
+
+	private:
+		/// <summary>
+		/// A record as stored in the file, kept after it's written so compaction can rewrite the records the ini doesn't contain.
+		/// </summary>
+		struct EncodedRecord
+		{
+			uint64_t sequence;
+			std::vector<uint8_t> bytes;
+		};
+
+		static EncodedRecord encodeRecord(const JournalRecord& record);
+		static uint64_t createJournalId();
+		void startWorker();
+		void workerLoop();
+		bool appendToFile(const std::vector<EncodedRecord>& records);
+		bool rewriteFile();
+		void closeFile();
+
+		std::filesystem::path _fileName;
+		uint64_t _journalId = 0;
+
+		std::mutex _journalMutex;
+		std::condition_variable _journalCondition;
+		std::thread _worker;
+		std::vector<EncodedRecord> _pendingRecords;		// appended, not picked up by the thread yet
+		uint64_t _lastSequence = 0;
+		uint64_t _saveRequestedSequence = 0;				// sequence passed to the ini by the last beginSave
+		uint64_t _savedSequence = 0;						// sequence the ini on disk contains
+		bool _compactRequested = false;
+		std::chrono::steady_clock::time_point _lastAppendTime;
+		bool _isRunning = false;			// cleared by the worker under _journalMutex when it exits
+		bool _stopRequested = false;
+
+		// owned by the journal thread (and by open(), before the thread runs)
+		std::vector<EncodedRecord> _records;		// records in the file, the ini doesn't contain
+		std::FILE* _file = nullptr;					// open for appending
+		bool _rewriteRequired = false;				// the file is missing, from another journal or has a torn tail: it's rewritten before appending
+	};
+}
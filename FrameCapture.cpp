@@ -0,0 +1,507 @@
+/// records the hook calls of captured frames into per-thread ring buffers, formatted and written by a background thread after the capture
+
+#include "FrameCapture.h"
+#include "TraceExport.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		int64_t getTimestamp()
+		{
+			return std::chrono::steady_clock::now().time_since_epoch().count();
+		}
+	}
+
+
+	FrameCapture::~FrameCapture()
+	{
+		// runs at dll unload, under the loader lock: the thread can't be joined here. stop() should have been called before.
+		if(_worker.joinable())
+		{
+			{
+				std::unique_lock lock(_captureMutex);
+				_stopRequested = true;
+			}
+			_captureCondition.notify_all();
+			_worker.detach();
+		}
+	}
+
+
+	void FrameCapture::setOutput(const std::filesystem::path& captureFolder, CaptureEventFormatter formatter, CaptureLogWriter logWriter)
+	{
+		std::unique_lock lock(_captureMutex);
+		_captureFolder = captureFolder;
+		_formatter = formatter;
+		_logWriter = logWriter;
+	}
+
+
+	bool FrameCapture::isBusy()
+	{
+		std::unique_lock lock(_captureMutex);
+		return _isWriting;
+	}
+
+
+	void FrameCapture::arm()
+	{
+		if(_mode != CaptureMode::Idle)
+		{
+			return;
+		}
+		_activeSettings = _triggerSettings;
+		_activeSettings.frameCount = std::max(_activeSettings.frameCount, 1u);
+		_mode = CaptureMode::Armed;
+		_frameStarts.clear();
+		_triggerShaderHash.store(_activeSettings.shaderHash, std::memory_order_relaxed);
+		if(_activeSettings.preTriggerFrameCount > 0)
+		{
+			startRecording();
+			_frameStarts.push_back(getTimestamp());
+			record(CaptureEventId::FrameBegin, 0, _frameIndex);
+		}
+	}
+
+
+	void FrameCapture::disarm()
+	{
+		if(_mode != CaptureMode::Armed)
+		{
+			return;
+		}
+		_mode = CaptureMode::Idle;
+		_triggerShaderHash.store(0, std::memory_order_relaxed);
+		_frameStarts.clear();
+		if(isCapturing())
+		{
+			stopRecording();
+		}
+	}
+
+
+	void FrameCapture::onPresent()
+	{
+		const int64_t now = getTimestamp();
+		const int64_t frameTime = _lastPresent != 0 ? now - _lastPresent : 0;
+		_lastPresent = now;
+		if(isCapturing())
+		{
+			record(CaptureEventId::FrameEnd, 0, _frameIndex, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::duration(frameTime)).count()));
+		}
+		++_frameIndex;
+		// taken after the FrameEnd, so the events of a frame are the ones from its start to the next one
+		const int64_t frameStart = getTimestamp();
+
+		switch(_mode)
+		{
+		case CaptureMode::Armed:
+			if(_activeSettings.frameTimeThresholdMilliseconds > 0.0f &&
+			   std::chrono::duration<float, std::milli>(std::chrono::steady_clock::duration(frameTime)).count() > _activeSettings.frameTimeThresholdMilliseconds)
+			{
+				requestCapture(CaptureTrigger::FrameTimeSpike);
+			}
+			break;
+		case CaptureMode::Capturing:
+			if(++_capturedFrameCount >= _activeSettings.frameCount)
+			{
+				endCapture(frameStart);
+			}
+			break;
+		default:
+			break;
+		}
+
+		if(_requestedTrigger.load(std::memory_order_relaxed) != static_cast<uint16_t>(CaptureTrigger::None))
+		{
+			// a trigger while a capture runs or is written is dropped
+			const auto trigger = static_cast<CaptureTrigger>(_requestedTrigger.exchange(static_cast<uint16_t>(CaptureTrigger::None), std::memory_order_relaxed));
+			if(_mode != CaptureMode::Capturing && !isBusy())
+			{
+				startCapture(trigger, frameStart);
+			}
+		}
+
+		if(isCapturing())
+		{
+			_frameSerial.fetch_add(1, std::memory_order_relaxed);
+			record(CaptureEventId::FrameBegin, 0, _frameIndex);
+			if(_mode == CaptureMode::Armed)
+			{
+				// the starts of the frames to keep and of the frame starting now. The capture thread drops the events before the oldest.
+				_frameStarts.push_back(frameStart);
+				while(_frameStarts.size() > _activeSettings.preTriggerFrameCount + 1)
+				{
+					_frameStarts.pop_front();
+				}
+				_historyBegin.store(_frameStarts.front(), std::memory_order_relaxed);
+			}
+		}
+	}
+
+
+	void FrameCapture::stop()
+	{
+		disarm();
+		if(_mode == CaptureMode::Capturing)
+		{
+			endCapture(getTimestamp());
+		}
+		std::thread worker;
+		{
+			std::unique_lock lock(_captureMutex);
+			if(!_isRunning)
+			{
+				return;
+			}
+			_stopRequested = true;
+			// taken under the lock: the worker clears _isRunning when it exits, a capture started after that starts a new worker in _worker.
+			worker = std::move(_worker);
+		}
+		_captureCondition.notify_all();
+		if(worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+
+	CaptureStatistics FrameCapture::getStatistics()
+	{
+		std::unique_lock lock(_captureMutex);
+		return _statistics;
+	}
+
+
+	FrameCapture::ThreadRing* FrameCapture::registerThread()
+	{
+		std::unique_lock lock(_registerMutex);
+		const uint32_t ringIndex = _ringCount.load(std::memory_order_relaxed);
+		if(ringIndex >= MaxThreadCount)
+		{
+			return nullptr;
+		}
+		auto ring = std::make_unique<ThreadRing>();
+		ring->threadIndex = ringIndex;
+		ring->events = std::make_unique<CaptureEvent[]>(RingCapacity);
+		ThreadRing* toReturn = ring.get();
+		_rings[ringIndex] = std::move(ring);
+		_ringCount.store(ringIndex + 1, std::memory_order_release);
+		return toReturn;
+	}
+
+
+	void FrameCapture::startRecording()
+	{
+		_droppedEventCount.store(0, std::memory_order_relaxed);
+		_historyBegin.store(0, std::memory_order_relaxed);
+		{
+			std::unique_lock lock(_captureMutex);
+			_isDraining = true;
+			if(!_isRunning)
+			{
+				startWorker();
+			}
+		}
+		_frameSerial.fetch_add(1, std::memory_order_relaxed);
+		_isCapturing.store(true, std::memory_order_relaxed);
+		_captureCondition.notify_all();
+	}
+
+
+	void FrameCapture::stopRecording()
+	{
+		_isCapturing.store(false, std::memory_order_relaxed);
+		{
+			std::unique_lock lock(_captureMutex);
+			_isDraining = false;
+		}
+		_captureCondition.notify_all();
+	}
+
+
+	void FrameCapture::startCapture(CaptureTrigger trigger, int64_t now)
+	{
+		if(_mode == CaptureMode::Idle)
+		{
+			// only the capture key triggers when not armed, there are no frames kept before it
+			_activeSettings = _triggerSettings;
+			_activeSettings.frameCount = std::max(_activeSettings.frameCount, 1u);
+			_activeSettings.preTriggerFrameCount = 0;
+			_frameStarts.clear();
+		}
+		_triggerShaderHash.store(0, std::memory_order_relaxed);
+		// _frameStarts ends with the start of the frame which just ended: keep it and the ones before it, up to the frames to keep.
+		while(_frameStarts.size() > _activeSettings.preTriggerFrameCount)
+		{
+			_frameStarts.pop_front();
+		}
+		const int64_t captureBegin = _frameStarts.empty() ? now : _frameStarts.front();
+		_frameStarts.clear();
+		_mode = CaptureMode::Capturing;
+		_capturedFrameCount = 0;
+		_historyBegin.store(captureBegin, std::memory_order_relaxed);
+		{
+			std::unique_lock lock(_captureMutex);
+			_isWriting = true;
+			_isCaptureEnded = false;
+			_captureBegin = captureBegin;
+			_captureTriggerTime = now;
+			_captureTrigger = trigger;
+			_captureFrameCount = _activeSettings.frameCount;
+		}
+		if(!isCapturing())
+		{
+			startRecording();
+		}
+	}
+
+
+	void FrameCapture::endCapture(int64_t now)
+	{
+		_isCapturing.store(false, std::memory_order_relaxed);
+		_mode = CaptureMode::Idle;
+		{
+			std::unique_lock lock(_captureMutex);
+			_captureEnd = now;
+			_isDraining = false;
+			_isCaptureEnded = true;
+		}
+		_captureCondition.notify_all();
+	}
+
+
+	void FrameCapture::startWorker()
+	{
+		// _captureMutex is held. stop() joined the thread it stopped, _worker is empty.
+		_stopRequested = false;
+		_isRunning = true;
+		_worker = std::thread(&FrameCapture::workerLoop, this);
+	}
+
+
+	void FrameCapture::workerLoop()
+	{
+		std::deque<EventChunk> chunks;
+		size_t chunkEventCount = 0;
+		size_t capturedEventCount = 0;		// drained from the trigger on
+		bool wasCapturing = false;
+		while(true)
+		{
+			bool isCaptureEnded = false;
+			bool isCapturing = false;
+			{
+				std::unique_lock lock(_captureMutex);
+				if(_isDraining && !_isCaptureEnded)
+				{
+					// events are recorded: drain the rings regularly so they don't fill up
+					_captureCondition.wait_for(lock, DrainInterval, [this] { return _isCaptureEnded || _stopRequested; });
+				}
+				else if(!_isCaptureEnded)
+				{
+					// disarmed: the frames kept for a capture aren't needed anymore
+					chunks.clear();
+					chunkEventCount = 0;
+					_captureCondition.wait(lock, [this] { return _stopRequested || _isDraining || _isCaptureEnded; });
+					if(!_isDraining && !_isCaptureEnded)
+					{
+						// stop requested, nothing recorded. Decided under the lock, a later capture starts a new worker.
+						_isRunning = false;
+						return;
+					}
+				}
+				isCaptureEnded = _isCaptureEnded;
+				isCapturing = _isWriting;
+			}
+			if(isCapturing != wasCapturing)
+			{
+				// triggered: the chunks kept so far are the frames before the trigger, the ones drained from now on are the capture
+				capturedEventCount = 0;
+				wasCapturing = isCapturing;
+			}
+
+			EventChunk chunk;
+			drainRings(chunk.events);
+			if(isCapturing && capturedEventCount + chunk.events.size() > MaxCaptureEventCount)
+			{
+				// like a full ring, the newest events are dropped: the capture keeps its start and says it's incomplete
+				const size_t keptEventCount = MaxCaptureEventCount - std::min(capturedEventCount, MaxCaptureEventCount);
+				_droppedEventCount.fetch_add(chunk.events.size() - keptEventCount, std::memory_order_relaxed);
+				chunk.events.resize(keptEventCount);
+			}
+			if(!chunk.events.empty())
+			{
+				for(const auto& event : chunk.events)
+				{
+					chunk.newestTimestamp = std::max(chunk.newestTimestamp, event.timestamp);
+				}
+				chunkEventCount += chunk.events.size();
+				if(isCapturing)
+				{
+					capturedEventCount += chunk.events.size();
+				}
+				chunks.push_back(std::move(chunk));
+			}
+			if(isCaptureEnded)
+			{
+				writeCapture(chunks, _droppedEventCount.load(std::memory_order_relaxed));
+				chunks.clear();
+				chunkEventCount = 0;
+				capturedEventCount = 0;
+				wasCapturing = false;
+				std::unique_lock lock(_captureMutex);
+				_isCaptureEnded = false;
+				_isWriting = false;
+				continue;
+			}
+
+			// drop the frames older than the ones to keep, and armed the oldest ones past the budget. The budget is for the frames kept
+			// before a trigger only, the capture itself is limited by MaxCaptureEventCount above.
+			const int64_t historyBegin = _historyBegin.load(std::memory_order_relaxed);
+			while(!chunks.empty() && (chunks.front().newestTimestamp < historyBegin || (!isCapturing && chunkEventCount > MaxHistoryEventCount)))
+			{
+				chunkEventCount -= chunks.front().events.size();
+				chunks.pop_front();
+			}
+		}
+	}
+
+
+	void FrameCapture::drainRings(std::vector<CaptureEvent>& events)
+	{
+		const uint32_t ringCount = _ringCount.load(std::memory_order_acquire);
+		for(uint32_t ringIndex = 0; ringIndex < ringCount; ++ringIndex)
+		{
+			ThreadRing& ring = *_rings[ringIndex];
+			uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+			const uint32_t head = ring.head.load(std::memory_order_acquire);
+			for(; tail != head; ++tail)
+			{
+				events.push_back(ring.events[tail & (RingCapacity - 1)]);
+			}
+			ring.tail.store(tail, std::memory_order_release);
+		}
+	}
+
+
+	void FrameCapture::writeCapture(std::deque<EventChunk>& chunks, uint64_t droppedEventCount)
+	{
+		const auto startTime = std::chrono::steady_clock::now();
+		std::filesystem::path captureFolder;
+		CaptureEventFormatter formatter;
+		CaptureLogWriter logWriter;
+		uint32_t captureIndex;
+		int64_t captureBegin;
+		int64_t captureTriggerTime;
+		int64_t captureEnd;
+		CaptureTrigger trigger;
+		uint32_t frameCount;
+		{
+			std::unique_lock lock(_captureMutex);
+			captureFolder = _captureFolder;
+			formatter = _formatter;
+			logWriter = _logWriter;
+			captureIndex = _statistics.captureCount;
+			captureBegin = _captureBegin;
+			captureTriggerTime = _captureTriggerTime;
+			captureEnd = _captureEnd;
+			trigger = _captureTrigger;
+			frameCount = _captureFrameCount;
+		}
+		const CaptureOutput output = _output;
+
+		// events still recorded when the capture ended are drained with the next capture, which drops them.
+		std::vector<CaptureEvent> events;
+		uint32_t preTriggerFrameCount = 0;
+		for(const auto& chunk : chunks)
+		{
+			for(const auto& event : chunk.events)
+			{
+				if(event.timestamp >= captureBegin && event.timestamp <= captureEnd)
+				{
+					events.push_back(event);
+					if(event.eventId == CaptureEventId::FrameBegin && event.timestamp < captureTriggerTime)
+					{
+						++preTriggerFrameCount;
+					}
+				}
+			}
+		}
+		// the rings are in order per thread, the threads are interleaved by timestamp
+		std::stable_sort(events.begin(), events.end(), [](const CaptureEvent& a, const CaptureEvent& b) { return a.timestamp < b.timestamp; });
+
+		if((output == CaptureOutput::Log || output == CaptureOutput::LogAndFile) && nullptr != formatter && nullptr != logWriter)
+		{
+			std::string line = "Capture " + std::to_string(captureIndex) + " (" + getCaptureTriggerName(trigger) + "): " + std::to_string(preTriggerFrameCount) +
+				" frames before the trigger, " + std::to_string(frameCount) + " from the trigger on.";
+			logWriter(line.c_str());
+			for(const auto& event : events)
+			{
+				line.clear();
+				formatter(event, line);
+				logWriter(line.c_str());
+			}
+			if(droppedEventCount > 0)
+			{
+				line = std::to_string(droppedEventCount) + " events of the capture were dropped, a ring was full or too many threads recorded events.";
+				logWriter(line.c_str());
+			}
+		}
+
+		CaptureFileHeader header = {};
+		header.magic = CAPTURE_FILE_MAGIC;
+		header.version = CAPTURE_FILE_VERSION;
+		header.ticksPerSecond = std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+		header.eventCount = events.size();
+		header.droppedEventCount = droppedEventCount;
+		header.captureIndex = captureIndex;
+		header.threadCount = _ringCount.load(std::memory_order_acquire);
+		header.trigger = trigger;
+		header.preTriggerFrameCount = static_cast<uint16_t>(std::min<uint32_t>(preTriggerFrameCount, UINT16_MAX));
+		header.frameCount = frameCount;
+		char baseName[64];
+		snprintf(baseName, sizeof(baseName), "capture_%lld_%04u", static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(
+				 std::chrono::system_clock::now().time_since_epoch()).count()), captureIndex);
+		std::error_code ec;
+		std::string fileName;
+		if((output == CaptureOutput::File || output == CaptureOutput::LogAndFile) && !captureFolder.empty())
+		{
+			const std::filesystem::path capturePath = captureFolder / (std::string(baseName) + ".stcap");
+			std::filesystem::create_directories(captureFolder, ec);
+			std::ofstream captureFile(capturePath, std::ios::binary | std::ios::trunc);
+			if(captureFile.is_open())
+			{
+				captureFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				captureFile.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(CaptureEvent));
+				if(captureFile.good())
+				{
+					fileName = capturePath.filename().string();
+				}
+			}
+		}
+		std::string traceFileName;
+		if(_isTraceExported.load(std::memory_order_relaxed) && !captureFolder.empty())
+		{
+			const std::filesystem::path tracePath = captureFolder / (std::string(baseName) + ".json");
+			std::filesystem::create_directories(captureFolder, ec);
+			if(writeChromeTrace(tracePath, header, events.data(), events.size()))
+			{
+				traceFileName = tracePath.filename().string();
+			}
+		}
+
+		std::unique_lock lock(_captureMutex);
+		_statistics.captureCount++;
+		_statistics.trigger = trigger;
+		_statistics.frameCount = preTriggerFrameCount + frameCount;
+		_statistics.eventCount = events.size();
+		_statistics.droppedEventCount = droppedEventCount;
+		_statistics.writeMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		_statistics.fileName = fileName;
+		_statistics.traceFileName = traceFileName;
+	}
+}
@@ -0,0 +1,286 @@
+/// records the hook calls of captured frames into per-thread ring buffers, formatted and written by a background thread after the capture
+
+#pragma once
+
+#include "CaptureFormat.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// Where a finished capture goes.
+	/// </summary>
+	enum class CaptureOutput : int
+	{
+		Log = 0,		// a line per event in the reshade log, like the synchronous capture did
+		File,			// a binary .stcap file in the capture folder, see CaptureFormat.h
+		LogAndFile,
+	};
+
+
+	/// <summary>
+	/// Formats an event as a line of text. Runs on the capture thread.
+	/// </summary>
+	using CaptureEventFormatter = void(*)(const CaptureEvent& event, std::string& line);
+	/// <summary>
+	/// Writes a line of text to the log. Runs on the capture thread.
+	/// </summary>
+	using CaptureLogWriter = void(*)(const char* line);
+
+
+	/// <summary>
+	/// How many frames a capture covers and what starts it besides the capture key. Only used while armed, except frameCount.
+	/// </summary>
+	struct CaptureTriggerSettings
+	{
+		uint32_t frameCount = 1;						// frames captured from the trigger on
+		uint32_t preTriggerFrameCount = 0;				// frames kept while armed, written in front of a triggered capture. 0: nothing is recorded till the trigger
+		float frameTimeThresholdMilliseconds = 0.0f;	// a frame taking longer triggers, 0 for off
+		uint32_t shaderHash = 0;						// the first bind of a pipeline with this shader triggers, 0 for off
+	};
+
+
+	struct CaptureStatistics
+	{
+		uint32_t captureCount = 0;			// captures written this session
+		CaptureTrigger trigger = CaptureTrigger::None;		// of the last capture
+		uint32_t frameCount = 0;			// of the last capture, the frames kept before the trigger included
+		uint64_t eventCount = 0;			// of the last capture
+		uint64_t droppedEventCount = 0;		// of the last capture
+		double writeMilliseconds = 0.0;		// formatting and writing the last capture, on the capture thread
+		std::string fileName;				// of the last capture, empty if it wasn't written to a file
+		std::string traceFileName;			// of the last capture, empty if it wasn't exported as a trace
+	};
+
+
+	/// <summary>
+	/// Frame capture which keeps the captured frames close to their normal speed. While recording, a hook only copies a fixed size CaptureEvent
+	///	into the ring buffer of its thread: no formatting, no allocation and no lock. Each thread gets its own single producer / single consumer
+	///	ring on its first event. The capture thread drains the rings while the frames run, and once the capture ended it sorts the events by
+	///	timestamp and formats them to the log and/or writes them to a binary file and a Chrome trace. If a ring is full the event is dropped and counted, the
+	///	game thread never waits. The thread is started by the first capture.
+	///
+	///	A capture covers frameCount frames from the trigger on. The capture key always triggers. Armed, a frame time spike or the first bind of a
+	///	shader trigger as well, and the last preTriggerFrameCount frames are recorded all the time so a capture includes what led up to the
+	///	trigger. The capture thread keeps those in chunks per drain and drops the chunks older than the frames to keep, at most
+	///	MaxHistoryEventCount events. From the trigger on the events are kept up to MaxCaptureEventCount, the ones past it are counted as
+	///	dropped. Armed without frames to keep nothing is recorded: the overhead is a compare per present and per pipeline
+	///	bind. Arming is for a single capture, it's disarmed when triggered.
+	/// </summary>
+	class FrameCapture
+	{
+	public:
+		static constexpr uint32_t RingCapacity = 16384;		// events per thread, a power of 2. 1 MB per ring.
+		static constexpr uint32_t MaxThreadCount = 64;		// threads recording events. Events of more threads are dropped.
+		static constexpr size_t MaxHistoryEventCount = 262144;		// events kept for the frames before a trigger, 16 MB. Older frames are dropped.
+		static constexpr size_t MaxCaptureEventCount = 2097152;		// events of a capture from the trigger on, 128 MB. Newer events are dropped and counted.
+		static constexpr std::chrono::milliseconds DrainInterval = std::chrono::milliseconds(1);
+
+		~FrameCapture();
+
+		/// <summary>
+		/// Sets where captures go. Has to be called before the first capture.
+		/// </summary>
+		/// <param name="captureFolder">folder for the binary capture files, created when the first file is written</param>
+		/// <param name="formatter"></param>
+		/// <param name="logWriter"></param>
+		void setOutput(const std::filesystem::path& captureFolder, CaptureEventFormatter formatter, CaptureLogWriter logWriter);
+		void setCaptureOutput(CaptureOutput output) { _output = output; }
+		CaptureOutput getCaptureOutput() const { return _output; }
+		/// <summary>
+		/// If true, captures are also exported as a Chrome trace (.json) in the capture folder, see TraceExport.h. Independent of the output.
+		/// </summary>
+		/// <param name="isExported"></param>
+		void setTraceExport(bool isExported) { _isTraceExported = isExported; }
+		bool isTraceExported() const { return _isTraceExported; }
+		/// <summary>
+		/// Sets the frame counts and triggers. Takes effect with the next arm() or capture. Present thread only, like the other control functions.
+		/// </summary>
+		/// <param name="settings"></param>
+		void setTriggerSettings(const CaptureTriggerSettings& settings) { _triggerSettings = settings; }
+		const CaptureTriggerSettings& getTriggerSettings() const { return _triggerSettings; }
+
+		/// <summary>
+		/// True while events are recorded. A relaxed atomic load, for the hooks to test before recording.
+		/// </summary>
+		bool isCapturing() const { return _isCapturing.load(std::memory_order_relaxed); }
+		/// <summary>
+		/// Changes with every recorded frame. Hooks which record something once per frame, like the resource of a view, compare it to
+		///	what they saw last: each frame of a capture has to be complete on its own as the frames kept before a trigger are trimmed.
+		/// </summary>
+		uint32_t getFrameSerial() const { return _frameSerial.load(std::memory_order_relaxed); }
+		bool isArmed() const { return _mode == CaptureMode::Armed; }
+		/// <summary>
+		/// True from the trigger till the capture is written. Triggers are ignored then.
+		/// </summary>
+		bool isBusy();
+		/// <summary>
+		/// Starts watching the triggers of the trigger settings, and recording the frames to keep before the trigger.
+		/// </summary>
+		void arm();
+		void disarm();
+		/// <summary>
+		/// Starts a capture with the next present, if none is running. Can be called from any thread.
+		/// </summary>
+		/// <param name="trigger"></param>
+		void requestCapture(CaptureTrigger trigger)
+		{
+			uint16_t none = static_cast<uint16_t>(CaptureTrigger::None);
+			_requestedTrigger.compare_exchange_strong(none, static_cast<uint16_t>(trigger), std::memory_order_relaxed);
+		}
+		/// <summary>
+		/// Called for every bound pipeline: triggers a capture the first time the shader of the trigger settings is bound while armed.
+		/// </summary>
+		/// <param name="shaderHash"></param>
+		void checkShaderBind(uint32_t shaderHash)
+		{
+			// 0 if not armed for a shader
+			if(shaderHash == _triggerShaderHash.load(std::memory_order_relaxed) && shaderHash != 0)
+			{
+				_triggerShaderHash.store(0, std::memory_order_relaxed);
+				requestCapture(CaptureTrigger::ShaderBind);
+			}
+		}
+		/// <summary>
+		/// Marks the end of a frame: checks the frame time trigger, starts a requested capture and ends the capture once it has all its frames.
+		///	Called in present.
+		/// </summary>
+		void onPresent();
+		/// <summary>
+		/// Records an event in the ring of the calling thread. Only call while isCapturing().
+		/// </summary>
+		void record(CaptureEventId eventId, uint64_t commandList, uint64_t arg0 = 0, uint64_t arg1 = 0, uint64_t arg2 = 0, uint64_t arg3 = 0, uint64_t arg4 = 0)
+		{
+			ThreadRing* ring = getThreadRing();
+			if(nullptr == ring)
+			{
+				_droppedEventCount.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			const uint32_t head = ring->head.load(std::memory_order_relaxed);
+			if(head - ring->tail.load(std::memory_order_acquire) >= RingCapacity)
+			{
+				_droppedEventCount.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			CaptureEvent& event = ring->events[head & (RingCapacity - 1)];
+			event.timestamp = std::chrono::steady_clock::now().time_since_epoch().count();
+			event.commandList = commandList;
+			event.eventId = eventId;
+			event.reserved = 0;
+			event.threadIndex = ring->threadIndex;
+			event.args[0] = arg0;
+			event.args[1] = arg1;
+			event.args[2] = arg2;
+			event.args[3] = arg3;
+			event.args[4] = arg4;
+			ring->head.store(head + 1, std::memory_order_release);
+		}
+		/// <summary>
+		/// Disarms and writes the capture in progress, then stops the capture thread. Must not be called from DllMain, see ConfigSaver::stop.
+		/// </summary>
+		void stop();
+		CaptureStatistics getStatistics();
+
+	private:
+		enum class CaptureMode
+		{
+			Idle,
+			Armed,
+			Capturing,
+		};
+
+		/// <summary>
+		/// Ring of one thread. head is only written by the recording thread, tail only by the capture thread, each on its own cache line.
+		/// </summary>
+		struct ThreadRing
+		{
+			alignas(64) std::atomic<uint32_t> head = 0;
+			alignas(64) std::atomic<uint32_t> tail = 0;
+			uint32_t threadIndex = 0;
+			std::unique_ptr<CaptureEvent[]> events;
+		};
+
+		/// <summary>
+		/// The events of one drain of the rings, kept by the capture thread till they're written or older than the frames to keep.
+		/// </summary>
+		struct EventChunk
+		{
+			int64_t newestTimestamp = 0;
+			std::vector<CaptureEvent> events;
+		};
+
+		ThreadRing* getThreadRing()
+		{
+			// one FrameCapture per process, so the ring of a thread can be cached in a plain thread_local
+			thread_local ThreadRing* threadRing = nullptr;
+			thread_local bool isRegistered = false;
+			if(!isRegistered)
+			{
+				// nullptr if there are too many threads already, the thread's events are dropped then
+				threadRing = registerThread();
+				isRegistered = true;
+			}
+			return threadRing;
+		}
+		ThreadRing* registerThread();
+		void startRecording();
+		void stopRecording();
+		void startCapture(CaptureTrigger trigger, int64_t now);
+		void endCapture(int64_t now);
+		void startWorker();
+		void workerLoop();
+		void drainRings(std::vector<CaptureEvent>& events);
+		void writeCapture(std::deque<EventChunk>& chunks, uint64_t droppedEventCount);
+
+		std::array<std::unique_ptr<ThreadRing>, MaxThreadCount> _rings;
+		std::atomic<uint32_t> _ringCount = 0;		// rings [0, _ringCount) are registered, published with release
+		std::mutex _registerMutex;
+		std::atomic<bool> _isCapturing = false;
+		std::atomic<uint32_t> _frameSerial = 0;
+		std::atomic<uint64_t> _droppedEventCount = 0;		// of the capture in progress, the frames kept before the trigger included
+		std::atomic<uint16_t> _requestedTrigger = static_cast<uint16_t>(CaptureTrigger::None);
+		std::atomic<uint32_t> _triggerShaderHash = 0;		// while armed for a shader bind
+		std::atomic<int64_t> _historyBegin = 0;				// while armed: the events before this timestamp can be dropped
+		std::filesystem::path _captureFolder;
+		CaptureEventFormatter _formatter = nullptr;
+		CaptureLogWriter _logWriter = nullptr;
+		std::atomic<CaptureOutput> _output = CaptureOutput::Log;
+		std::atomic<bool> _isTraceExported = false;
+
+		// present thread
+		CaptureTriggerSettings _triggerSettings;
+		CaptureTriggerSettings _activeSettings;		// copy taken by arm() or the capture
+		CaptureMode _mode = CaptureMode::Idle;
+		uint32_t _capturedFrameCount = 0;
+		uint64_t _frameIndex = 0;
+		int64_t _lastPresent = 0;
+		std::deque<int64_t> _frameStarts;			// while recording armed: the start of the frames to keep and of the current frame
+
+		std::mutex _captureMutex;
+		std::condition_variable _captureCondition;
+		std::thread _worker;
+		bool _isRunning = false;			// cleared by the worker under _captureMutex when it exits
+		bool _stopRequested = false;
+		bool _isDraining = false;			// events are recorded, the capture thread drains the rings
+		bool _isCaptureEnded = false;		// the capture has all its frames, the capture thread writes it
+		bool _isWriting = false;			// from the trigger till the capture thread wrote the capture
+		int64_t _captureBegin = 0;			// start of the oldest frame kept before the trigger, or the trigger
+		int64_t _captureTriggerTime = 0;
+		int64_t _captureEnd = 0;
+		CaptureTrigger _captureTrigger = CaptureTrigger::None;
+		uint32_t _captureFrameCount = 0;
+		CaptureStatistics _statistics;
+	};
+}
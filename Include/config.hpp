@@ -9,3 +9,6 @@
 // The subdirectory to load shader binaries from
 #define RESHADE_ADDON_SHADER_LOAD_DIR ".\\shaderreplace"
 
+// The subdirectory to save frame captures to
+#define RESHADE_ADDON_CAPTURE_SAVE_DIR ".\\capture"
+
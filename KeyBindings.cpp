@@ -0,0 +1,92 @@
+/// per-frame keyboard snapshot and the table dispatching the pressed keys to the actions bound to them
+
+#include "stdafx.h"
+#include "KeyBindings.h"
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		// same layout as KeyData::getKeyForIniFile
+		constexpr uint32_t iniKey(uint8_t keyCode, bool ctrlRequired = false)
+		{
+			return (static_cast<uint32_t>(keyCode) << 24) | ((ctrlRequired ? 1u : 0u) << 8);
+		}
+	}
+
+
+	const std::array<KeyCommandInfo, KEY_COMMAND_COUNT> KEY_COMMANDS = { {
+		{ "CaptureFrame", "capture the calls of the next frame, see Frame capture", iniKey(VK_F1) },
+		{ "PreviousPixelShader", "previous pixel shader", iniKey(VK_NUMPAD1) },
+		{ "NextPixelShader", "next pixel shader", iniKey(VK_NUMPAD2) },
+		{ "PreviousMarkedPixelShader", "previous marked pixel shader in the group", iniKey(VK_NUMPAD1, true) },
+		{ "NextMarkedPixelShader", "next marked pixel shader in the group", iniKey(VK_NUMPAD2, true) },
+		{ "MarkPixelShader", "mark/unmark the current pixel shader as being part of the group", iniKey(VK_NUMPAD3) },
+		{ "PreviousVertexShader", "previous vertex shader", iniKey(VK_NUMPAD4) },
+		{ "NextVertexShader", "next vertex shader", iniKey(VK_NUMPAD5) },
+		{ "PreviousMarkedVertexShader", "previous marked vertex shader in the group", iniKey(VK_NUMPAD4, true) },
+		{ "NextMarkedVertexShader", "next marked vertex shader in the group", iniKey(VK_NUMPAD5, true) },
+		{ "MarkVertexShader", "mark/unmark the current vertex shader as being part of the group", iniKey(VK_NUMPAD6) },
+		{ "PreviousComputeShader", "previous compute shader", iniKey(VK_NUMPAD7) },
+		{ "NextComputeShader", "next compute shader", iniKey(VK_NUMPAD8) },
+		{ "PreviousMarkedComputeShader", "previous marked compute shader in the group", iniKey(VK_NUMPAD7, true) },
+		{ "NextMarkedComputeShader", "next marked compute shader in the group", iniKey(VK_NUMPAD8, true) },
+		{ "MarkComputeShader", "mark/unmark the current compute shader as being part of the group", iniKey(VK_NUMPAD9) },
+	} };
+
+
+	void KeyboardSnapshot::update(const reshade::api::effect_runtime* runtime, const std::array<uint64_t, 4>& keysToRead, bool readAllKeys)
+	{
+		_keysDown = {};
+		_keysPressed = {};
+		_modifierMask = (runtime->is_key_down(VK_MENU) ? KEY_MODIFIER_ALT : 0) | (runtime->is_key_down(VK_CONTROL) ? KEY_MODIFIER_CTRL : 0) |
+						(runtime->is_key_down(VK_SHIFT) ? KEY_MODIFIER_SHIFT : 0);
+		if(readAllKeys)
+		{
+			// keys below 7 are mouse buttons. A pressed key is down too, so the bound keys are read as well.
+			for(uint32_t keyCode = 7; keyCode < 256; ++keyCode)
+			{
+				if(keyCode == VK_MENU || keyCode == VK_CONTROL || keyCode == VK_SHIFT || !runtime->is_key_down(keyCode))
+				{
+					continue;
+				}
+				setBit(_keysDown, static_cast<uint8_t>(keyCode));
+				if(runtime->is_key_pressed(keyCode))
+				{
+					setBit(_keysPressed, static_cast<uint8_t>(keyCode));
+				}
+			}
+			return;
+		}
+		auto readKey = [this, runtime](uint8_t keyCode)
+			{
+				if(runtime->is_key_pressed(keyCode))
+				{
+					setBit(_keysPressed, keyCode);
+					setBit(_keysDown, keyCode);
+				}
+			};
+		forEachKey(keysToRead, readKey);
+	}
+
+
+	void KeyBindingTable::clear()
+	{
+		for(auto& actions : _actionsPerKey)
+		{
+			actions.clear();
+		}
+		_boundKeys = {};
+	}
+
+
+	void KeyBindingTable::bind(uint8_t keyCode, uint8_t modifierMask, bool isGroupToggle, int32_t target)
+	{
+		if(keyCode == 0)
+		{
+			return;
+		}
+		_actionsPerKey[keyCode].push_back({ modifierMask, isGroupToggle, target });
+		_boundKeys[keyCode >> 6] |= 1ull << (keyCode & 63);
+	}
+}
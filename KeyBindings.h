@@ -0,0 +1,156 @@
+/// per-frame keyboard snapshot and the table dispatching the pressed keys to the actions bound to them
+
+#pragma once
+
+#include <reshade_api.hpp>
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+namespace ShaderToggler
+{
+	// modifier mask of a key binding and of the keyboard snapshot. A binding only fires if the modifiers held down are exactly its mask.
+	constexpr uint8_t KEY_MODIFIER_ALT = 0x1;
+	constexpr uint8_t KEY_MODIFIER_CTRL = 0x2;
+	constexpr uint8_t KEY_MODIFIER_SHIFT = 0x4;
+
+	/// <summary>
+	/// Fixed actions with a configurable key binding, stored in the KeyBindings section of the ini. Values are positions in KEY_COMMANDS.
+	/// </summary>
+	enum class KeyCommand : uint8_t
+	{
+		CaptureFrame = 0,
+		PreviousPixelShader,
+		NextPixelShader,
+		PreviousMarkedPixelShader,
+		NextMarkedPixelShader,
+		MarkPixelShader,
+		PreviousVertexShader,
+		NextVertexShader,
+		PreviousMarkedVertexShader,
+		NextMarkedVertexShader,
+		MarkVertexShader,
+		PreviousComputeShader,
+		NextComputeShader,
+		PreviousMarkedComputeShader,
+		NextMarkedComputeShader,
+		MarkComputeShader,
+		Count
+	};
+
+	constexpr size_t KEY_COMMAND_COUNT = static_cast<size_t>(KeyCommand::Count);
+
+
+	struct KeyCommandInfo
+	{
+		const char* iniKey;
+		const char* description;		// shown in the help
+		uint32_t defaultKey;			// in the ini format, see KeyData::getKeyForIniFile
+	};
+
+
+	/// <summary>
+	/// Ini key, help text and default binding per KeyCommand, in the order of the enum. The defaults are the keys the hunting used before
+	///	they were configurable.
+	/// </summary>
+	extern const std::array<KeyCommandInfo, KEY_COMMAND_COUNT> KEY_COMMANDS;
+
+
+	/// <summary>
+	/// The state of the keys for one frame, read from the runtime once in present. Only the keys with a binding are read, unless all keys
+	///	are requested (when a new key binding is being collected), so reading costs one call per bound key plus one per modifier.
+	/// </summary>
+	class KeyboardSnapshot
+	{
+	public:
+		/// <summary>
+		/// Reads the keys for this frame. keysToRead is a 256 bit mask of the key codes to read (see KeyBindingTable::getBoundKeys).
+		/// </summary>
+		/// <param name="runtime"></param>
+		/// <param name="keysToRead"></param>
+		/// <param name="readAllKeys">if true, reads which keys are down for all keys instead, to collect a new binding</param>
+		void update(const reshade::api::effect_runtime* runtime, const std::array<uint64_t, 4>& keysToRead, bool readAllKeys);
+
+		uint8_t getModifierMask() const { return _modifierMask; }
+
+		/// <summary>
+		/// Calls callback(keyCode) for every key pressed this frame.
+		/// </summary>
+		template<typename Callback>
+		void forEachPressedKey(Callback&& callback) const { forEachKey(_keysPressed, callback); }
+		/// <summary>
+		/// Calls callback(keyCode) for every key down this frame, modifiers excluded. Only complete if all keys were read.
+		/// </summary>
+		template<typename Callback>
+		void forEachKeyDown(Callback&& callback) const { forEachKey(_keysDown, callback); }
+
+	private:
+		static void setBit(std::array<uint64_t, 4>& bits, uint8_t keyCode) { bits[keyCode >> 6] |= 1ull << (keyCode & 63); }
+
+		template<typename Callback>
+		static void forEachKey(const std::array<uint64_t, 4>& keys, Callback& callback)
+		{
+			for(uint32_t word = 0; word < 4; ++word)
+			{
+				uint64_t bits = keys[word];
+				while(bits != 0)
+				{
+					callback(static_cast<uint8_t>(word * 64 + std::countr_zero(bits)));
+					bits &= bits - 1;
+				}
+			}
+		}
+
+		std::array<uint64_t, 4> _keysDown = {};
+		std::array<uint64_t, 4> _keysPressed = {};
+		uint8_t _modifierMask = 0;
+	};
+
+
+	/// <summary>
+	/// Maps a key code to the actions bound to it, with the modifier mask each needs. An action is a KeyCommand or the toggle of a group.
+	///	Rebuilt when a binding changes, dispatching only looks at the keys pressed this frame.
+	/// </summary>
+	class KeyBindingTable
+	{
+	public:
+		struct BoundAction
+		{
+			uint8_t modifierMask;
+			bool isGroupToggle;
+			int32_t target;			// KeyCommand, or the id of the group to toggle
+		};
+
+		void clear();
+		/// <summary>
+		/// Binds an action to a key, ignored for key code 0 (unbound).
+		/// </summary>
+		void bind(uint8_t keyCode, uint8_t modifierMask, bool isGroupToggle, int32_t target);
+		const std::array<uint64_t, 4>& getBoundKeys() const { return _boundKeys; }
+
+		/// <summary>
+		/// Calls callback(const BoundAction&) for every action bound to a key pressed in the snapshot with the modifiers held down.
+		/// </summary>
+		template<typename Callback>
+		void dispatch(const KeyboardSnapshot& snapshot, Callback&& callback) const
+		{
+			const uint8_t modifierMask = snapshot.getModifierMask();
+			snapshot.forEachPressedKey([&](uint8_t keyCode)
+				{
+					for(const auto& action : _actionsPerKey[keyCode])
+					{
+						if(action.modifierMask == modifierMask)
+						{
+							callback(action);
+						}
+					}
+				});
+		}
+
+	private:
+		std::array<std::vector<BoundAction>, 256> _actionsPerKey;
+		std::array<uint64_t, 4> _boundKeys = {};
+	};
+}
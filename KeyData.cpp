@@ -81,45 +81,26 @@ namespace ShaderToggler
 	}
 
 
-	void KeyData::collectKeysPressed(const reshade::api::effect_runtime* runtime)
+	void KeyData::collectKeysPressed(const KeyboardSnapshot& keyboard)
 	{
-		// keys below 7 aren't interesting.
-		for(int i=7;i<256;i++)
-		{
-			switch(i)
+		// the snapshot skips the keys below 7 and the modifiers. With more keys down, the highest key code wins.
+		bool isKeyDown = false;
+		keyboard.forEachKeyDown([this, &isKeyDown](uint8_t keyCode)
 			{
-				case VK_MENU:
-				case VK_CONTROL:
-				case VK_SHIFT:
-					break;
-				default:
-					if(runtime->is_key_down(i))
-					{
-						_keyCode = i;
-						_altRequired = runtime->is_key_down(VK_MENU);
-						_ctrlRequired = runtime->is_key_down(VK_CONTROL);
-						_shiftRequired = runtime->is_key_down(VK_SHIFT);
-					}
-			}
+				_keyCode = keyCode;
+				isKeyDown = true;
+			});
+		if(isKeyDown)
+		{
+			const uint8_t modifierMask = keyboard.getModifierMask();
+			_altRequired = (modifierMask & KEY_MODIFIER_ALT) != 0;
+			_ctrlRequired = (modifierMask & KEY_MODIFIER_CTRL) != 0;
+			_shiftRequired = (modifierMask & KEY_MODIFIER_SHIFT) != 0;
 		}
 		setKeyAsString();
 	}
 
 
-	bool KeyData::isKeyPressed(const reshade::api::effect_runtime* runtime)
-	{
-		bool toReturn = runtime->is_key_pressed(_keyCode);
-		const bool altPressed = runtime->is_key_down(VK_MENU);;
-		const bool shiftPressed = runtime->is_key_down(VK_SHIFT);
-		const bool ctrlPressed = runtime->is_key_down(VK_CONTROL);
-
-		toReturn &= ((_altRequired && altPressed) || (!_altRequired && !altPressed));
-		toReturn &= ((_shiftRequired && shiftPressed) || (!_shiftRequired && !shiftPressed));
-		toReturn &= ((_ctrlRequired && ctrlPressed) || (!_ctrlRequired && !ctrlPressed));
-		return toReturn;
-	}
-
-
 	std::string KeyData::vkCodeToString(uint8_t vkCode)
 	{
 		// from ReShade
@@ -34,6 +34,7 @@
 #include <reshade_api.hpp>
 
 #include "stdafx.h"
+#include "KeyBindings.h"
 
 namespace ShaderToggler
 {
@@ -63,14 +64,8 @@ namespace ShaderToggler
 		/// <summary>
 		/// Used for when the instance of this class is used to collect temporary keybinding data for editing
 		/// </summary>
-		/// <param name="runtime"></param>
-		void collectKeysPressed(const reshade::api::effect_runtime* runtime);
-		/// <summary>
-		/// Returns true if the keyboard shortcut defined by this instance is currently pressed down
-		/// </summary>
-		/// <param name="runtime"></param>
-		/// <returns></returns>
-		bool isKeyPressed(const reshade::api::effect_runtime* runtime);
+		/// <param name="keyboard">read with all keys, see KeyboardSnapshot::update</param>
+		void collectKeysPressed(const KeyboardSnapshot& keyboard);
 
 		/// <summary>
 		/// Returns a usable description for the keyboard shortcut, or 'Press a key' if undefined/empty
@@ -78,6 +73,10 @@ namespace ShaderToggler
 		/// <returns></returns>
 		std::string getKeyAsString() { return _keyAsString;}
 		uint8_t getKeyCode() { return _keyCode;}
+		/// <summary>
+		/// The modifiers required, as KEY_MODIFIER_* bits.
+		/// </summary>
+		uint8_t getModifierMask() const { return (_altRequired ? KEY_MODIFIER_ALT : 0) | (_ctrlRequired ? KEY_MODIFIER_CTRL : 0) | (_shiftRequired ? KEY_MODIFIER_SHIFT : 0); }
 		bool isValid() { return _keyCode > 0; }
 
 	private:
@@ -0,0 +1,152 @@
+/// leveled, rate limited logging to the reshade log, formatted only when enabled and written on a background thread
+
+#include <reshade.hpp>
+#include "Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace ShaderToggler
+{
+	Logger g_logger;
+
+
+	Logger::~Logger()
+	{
+		// runs at dll unload, under the loader lock: the thread can't be joined here. stop() should have been called before.
+		if(_worker.joinable())
+		{
+			{
+				std::unique_lock lock(_queueMutex);
+				_stopRequested = true;
+			}
+			_queueCondition.notify_all();
+			_worker.detach();
+		}
+	}
+
+
+	void Logger::write(LogSite& site, LogLevel level, const char* format, ...)
+	{
+		// the rate limit is checked before formatting, a suppressed message costs two atomics
+		const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+		constexpr int64_t windowTicks = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)).count();
+		int64_t windowStart = site.windowStart.load(std::memory_order_relaxed);
+		if(now - windowStart >= windowTicks && site.windowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed))
+		{
+			site.windowCount.store(0, std::memory_order_relaxed);
+		}
+		if(site.windowCount.fetch_add(1, std::memory_order_relaxed) >= SiteMessagesPerSecond)
+		{
+			site.suppressedCount.fetch_add(1, std::memory_order_relaxed);
+			_suppressedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		thread_local char t_text[MessageSize];
+		va_list args;
+		va_start(args, format);
+		const int formattedLength = vsnprintf(t_text, MessageSize, format, args);
+		va_end(args);
+		if(formattedLength < 0)
+		{
+			return;
+		}
+		size_t length = std::min(static_cast<size_t>(formattedLength), MessageSize - 1);
+		// a message cut at MessageSize leaves the count for the next one
+		const uint32_t suppressedCount = length < MessageSize - 1 ? site.suppressedCount.exchange(0, std::memory_order_relaxed) : 0;
+		if(suppressedCount > 0)
+		{
+			const int suffixLength = snprintf(t_text + length, MessageSize - length, " (%u more suppressed)", suppressedCount);
+			length = std::min(length + static_cast<size_t>(std::max(suffixLength, 0)), MessageSize - 1);
+		}
+
+		{
+			std::unique_lock lock(_queueMutex);
+			if(_writeIndex - _readIndex >= RingSize)
+			{
+				_droppedCount.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			Message& message = _ring[_writeIndex % RingSize];
+			message.level = level;
+			memcpy(message.text, t_text, length);
+			message.text[length] = '\0';
+			++_writeIndex;
+			if(!_isRunning)
+			{
+				// stop() joined the thread it stopped, _worker is empty.
+				_stopRequested = false;
+				_isRunning = true;
+				_worker = std::thread(&Logger::workerLoop, this);
+			}
+		}
+		_queueCondition.notify_one();
+	}
+
+
+	void Logger::stop()
+	{
+		std::thread worker;
+		{
+			std::unique_lock lock(_queueMutex);
+			if(!_isRunning)
+			{
+				return;
+			}
+			_stopRequested = true;
+			// taken under the lock: the worker clears _isRunning when it exits, a message logged after that starts a new worker in _worker.
+			worker = std::move(_worker);
+		}
+		_queueCondition.notify_all();
+		if(worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+
+	void Logger::workerLoop()
+	{
+		Message message;
+		while(true)
+		{
+			{
+				std::unique_lock lock(_queueMutex);
+				_queueCondition.wait(lock, [this] { return _stopRequested || _readIndex != _writeIndex; });
+				if(_readIndex == _writeIndex)
+				{
+					// stop requested and everything written. Decided under the lock, a later message starts a new worker.
+					_isRunning = false;
+					return;
+				}
+				message = _ring[_readIndex % RingSize];
+				++_readIndex;
+			}
+			const LogLevel level = std::min(message.level, LogLevel::Debug);
+			reshade::log_message(static_cast<reshade::log_level>(level), message.text);
+			_writtenCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+
+	const char* getLogLevelName(LogLevel level)
+	{
+		switch(level)
+		{
+		case LogLevel::Error:
+			return "Error";
+		case LogLevel::Warning:
+			return "Warning";
+		case LogLevel::Info:
+			return "Info";
+		case LogLevel::Debug:
+			return "Debug";
+		case LogLevel::Trace:
+			return "Trace";
+		}
+		return "?";
+	}
+}
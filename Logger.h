@@ -0,0 +1,129 @@
+/// leveled, rate limited logging to the reshade log, formatted only when enabled and written on a background thread
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// levels above this one are compiled out, their arguments aren't even evaluated. 5 keeps Trace, 4 stops at Debug, 2 at Warning.
+#ifndef SHADERTOGGLER_LOG_MAX_LEVEL
+#ifdef _DEBUG
+#define SHADERTOGGLER_LOG_MAX_LEVEL 5
+#else
+#define SHADERTOGGLER_LOG_MAX_LEVEL 4
+#endif
+#endif
+
+/// <summary>
+/// Logs a printf style message at level if the level is compiled in and enabled at runtime. Nothing is formatted otherwise, and nothing
+///	either once the call site logged more than Logger::SiteMessagesPerSecond messages in the last second.
+/// </summary>
+#define SHADERTOGGLER_LOG(level, ...) \
+	do \
+	{ \
+		if constexpr(static_cast<int>(level) <= SHADERTOGGLER_LOG_MAX_LEVEL) \
+		{ \
+			if(ShaderToggler::g_logger.isEnabled(level)) \
+			{ \
+				static ShaderToggler::LogSite s_logSite; \
+				ShaderToggler::g_logger.write(s_logSite, level, __VA_ARGS__); \
+			} \
+		} \
+	} while(false)
+
+#define LOG_ERROR(...) SHADERTOGGLER_LOG(ShaderToggler::LogLevel::Error, __VA_ARGS__)
+#define LOG_WARNING(...) SHADERTOGGLER_LOG(ShaderToggler::LogLevel::Warning, __VA_ARGS__)
+#define LOG_INFO(...) SHADERTOGGLER_LOG(ShaderToggler::LogLevel::Info, __VA_ARGS__)
+#define LOG_DEBUG(...) SHADERTOGGLER_LOG(ShaderToggler::LogLevel::Debug, __VA_ARGS__)
+#define LOG_TRACE(...) SHADERTOGGLER_LOG(ShaderToggler::LogLevel::Trace, __VA_ARGS__)
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// Same values as reshade::log_level. Trace is for the calls made many times per frame, it's written to the reshade log as debug.
+	/// </summary>
+	enum class LogLevel : int
+	{
+		Error = 1,
+		Warning,
+		Info,		// once per session or per device: config loaded, device and swapchain created
+		Debug,		// per created object: pipelines, layouts, resources and views
+		Trace,		// per call of the command list hooks
+	};
+
+
+	/// <summary>
+	/// Rate limit state of a log call site, a static made by SHADERTOGGLER_LOG.
+	/// </summary>
+	struct LogSite
+	{
+		std::atomic<int64_t> windowStart = 0;			// steady_clock ticks
+		std::atomic<uint32_t> windowCount = 0;			// messages of the call site since windowStart, suppressed ones included
+		std::atomic<uint32_t> suppressedCount = 0;		// suppressed since the last message written, appended to the next one
+	};
+
+
+	/// <summary>
+	/// Formats the messages on the calling thread into a thread local buffer and queues them in a fixed ring, the background thread hands them
+	///	to reshade::log_message, which writes and flushes the log file for every message. When the ring is full the message is dropped and
+	///	counted, the calling thread never waits on the file. The thread is started by the first message.
+	/// </summary>
+	class Logger
+	{
+	public:
+		static constexpr size_t MessageSize = 512;				// longer messages are cut
+		static constexpr size_t RingSize = 256;
+		static constexpr uint32_t SiteMessagesPerSecond = 16;
+
+		~Logger();
+
+		bool isEnabled(LogLevel level) const { return static_cast<int>(level) <= _level.load(std::memory_order_relaxed); }
+		LogLevel getLevel() const { return static_cast<LogLevel>(_level.load(std::memory_order_relaxed)); }
+		void setLevel(LogLevel level) { _level.store(static_cast<int>(level), std::memory_order_relaxed); }
+		/// <summary>
+		/// Use SHADERTOGGLER_LOG, which checks the level first and keeps the call site's LogSite.
+		/// </summary>
+		void write(LogSite& site, LogLevel level, const char* format, ...);
+		/// <summary>
+		/// Writes the queued messages and stops the thread. Must not be called from DllMain, as the thread exit needs the loader lock. A later
+		///	message starts the thread again.
+		/// </summary>
+		void stop();
+
+		uint64_t getWrittenCount() const { return _writtenCount.load(std::memory_order_relaxed); }
+		uint64_t getSuppressedCount() const { return _suppressedCount.load(std::memory_order_relaxed); }
+		uint64_t getDroppedCount() const { return _droppedCount.load(std::memory_order_relaxed); }
+
+	private:
+		struct Message
+		{
+			LogLevel level = LogLevel::Info;
+			char text[MessageSize];
+		};
+
+		void workerLoop();
+
+		std::atomic<int> _level = static_cast<int>(LogLevel::Info);
+		std::mutex _queueMutex;
+		std::condition_variable _queueCondition;
+		std::thread _worker;
+		std::array<Message, RingSize> _ring;
+		size_t _readIndex = 0;			// next message to write, both grow without wrapping
+		size_t _writeIndex = 0;
+		bool _isRunning = false;			// cleared by the worker under _queueMutex when it exits
+		bool _stopRequested = false;
+		std::atomic<uint64_t> _writtenCount = 0;
+		std::atomic<uint64_t> _suppressedCount = 0;
+		std::atomic<uint64_t> _droppedCount = 0;
+	};
+
+
+	extern Logger g_logger;
+
+	const char* getLogLevelName(LogLevel level);
+}
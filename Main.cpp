@@ -41,8 +41,21 @@
 #include "ShaderManager.h"
 #include "CDataFile.h"
 #include "ToggleGroup.h"
+#include "KeyBindings.h"
+#include "ShaderDumper.h"
+#include "PipelineLayoutCache.h"
+#include "ConfigSaver.h"
+#include "EditJournal.h"
+#include "ConfigSnapshot.h"
+#include "Logger.h"
+#include "MemoryTracker.h"
+#include "UploadProfiler.h"
+#include "CommandCensus.h"
 #include <vector>
+#include <charconv>
 #include <filesystem>
+#include <mutex>
+#include <thread>
 
 #include <unordered_map>
 
@@ -67,15 +80,39 @@ struct __declspec(uuid("038B03AA-4C75-443B-A695-752D80797037")) CommandListDataC
     uint64_t activePixelShaderPipeline;
     uint64_t activeVertexShaderPipeline;
 	uint64_t activeComputeShaderPipeline;
+	// shadow of the last cb13 push_constants on this command list, to skip pushing the same data again. Reset when the command list is reset
+	// or when something else binds a constant buffer to CBINDEX.
+	bool hasPushedInjectData = false;
+	uint64_t pushedInjectLayout = 0;
+	ShaderInjectData pushedInjectData = {};
+	// the commands recorded since the last reset, added to the census of the queue when executed. The immediate command list is rolled up at present.
+	CommandCounts commandCounts;
 };
 
+struct __declspec(uuid("7C1D3E52-9A4B-4F0E-8C6D-2B5A1F3E9D47")) CommandQueueDataContainer {
+	uint32_t censusIndex = 0;
+};
+
+static atomic_uint64_t g_injectPushesIssued = 0;
+static atomic_uint64_t g_injectPushesElided = 0;
+static atomic_uint64_t g_injectBufferUploads = 0;
+
 #define FRAMECOUNT_COLLECTION_PHASE_DEFAULT 250;
 #define HASH_FILE_NAME	"ShaderToggler.ini"
+#define JOURNAL_FILE_NAME	"ShaderToggler.journal"
+#define SNAPSHOT_FILE_NAME	"ShaderToggler.snapshot"
+#define MEMORY_CSV_FILE_NAME	"ShaderToggler_memory.csv"
+#define UPLOADS_CSV_FILE_NAME	"ShaderToggler_uploads.csv"
+#define JOURNAL_COMPACTION_IDLE_TIME	std::chrono::seconds(5)		// the journaled edits are saved in the ini once no edit was made for this long
 
 static ShaderToggler::ShaderManager g_pixelShaderManager;
 static ShaderToggler::ShaderManager g_vertexShaderManager;
 static ShaderToggler::ShaderManager g_computeShaderManager;
 static KeyData g_keyCollector;
+static KeyboardSnapshot g_keyboardSnapshot;		// read once per frame in present, the overlay of that frame uses it too
+static KeyBindingTable g_keyBindingTable;
+static std::array<KeyData, KEY_COMMAND_COUNT> g_commandKeys;		// per KeyCommand
+static atomic_bool g_keyBindingsChanged = true;		// set when a group or command binding changes, see rebuildKeyBindingTable
 static atomic_uint32_t g_activeCollectorFrameCounter = 0;
 static std::vector<ToggleGroup> g_toggleGroups;
 static atomic_int g_toggleGroupIdKeyBindingEditing = -1;
@@ -83,6 +120,21 @@ static atomic_int g_toggleGroupIdShaderEditing = -1;
 static float g_overlayOpacity = 1.0f;
 static int g_startValueFramecountCollectionPhase = FRAMECOUNT_COLLECTION_PHASE_DEFAULT;
 static std::string g_iniFileName = "";
+static bool g_writeLegacyHashKeys = false;		// ini only: write the group hashes as ShaderHash<i> keys (readable by older versions) instead of packed
+static atomic_bool g_shaderDumpSelectionChanged = true;		// set when the marked / hunted shaders or the groups change, see updateShaderDumpSelection
+static ShaderToggler::ShaderDumper g_shaderDumper;
+static ShaderToggler::PipelineLayoutCache g_pipelineLayoutCache;
+static ShaderToggler::ConfigSaver g_configSaver;
+static ShaderToggler::EditJournal g_editJournal;
+static std::filesystem::path g_journalFileName;
+static std::filesystem::path g_snapshotFileName;
+static ShaderToggler::MemoryTracker g_memoryTracker;
+static ShaderToggler::UploadProfiler g_uploadProfiler;
+static ShaderToggler::CommandCensus g_commandCensus;
+static std::atomic<command_list*> g_uploadImmediateCommandList = nullptr;		// the device calls are attributed to its shaders, D3D9/10/11 and OpenGL only
+static std::atomic<device*> g_presentDevice = nullptr;		// the device of the runtime presenting, whose frames the frame capture covers
+static std::filesystem::path g_uploadsFileName;
+static std::string g_uploadsExportStatus;		// shown next to the export button
 
 /// contains shader code to override ouput
 static thread_local std::vector<std::vector<uint8_t>> s_constant_color;
@@ -126,45 +178,93 @@ static uint32_t calculateShaderHash(void* shaderData)
 }
 
 
+/// <summary>
+/// The groups and settings read from the ini (or its snapshot), with the journaled edits replayed on the groups. Loaded on a background thread
+/// started in DllMain and applied to the globals by ensureConfigLoaded.
+/// </summary>
+struct ShaderTogglerConfig
+{
+	std::vector<ToggleGroup> toggleGroups;
+	ShaderTogglerSettings settings;
+	bool isLoadedFromSnapshot = false;
+	size_t replayedEdits = 0;
+	double loadMilliseconds = 0.0;
+};
+
+static ShaderTogglerConfig g_loadedConfig;		// written by g_configLoadThread, read after joining it
+static std::thread g_configLoadThread;
+static std::mutex g_configLoadMutex;
+static atomic_bool g_configLoaded = false;		// set once g_loadedConfig is applied to the globals
+static double g_processAttachMilliseconds = 0.0;
+
+
 /// <summary>
 /// Adds a default group with VK_CAPITAL as toggle key. Only used if there aren't any groups defined in the ini file.
 /// </summary>
-void addDefaultGroup()
+void addDefaultGroup(std::vector<ToggleGroup>& toggleGroups)
 {
 	ToggleGroup toAdd("Default", ToggleGroup::getNewGroupId());
 	toAdd.setToggleKey(VK_CAPITAL, false, false, false);
-	g_toggleGroups.push_back(toAdd);
+	toggleGroups.push_back(toAdd);
 }
 
 
 /// <summary>
-/// Loads the defined hashes and groups from the shaderToggler.ini file.
+/// Reads a 64 bit value written by saveShaderTogglerIniFile as a string (CDataFile only has 32 bit integers). Returns 0 if it's not there.
 /// </summary>
-void loadShaderTogglerIniFile()
+static uint64_t getUInt64FromIniFile(CDataFile& iniFile, std::string_view key, std::string_view section, int base)
+{
+	const std::string value = iniFile.GetValue(key, section);
+	uint64_t result = 0;
+	std::from_chars(value.data(), value.data() + value.size(), result, base);
+	return result;
+}
+
+
+/// <summary>
+/// Loads the defined hashes and groups from the shaderToggler.ini file into the config passed in. Doesn't touch the globals.
+/// </summary>
+/// <param name="config"></param>
+void loadShaderTogglerIniFile(ShaderTogglerConfig& config)
 {
-	// Will assume it's started at the start of the application and therefore no groups are present.
 	CDataFile iniFile;
 	if(!iniFile.Load(g_iniFileName))
 	{
 		// not there
 		return;
 	}
+	ShaderTogglerSettings& settings = config.settings;
+	settings.savedJournalId = getUInt64FromIniFile(iniFile, "JournalId", "General", 16);
+	settings.savedJournalSequence = getUInt64FromIniFile(iniFile, "JournalSequence", "General", 10);
+	settings.shaderDumpLayout = iniFile.GetInt("ShaderDumpLayout", "General");
+	settings.shaderDumpCompressed = iniFile.GetBool("ShaderDumpCompressed", "General");
+	settings.writeLegacyHashKeys = iniFile.GetBool("WriteLegacyHashKeys", "General");
+	settings.shaderDumpPolicy = iniFile.GetInt("ShaderDumpPolicy", "General");
+	for(size_t i = 0; i < KEY_COMMAND_COUNT; ++i)
+	{
+		// keys not in the ini keep their default binding
+		const uint32_t commandKey = iniFile.GetUInt(KEY_COMMANDS[i].iniKey, "KeyBindings");
+		if(commandKey != UINT_MAX)
+		{
+			settings.commandKeys[i] = commandKey;
+		}
+	}
 	int groupCounter = 0;
 	const int numberOfGroups = iniFile.GetInt("AmountGroups", "General");
 	if(numberOfGroups==INT_MIN)
 	{
 		// old format file?
-		addDefaultGroup();
+		addDefaultGroup(config.toggleGroups);
 		groupCounter=-1;	// enforce old format read for pre 1.0 ini file.
 	}
 	else
 	{
 		for(int i=0;i<numberOfGroups;i++)
 		{
-			g_toggleGroups.push_back(ToggleGroup("", ToggleGroup::getNewGroupId()));
+			config.toggleGroups.push_back(ToggleGroup("", ToggleGroup::getNewGroupId()));
 		}
 	}
-	for(auto& group: g_toggleGroups)
+	for(auto& group: config.toggleGroups)
 	{
 		group.loadState(iniFile, groupCounter);		// groupCounter is normally 0 or greater. For when the old format is detected, it's -1 (and there's 1 group).
 		groupCounter++;
@@ -173,23 +273,345 @@ void loadShaderTogglerIniFile()
 
 
 /// <summary>
-/// Saves the currently known toggle groups with their shader hashes to the shadertoggler.ini file
+/// Returns the position of the group in g_toggleGroups, which is how the edit journal refers to it.
 /// </summary>
-void saveShaderTogglerIniFile()
+static uint32_t getToggleGroupIndex(const ToggleGroup& group)
 {
-	// format: first section with # of groups, then per group a section with pixel and vertex shaders, as well as their name and key value.
-	// groups are stored with "Group" + group counter, starting with 0.
-	CDataFile iniFile;
-	iniFile.SetInt("AmountGroups", g_toggleGroups.size(), "",  "General");
+	const auto it = std::find_if(g_toggleGroups.begin(), g_toggleGroups.end(), [&group](const ToggleGroup& candidate) { return candidate.getId() == group.getId(); });
+	return static_cast<uint32_t>(it - g_toggleGroups.begin());
+}
 
-	int groupCounter = 0;
+
+/// <summary>
+/// Appends an edit of the group passed in to the edit journal, see EditJournal.
+/// </summary>
+static void journalEdit(JournalOperation operation, const ToggleGroup& group, uint32_t value = 0, ShaderStage stage = ShaderStage::None, std::string text = std::string())
+{
+	JournalRecord record;
+	record.operation = operation;
+	record.groupIndex = getToggleGroupIndex(group);
+	record.value = value;
+	record.stage = stage;
+	record.text = std::move(text);
+	g_editJournal.append(std::move(record));
+}
+
+
+/// <summary>
+/// Journals the mark toggled on the hunted shader of the manager passed in, if a group's shaders are being edited. A mark made while editing
+/// is stored in the group when the editing is done, so the journal stores it as an edit of the group right away.
+/// </summary>
+static void journalMarkToggle(ShaderManager& shaderManager, ShaderStage stage)
+{
+	const int groupIdShaderEditing = g_toggleGroupIdShaderEditing;
+	const uint32_t huntedShaderHash = shaderManager.getActiveHuntedShaderHash();
+	if(groupIdShaderEditing < 0 || huntedShaderHash == 0)
+	{
+		return;
+	}
+	for(const auto& group : g_toggleGroups)
+	{
+		if(group.getId() == groupIdShaderEditing)
+		{
+			journalEdit(shaderManager.isHuntedShaderMarked() ? JournalOperation::Mark : JournalOperation::Unmark, group, huntedShaderHash, stage);
+			return;
+		}
+	}
+}
+
+
+/// <summary>
+/// Applies an edit read back from the journal to the groups loaded from the ini. The ini holds the groups as they were before the first
+/// edit returned by the journal, so the group positions in the records match when they're applied in order.
+/// </summary>
+static void applyJournalRecord(std::vector<ToggleGroup>& toggleGroups, const JournalRecord& record)
+{
+	if(record.operation == JournalOperation::CreateGroup)
+	{
+		addDefaultGroup(toggleGroups);
+		return;
+	}
+	if(record.groupIndex >= toggleGroups.size())
+	{
+		return;
+	}
+	ToggleGroup& group = toggleGroups[record.groupIndex];
+	switch(record.operation)
+	{
+	case JournalOperation::DeleteGroup:
+		toggleGroups.erase(toggleGroups.begin() + record.groupIndex);
+		break;
+	case JournalOperation::Rename:
+		group.setName(record.text);
+		break;
+	case JournalOperation::Rebind:
+		{
+			KeyData keyData;
+			keyData.setKeyFromIniFile(record.value);
+			group.setToggleKey(keyData);
+		}
+		break;
+	case JournalOperation::SetActiveAtStartup:
+		group.setIsActiveAtStartup(record.value != 0);
+		break;
+	case JournalOperation::Mark:
+	case JournalOperation::Unmark:
+		group.setShaderHashMarked(record.stage, record.value, record.operation == JournalOperation::Mark);
+		break;
+	default:
+		break;
+	}
+}
+
+
+/// <summary>
+/// Opens the edit journal and replays the edits the ini doesn't contain on the groups loaded from it. They're saved in the ini once the user
+/// is idle, like the edits made in this session.
+/// </summary>
+/// <param name="config">loaded from the ini</param>
+static void replayEditJournal(ShaderTogglerConfig& config)
+{
+	const std::vector<JournalRecord> records = g_editJournal.open(g_journalFileName, config.settings.savedJournalId, config.settings.savedJournalSequence);
+	for(const auto& record : records)
+	{
+		applyJournalRecord(config.toggleGroups, record);
+	}
+	config.replayedEdits = records.size();
+}
+
+
+/// <summary>
+/// Takes a snapshot of the groups passed in for saveConfigSnapshot.
+/// </summary>
+static std::vector<ToggleGroupSnapshot> takeToggleGroupSnapshots(const std::vector<ToggleGroup>& toggleGroups)
+{
+	std::vector<ToggleGroupSnapshot> groups;
+	groups.reserve(toggleGroups.size());
+	for(const auto& group : toggleGroups)
+	{
+		groups.push_back(group.takeSnapshot());
+	}
+	return groups;
+}
+
+
+/// <summary>
+/// Body of g_configLoadThread: reads the ini and the journal into g_loadedConfig. Nothing else may touch g_loadedConfig till the thread is joined.
+/// If the binary snapshot was made from the ini as it is now, it's read instead of the ini. Otherwise the ini is parsed and the snapshot is
+/// rebuilt for the next start.
+/// </summary>
+static void loadShaderTogglerConfig()
+{
+	const auto startTime = std::chrono::steady_clock::now();
+	IniFileStamp iniStamp;
+	if(readIniFileStamp(g_iniFileName, iniStamp))
+	{
+		g_loadedConfig.isLoadedFromSnapshot = loadConfigSnapshot(g_snapshotFileName, iniStamp, g_loadedConfig.settings, g_loadedConfig.toggleGroups);
+		if(!g_loadedConfig.isLoadedFromSnapshot)
+		{
+			loadShaderTogglerIniFile(g_loadedConfig);
+			std::vector<ToggleGroupSnapshot> groups = takeToggleGroupSnapshots(g_loadedConfig.toggleGroups);
+			saveConfigSnapshot(g_snapshotFileName, iniStamp, g_loadedConfig.settings, groups);
+		}
+	}
+	replayEditJournal(g_loadedConfig);
+	g_loadedConfig.loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+
+/// <summary>
+/// Thread proc of g_configLoadThread. The thread holds a reference on the addon module, taken in DllMain before it's started: if ReShade
+/// unloads the addon before any hook joined the thread, the module stays mapped till the config is loaded (and the snapshot written) instead
+/// of the thread running on in unmapped code. Dropping the reference can unload the module, so it's dropped by FreeLibraryAndExitThread,
+/// which doesn't return into it.
+/// </summary>
+/// <param name="module">the reference to release</param>
+static void runConfigLoadThread(HMODULE module)
+{
+	loadShaderTogglerConfig();
+	FreeLibraryAndExitThread(module, 0);
+}
+
+
+/// <summary>
+/// Moves the loaded config into the globals, on the thread of the first hook which needs it.
+/// </summary>
+static void applyShaderTogglerConfig(ShaderTogglerConfig& config)
+{
+	// Will assume it's started at the start of the application and therefore no groups are present.
+	g_toggleGroups = std::move(config.toggleGroups);
+	const ShaderTogglerSettings& settings = config.settings;
+	if(settings.shaderDumpLayout == static_cast<int>(ShaderToggler::ShaderDumpLayout::Pack))
+	{
+		g_shaderDumper.setDumpLayout(ShaderToggler::ShaderDumpLayout::Pack);
+	}
+	g_shaderDumper.setCompressDumps(settings.shaderDumpCompressed);
+	g_writeLegacyHashKeys = settings.writeLegacyHashKeys;
+	if(settings.shaderDumpPolicy >= static_cast<int>(ShaderToggler::ShaderDumpPolicy::Off) && settings.shaderDumpPolicy <= static_cast<int>(ShaderToggler::ShaderDumpPolicy::HuntedOrMarked))
+	{
+		g_shaderDumper.setDumpPolicy(static_cast<ShaderToggler::ShaderDumpPolicy>(settings.shaderDumpPolicy));
+	}
+	for(size_t i = 0; i < KEY_COMMAND_COUNT; ++i)
+	{
+		g_commandKeys[i].setKeyFromIniFile(settings.commandKeys[i]);
+	}
+	g_shaderDumpSelectionChanged = true;
+	g_keyBindingsChanged = true;
+}
+
+
+/// <summary>
+/// Makes sure the config loaded on g_configLoadThread is applied to the globals, waiting for the thread if it's still loading. Called by the
+/// hooks which use the groups or the settings before anything else: init_device (the draw hooks only run on an initialized device),
+/// present and the overlay. Only an atomic load once the config is applied.
+/// </summary>
+/// <param name="hookName">for the startup timing in the log</param>
+static void ensureConfigLoaded(const char* hookName)
+{
+	if(g_configLoaded.load(std::memory_order_acquire))
+	{
+		return;
+	}
+	std::unique_lock lock(g_configLoadMutex);
+	if(g_configLoaded.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+	const auto waitStartTime = std::chrono::steady_clock::now();
+	if(g_configLoadThread.joinable())
+	{
+		g_configLoadThread.join();
+	}
+	else
+	{
+		// the thread couldn't be started in DllMain, load it here.
+		loadShaderTogglerConfig();
+	}
+	const double waitMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStartTime).count();
+	const size_t groupCount = g_loadedConfig.toggleGroups.size();
+	applyShaderTogglerConfig(g_loadedConfig);
+	g_configLoaded.store(true, std::memory_order_release);
+
+	char message[256];
+	snprintf(message, sizeof(message), "Config loaded from the %s in %.1f ms off DllMain (%zu groups, %zu journaled edits replayed). %s waited %.1f ms for it, DLL_PROCESS_ATTACH took %.2f ms.",
+			 g_loadedConfig.isLoadedFromSnapshot ? "snapshot" : "ini", g_loadedConfig.loadMilliseconds, groupCount, g_loadedConfig.replayedEdits, hookName, waitMilliseconds,
+			 g_processAttachMilliseconds);
+	reshade::log_message(reshade::log_level::info, message);
+}
+
+
+/// <summary>
+/// Saves the currently known toggle groups with their shader hashes to the shadertoggler.ini file. Only the snapshot of the groups and settings
+/// is taken here, serializing and writing is done on g_configSaver's thread. The result is shown next to the save button.
+/// </summary>
+void saveShaderTogglerIniFile()
+{
+	std::vector<ToggleGroupSnapshot> groups;
+	groups.reserve(g_toggleGroups.size());
 	for(const auto& group: g_toggleGroups)
 	{
-		group.saveState(iniFile, groupCounter);
-		groupCounter++;
+		ToggleGroupSnapshot& snapshot = groups.emplace_back(group.takeSnapshot());
+		if(group.getId() == g_toggleGroupIdShaderEditing)
+		{
+			// the group's hashes are in the shader managers while they're edited, the marks are what the group will hold when done.
+			const auto pixelShaderHashes = g_pixelShaderManager.getMarkedShaderHashes();
+			const auto vertexShaderHashes = g_vertexShaderManager.getMarkedShaderHashes();
+			const auto computeShaderHashes = g_computeShaderManager.getMarkedShaderHashes();
+			snapshot.pixelShaderHashes.assign(pixelShaderHashes.begin(), pixelShaderHashes.end());
+			snapshot.vertexShaderHashes.assign(vertexShaderHashes.begin(), vertexShaderHashes.end());
+			snapshot.computeShaderHashes.assign(computeShaderHashes.begin(), computeShaderHashes.end());
+		}
+	}
+	const int shaderDumpLayout = static_cast<int>(g_shaderDumper.getDumpLayout());
+	const int shaderDumpPolicy = static_cast<int>(g_shaderDumper.getDumpPolicy());
+	const bool shaderDumpCompressed = g_shaderDumper.getCompressDumps();
+	const bool writeLegacyHashKeys = g_writeLegacyHashKeys;
+	std::array<uint32_t, KEY_COMMAND_COUNT> commandKeys;
+	for(size_t i = 0; i < KEY_COMMAND_COUNT; ++i)
+	{
+		commandKeys[i] = g_commandKeys[i].getKeyForIniFile();
+	}
+	const std::string iniFileName = g_iniFileName;
+	const std::filesystem::path snapshotFileName = g_snapshotFileName;
+	const uint64_t journalId = g_editJournal.getJournalId();
+	const uint64_t journalSequence = g_editJournal.beginSave();
+
+	g_configSaver.requestSave([=](std::string& error) mutable
+		{
+			// format: first section with # of groups, then per group a section with pixel and vertex shaders, as well as their name and key value.
+			// groups are stored with "Group" + group counter, starting with 0.
+			CDataFile iniFile;
+			iniFile.SetInt("AmountGroups", groups.size(), "",  "General");
+			iniFile.SetInt("ShaderDumpLayout", shaderDumpLayout, "", "General");
+			iniFile.SetInt("ShaderDumpPolicy", shaderDumpPolicy, "", "General");
+			iniFile.SetBool("ShaderDumpCompressed", shaderDumpCompressed, "", "General");
+			iniFile.SetBool("WriteLegacyHashKeys", writeLegacyHashKeys, "", "General");
+			// the journaled edits up to journalSequence are in this snapshot, see EditJournal.
+			char journalIdText[17];
+			snprintf(journalIdText, sizeof(journalIdText), "%016llx", static_cast<unsigned long long>(journalId));
+			iniFile.SetValue("JournalId", journalIdText, "", "General");
+			iniFile.SetValue("JournalSequence", std::to_string(journalSequence), "", "General");
+			for(size_t i = 0; i < KEY_COMMAND_COUNT; ++i)
+			{
+				iniFile.SetUInt(KEY_COMMANDS[i].iniKey, commandKeys[i], "", "KeyBindings");
+			}
+
+			int groupCounter = 0;
+			for(auto& group: groups)
+			{
+				ToggleGroup::saveSnapshot(iniFile, groupCounter, group, writeLegacyHashKeys);
+				groupCounter++;
+			}
+			iniFile.SetFileName(iniFileName);
+			if(!iniFile.Save())
+			{
+				error = "couldn't write " + iniFileName;
+				return false;
+			}
+			g_editJournal.compact(journalSequence);
+
+			// the snapshot of the new ini, so the next start doesn't have to parse it. The hash vectors are already sorted by saveSnapshot.
+			IniFileStamp iniStamp;
+			if(readIniFileStamp(iniFileName, iniStamp))
+			{
+				ShaderTogglerSettings settings;
+				settings.shaderDumpLayout = shaderDumpLayout;
+				settings.shaderDumpPolicy = shaderDumpPolicy;
+				settings.shaderDumpCompressed = shaderDumpCompressed;
+				settings.writeLegacyHashKeys = writeLegacyHashKeys;
+				settings.savedJournalId = journalId;
+				settings.savedJournalSequence = journalSequence;
+				settings.commandKeys = commandKeys;
+				saveConfigSnapshot(snapshotFileName, iniStamp, settings, groups);
+			}
+			return true;
+		});
+}
+
+
+/// <summary>
+/// Shows the state of the last save of the toggle groups, next to the save button.
+/// </summary>
+static void displayConfigSaveStatus()
+{
+	const ConfigSaveStatus status = g_configSaver.getStatus();
+	switch(status.state)
+	{
+	case ConfigSaveState::Saving:
+		ImGui::SameLine();
+		ImGui::TextUnformatted("Saving...");
+		break;
+	case ConfigSaveState::Saved:
+		ImGui::SameLine();
+		ImGui::Text("Saved (%.0f ms).", status.durationMilliseconds);
+		break;
+	case ConfigSaveState::Failed:
+		ImGui::SameLine();
+		ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Save failed: %s", status.error.c_str());
+		break;
+	default:
+		break;
 	}
-	iniFile.SetFileName(g_iniFileName);
-	iniFile.Save();
 }
 
 
@@ -210,6 +632,105 @@ static void onResetCommandList(command_list *commandList)
 	commandListData.activePixelShaderPipeline = -1;
 	commandListData.activeVertexShaderPipeline = -1;
 	commandListData.activeComputeShaderPipeline = -1;
+	commandListData.hasPushedInjectData = false;
+	commandListData.commandCounts.reset();
+}
+
+
+static void onInitCommandQueue(command_queue* queue)
+{
+	queue->create_private_data<CommandQueueDataContainer>().censusIndex = g_commandCensus.registerQueue(static_cast<uint32_t>(queue->get_type()));
+}
+
+
+static void onDestroyCommandQueue(command_queue* queue)
+{
+	g_commandCensus.unregisterQueue(queue->get_private_data<CommandQueueDataContainer>().censusIndex);
+	queue->destroy_private_data<CommandQueueDataContainer>();
+}
+
+
+static void onExecuteCommandList(command_queue* queue, command_list* commandList)
+{
+	// a list executed again without a reset is counted again
+	g_commandCensus.onExecute(queue->get_private_data<CommandQueueDataContainer>().censusIndex, commandList->get_private_data<CommandListDataContainer>().commandCounts);
+}
+
+
+/// <summary>
+/// Counts a command of the game in the census of the command list.
+/// </summary>
+static void countCommand(command_list* commandList, CommandKind kind)
+{
+	if(nullptr != commandList)
+	{
+		commandList->get_private_data<CommandListDataContainer>().commandCounts.add(kind);
+	}
+}
+
+
+static bool onDispatch(command_list* commandList, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+	countCommand(commandList, CommandKind::Dispatch);
+	return false;
+}
+
+
+static void onBarrier(command_list* commandList, uint32_t count, const resource* resources, const resource_usage* oldStates, const resource_usage* newStates)
+{
+	countCommand(commandList, CommandKind::Barrier);
+}
+
+
+static bool onClearRenderTargetView(command_list* commandList, resource_view rtv, const float color[4], uint32_t rectCount, const rect* rects)
+{
+	countCommand(commandList, CommandKind::Clear);
+	return false;
+}
+
+
+static bool onClearDepthStencilView(command_list* commandList, resource_view dsv, const float* depth, const uint8_t* stencil, uint32_t rectCount, const rect* rects)
+{
+	countCommand(commandList, CommandKind::Clear);
+	return false;
+}
+
+
+static bool onClearUnorderedAccessViewUint(command_list* commandList, resource_view uav, const uint32_t values[4], uint32_t rectCount, const rect* rects)
+{
+	countCommand(commandList, CommandKind::Clear);
+	return false;
+}
+
+
+static bool onClearUnorderedAccessViewFloat(command_list* commandList, resource_view uav, const float values[4], uint32_t rectCount, const rect* rects)
+{
+	countCommand(commandList, CommandKind::Clear);
+	return false;
+}
+
+
+static void onBeginRenderPass(command_list* commandList, uint32_t count, const render_pass_render_target_desc* rts, const render_pass_depth_stencil_desc* ds)
+{
+	countCommand(commandList, CommandKind::RenderPassBegin);
+}
+
+
+/// <summary>
+/// Counts the push in the census of the command list, and invalidates its cb13 shadow if the game (or another addon) binds its own constant buffer to CBINDEX for the pixel stage.
+/// </summary>
+static void onPushDescriptors(command_list* commandList, shader_stage stages, pipeline_layout layout, uint32_t paramIndex, const descriptor_table_update& update)
+{
+	CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
+	commandListData.commandCounts.add(CommandKind::DescriptorBind);
+	if(update.type != descriptor_type::constant_buffer || (stages & shader_stage::pixel) != shader_stage::pixel)
+	{
+		return;
+	}
+	if(update.binding <= CBINDEX && CBINDEX < update.binding + update.count)
+	{
+		commandListData.hasPushedInjectData = false;
+	}
 }
 
 
@@ -218,12 +739,8 @@ static void onInitPipeline(device *device, pipeline_layout layout, uint32_t subo
 	
 	bool isPixelShader = false;
 	
-	// logging infos
-	std::stringstream s;
-	s << "onInitPipeline, pipelineHandle: " << (void*)pipelineHandle.handle << "), ";
-	s << "layout =  " << reinterpret_cast<void*>(layout.handle) << " ;";
 	// always "FFFF*" for pipelineHandle.handle...
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	LOG_DEBUG("onInitPipeline(pipeline: 0x%llx, layout: 0x%llx)", pipelineHandle.handle, layout.handle);
 
 	// shader has been created, we will now create a hash and store it with the handle we got.
 	for (uint32_t i = 0; i < subobjectCount; ++i)
@@ -256,9 +773,6 @@ static void onInitPipeline(device *device, pipeline_layout layout, uint32_t subo
 		// if not done, clone the pipeline to have a new version with fixed color for PS
 		clone_pipeline(device, cb_inject_layout, subobjectCount, subobjects, pipelineHandle, s_constant_color, pipelineCloneMap);
 
-		/* s << "onInitPipeline, color pipeline : " << (void*)colorPSShader.pipeline.handle << ") cloned from ("
-			<< (void*)pipelineHandle.handle << ")";
-		reshade::log_message(reshade::log_level::info, s.str().c_str()); */
 	}
 }
 
@@ -268,62 +782,16 @@ static void onDestroyPipeline(device *device, pipeline pipelineHandle)
 	g_vertexShaderManager.removeHandle(pipelineHandle.handle);
 	g_computeShaderManager.removeHandle(pipelineHandle.handle);
 
-	std::stringstream s;
-	s << "on_destroy_pipeline("
-		<< reinterpret_cast<void*>(pipelineHandle.handle)
-		<< ")";
-	//reshade::log_message(reshade::log_level::info, s.str().c_str());
-
 	// suppress cloned pipeline 
 	if (colorPSShader.initialized) {
 		device->destroy_pipeline(colorPSShader.pipeline);
 		colorPSShader.initialized = false;
 
-		s << "suppress cloned pipeline";
-		reshade::log_message(reshade::log_level::info, s.str().c_str());
+		LOG_DEBUG("on_destroy_pipeline(0x%llx): suppress cloned pipeline", pipelineHandle.handle);
 	}
 
 }
 
-/// <summary>
-/// Imported from reshade example shader_dump_addon.cpp
-/// </summary>
-
-static void save_shader_code(device_api device_type, const shader_desc &desc)
-{
-	if (desc.code_size == 0)
-		return;
-
-	uint32_t shader_hash = compute_crc32(static_cast<const uint8_t *>(desc.code), desc.code_size);
-
-	const wchar_t *extension = L".cso";
-	if (device_type == device_api::vulkan || (
-		device_type == device_api::opengl && desc.code_size > sizeof(uint32_t) && *static_cast<const uint32_t *>(desc.code) == 0x07230203 /* SPIR-V magic value */))
-		extension = L".spv"; // Vulkan uses SPIR-V (and sometimes OpenGL does too)
-	else if (device_type == device_api::opengl)
-		extension = L".glsl"; // OpenGL otherwise uses plain text GLSL
-
-	// Prepend executable directory to image files
-	wchar_t file_prefix[MAX_PATH] = L"";
-	GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
-
-	std::filesystem::path dump_path = file_prefix;
-	dump_path  = dump_path.parent_path();
-	dump_path /= RESHADE_ADDON_SHADER_SAVE_DIR;
-
-	if (std::filesystem::exists(dump_path) == false)
-		std::filesystem::create_directory(dump_path);
-
-	wchar_t hash_string[11];
-	swprintf_s(hash_string, L"0x%08X", shader_hash);
-
-	dump_path /= hash_string;
-	dump_path += extension;
-
-	std::ofstream file(dump_path, std::ios::binary);
-	file.write(static_cast<const char *>(desc.code), desc.code_size);
-}
-
 // to display debug infos, taken from clshortfuse renodx repo
 
 // to display infos on pipeline_layout, taken from clshortfuse renodx repo
@@ -338,151 +806,86 @@ static void logLayout(
 		if (param.type == reshade::api::pipeline_layout_param_type::descriptor_table) {
 			for (uint32_t rangeIndex = 0; rangeIndex < param.descriptor_table.count; ++rangeIndex) {
 				auto range = param.descriptor_table.ranges[rangeIndex];
-				std::stringstream s;
-				s << "logPipelineLayout("
-					<< reinterpret_cast<void*>(layout.handle) << "[" << paramIndex << "]"
-					<< " | TBL"
-					<< " | " << reinterpret_cast<void*>(&param.descriptor_table.ranges)
-					<< " | ";
+				const char* typeName = "???";
 				switch (range.type) {
 				case reshade::api::descriptor_type::sampler:
-					s << "SMP";
+					typeName = "SMP";
 					break;
 				case reshade::api::descriptor_type::sampler_with_resource_view:
-					s << "SMPRV";
+					typeName = "SMPRV";
 					break;
 				case reshade::api::descriptor_type::texture_shader_resource_view:
-					s << "TSRV";
+					typeName = "TSRV";
 					break;
 				case reshade::api::descriptor_type::texture_unordered_access_view:
-					s << "TUAV";
+					typeName = "TUAV";
 					break;
 				case reshade::api::descriptor_type::constant_buffer:
-					s << "CBV";
+					typeName = "CBV";
 					break;
 				case reshade::api::descriptor_type::shader_storage_buffer:
-					s << "SSB";
+					typeName = "SSB";
 					break;
 				case reshade::api::descriptor_type::acceleration_structure:
-					s << "ACC";
+					typeName = "ACC";
 					break;
-				default:
-					s << "??? (0x" << std::hex << (uint32_t)range.type << std::dec << ")";
 				}
-
-				s << ", array_size: " << range.array_size
-					<< ", binding: " << range.binding
-					<< ", count: " << range.count
-					<< ", register: " << range.dx_register_index
-					<< ", space: " << range.dx_register_space
-					<< ", visibility: " << to_string(range.visibility)
-					<< ")"
-					<< " [" << rangeIndex << "/" << param.descriptor_table.count << "]";
-				reshade::log_message(reshade::log_level::info, s.str().c_str());
+				LOG_DEBUG("logPipelineLayout(0x%llx[%u] | TBL | %p | %s (0x%x), array_size: %u, binding: %u, count: %u, register: %u, space: %u, visibility: %s) [%u/%u]",
+						  layout.handle, paramIndex, static_cast<const void*>(&param.descriptor_table.ranges), typeName, static_cast<uint32_t>(range.type), range.array_size,
+						  range.binding, range.count, range.dx_register_index, range.dx_register_space, to_string(range.visibility), rangeIndex, param.descriptor_table.count);
 			}
 		}
 		else if (param.type == reshade::api::pipeline_layout_param_type::push_constants) {
-			std::stringstream s;
-			s << "logPipelineLayout("
-				<< reinterpret_cast<void*>(layout.handle) << "[" << paramIndex << "]"
-				<< " | PC"
-				<< ", binding: " << param.push_constants.binding
-				<< ", count " << param.push_constants.count
-				<< ", register: " << param.push_constants.dx_register_index
-				<< ", space: " << param.push_constants.dx_register_space
-				<< ", visibility " << to_string(param.push_constants.visibility)
-				<< ")";
-			reshade::log_message(reshade::log_level::info, s.str().c_str());
+			LOG_DEBUG("logPipelineLayout(0x%llx[%u] | PC, binding: %u, count %u, register: %u, space: %u, visibility %s)", layout.handle, paramIndex,
+					  param.push_constants.binding, param.push_constants.count, param.push_constants.dx_register_index, param.push_constants.dx_register_space,
+					  to_string(param.push_constants.visibility));
 		}
 		else if (param.type == reshade::api::pipeline_layout_param_type::push_descriptors) {
-			std::stringstream s;
-			s << "logPipelineLayout("
-				<< reinterpret_cast<void*>(layout.handle) << "[" << paramIndex << "]"
-				<< " | PD |"
-				<< " array_size: " << param.push_descriptors.array_size
-				<< ", binding: " << param.push_descriptors.binding
-				<< ", count " << param.push_descriptors.count
-				<< ", register: " << param.push_descriptors.dx_register_index
-				<< ", space: " << param.push_descriptors.dx_register_space
-				<< ", type: " << to_string(param.push_descriptors.type)
-				<< ", visibility " << to_string(param.push_descriptors.visibility)
-				<< ")";
-			reshade::log_message(reshade::log_level::info, s.str().c_str());
+			LOG_DEBUG("logPipelineLayout(0x%llx[%u] | PD | array_size: %u, binding: %u, count %u, register: %u, space: %u, type: %s, visibility %s)", layout.handle,
+					  paramIndex, param.push_descriptors.array_size, param.push_descriptors.binding, param.push_descriptors.count, param.push_descriptors.dx_register_index,
+					  param.push_descriptors.dx_register_space, to_string(param.push_descriptors.type), to_string(param.push_descriptors.visibility));
 		}
 		else if (param.type == reshade::api::pipeline_layout_param_type::push_descriptors_with_ranges) {
-			std::stringstream s;
-			s << "logPipelineLayout("
-				<< reinterpret_cast<void*>(layout.handle) << "[" << paramIndex << "]"
-				<< " | PDR?? | "
-				<< ")";
-			reshade::log_message(reshade::log_level::info, s.str().c_str());
+			LOG_DEBUG("logPipelineLayout(0x%llx[%u] | PDR?? | )", layout.handle, paramIndex);
 #if RESHADE_API_VERSION >= 13
 		}
 		else if (param.type == reshade::api::pipeline_layout_param_type::descriptor_table_with_static_samplers) {
 			for (uint32_t rangeIndex = 0; rangeIndex < param.descriptor_table_with_static_samplers.count; ++rangeIndex) {
 				auto range = param.descriptor_table_with_static_samplers.ranges[rangeIndex];
-				std::stringstream s;
-				s << "logPipelineLayout("
-					<< reinterpret_cast<void*>(layout.handle) << "[" << paramIndex << "]"
-					<< " | TBLSS"
-					<< " | " << reinterpret_cast<void*>(&param.descriptor_table.ranges)
-					<< " | ";
-				if (range.static_samplers == nullptr) {
-					s << " null ";
+				const sampler_desc* sampler = range.static_samplers;
+				if (sampler == nullptr) {
+					LOG_DEBUG("logPipelineLayout(0x%llx[%u] | TBLSS | %p |  null ", layout.handle, paramIndex, static_cast<const void*>(&param.descriptor_table.ranges));
 				}
 				else {
-					s << ", filter: " << (uint32_t)range.static_samplers->filter;
-					s << ", address_u: " << (uint32_t)range.static_samplers->address_u;
-					s << ", address_v: " << (uint32_t)range.static_samplers->address_v;
-					s << ", address_w: " << (uint32_t)range.static_samplers->address_w;
-					s << ", mip_lod_bias: " << (uint32_t)range.static_samplers->mip_lod_bias;
-					s << ", max_anisotropy: " << (uint32_t)range.static_samplers->max_anisotropy;
-					s << ", compare_op: " << (uint32_t)range.static_samplers->compare_op;
-					s << ", border_color: [" << range.static_samplers->border_color[0] << ", " << range.static_samplers->border_color[1] << ", " << range.static_samplers->border_color[2] << ", " << range.static_samplers->border_color[3] << "]";
-					s << ", min_lod: " << range.static_samplers->min_lod;
-					s << ", max_lod: " << range.static_samplers->max_lod;
+					LOG_DEBUG("logPipelineLayout(0x%llx[%u] | TBLSS | %p | , filter: %u, address_u: %u, address_v: %u, address_w: %u, mip_lod_bias: %u, max_anisotropy: %u, "
+							  "compare_op: %u, border_color: [%g, %g, %g, %g], min_lod: %g, max_lod: %g", layout.handle, paramIndex,
+							  static_cast<const void*>(&param.descriptor_table.ranges), (uint32_t)sampler->filter, (uint32_t)sampler->address_u, (uint32_t)sampler->address_v,
+							  (uint32_t)sampler->address_w, (uint32_t)sampler->mip_lod_bias, (uint32_t)sampler->max_anisotropy, (uint32_t)sampler->compare_op,
+							  sampler->border_color[0], sampler->border_color[1], sampler->border_color[2], sampler->border_color[3], sampler->min_lod, sampler->max_lod);
 				}
-				reshade::log_message(reshade::log_level::info, s.str().c_str());
 			}
 		}
 		else if (param.type == reshade::api::pipeline_layout_param_type::push_descriptors_with_static_samplers) {
 			for (uint32_t rangeIndex = 0; rangeIndex < param.descriptor_table.count; ++rangeIndex) {
 				auto range = param.descriptor_table_with_static_samplers.ranges[rangeIndex];
-				std::stringstream s;
-				s << "logPipelineLayout("
-					<< reinterpret_cast<void*>(layout.handle) << "[" << paramIndex << "]"
-					<< " | PDSS"
-					<< " | " << reinterpret_cast<void*>(&range)
-					<< " | ";
-				if (range.static_samplers == nullptr) {
-					s << "not";
+				const sampler_desc* sampler = range.static_samplers;
+				if (sampler == nullptr) {
+					LOG_DEBUG("logPipelineLayout(0x%llx[%u] | PDSS | %p | not) [%u/%u]", layout.handle, paramIndex, static_cast<const void*>(&range), rangeIndex,
+							  param.descriptor_table.count);
 				}
 				else {
-					s << "filter: " << (uint32_t)range.static_samplers->filter
-						<< ", address_u: " << (uint32_t)range.static_samplers->address_u
-						<< ", address_v: " << (uint32_t)range.static_samplers->address_v
-						<< ", address_w: " << (uint32_t)range.static_samplers->address_w
-						<< ", mip_lod_bias: " << (uint32_t)range.static_samplers->mip_lod_bias
-						<< ", max_anisotropy: " << (uint32_t)range.static_samplers->max_anisotropy
-						<< ", compare_op: " << (uint32_t)range.static_samplers->compare_op
-						<< ", border_color: [" << range.static_samplers->border_color[0] << ", " << range.static_samplers->border_color[1] << ", " << range.static_samplers->border_color[2] << ", " << range.static_samplers->border_color[3] << "]"
-						<< ", min_lod: " << range.static_samplers->min_lod
-						<< ", max_lod: " << range.static_samplers->max_lod;
+					LOG_DEBUG("logPipelineLayout(0x%llx[%u] | PDSS | %p | filter: %u, address_u: %u, address_v: %u, address_w: %u, mip_lod_bias: %u, max_anisotropy: %u, "
+							  "compare_op: %u, border_color: [%g, %g, %g, %g], min_lod: %g, max_lod: %g) [%u/%u]", layout.handle, paramIndex, static_cast<const void*>(&range),
+							  (uint32_t)sampler->filter, (uint32_t)sampler->address_u, (uint32_t)sampler->address_v, (uint32_t)sampler->address_w,
+							  (uint32_t)sampler->mip_lod_bias, (uint32_t)sampler->max_anisotropy, (uint32_t)sampler->compare_op, sampler->border_color[0],
+							  sampler->border_color[1], sampler->border_color[2], sampler->border_color[3], sampler->min_lod, sampler->max_lod, rangeIndex,
+							  param.descriptor_table.count);
 				}
-				s << ")"
-					<< " [" << rangeIndex << "/" << param.descriptor_table.count << "]";
-				reshade::log_message(reshade::log_level::info, s.str().c_str());
 			}
 #endif
 		}
 		else {
-			std::stringstream s;
-			s << "logPipelineLayout("
-				<< reinterpret_cast<void*>(layout.handle) << "[" << paramIndex << "]"
-				<< " | ??? (0x" << std::hex << (uint32_t)param.type << std::dec << ")"
-				<< " | " << to_string(param.type)
-				<< ")";
-			reshade::log_message(reshade::log_level::info, s.str().c_str());
+			LOG_DEBUG("logPipelineLayout(0x%llx[%u] | ??? (0x%x) | %s)", layout.handle, paramIndex, static_cast<uint32_t>(param.type), to_string(param.type));
 		}
 	}
 }
@@ -498,9 +901,10 @@ static void on_init_pipeline_layout(
 		
 	    // auto &global_data = device->get_private_data<global_shared>();
 
-		logLayout(paramCount, params, layout);
-
-		std::stringstream s;
+		if (g_logger.isEnabled(LogLevel::Debug))
+		{
+			logLayout(paramCount, params, layout);
+		}
 
 		bool foundVisiblity = false;
 		uint32_t cbvIndex = 0;
@@ -547,10 +951,8 @@ static void on_init_pipeline_layout(
 		// generate data for constant_buffer or shader_resource_view
 		for (uint32_t paramIndex = 0; paramIndex < paramCount; ++paramIndex) {
 			auto param = params[paramIndex];
-			s << "* looping on  paramCount : param = " << to_string(paramIndex) << ", param.type = " << to_string(param.type) <<", param.push_descriptors.type = " << to_string(param.push_descriptors.type);
-			reshade::log_message(reshade::log_level::info, s.str().c_str());
-			s.str("");
-			s.clear();
+			LOG_DEBUG("* looping on  paramCount : param = %u, param.type = %s, param.push_descriptors.type = %s", paramIndex, to_string(param.type),
+					  to_string(param.push_descriptors.type));
 			if (param.push_descriptors.type == descriptor_type::constant_buffer)
 			{	
 				// for push descriptor : store info for CB injection
@@ -624,16 +1026,21 @@ static void on_init_pipeline_layout(
 				newParams.push_constants.dx_register_space = 0;
 				newParams.push_constants.visibility = reshade::api::shader_stage::all;
 
-				auto result = device->create_pipeline_layout(1, &newParams, &shared_data.saved_pipeline_layout);
+				// the layout is the same for every game layout, the cache creates it once and hands out the same one afterwards.
+				// The reference on the previous one is released, so nothing leaks when the layout is replaced.
+				reshade::api::pipeline_layout injectionLayout = { 0 };
+				const bool result = g_pipelineLayoutCache.acquire(device, 1, &newParams, &injectionLayout);
+				if (result)
+				{
+					if (shared_data.saved_pipeline_layout.handle != 0)
+					{
+						g_pipelineLayoutCache.release(device, shared_data.saved_pipeline_layout);
+					}
+					shared_data.saved_pipeline_layout = injectionLayout;
+				}
 
-				s << "!!! on_init_pipeline_layout("
-					<< "Creating D3D11 Layout "
-					<< reinterpret_cast<void*>(&shared_data.saved_pipeline_layout.handle)
-					<< ": " << result
-					<< " )";
-				reshade::log_message(reshade::log_level::warning, s.str().c_str());
-				s.str("");
-				s.clear();
+				LOG_DEBUG("!!! on_init_pipeline_layout(Using D3D11 Layout 0x%llx: %d, cache hits: %llu, misses: %llu )", shared_data.saved_pipeline_layout.handle,
+						  result ? 1 : 0, g_pipelineLayoutCache.getHitCount(), g_pipelineLayoutCache.getMissCount());
 				// */
 			}
 			else if (param.push_descriptors.type == descriptor_type::shader_resource_view)
@@ -644,12 +1051,7 @@ static void on_init_pipeline_layout(
 
 		} 
 
-		// std::stringstream s;
-		s << "on_init_pipeline_layout++("
-			<< reinterpret_cast<void*>(layout.handle)
-			<< " , max injections: " << (maxCount)
-			<< " )";
-		reshade::log_message(reshade::log_level::info, s.str().c_str());
+		LOG_DEBUG("on_init_pipeline_layout++(0x%llx , max injections: %u )", layout.handle, maxCount);
 }
 
 static bool on_create_pipeline_layout(
@@ -657,33 +1059,101 @@ static bool on_create_pipeline_layout(
 	uint32_t& param_count,
 	reshade::api::pipeline_layout_param*& params) 
 {
-	std::stringstream s;
-
-	// s << "on_create_pipeline_layout(" << " param count: " << param_count << ")";
-	s << "on_create_pipeline_layout()";
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	LOG_DEBUG("on_create_pipeline_layout(param count: %u)", param_count);
+	return false;
 }
 
 // create the container for global shared data in private_data of device
+/// <summary>
+/// Creates the persistent constant buffer holding the injected parameters, and the layout to bind it to CBINDEX with push_descriptors.
+/// Only done for D3D10/D3D11, other APIs (and a failed creation) keep using push_constants.
+/// </summary>
+/// <param name="device"></param>
+static void createInjectedParameterBuffer(device* device)
+{
+	if (shared_data.cb_inject_buffer.handle != 0 || (device->get_api() != device_api::d3d11 && device->get_api() != device_api::d3d10))
+	{
+		return;
+	}
+	// gpu_only so update_buffer_region can be used for the once per frame upload
+	subresource_data initialData = {};
+	initialData.data = &shared_data.cb_inject_values;
+	if (!device->create_resource(resource_desc(sizeof(ShaderInjectData), memory_heap::gpu_only, resource_usage::constant_buffer), &initialData, resource_usage::constant_buffer, &shared_data.cb_inject_buffer))
+	{
+		reshade::log_message(reshade::log_level::warning, "Creating the injected parameter buffer failed, using push_constants");
+		shared_data.cb_inject_buffer = { 0 };
+		return;
+	}
+	descriptor_range injectRange;
+	injectRange.binding = 0;
+	injectRange.dx_register_index = CBINDEX;
+	injectRange.count = 1;
+	injectRange.visibility = shader_stage::pixel;
+	injectRange.type = descriptor_type::constant_buffer;
+	const pipeline_layout_param injectParam(injectRange);
+	if (!g_pipelineLayoutCache.acquire(device, 1, &injectParam, &shared_data.cb_inject_buffer_layout))
+	{
+		reshade::log_message(reshade::log_level::warning, "Creating the injected parameter buffer layout failed, using push_constants");
+		device->destroy_resource(shared_data.cb_inject_buffer);
+		shared_data.cb_inject_buffer = { 0 };
+		return;
+	}
+	shared_data.cb_inject_device = device;
+	shared_data.cb_inject_dirty = false;
+}
+
+
+static void destroyInjectedParameterBuffer(device* device)
+{
+	if (shared_data.cb_inject_device != device)
+	{
+		return;
+	}
+	g_pipelineLayoutCache.release(device, shared_data.cb_inject_buffer_layout);
+	device->destroy_resource(shared_data.cb_inject_buffer);
+	shared_data.cb_inject_buffer_layout = { 0 };
+	shared_data.cb_inject_buffer = { 0 };
+	shared_data.cb_inject_device = nullptr;
+}
+
+
 static void on_init_device(device* device)
 {
 	
-	std::stringstream s;
-	s << "init_device("
-		<< reinterpret_cast<void*>(device)
-		<< ")";
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	LOG_INFO("init_device(%p)", static_cast<void*>(device));
+	// the draw hooks use the groups once the device is initialized.
+	ensureConfigLoaded("init_device");
 	
 	//to be defined if usefull...
 	device->create_private_data<global_shared>();
+
+	createInjectedParameterBuffer(device);
 }
 static void on_destroy_device(device* device)
 {
-	std::stringstream s;
-	s << "destroy_device("
-		<< reinterpret_cast<void*>(device)
-		<< ")";
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	LOG_INFO("destroy_device(%p)", static_cast<void*>(device));
+
+	// write what's left in the dump queue, a save and a capture in progress, can't be done in DllMain
+	g_shaderDumper.stop();
+	// the capture follows the presents of one device: destroying another one (a secondary or short lived device) has to leave an armed or
+	// running capture alone, and mustn't change its state while that device presents on another thread.
+	reshade::api::device* presentDevice = device;
+	if(g_presentDevice.compare_exchange_strong(presentDevice, nullptr))
+	{
+		s_frame_capture.stop();
+	}
+	g_configSaver.stop();
+	g_editJournal.stop();
+	g_logger.stop();
+	g_uploadImmediateCommandList.store(nullptr, std::memory_order_relaxed);
+
+	// the layouts and resources created for the device have to go before the device does.
+	destroyInjectedParameterBuffer(device);
+	if (shared_data.saved_device == device)
+	{
+		shared_data.saved_pipeline_layout = { 0 };
+	}
+	g_pipelineLayoutCache.releaseAll(device);
 
 	device->destroy_private_data<global_shared>();
 }
@@ -694,19 +1164,9 @@ static void on_init_swapchain(reshade::api::swapchain* swapchain) {
 	for (uint32_t index = 0; index < backBufferCount; index++) {
 		auto buffer = swapchain->get_back_buffer(index);
 
-		std::stringstream s;
-		s << "init_swapchain("
-			<< "buffer:" << reinterpret_cast<void*>(buffer.handle)
-			<< ")";
-		reshade::log_message(reshade::log_level::info, s.str().c_str());
+		LOG_INFO("init_swapchain(buffer:0x%llx)", buffer.handle);
 	}
-
-	std::stringstream s;
-	s << "init_swapchain"
-		// << "(colorspace: " << to_string(swapchain->get_color_space())
-		<< "(colorspace: "
-		<< ")";
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	LOG_INFO("init_swapchain(%zu back buffers)", backBufferCount);
 }
 
 static void on_init_resource(
@@ -716,46 +1176,33 @@ static void on_init_resource(
 	reshade::api::resource_usage initial_state,
 	reshade::api::resource resource
 ) {
-
-	bool warn = false;
-	std::stringstream s;
-	s << "init_resource(";
-	s << reinterpret_cast<void*>(resource.handle);
-	s << ", flags: " << std::hex << (uint32_t)desc.flags << std::dec
-		<< ", state: " << std::hex << (uint32_t)initial_state << std::dec
-		<< ", type: " << to_string(desc.type)
-		<< ", usage: " << std::hex << (uint32_t)desc.usage << std::dec;
+	const ShaderToggler::ResourceDescription description = ResourceRegistry::describeResource(desc);
+	s_resource_registry.addResource(resource, description);
+	g_memoryTracker.onCreate(description);
 
 	switch (desc.type) {
 	case reshade::api::resource_type::buffer:
-		s << ", size: " << desc.buffer.size;
-		s << ", stride: " << desc.buffer.stride;
+		LOG_DEBUG("init_resource(0x%llx, flags: %x, state: %x, type: %s, usage: %x, size: %llu, stride: %u)", resource.handle, (uint32_t)desc.flags,
+				  (uint32_t)initial_state, to_string(desc.type), (uint32_t)desc.usage, desc.buffer.size, desc.buffer.stride);
 		break;
 	case reshade::api::resource_type::texture_1d:
 	case reshade::api::resource_type::texture_2d:
 	case reshade::api::resource_type::texture_3d:
 	case reshade::api::resource_type::surface:
-		s << ", width: " << desc.texture.width
-			<< ", height: " << desc.texture.height
-			<< ", levels: " << desc.texture.levels
-		    << ", format: " << to_string(desc.texture.format);
-			//<< ", format: " ;
+		LOG_DEBUG("init_resource(0x%llx, flags: %x, state: %x, type: %s, usage: %x, width: %u, height: %u, levels: %u, format: %s)", resource.handle,
+				  (uint32_t)desc.flags, (uint32_t)initial_state, to_string(desc.type), (uint32_t)desc.usage, desc.texture.width, desc.texture.height,
+				  (uint32_t)desc.texture.levels, to_string(desc.texture.format));
 		if (desc.texture.format == reshade::api::format::unknown) {
-			warn = true;
+			LOG_WARNING("init_resource(0x%llx, type: %s, width: %u, height: %u): unknown format", resource.handle, to_string(desc.type), desc.texture.width,
+						desc.texture.height);
 		}
 		break;
 	default:
 	case reshade::api::resource_type::unknown:
+		LOG_DEBUG("init_resource(0x%llx, flags: %x, state: %x, type: %s, usage: %x)", resource.handle, (uint32_t)desc.flags, (uint32_t)initial_state,
+				  to_string(desc.type), (uint32_t)desc.usage);
 		break;
 	}
-
-	s << ")";
-	reshade::log_message(
-		warn
-		? reshade::log_level::warning
-		: reshade::log_level::info,
-		s.str().c_str()
-	);
 }
 
 static void on_init_resource_view(
@@ -785,67 +1232,215 @@ static void on_init_resource_view(
 	}
 
 	if (!forceAll && !traceRunning && presentCount >= MAX_PRESENT_COUNT) return; */
-	std::stringstream s;
-	s << "init_resource_view("
-		<< reinterpret_cast<void*>(view.handle)
-		<< ", view type: " << to_string(desc.type) << " (0x" << std::hex << (uint32_t)desc.type << std::dec << ")"
-		<< ", view format: " << to_string(desc.format) << " (0x" << std::hex << (uint32_t)desc.format << std::dec << ")"
-		<< ", resource: " << reinterpret_cast<void*>(resource.handle)
-		<< ", resource usage: " << to_string(usage_type) << " 0x" << std::hex << (uint32_t)usage_type << std::dec;
-	// if (desc.type == reshade::api::resource_view_type::buffer) return;
-	if (resource.handle) {
-		const auto resourceDesc = device->get_resource_desc(resource);
-		s << ", resource type: " << to_string(resourceDesc.type);
-
-		switch (resourceDesc.type) {
-		default:
-		case reshade::api::resource_type::unknown:
-			break;
-		case reshade::api::resource_type::buffer:
-			// if (!traceRunning) return;
-			return;
-			s << ", buffer offset: " << desc.buffer.offset;
-			s << ", buffer size: " << desc.buffer.size;
-			break;
-		case reshade::api::resource_type::texture_1d:
-		case reshade::api::resource_type::texture_2d:
-		case reshade::api::resource_type::surface:
-			s << ", texture format: " << to_string(resourceDesc.texture.format);
-			s << ", texture width: " << resourceDesc.texture.width;
-			s << ", texture height: " << resourceDesc.texture.height;
-			break;
-		case reshade::api::resource_type::texture_3d:
-			s << ", texture format: " << to_string(resourceDesc.texture.format);
-			s << ", texture width: " << resourceDesc.texture.width;
-			s << ", texture height: " << resourceDesc.texture.height;
-			s << ", texture depth: " << resourceDesc.texture.depth_or_layers;
-			break;
-		}
+	s_resource_registry.addResourceView(view, resource, usage_type, desc);
+	if (!g_logger.isEnabled(LogLevel::Debug)) {
+		return;
+	}
+	// the view got the dimensions of its resource from the registry, the device isn't asked for the resource desc
+	ShaderToggler::ResourceDescription resourceDesc;
+	if (resource.handle != 0) {
+		s_resource_registry.find(resource.handle, resourceDesc);
+	}
+	switch (static_cast<reshade::api::resource_type>(resourceDesc.type)) {
+	default:
+	case reshade::api::resource_type::unknown:
+		LOG_DEBUG("init_resource_view(0x%llx, view type: %s (0x%x), view format: %s (0x%x), resource: 0x%llx, resource usage: %s 0x%x, resource type: %s)", view.handle,
+				  to_string(desc.type), (uint32_t)desc.type, to_string(desc.format), (uint32_t)desc.format, resource.handle, to_string(usage_type), (uint32_t)usage_type,
+				  to_string(static_cast<reshade::api::resource_type>(resourceDesc.type)));
+		break;
+	case reshade::api::resource_type::buffer:
+		// if (!traceRunning) return;
+		break;
+	case reshade::api::resource_type::texture_1d:
+	case reshade::api::resource_type::texture_2d:
+	case reshade::api::resource_type::surface:
+		LOG_DEBUG("init_resource_view(0x%llx, view type: %s (0x%x), view format: %s (0x%x), resource: 0x%llx, resource usage: %s 0x%x, resource type: %s, "
+				  "texture format: %s, texture width: %u, texture height: %u)", view.handle, to_string(desc.type), (uint32_t)desc.type, to_string(desc.format),
+				  (uint32_t)desc.format, resource.handle, to_string(usage_type), (uint32_t)usage_type, to_string(static_cast<reshade::api::resource_type>(resourceDesc.type)),
+				  to_string(static_cast<reshade::api::format>(resourceDesc.format)), resourceDesc.width, resourceDesc.height);
+		break;
+	case reshade::api::resource_type::texture_3d:
+		LOG_DEBUG("init_resource_view(0x%llx, view type: %s (0x%x), view format: %s (0x%x), resource: 0x%llx, resource usage: %s 0x%x, resource type: %s, "
+				  "texture format: %s, texture width: %u, texture height: %u, texture depth: %u)", view.handle, to_string(desc.type), (uint32_t)desc.type,
+				  to_string(desc.format), (uint32_t)desc.format, resource.handle, to_string(usage_type), (uint32_t)usage_type, to_string(static_cast<reshade::api::resource_type>(resourceDesc.type)),
+				  to_string(static_cast<reshade::api::format>(resourceDesc.format)), resourceDesc.width, resourceDesc.height, (uint32_t)resourceDesc.depthOrLayers);
+		break;
 	}
-	s << ")";
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
 }
 
 static void on_destroy_resource(reshade::api::device* device, reshade::api::resource resource) {
-	std::stringstream s;
-	s << "on_destroy_resource("
-		<< reinterpret_cast<void*>(resource.handle)
-		<< ")";
-	reshade::log_message(reshade::log_level::debug, s.str().c_str());
+	// the registry has what the resource was counted with. A resource the registry rejected is described again.
+	ShaderToggler::ResourceDescription description;
+	if (s_resource_registry.find(resource.handle, description)) {
+		g_memoryTracker.onDestroy(description);
+		s_resource_registry.remove(resource.handle);
+	}
+	else if (s_resource_registry.getRejectedCount() > 0) {
+		g_memoryTracker.onDestroy(ResourceRegistry::describeResource(device->get_resource_desc(resource)));
+	}
+	LOG_DEBUG("on_destroy_resource(0x%llx)", resource.handle);
 }
 
 static void on_destroy_resource_view(reshade::api::device* device, reshade::api::resource_view view) {
-	std::stringstream s;
-	s << "on_destroy_resource_view("
-		<< reinterpret_cast<void*>(view.handle)
-		<< ")";
-	reshade::log_message(reshade::log_level::debug, s.str().c_str());
+	s_resource_registry.remove(view.handle);
+	LOG_DEBUG("on_destroy_resource_view(0x%llx)", view.handle);
 
 	/* auto& data = device->get_private_data<device_data>();
 	std::unique_lock lock(data.mutex);
 	data.resourceViews.erase(view.handle); */
 }
 
+
+/// <summary>
+/// The shaders bound on the command list, the uploads issued on it are attributed to them.
+/// </summary>
+static UploadShaders getUploadShaders(command_list* commandList)
+{
+	UploadShaders shaders;
+	if(nullptr == commandList)
+	{
+		return shaders;
+	}
+	const CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
+	shaders.pixelShaderHash = g_pixelShaderManager.getShaderHash(commandListData.activePixelShaderPipeline);
+	shaders.vertexShaderHash = g_vertexShaderManager.getShaderHash(commandListData.activeVertexShaderPipeline);
+	shaders.computeShaderHash = g_computeShaderManager.getShaderHash(commandListData.activeComputeShaderPipeline);
+	return shaders;
+}
+
+
+static ShaderToggler::ResourceDescription describeUploadResource(device* device, resource resource)
+{
+	ShaderToggler::ResourceDescription description;
+	if(!s_resource_registry.find(resource.handle, description))
+	{
+		// rejected by the registry's budget
+		description = ResourceRegistry::describeResource(device->get_resource_desc(resource));
+	}
+	return description;
+}
+
+
+/// <summary>
+/// Counts a copy as a staged upload if its source is in an upload heap, as a readback if its destination is in a readback heap.
+/// </summary>
+static void recordUploadCopy(command_list* commandList, resource source, resource dest, uint64_t bytes)
+{
+	const ShaderToggler::ResourceDescription sourceDescription = describeUploadResource(commandList->get_device(), source);
+	const ShaderToggler::ResourceDescription destDescription = describeUploadResource(commandList->get_device(), dest);
+	UploadKind kind = UploadKind::GpuCopy;
+	if(static_cast<memory_heap>(sourceDescription.heap) == memory_heap::cpu_to_gpu)
+	{
+		kind = UploadKind::StagedCopy;
+	}
+	else if(static_cast<memory_heap>(destDescription.heap) == memory_heap::gpu_to_cpu || static_cast<memory_heap>(destDescription.heap) == memory_heap::cpu_only)
+	{
+		kind = UploadKind::Readback;
+	}
+	g_uploadProfiler.record(kind, bytes, getUploadShaders(commandList));
+}
+
+
+/// <summary>
+/// update_buffer_region, update_texture_region and map_buffer_region are device calls. Under D3D9/10/11 and OpenGL they're issued on the immediate
+///	context, and are attributed to the shaders bound on it. Under D3D12 and Vulkan they're not attributed.
+/// </summary>
+static bool onUpdateBufferRegion(device* device, const void* data, resource resource, uint64_t offset, uint64_t size)
+{
+	if(g_uploadProfiler.isEnabled())
+	{
+		const uint64_t bytes = size != UINT64_MAX ? size : describeUploadResource(device, resource).size - offset;
+		g_uploadProfiler.record(UploadKind::BufferUpdate, bytes, getUploadShaders(g_uploadImmediateCommandList.load(std::memory_order_relaxed)));
+	}
+	return false;
+}
+
+
+static bool onUpdateTextureRegion(device* device, const subresource_data& data, resource resource, uint32_t subresource, const subresource_box* box)
+{
+	if(g_uploadProfiler.isEnabled())
+	{
+		const uint64_t bytes = MemoryTracker::estimateSubresourceBytes(describeUploadResource(device, resource), subresource, box);
+		g_uploadProfiler.record(UploadKind::TextureUpdate, bytes, getUploadShaders(g_uploadImmediateCommandList.load(std::memory_order_relaxed)));
+	}
+	return false;
+}
+
+
+/// <summary>
+/// unmap_buffer_region doesn't tell the size, the bytes written through a map are counted here.
+/// </summary>
+static void onMapBufferRegion(device* device, resource resource, uint64_t offset, uint64_t size, map_access access, void** data)
+{
+	if(g_uploadProfiler.isEnabled() && access != map_access::read_only)
+	{
+		const uint64_t bytes = size != UINT64_MAX ? size : describeUploadResource(device, resource).size - offset;
+		g_uploadProfiler.record(UploadKind::BufferMap, bytes, getUploadShaders(g_uploadImmediateCommandList.load(std::memory_order_relaxed)));
+	}
+}
+
+
+static bool onCopyResource(command_list* commandList, resource source, resource dest)
+{
+	countCommand(commandList, CommandKind::Copy);
+	if(g_uploadProfiler.isEnabled())
+	{
+		recordUploadCopy(commandList, source, dest, MemoryTracker::estimateBytes(describeUploadResource(commandList->get_device(), source)));
+	}
+	return false;
+}
+
+
+static bool onCopyBufferRegion(command_list* commandList, resource source, uint64_t sourceOffset, resource dest, uint64_t destOffset, uint64_t size)
+{
+	countCommand(commandList, CommandKind::Copy);
+	if(g_uploadProfiler.isEnabled())
+	{
+		const uint64_t bytes = size != UINT64_MAX ? size : describeUploadResource(commandList->get_device(), source).size - sourceOffset;
+		recordUploadCopy(commandList, source, dest, bytes);
+	}
+	return false;
+}
+
+
+static bool onCopyBufferToTexture(command_list* commandList, resource source, uint64_t sourceOffset, uint32_t rowLength, uint32_t sliceHeight, resource dest,
+								  uint32_t destSubresource, const subresource_box* destBox)
+{
+	countCommand(commandList, CommandKind::Copy);
+	if(g_uploadProfiler.isEnabled())
+	{
+		const uint64_t bytes = MemoryTracker::estimateSubresourceBytes(describeUploadResource(commandList->get_device(), dest), destSubresource, destBox);
+		recordUploadCopy(commandList, source, dest, bytes);
+	}
+	return false;
+}
+
+
+static bool onCopyTextureRegion(command_list* commandList, resource source, uint32_t sourceSubresource, const subresource_box* sourceBox, resource dest,
+								uint32_t destSubresource, const subresource_box* destBox, filter_mode filter)
+{
+	countCommand(commandList, CommandKind::Copy);
+	if(g_uploadProfiler.isEnabled())
+	{
+		const uint64_t bytes = MemoryTracker::estimateSubresourceBytes(describeUploadResource(commandList->get_device(), source), sourceSubresource, sourceBox);
+		recordUploadCopy(commandList, source, dest, bytes);
+	}
+	return false;
+}
+
+
+static bool onCopyTextureToBuffer(command_list* commandList, resource source, uint32_t sourceSubresource, const subresource_box* sourceBox, resource dest,
+								  uint64_t destOffset, uint32_t rowLength, uint32_t sliceHeight)
+{
+	countCommand(commandList, CommandKind::Copy);
+	if(g_uploadProfiler.isEnabled())
+	{
+		const uint64_t bytes = MemoryTracker::estimateSubresourceBytes(describeUploadResource(commandList->get_device(), source), sourceSubresource, sourceBox);
+		recordUploadCopy(commandList, source, dest, bytes);
+	}
+	return false;
+}
+
 //********************************
 
 void on_bind_descriptor_tables(
@@ -856,16 +1451,16 @@ void on_bind_descriptor_tables(
 	uint32_t count,
 	const reshade::api::descriptor_table* tables
 ) {
-	std::stringstream s;
-	s << "on_bind_descriptor_tables()";
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	countCommand(cmd_list, CommandKind::DescriptorBind);
+	LOG_TRACE("on_bind_descriptor_tables(stages: %s, layout: 0x%llx, first: %u, count: %u)", to_string(stages), layout.handle, first, count);
 }
 
+/// Imported from reshade example shader_dump_addon.cpp, the shader code is written (or cached, see ShaderDumpPolicy) by g_shaderDumper on its own thread
 static bool on_create_pipeline(device *device, pipeline_layout, uint32_t subobject_count, const pipeline_subobject *subobjects)
 {
 	const device_api device_type = device->get_api();
 
-	// Go through all shader stages that are in this pipeline and dump the associated shader code
+	// Go through all shader stages that are in this pipeline and queue the associated shader code for dumping
 	for (uint32_t i = 0; i < subobject_count; ++i)
 	{
 		switch (subobjects[i].type)
@@ -884,7 +1479,7 @@ static bool on_create_pipeline(device *device, pipeline_layout, uint32_t subobje
 		case pipeline_subobject_type::miss_shader:
 		case pipeline_subobject_type::intersection_shader:
 		case pipeline_subobject_type::callable_shader:
-			save_shader_code(device_type, *static_cast<const shader_desc *>(subobjects[i].data));
+			g_shaderDumper.addShader(device_type, subobjects[i].type, *static_cast<const shader_desc *>(subobjects[i].data));
 			break;
 		}
 	}
@@ -900,18 +1495,12 @@ static bool on_create_pipeline(device *device, pipeline_layout, uint32_t subobje
 /// End of example shader_dump_addon.cpp
 
 /// <summary>
-/// This function will return true if the command list specified has one or more shader hashes which are currently marked to be hidden. Otherwise false.
+/// This function will return true if the command list has one or more shader hashes which are currently marked to be hidden. Otherwise false.
 /// </summary>
-/// <param name="commandList"></param>
+/// <param name="commandListData"></param>
 /// <returns>true if the draw call has to be blocked</returns>
-bool blockDrawCallForCommandList(command_list* commandList)
+bool blockDrawCallForCommandList(const CommandListDataContainer& commandListData)
 {
-	if (nullptr == commandList)
-	{
-		return false;
-	}
-
-	const CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
 	uint32_t shaderHash = g_pixelShaderManager.getShaderHash(commandListData.activePixelShaderPipeline);
 	bool blockCall = g_pixelShaderManager.isBlockedShader(shaderHash);
 	for (auto& group : g_toggleGroups)
@@ -939,9 +1528,17 @@ bool blockDrawCallForCommandList(command_list* commandList)
 static void on_bind_pipeline(command_list* commandList, pipeline_stage stages, pipeline pipelineHandle)
 {
 	
-	uint64_t shaderHash; 
+	uint64_t shaderHash = 0;
+	uint32_t pixelShaderHash = 0;
+	uint32_t vertexShaderHash = 0;
 	
-	if(nullptr != commandList && pipelineHandle.handle != 0)
+	if(nullptr == commandList)
+	{
+		return;
+	}
+	CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
+	commandListData.commandCounts.add(CommandKind::PipelineBind);
+	if(pipelineHandle.handle != 0)
 	{
 		const bool handleHasPixelShaderAttached = g_pixelShaderManager.isKnownHandle(pipelineHandle.handle);
 		const bool handleHasVertexShaderAttached = g_vertexShaderManager.isKnownHandle(pipelineHandle.handle);
@@ -951,12 +1548,14 @@ static void on_bind_pipeline(command_list* commandList, pipeline_stage stages, p
 			// draw call with unknown handle, don't collect it
 			return;
 		}
-		CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
 		
 
-		if (handleHasPixelShaderAttached) shaderHash = g_pixelShaderManager.getShaderHash(pipelineHandle.handle);		
-		if (handleHasVertexShaderAttached) shaderHash = g_vertexShaderManager.getShaderHash(pipelineHandle.handle);
+		if (handleHasPixelShaderAttached) shaderHash = pixelShaderHash = g_pixelShaderManager.getShaderHash(pipelineHandle.handle);		
+		if (handleHasVertexShaderAttached) shaderHash = vertexShaderHash = g_vertexShaderManager.getShaderHash(pipelineHandle.handle);
 		if (handleHasComputeShaderAttached) shaderHash = g_computeShaderManager.getShaderHash(pipelineHandle.handle);
+		// a graphics pipeline can have both, shaderHash is the vertex shader then
+		s_frame_capture.checkShaderBind(static_cast<uint32_t>(shaderHash));
+		s_frame_capture.checkShaderBind(pixelShaderHash);
 
 
 		// always do the following code as that has to run for every bind on a pipeline:
@@ -1020,9 +1619,8 @@ static void on_bind_pipeline(command_list* commandList, pipeline_stage stages, p
 		}
 
 		// inject a cb containing mod paramter and replace the shader by the cloned one if it is in the blocked list 
-		if (blockDrawCallForCommandList(commandList) && handleHasPixelShaderAttached && constant_color) 
+		if (blockDrawCallForCommandList(commandListData) && handleHasPixelShaderAttached && constant_color) 
 		{
-			std::stringstream s;
 			//clone pipeline
 			auto pipelineCloned = pipelineCloneMap.find(pipelineHandle.handle);
 			if (pipelineCloned != pipelineCloneMap.end()) {
@@ -1053,38 +1651,67 @@ static void on_bind_pipeline(command_list* commandList, pipeline_stage stages, p
 					values	Pointer to the first element of an array of 32-bit values to set the constants to. These can be floating-point, integer or boolean depending on what the shader is expecting.
 				*/
 
-				commandList->push_constants(
-					shader_stage::pixel,  
-					shared_data.saved_pipeline_layout,
-					0,
-					0,
-					CBSIZE,
-					&shared_data.cb_inject_values
-				); 
-				s << "!!! push_constant !!!, layout =  " << reinterpret_cast<void*>(&shared_data.saved_pipeline_layout.handle) << ";";
-				reshade::log_message(reshade::log_level::info, s.str().c_str());
-				s.str("");
-				s.clear();
+				if (shared_data.cb_inject_buffer.handle != 0)
+				{
+					// the values are in the persistent buffer, uploaded once per frame at present: it only has to be bound once on this command list.
+					if (!commandListData.hasPushedInjectData || commandListData.pushedInjectLayout != shared_data.cb_inject_buffer_layout.handle)
+					{
+						const buffer_range injectBufferRange = { shared_data.cb_inject_buffer, 0, sizeof(ShaderInjectData) };
+						descriptor_table_update injectUpdate = {};
+						injectUpdate.binding = 0;
+						injectUpdate.count = 1;
+						injectUpdate.type = descriptor_type::constant_buffer;
+						injectUpdate.descriptors = &injectBufferRange;
+						commandList->push_descriptors(shader_stage::pixel, shared_data.cb_inject_buffer_layout, 0, injectUpdate);
+						commandListData.hasPushedInjectData = true;
+						commandListData.pushedInjectLayout = shared_data.cb_inject_buffer_layout.handle;
+						++g_injectPushesIssued;
+					}
+					else
+					{
+						++g_injectPushesElided;
+					}
+				}
+				// only push when the values or the layout changed since the last push on this command list
+				else if (!commandListData.hasPushedInjectData || commandListData.pushedInjectLayout != shared_data.saved_pipeline_layout.handle
+					|| memcmp(&commandListData.pushedInjectData, &shared_data.cb_inject_values, sizeof(ShaderInjectData)) != 0)
+				{
+					commandList->push_constants(
+						shader_stage::pixel,  
+						shared_data.saved_pipeline_layout,
+						0,
+						0,
+						CBSIZE,
+						&shared_data.cb_inject_values
+					); 
+					commandListData.hasPushedInjectData = true;
+					commandListData.pushedInjectLayout = shared_data.saved_pipeline_layout.handle;
+					commandListData.pushedInjectData = shared_data.cb_inject_values;
+					++g_injectPushesIssued;
+
+					if (s_frame_capture.isCapturing())
+					{
+						s_frame_capture.record(CaptureEventId::InjectPushConstants, reinterpret_cast<uint64_t>(commandList), shared_data.saved_pipeline_layout.handle);
+					}
+				}
+				else
+				{
+					++g_injectPushesElided;
+				}
 				
 				//replace pipeline by the clone
 				auto newPipeline = pipelineCloned->second;
 				commandList->bind_pipeline(stages, newPipeline);
-				s << "pipeline Pixel replaced ("
-					<< reinterpret_cast<void*>(pipelineHandle.handle)
-					<< ")";
-
-				reshade::log_message(reshade::log_level::info, s.str().c_str());
-				s.str("");
-				s.clear();
+				if (s_frame_capture.isCapturing())
+				{
+					s_frame_capture.record(CaptureEventId::PipelineReplaced, reinterpret_cast<uint64_t>(commandList), pipelineHandle.handle);
+				}
 			}
 		}
 	}
 
-	if (s_do_capture) {
-		std::stringstream s;
-		s << "bind_pipeline(" << to_string(stages)<< " : " << (void *)shaderHash << ", pipelineHandle: " << (void *)pipelineHandle.handle << ")";
-
-		reshade::log_message(reshade::log_level::info, s.str().c_str());
+	if (s_frame_capture.isCapturing()) {
+		s_frame_capture.record(CaptureEventId::BindPipeline, reinterpret_cast<uint64_t>(commandList), static_cast<uint64_t>(stages), shaderHash, pipelineHandle.handle, pixelShaderHash, vertexShaderHash);
 	}
 }
 
@@ -1094,16 +1721,19 @@ static void on_bind_pipeline(command_list* commandList, pipeline_stage stages, p
 static bool on_draw(command_list* commandList, uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance)
 {
 	
-	if (s_do_capture)
+	if (s_frame_capture.isCapturing())
 	{
-		std::stringstream s;
-		s << "draw(" << vertex_count << ", " << instance_count << ", " << first_vertex << ", " << first_instance << ")";
-
-		reshade::log_message(reshade::log_level::info, s.str().c_str());
+		s_frame_capture.record(CaptureEventId::Draw, reinterpret_cast<uint64_t>(commandList), vertex_count, instance_count, first_vertex, first_instance);
+	}
+	if (nullptr == commandList)
+	{
+		return false;
 	}
+	CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
+	commandListData.commandCounts.add(CommandKind::Draw);
 	// check if for this command list the active shader handles are part of the blocked set. If so, return true
 	if (!constant_color) 
-		return blockDrawCallForCommandList(commandList);
+		return blockDrawCallForCommandList(commandListData);
 	else
 		return false;
 }
@@ -1111,16 +1741,19 @@ static bool on_draw(command_list* commandList, uint32_t vertex_count, uint32_t i
 
 static bool onDrawIndexed(command_list* commandList, uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
 {
-	if (s_do_capture)
+	if (s_frame_capture.isCapturing())
 	{
-		std::stringstream s;
-		s << "draw_indexed(" << index_count << ", " << instance_count << ", " << first_index << ", " << vertex_offset << ", " << first_instance << ")";
-
-		reshade::log_message(reshade::log_level::info, s.str().c_str());
+		s_frame_capture.record(CaptureEventId::DrawIndexed, reinterpret_cast<uint64_t>(commandList), index_count, instance_count, first_index, static_cast<uint32_t>(vertex_offset), first_instance);
+	}
+	if (nullptr == commandList)
+	{
+		return false;
 	}
+	CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
+	commandListData.commandCounts.add(CommandKind::DrawIndexed);
 	// same as onDraw
 	if (!constant_color)
-		return blockDrawCallForCommandList(commandList);
+		return blockDrawCallForCommandList(commandListData);
 	else
 		return false;
 }
@@ -1128,39 +1761,21 @@ static bool onDrawIndexed(command_list* commandList, uint32_t index_count, uint3
 
 static bool onDrawOrDispatchIndirect(command_list* commandList, indirect_command type, resource buffer, uint64_t offset, uint32_t draw_count, uint32_t stride)
 {
-	std::stringstream s;
-	switch(type)
+	if (s_frame_capture.isCapturing())
 	{
-		case indirect_command::unknown:
-			if (s_do_capture) 
-				s << "draw_or_dispatch_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-			break;
-		case indirect_command::draw:
-			if (s_do_capture) 
-				s << "draw_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-			break;
-		case indirect_command::draw_indexed:
-			if (s_do_capture) 
-				s << "draw_indexed_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-			break;
-		case indirect_command::dispatch:
-			if (s_do_capture) 
-				s << "dispatch_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-			// same as OnDraw
-			if (!constant_color)
-				return blockDrawCallForCommandList(commandList);
-		// the rest aren't blocked
-		case indirect_command::dispatch_mesh:
-			if (s_do_capture) 
-				s << "dispatch_mesh_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-			break;
-			
-		case indirect_command::dispatch_rays:
-			if (s_do_capture) 
-					s << "dispatch_rays_indirect(" << (void *)buffer.handle << ", " << offset << ", " << draw_count << ", " << stride << ")";
-			break;
+		s_frame_capture.record(CaptureEventId::DrawOrDispatchIndirect, reinterpret_cast<uint64_t>(commandList), static_cast<uint64_t>(type), buffer.handle, offset, draw_count, stride);
+	}
+	if (nullptr == commandList)
+	{
+		return false;
+	}
+	CommandListDataContainer& commandListData = commandList->get_private_data<CommandListDataContainer>();
+	commandListData.commandCounts.add(type == indirect_command::dispatch ? CommandKind::Dispatch : CommandKind::DrawIndirect);
+	// only dispatches are blocked, same as OnDraw
+	if (type == indirect_command::dispatch && !constant_color)
+	{
+		return blockDrawCallForCommandList(commandListData);
 	}
-	if (s_do_capture) reshade::log_message(reshade::log_level::info, s.str().c_str());
 	return false;
 }
 
@@ -1193,8 +1808,241 @@ static void displayShaderManagerStats(ShaderManager& toDisplay, const char* shad
 }
 
 
+static void displayCommandCensus()
+{
+	uint64_t drawCount = 0;
+	uint64_t dispatchCount = 0;
+	uint64_t commandListCount = 0;
+	for(uint32_t i = 0; i < g_commandCensus.getQueueCount(); ++i)
+	{
+		const QueueCensus& census = g_commandCensus.getQueue(i);
+		drawCount += census.lastFrame[static_cast<size_t>(CommandKind::Draw)] + census.lastFrame[static_cast<size_t>(CommandKind::DrawIndexed)]
+			+ census.lastFrame[static_cast<size_t>(CommandKind::DrawIndirect)];
+		dispatchCount += census.lastFrame[static_cast<size_t>(CommandKind::Dispatch)];
+		commandListCount += census.lastFrameCommandLists;
+	}
+	ImGui::Text("Last frame: %llu draws, %llu dispatches in %llu command lists.", drawCount, dispatchCount, commandListCount);
+	if(!ImGui::TreeNode("Commands per frame"))
+	{
+		return;
+	}
+	for(uint32_t i = 0; i < g_commandCensus.getQueueCount(); ++i)
+	{
+		const QueueCensus& census = g_commandCensus.getQueue(i);
+		if(!census.isActive)
+		{
+			continue;
+		}
+		const command_queue_type type = static_cast<command_queue_type>(census.type);
+		// the queues past the slots are counted together, their types too
+		char queueName[32];
+		if(i == CommandCensus::OverflowQueueIndex)
+		{
+			snprintf(queueName, sizeof(queueName), "Other queues");
+		}
+		else
+		{
+			snprintf(queueName, sizeof(queueName), "Queue %u", i);
+		}
+		ImGui::Text("%s (%s%s%s): %llu command lists, %.1f on average, the largest with %u commands.", queueName, (type & command_queue_type::graphics) != 0 ? "graphics " : "",
+			(type & command_queue_type::compute) != 0 ? "compute " : "", (type & command_queue_type::copy) != 0 ? "copy" : "", census.lastFrameCommandLists,
+			census.averageCommandLists, census.lastFrameLargestCommandList);
+		ImGui::PushID(static_cast<int>(i));
+		if(ImGui::BeginTable("Commands", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+		{
+			ImGui::TableSetupColumn("Command");
+			ImGui::TableSetupColumn("Last frame");
+			ImGui::TableSetupColumn("Average");
+			ImGui::TableSetupColumn("Peak");
+			ImGui::TableHeadersRow();
+			for(uint32_t kind = 0; kind < static_cast<uint32_t>(CommandKind::Count); ++kind)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(getCommandKindName(static_cast<CommandKind>(kind)));
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", census.lastFrame[kind]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f", census.average[kind]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%llu", census.peak[kind]);
+			}
+			ImGui::EndTable();
+		}
+		ImGui::PopID();
+	}
+	ImGui::TreePop();
+}
+
+
+static void displayFrameCaptureStats()
+{
+	const ShaderToggler::CaptureStatistics statistics = s_frame_capture.getStatistics();
+	if(statistics.captureCount == 0)
+	{
+		ImGui::TextUnformatted("No frame captured yet.");
+		return;
+	}
+	ImGui::Text("Capture %u (%s): %u frames, %llu events, %llu dropped, written in %.1f ms.", statistics.captureCount, ShaderToggler::getCaptureTriggerName(statistics.trigger),
+		statistics.frameCount, statistics.eventCount, statistics.droppedEventCount, statistics.writeMilliseconds);
+	if(!statistics.fileName.empty())
+	{
+		ImGui::Text("Capture file: %s", statistics.fileName.c_str());
+	}
+	if(!statistics.traceFileName.empty())
+	{
+		ImGui::Text("Trace file: %s", statistics.traceFileName.c_str());
+	}
+}
+
+
+static void displayMemoryStats()
+{
+	constexpr double megabyte = 1024.0 * 1024.0;
+	const ShaderToggler::MemorySnapshot& snapshot = g_memoryTracker.getSnapshot();
+	const ShaderToggler::MemoryTotals& total = snapshot.get(MemoryCategory::Total);
+	ImGui::Text("%lld resources, %.1f MB, peak %.1f MB.", total.count, static_cast<double>(total.bytes) / megabyte, static_cast<double>(total.peakBytes) / megabyte);
+	ImGui::Text("Last frame: %llu created (%.2f MB), %llu destroyed (%.2f MB). Churn: %.2f MB per frame.", snapshot.allocationCount,
+		static_cast<double>(snapshot.allocatedBytes) / megabyte, snapshot.releaseCount, static_cast<double>(snapshot.freedBytes) / megabyte, snapshot.churnBytesPerFrame / megabyte);
+}
+
+
+static void displayMemoryCategories()
+{
+	constexpr double megabyte = 1024.0 * 1024.0;
+	const ShaderToggler::MemorySnapshot& snapshot = g_memoryTracker.getSnapshot();
+	if(ImGui::BeginTable("GPU memory", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+	{
+		ImGui::TableSetupColumn("Category");
+		ImGui::TableSetupColumn("MB");
+		ImGui::TableSetupColumn("Peak MB");
+		ImGui::TableSetupColumn("Resources");
+		ImGui::TableHeadersRow();
+		for(uint32_t i = static_cast<uint32_t>(MemoryCategory::Total) + 1; i < static_cast<uint32_t>(MemoryCategory::Count); ++i)
+		{
+			const MemoryCategory category = static_cast<MemoryCategory>(i);
+			const ShaderToggler::MemoryTotals& totals = snapshot.get(category);
+			if(totals.peakBytes == 0 && totals.count == 0)
+			{
+				continue;
+			}
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(ShaderToggler::getMemoryCategoryName(category));
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", static_cast<double>(totals.bytes) / megabyte);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", static_cast<double>(totals.peakBytes) / megabyte);
+			ImGui::TableNextColumn();
+			ImGui::Text("%lld", totals.count);
+		}
+		ImGui::EndTable();
+	}
+}
+
+
+static void displayUploadStats()
+{
+	constexpr double megabyte = 1024.0 * 1024.0;
+	const UploadFrame& frame = g_uploadProfiler.getLastFrame();
+	ImGui::PlotHistogram("MB per frame", g_uploadProfiler.getHistoryMegabytes(), static_cast<int>(UploadProfiler::HistoryFrameCount), g_uploadProfiler.getHistoryOffset(),
+		nullptr, 0.0f, FLT_MAX, ImVec2(0, 80));
+	for(uint32_t i = 0; i < static_cast<uint32_t>(UploadKind::Count); ++i)
+	{
+		const UploadKind kind = static_cast<UploadKind>(i);
+		ImGui::Text("%s: %.2f MB in %llu calls, %.1f MB total.", getUploadKindName(kind), static_cast<double>(frame.get(kind).bytes) / megabyte, frame.get(kind).calls,
+			static_cast<double>(g_uploadProfiler.getSessionTotals().get(kind).bytes) / megabyte);
+	}
+	ImGui::Text("Not attributed to shaders: %llu calls.", g_uploadProfiler.getUnattributedCount());
+	if(ImGui::BeginTable("Uploads", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+	{
+		ImGui::TableSetupColumn("Pixel shader");
+		ImGui::TableSetupColumn("Vertex shader");
+		ImGui::TableSetupColumn("Compute shader");
+		ImGui::TableSetupColumn("MB last frame");
+		ImGui::TableSetupColumn("MB total");
+		ImGui::TableHeadersRow();
+		for(const UploadShaderTotals& totals : g_uploadProfiler.getTopShaders())
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%08X", totals.shaders.pixelShaderHash);
+			ImGui::TableNextColumn();
+			ImGui::Text("%08X", totals.shaders.vertexShaderHash);
+			ImGui::TableNextColumn();
+			ImGui::Text("%08X", totals.shaders.computeShaderHash);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f (%llu)", static_cast<double>(totals.frame.bytes) / megabyte, totals.frame.calls);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", static_cast<double>(totals.session.bytes) / megabyte);
+		}
+		ImGui::EndTable();
+	}
+}
+
+
+static void displayShaderDumperStats()
+{
+	ImGui::Text("Shader dump: %llu queued, %llu written, %llu skipped, %llu dropped, %llu waiting.", g_shaderDumper.getQueuedCount(), g_shaderDumper.getWrittenCount(),
+		g_shaderDumper.getSkippedCount(), g_shaderDumper.getDroppedCount(), static_cast<uint64_t>(g_shaderDumper.getPendingCount()));
+	ImGui::Text("Code cache: %llu shaders, %.1f MB, %llu evicted.", static_cast<uint64_t>(g_shaderDumper.getCachedCount()),
+		static_cast<double>(g_shaderDumper.getCachedBytes()) / (1024.0 * 1024.0), g_shaderDumper.getEvictedCount());
+	const uint64_t compressedRawBytes = g_shaderDumper.getCompressedRawBytes();
+	if(compressedRawBytes > 0)
+	{
+		const double rawMegabytes = static_cast<double>(compressedRawBytes) / (1024.0 * 1024.0);
+		ImGui::Text("Compression: %.1f MB in, ratio %.2f, %.2f ms CPU per MB.", rawMegabytes, static_cast<double>(compressedRawBytes) / static_cast<double>(g_shaderDumper.getCompressedStoredBytes()),
+			static_cast<double>(g_shaderDumper.getCompressionNanoseconds()) / 1000000.0 / rawMegabytes);
+	}
+}
+
+
+static void displayPipelineLayoutCacheStats()
+{
+	ImGui::Text("Injection layouts: %llu live, %llu requests reused, %llu created, %llu destroyed.", static_cast<uint64_t>(g_pipelineLayoutCache.getLayoutCount()),
+		g_pipelineLayoutCache.getHitCount(), g_pipelineLayoutCache.getMissCount(), g_pipelineLayoutCache.getDestroyedCount());
+	const uint64_t pushesIssued = g_injectPushesIssued;
+	const uint64_t pushesElided = g_injectPushesElided;
+	ImGui::Text("cb%d %s: %llu issued, %llu skipped as unchanged. Buffer uploads: %llu.", CBINDEX, shared_data.cb_inject_buffer.handle != 0 ? "binds" : "pushes",
+		pushesIssued, pushesElided, static_cast<uint64_t>(g_injectBufferUploads));
+}
+
+
+static bool displayInjectedParameter(const char* label, float& value, float minValue, float maxValue, const char* format)
+{
+	return ImGui::SliderFloat(label, &value, minValue, maxValue, format);
+}
+
+
+static bool displayInjectedParameter(const char* label, int& value, int minValue, int maxValue, const char* format)
+{
+	return ImGui::SliderInt(label, &value, minValue, maxValue, format);
+}
+
+
+/// <summary>
+/// Displays a slider per parameter in SHADER_INJECT_PARAMETERS (see mod_parameters.h) which has a label. Changed values are uploaded at the next present.
+/// </summary>
+static void displayInjectedParameters()
+{
+	bool changed = false;
+#define SHADER_INJECT_DISPLAY_PARAMETER(type, name, offset, defaultValue, minValue, maxValue, label, format) \
+	if (label[0] != '\0') \
+	{ \
+		changed |= displayInjectedParameter(label, shared_data.cb_inject_values.name, static_cast<type>(minValue), static_cast<type>(maxValue), format); \
+	}
+	SHADER_INJECT_PARAMETERS(SHADER_INJECT_DISPLAY_PARAMETER)
+#undef SHADER_INJECT_DISPLAY_PARAMETER
+	if (changed)
+	{
+		shared_data.cb_inject_dirty = true;
+	}
+}
+
+
 static void onReshadeOverlay(reshade::api::effect_runtime *runtime)
 {
+	ensureConfigLoaded("reshade_overlay");
 	if(g_toggleGroupIdShaderEditing>=0)
 	{
 		ImGui::SetNextWindowBgAlpha(g_overlayOpacity);
@@ -1218,6 +2066,7 @@ static void onReshadeOverlay(reshade::api::effect_runtime *runtime)
 		displayShaderManagerStats(g_vertexShaderManager, "vertex");
 		displayShaderManagerStats(g_pixelShaderManager, "pixel");
 		displayShaderManagerStats(g_computeShaderManager, "compute");
+		displayCommandCensus();
 
 		if(g_activeCollectorFrameCounter > 0)
 		{
@@ -1239,93 +2088,201 @@ static void onReshadeOverlay(reshade::api::effect_runtime *runtime)
 }
 
 
-
-static void onReshadePresent(effect_runtime* runtime)
+/// <summary>
+/// Passes the shaders to dump with the selective dump policies to the shader dumper. ToggleGroups: the hashes of all groups, plus the ones marked
+/// for the group being edited as its hashes are moved to the shader managers while editing. HuntedOrMarked: the hunted and marked shaders.
+/// </summary>
+static void updateShaderDumpSelection()
 {
-
-	if (s_do_capture)
+	std::unordered_set<uint32_t> selectedHashes;
+	switch(g_shaderDumper.getDumpPolicy())
 	{
-		reshade::log_message(reshade::log_level::info, "present()");
-		reshade::log_message(reshade::log_level::info, "--- End Frame ---");
-		s_do_capture = false;
-	}
-	else
-	{
-		// The keyboard shortcut to trigger logging
-		if (runtime->is_key_pressed(VK_F1))
+	case ShaderToggler::ShaderDumpPolicy::ToggleGroups:
+		for(const auto& group : g_toggleGroups)
+		{
+			selectedHashes.merge(group.getPixelShaderHashes());
+			selectedHashes.merge(group.getVertexShaderHashes());
+			selectedHashes.merge(group.getComputeShaderHashes());
+		}
+		// the marked shaders are added for both
+		[[fallthrough]];
+	case ShaderToggler::ShaderDumpPolicy::HuntedOrMarked:
+		for(ShaderManager* manager : { &g_pixelShaderManager, &g_vertexShaderManager, &g_computeShaderManager })
 		{
-			s_do_capture = true;
-			reshade::log_message(reshade::log_level::info, "--- Frame ---");
+			selectedHashes.merge(manager->getMarkedShaderHashes());
+			if(g_shaderDumper.getDumpPolicy() == ShaderToggler::ShaderDumpPolicy::HuntedOrMarked && manager->isInHuntingMode() && manager->getActiveHuntedShaderHash() != 0)
+			{
+				selectedHashes.emplace(manager->getActiveHuntedShaderHash());
+			}
 		}
+		break;
+	default:
+		// Off and All don't use a selection
+		break;
 	}
+	g_shaderDumper.setSelectedHashes(std::move(selectedHashes));
+}
 
 
-	if(g_activeCollectorFrameCounter>0)
+/// <summary>
+/// Binds the toggle keys of the groups and the command keys in g_keyBindingTable. Only done when a binding changed: present then reads just
+/// the bound keys and looks up the actions of the pressed ones, instead of asking the runtime about every group's key.
+/// </summary>
+static void rebuildKeyBindingTable()
+{
+	g_keyBindingTable.clear();
+	for(auto& group : g_toggleGroups)
 	{
-		--g_activeCollectorFrameCounter;
+		g_keyBindingTable.bind(group.getToggleKey(), group.getToggleKeyModifierMask(), true, group.getId());
 	}
+	for(size_t i = 0; i < KEY_COMMAND_COUNT; ++i)
+	{
+		g_keyBindingTable.bind(g_commandKeys[i].getKeyCode(), g_commandKeys[i].getModifierMask(), false, static_cast<int32_t>(i));
+	}
+}
+
 
-	for(auto& group: g_toggleGroups)
+/// <summary>
+/// Toggles the group with the id passed in. If the group's shaders are being edited, it toggles the ones currently marked too.
+/// </summary>
+static void toggleGroupByKey(int groupId)
+{
+	for(auto& group : g_toggleGroups)
 	{
-		if(group.isToggleKeyPressed(runtime))
+		if(group.getId() == groupId)
 		{
 			group.toggleActive();
-			// if the group's shaders are being edited, it should toggle the ones currently marked.
 			if(group.getId() == g_toggleGroupIdShaderEditing)
 			{
 				g_vertexShaderManager.toggleHideMarkedShaders();
 				g_pixelShaderManager.toggleHideMarkedShaders();
 				g_computeShaderManager.toggleHideMarkedShaders();
 			}
+			return;
 		}
 	}
+}
+
+
+static void onReshadePresent(effect_runtime* runtime)
+{
+	ensureConfigLoaded("reshade_present");
 
-	// hardcoded hunting keys.
-	// If Ctrl is pressed too, it'll step to the next marked shader (if any)
-	// Numpad 1: previous pixel shader
-	// Numpad 2: next pixel shader
-	// Numpad 3: mark current pixel shader as part of the toggle group
-	// Numpad 4: previous vertex shader
-	// Numpad 5: next vertex shader
-	// Numpad 6: mark current vertex shader as part of the toggle group
-	// Numpad 7: previous compute shader
-	// Numpad 8: next compute shader
-	// Numpad 9: mark current compute shader as part of the toggle group
-	if(runtime->is_key_pressed(VK_NUMPAD1))
+	// read the keys once for this frame (all of them while the overlay collects a new binding) and run the actions bound to the pressed ones.
+	if(g_keyBindingsChanged.exchange(false))
 	{
-		g_pixelShaderManager.huntPreviousShader(runtime->is_key_down(VK_CONTROL));
+		rebuildKeyBindingTable();
 	}
-	if(runtime->is_key_pressed(VK_NUMPAD2))
+	g_keyboardSnapshot.update(runtime, g_keyBindingTable.getBoundKeys(), g_toggleGroupIdKeyBindingEditing >= 0);
+	static_assert(KEY_COMMAND_COUNT <= 32, "the fired commands are a 32 bit mask");
+	uint32_t firedCommands = 0;
+	g_keyBindingTable.dispatch(g_keyboardSnapshot, [&firedCommands](const KeyBindingTable::BoundAction& action)
+		{
+			if(action.isGroupToggle)
+			{
+				toggleGroupByKey(action.target);
+			}
+			else
+			{
+				firedCommands |= 1u << action.target;
+			}
+		});
+	auto isCommandFired = [firedCommands](KeyCommand command) { return (firedCommands & (1u << static_cast<uint32_t>(command))) != 0; };
+
+	// upload the injected parameters once per frame, and only if they changed. The draw path only binds the buffer.
+	if(shared_data.cb_inject_dirty)
 	{
-		g_pixelShaderManager.huntNextShader(runtime->is_key_down(VK_CONTROL));
+		shared_data.cb_inject_dirty = false;
+		if(shared_data.cb_inject_buffer.handle != 0 && runtime->get_device() == shared_data.cb_inject_device)
+		{
+			shared_data.cb_inject_device->update_buffer_region(&shared_data.cb_inject_values, shared_data.cb_inject_buffer, 0, sizeof(ShaderInjectData));
+			++g_injectBufferUploads;
+		}
 	}
-	if(runtime->is_key_pressed(VK_NUMPAD3))
+
+	// the immediate command list lives across frames and isn't reset, reshade's own rendering at present can leave other data in cb13.
+	command_list* immediateCommandList = runtime->get_command_queue()->get_immediate_command_list();
+	if(nullptr != immediateCommandList)
 	{
-		g_pixelShaderManager.toggleMarkOnHuntedShader();
+		CommandListDataContainer& immediateCommandListData = immediateCommandList->get_private_data<CommandListDataContainer>();
+		immediateCommandListData.hasPushedInjectData = false;
+		// it isn't executed either, the commands of the game recorded on it are rolled up here
+		if(immediateCommandListData.commandCounts.getTotal() > 0)
+		{
+			g_commandCensus.onExecute(runtime->get_command_queue()->get_private_data<CommandQueueDataContainer>().censusIndex, immediateCommandListData.commandCounts);
+			immediateCommandListData.commandCounts.reset();
+		}
 	}
-	if(runtime->is_key_pressed(VK_NUMPAD4))
+	g_presentDevice.store(runtime->get_device(), std::memory_order_relaxed);
+	const device_api api = runtime->get_device()->get_api();
+	const bool hasImmediateContext = api == device_api::d3d9 || api == device_api::d3d10 || api == device_api::d3d11 || api == device_api::opengl;
+	g_uploadImmediateCommandList.store(hasImmediateContext ? immediateCommandList : nullptr, std::memory_order_relaxed);
+
+	// The keyboard shortcut to trigger logging. The frame capture ends and starts the captured frames and checks the frame time trigger here.
+	if (isCommandFired(KeyCommand::CaptureFrame))
 	{
-		g_vertexShaderManager.huntPreviousShader(runtime->is_key_down(VK_CONTROL));
+		s_frame_capture.requestCapture(CaptureTrigger::Key);
 	}
-	if(runtime->is_key_pressed(VK_NUMPAD5))
+	s_frame_capture.onPresent();
+	g_memoryTracker.onPresent();
+	g_uploadProfiler.onPresent();
+	g_commandCensus.onPresent();
+
+
+	if(g_activeCollectorFrameCounter>0)
 	{
-		g_vertexShaderManager.huntNextShader(runtime->is_key_down(VK_CONTROL));
+		--g_activeCollectorFrameCounter;
 	}
-	if(runtime->is_key_pressed(VK_NUMPAD6))
+
+	// the hunting keys, configurable in the KeyBindings section of the ini. See KEY_COMMANDS for the defaults.
+	struct HuntingCommands
 	{
-		g_vertexShaderManager.toggleMarkOnHuntedShader();
-	}
-	if(runtime->is_key_pressed(VK_NUMPAD7))
+		ShaderManager& manager;
+		ShaderStage stage;
+		KeyCommand previous;
+		KeyCommand next;
+		KeyCommand previousMarked;
+		KeyCommand nextMarked;
+		KeyCommand mark;
+	};
+	const HuntingCommands huntingCommands[] = {
+		{ g_pixelShaderManager, ShaderStage::Pixel, KeyCommand::PreviousPixelShader, KeyCommand::NextPixelShader, KeyCommand::PreviousMarkedPixelShader,
+		  KeyCommand::NextMarkedPixelShader, KeyCommand::MarkPixelShader },
+		{ g_vertexShaderManager, ShaderStage::Vertex, KeyCommand::PreviousVertexShader, KeyCommand::NextVertexShader, KeyCommand::PreviousMarkedVertexShader,
+		  KeyCommand::NextMarkedVertexShader, KeyCommand::MarkVertexShader },
+		{ g_computeShaderManager, ShaderStage::Compute, KeyCommand::PreviousComputeShader, KeyCommand::NextComputeShader, KeyCommand::PreviousMarkedComputeShader,
+		  KeyCommand::NextMarkedComputeShader, KeyCommand::MarkComputeShader },
+	};
+	for(const auto& commands : huntingCommands)
 	{
-		g_computeShaderManager.huntPreviousShader(runtime->is_key_down(VK_CONTROL));
+		if(isCommandFired(commands.previous) || isCommandFired(commands.previousMarked))
+		{
+			commands.manager.huntPreviousShader(isCommandFired(commands.previousMarked));
+			g_shaderDumpSelectionChanged = true;
+		}
+		if(isCommandFired(commands.next) || isCommandFired(commands.nextMarked))
+		{
+			commands.manager.huntNextShader(isCommandFired(commands.nextMarked));
+			g_shaderDumpSelectionChanged = true;
+		}
+		if(isCommandFired(commands.mark))
+		{
+			commands.manager.toggleMarkOnHuntedShader();
+			journalMarkToggle(commands.manager, commands.stage);
+			g_shaderDumpSelectionChanged = true;
+		}
 	}
-	if(runtime->is_key_pressed(VK_NUMPAD8))
+
+	if(g_shaderDumpSelectionChanged)
 	{
-		g_computeShaderManager.huntNextShader(runtime->is_key_down(VK_CONTROL));
+		g_shaderDumpSelectionChanged = false;
+		updateShaderDumpSelection();
 	}
-	if(runtime->is_key_pressed(VK_NUMPAD9))
+
+	// fold the journaled edits into the ini once the user stopped editing for a while. Saving compacts the journal.
+	if(g_editJournal.isIdleWithUnsavedEdits(JOURNAL_COMPACTION_IDLE_TIME))
 	{
-		g_computeShaderManager.toggleMarkOnHuntedShader();
+		saveShaderTogglerIniFile();
 	}
 
 	//TODO map Gui variable with cb13
@@ -1343,6 +2300,8 @@ void endKeyBindingEditing(bool acceptCollectedBinding, ToggleGroup& groupEditing
 	if (acceptCollectedBinding && g_toggleGroupIdKeyBindingEditing == groupEditing.getId() && g_keyCollector.isValid())
 	{
 		groupEditing.setToggleKey(g_keyCollector);
+		journalEdit(JournalOperation::Rebind, groupEditing, g_keyCollector.getKeyForIniFile());
+		g_keyBindingsChanged = true;
 	}
 	g_toggleGroupIdKeyBindingEditing = -1;
 	g_keyCollector.clear();
@@ -1382,6 +2341,7 @@ void endShaderEditing(bool acceptCollectedShaderHashes, ToggleGroup& groupEditin
 		g_computeShaderManager.stopHuntingMode();
 	}
 	g_toggleGroupIdShaderEditing = -1;
+	g_shaderDumpSelectionChanged = true;
 }
 
 
@@ -1407,6 +2367,7 @@ void startShaderEditing(ToggleGroup& groupEditing)
 
 	// after copying them to the managers, we can now clear the group's shader.
 	groupEditing.clearHashes();
+	g_shaderDumpSelectionChanged = true;
 }
 
 
@@ -1426,26 +2387,22 @@ static void showHelpMarker(const char* desc)
 
 static void displaySettings(reshade::api::effect_runtime* runtime)
 {
+	ensureConfigLoaded("reshade_overlay");
 	if(g_toggleGroupIdKeyBindingEditing >= 0)
 	{
-		// a keybinding is being edited. Read current pressed keys into the collector, cumulatively;
-		g_keyCollector.collectKeysPressed(runtime);
+		// a keybinding is being edited. Read current pressed keys into the collector, cumulatively. present reads all keys while editing.
+		g_keyCollector.collectKeysPressed(g_keyboardSnapshot);
 	}
 
 	if(ImGui::CollapsingHeader("General info and help"))
 	{
 		ImGui::PushTextWrapPos();
 		ImGui::TextUnformatted("The Shader Toggler allows you to create one or more groups with shaders to toggle on/off. You can assign a keyboard shortcut (including using keys like Shift, Alt and Control) to each group, including a handy name. Each group can have one or more vertex or pixel shaders assigned to it. When you press the assigned keyboard shortcut, any draw calls using these shaders will be disabled, effectively hiding the elements in the 3D scene.");
-		ImGui::TextUnformatted("\nThe following (hardcoded) keyboard shortcuts are used when you click a group's 'Change Shaders' button:");
-		ImGui::TextUnformatted("* Numpad 1 and Numpad 2: previous/next pixel shader");
-		ImGui::TextUnformatted("* Ctrl + Numpad 1 and Ctrl + Numpad 2: previous/next marked pixel shader in the group");
-		ImGui::TextUnformatted("* Numpad 3: mark/unmark the current pixel shader as being part of the group");
-		ImGui::TextUnformatted("* Numpad 4 and Numpad 5: previous/next vertex shader");
-		ImGui::TextUnformatted("* Ctrl + Numpad 4 and Ctrl + Numpad 5: previous/next marked vertex shader in the group");
-		ImGui::TextUnformatted("* Numpad 6: mark/unmark the current vertex shader as being part of the group");
-		ImGui::TextUnformatted("* Numpad 7 and Numpad 8: previous/next compute shader");
-		ImGui::TextUnformatted("* Ctrl + Numpad 7 and Ctrl + Numpad 8: previous/next marked compute shader in the group");
-		ImGui::TextUnformatted("* Numpad 9: mark/unmark the current compute shader as being part of the group");
+		ImGui::TextUnformatted("\nThe following keyboard shortcuts are used when you click a group's 'Change Shaders' button. They can be changed in the KeyBindings section of the ini:");
+		for(size_t i = 0; i < KEY_COMMAND_COUNT; ++i)
+		{
+			ImGui::Text("* %s: %s", g_commandKeys[i].isValid() ? g_commandKeys[i].getKeyAsString().c_str() : "(not bound)", KEY_COMMANDS[i].description);
+		}
 		ImGui::TextUnformatted("\nWhen you step through the shaders, the current shader is disabled in the 3D scene so you can see if that's the shader you were looking for.");
 		ImGui::TextUnformatted("When you're done, make sure you click 'Save all toggle groups' to preserve the groups you defined so next time you start your game they're loaded in and you can use them right away.");
 		ImGui::PopTextWrapPos();
@@ -1475,7 +2432,161 @@ static void displaySettings(reshade::api::effect_runtime* runtime)
 		// define the number of draw to differentiate
 		// ImGui::SliderInt("# of draws to differentiate", &draw_to_trace, 1, 5);
 		// ImGui::SliderFloat("# of draws to differentiate", &cb_inject_values[0], 0.0f, 5.0f, "ratio = %.0f");
-		ImGui::SliderFloat("# of draws to differentiate", &shared_data.cb_inject_values.colorFlag, 0.0f, 5.0f, "ratio = %.0f");
+		// the sliders are generated from SHADER_INJECT_PARAMETERS in mod_parameters.h
+		displayInjectedParameters();
+		displayPipelineLayoutCacheStats();
+	}
+
+	ImGui::Separator();
+
+	if (ImGui::CollapsingHeader("Shader dump"))
+	{
+		displayShaderDumperStats();
+		ImGui::SameLine();
+		showHelpMarker("Shader code of created pipelines is written to the shaderdump folder on a background thread. Skipped: already dumped in this or an earlier session. Dropped: the queue was full, the shader is queued again when another pipeline uses it.");
+		int dumpPolicy = static_cast<int>(g_shaderDumper.getDumpPolicy());
+		if(ImGui::Combo("Dump policy", &dumpPolicy, "Off\0All shaders\0Shaders in toggle groups\0Hunted or marked shaders\0"))
+		{
+			g_shaderDumper.setDumpPolicy(static_cast<ShaderToggler::ShaderDumpPolicy>(dumpPolicy));
+			g_shaderDumpSelectionChanged = true;
+		}
+		ImGui::SameLine();
+		showHelpMarker("All shaders: everything the game creates is dumped. The other policies keep the code of recently created shaders in the code cache and dump a shader when it's selected: when it's added to a toggle group or marked / hunted. Shaders evicted from the cache are dumped when the game creates them again. Stored in the ini file when the groups are saved.");
+		int dumpLayout = static_cast<int>(g_shaderDumper.getDumpLayout());
+		bool layoutChanged = ImGui::RadioButton("One file per shader", &dumpLayout, static_cast<int>(ShaderToggler::ShaderDumpLayout::PerFile));
+		ImGui::SameLine();
+		layoutChanged |= ImGui::RadioButton("Single pack file", &dumpLayout, static_cast<int>(ShaderToggler::ShaderDumpLayout::Pack));
+		if(layoutChanged)
+		{
+			g_shaderDumper.setDumpLayout(static_cast<ShaderToggler::ShaderDumpLayout>(dumpLayout));
+		}
+		ImGui::SameLine();
+		showHelpMarker("One file per shader: 0x<hash>.cso/.spv/.glsl files. Single pack file: all shaders are appended to shaderdump.pak with the sorted index shaderdump.idx, use tools/ShaderPackTool to list or extract them. Stored in the ini file when the groups are saved.");
+		bool compressDumps = g_shaderDumper.getCompressDumps();
+		if(ImGui::Checkbox("Compress dumped shaders", &compressDumps))
+		{
+			g_shaderDumper.setCompressDumps(compressDumps);
+		}
+		ImGui::SameLine();
+		showHelpMarker("Compresses the shader code on the dump thread. Files get an extra .lz extension, in the pack file the record is flagged. Use tools/ShaderPackTool to decompress them. The ratio and the CPU time per MB are shown above once shaders are compressed. Stored in the ini file when the groups are saved.");
+	}
+
+	ImGui::Separator();
+
+	if (ImGui::CollapsingHeader("Frame capture"))
+	{
+		displayFrameCaptureStats();
+		ShaderToggler::CaptureTriggerSettings triggerSettings = s_frame_capture.getTriggerSettings();
+		int frameCount = static_cast<int>(triggerSettings.frameCount);
+		int preTriggerFrameCount = static_cast<int>(triggerSettings.preTriggerFrameCount);
+		bool triggerSettingsChanged = ImGui::SliderInt("Frames to capture", &frameCount, 1, 120);
+		triggerSettingsChanged |= ImGui::SliderInt("Frames to keep before the trigger", &preTriggerFrameCount, 0, 60);
+		ImGui::SameLine();
+		showHelpMarker("Only while armed. The frames are recorded all the time then, at most 16 MB of events, so the capture shows what led up to the trigger. The frame that triggered a frame time spike is the last of them.");
+		triggerSettingsChanged |= ImGui::SliderFloat("Frame time trigger (ms)", &triggerSettings.frameTimeThresholdMilliseconds, 0.0f, 500.0f, "%.1f");
+		ImGui::SameLine();
+		showHelpMarker("Armed, a frame taking longer than this triggers the capture. 0 is off.");
+		triggerSettingsChanged |= ImGui::InputScalar("Shader bind trigger", ImGuiDataType_U32, &triggerSettings.shaderHash, nullptr, nullptr, "%08X", ImGuiInputTextFlags_CharsHexadecimal);
+		ImGui::SameLine();
+		showHelpMarker("Armed, the first bind of a pipeline with this shader hash triggers the capture. 0 is off.");
+		if(triggerSettingsChanged)
+		{
+			triggerSettings.frameCount = static_cast<uint32_t>(frameCount);
+			triggerSettings.preTriggerFrameCount = static_cast<uint32_t>(preTriggerFrameCount);
+			s_frame_capture.setTriggerSettings(triggerSettings);
+		}
+		if(s_frame_capture.isArmed())
+		{
+			if(ImGui::Button("Disarm"))
+			{
+				s_frame_capture.disarm();
+			}
+			ImGui::SameLine();
+			ImGui::TextUnformatted("Armed, waiting for a trigger.");
+		}
+		else if(ImGui::Button("Arm"))
+		{
+			s_frame_capture.arm();
+		}
+		int captureOutput = static_cast<int>(s_frame_capture.getCaptureOutput());
+		if(ImGui::Combo("Capture output", &captureOutput, "Reshade log\0Capture file\0Reshade log and capture file\0"))
+		{
+			s_frame_capture.setCaptureOutput(static_cast<ShaderToggler::CaptureOutput>(captureOutput));
+		}
+		ImGui::SameLine();
+		showHelpMarker("A capture records the calls of the frames into per-thread buffers, the frames aren't slowed down by formatting. Afterwards they're written as text to the reshade log and/or as a binary .stcap file in the capture folder. Dropped: a buffer was full. The capture key always starts a capture, arming adds the triggers above and disarms once triggered.");
+		bool isTraceExported = s_frame_capture.isTraceExported();
+		if(ImGui::Checkbox("Export as Chrome trace", &isTraceExported))
+		{
+			s_frame_capture.setTraceExport(isTraceExported);
+		}
+		ImGui::SameLine();
+		showHelpMarker("Also writes the capture as a .json trace in the capture folder. Open it in ui.perfetto.dev or chrome://tracing: a track per command list, draws and dispatches as slices with their pipelines, shader hashes and render targets.");
+		ImGui::Text("Resource registry: %llu resources, views and samplers, %.1f of %.0f MB, %llu rejected.", static_cast<uint64_t>(s_resource_registry.getCount()),
+			static_cast<double>(s_resource_registry.getMemoryUsed()) / (1024.0 * 1024.0), static_cast<double>(s_resource_registry.getMemoryBudget()) / (1024.0 * 1024.0),
+			s_resource_registry.getRejectedCount());
+		ImGui::SameLine();
+		showHelpMarker("Render targets, textures and buffers in the capture log are annotated with their type, size and format from the registry. Rejected: created while the registry was at its memory budget, they aren't annotated.");
+		int registryBudgetMegabytes = static_cast<int>(s_resource_registry.getMemoryBudget() / (1024 * 1024));
+		if(ImGui::SliderInt("Registry budget (MB)", &registryBudgetMegabytes, 8, 512))
+		{
+			s_resource_registry.setMemoryBudget(static_cast<size_t>(registryBudgetMegabytes) * 1024 * 1024);
+		}
+	}
+
+	ImGui::Separator();
+
+	if (ImGui::CollapsingHeader("GPU memory"))
+	{
+		displayMemoryStats();
+		ImGui::SameLine();
+		showHelpMarker("Estimated from the size, format, mip levels, layers and samples the game created the resources with, the driver's alignment and padding aren't included. A resource is counted once per group: its type, its format, the first of its usages in the list and its heap. Upload and readback heaps are in system memory, only the GPU heap is VRAM. Peaks are taken once per frame. Churn: created plus destroyed per frame, over the last second.");
+		displayMemoryCategories();
+		int csvInterval = static_cast<int>(g_memoryTracker.getCsvInterval());
+		if(ImGui::SliderInt("Write csv every (s)", &csvInterval, 0, 60))
+		{
+			g_memoryTracker.setCsvInterval(static_cast<uint32_t>(csvInterval));
+		}
+		ImGui::SameLine();
+		showHelpMarker("Writes the totals to ShaderToggler_memory.csv next to the game's exe, a line every this many seconds, a column per category. 0 is off, turning it on again starts a new file. Not stored in the ini file.");
+	}
+
+	ImGui::Separator();
+
+	if (ImGui::CollapsingHeader("Uploads"))
+	{
+		bool isUploadProfilerEnabled = g_uploadProfiler.isEnabled();
+		if(ImGui::Checkbox("Profile uploads", &isUploadProfilerEnabled))
+		{
+			g_uploadProfiler.setEnabled(isUploadProfilerEnabled);
+		}
+		ImGui::SameLine();
+		showHelpMarker("Counts the bytes the game uploads per frame: buffer and texture updates, buffers mapped for writing, and copies. Copies from upload heap resources are staged uploads, copies to readback heap resources are readbacks. Sizes are estimated from the regions and the resource descs. Each upload is attributed to the pixel, vertex and compute shaders bound on its command list. Under D3D12 and Vulkan the updates and maps aren't attributed, there's no immediate context. Off by default. Not stored in the ini file.");
+		if(g_uploadProfiler.isEnabled())
+		{
+			displayUploadStats();
+		}
+		if(ImGui::Button("Export uploads"))
+		{
+			std::string error;
+			g_uploadsExportStatus = g_uploadProfiler.exportCsv(g_uploadsFileName, error) ? "Written to " + g_uploadsFileName.string() : error;
+		}
+		ImGui::SameLine();
+		ImGui::TextUnformatted(g_uploadsExportStatus.c_str());
+	}
+
+	ImGui::Separator();
+
+	if (ImGui::CollapsingHeader("Logging"))
+	{
+		ImGui::Text("Log: %llu written, %llu suppressed, %llu dropped.", g_logger.getWrittenCount(), g_logger.getSuppressedCount(), g_logger.getDroppedCount());
+		int logLevel = static_cast<int>(g_logger.getLevel()) - 1;
+		if(ImGui::Combo("Log level", &logLevel, "Error\0Warning\0Info\0Debug\0Trace\0"))
+		{
+			g_logger.setLevel(static_cast<LogLevel>(logLevel + 1));
+		}
+		ImGui::SameLine();
+		showHelpMarker("Info logs the devices and swapchains. Debug adds every pipeline, layout, resource and view the game creates, which slows down loading. Trace adds the descriptor table binds of every frame, only in debug builds. A call site writes at most 16 messages a second, the ones over that are counted as suppressed. Dropped: the log thread fell behind. Not stored in the ini file.");
 	}
 
 	ImGui::Separator();
@@ -1485,7 +2596,9 @@ static void displaySettings(reshade::api::effect_runtime* runtime)
 	{
 		if(ImGui::Button(" New "))
 		{
-			addDefaultGroup();
+			addDefaultGroup(g_toggleGroups);
+			journalEdit(JournalOperation::CreateGroup, g_toggleGroups.back());
+			g_keyBindingsChanged = true;
 		}
 		ImGui::Separator();
 
@@ -1551,8 +2664,14 @@ static void displaySettings(reshade::api::effect_runtime* runtime)
 				ImGui::AlignTextToFramePadding();
 				ImGui::Text("Name");
 				ImGui::SameLine(ImGui::GetWindowWidth() * 0.25f);
-				ImGui::InputText("##Name", tmpBuffer, 149);
-				group.setName(tmpBuffer);
+				if(ImGui::InputText("##Name", tmpBuffer, 149))
+				{
+					group.setName(tmpBuffer);
+					if(group.getName() != name)
+					{
+						journalEdit(JournalOperation::Rename, group, 0, ShaderStage::None, group.getName());
+					}
+				}
 				ImGui::PopItemWidth();
 
 				// Key binding of group
@@ -1588,8 +2707,11 @@ static void displaySettings(reshade::api::effect_runtime* runtime)
 				ImGui::Text(" ");
 				ImGui::SameLine(ImGui::GetWindowWidth() * 0.25f);
 				bool isDefaultActive = group.isActiveAtStartup();
-				ImGui::Checkbox("Is active at startup", &isDefaultActive);
-				group.setIsActiveAtStartup(isDefaultActive);
+				if(ImGui::Checkbox("Is active at startup", &isDefaultActive))
+				{
+					group.setIsActiveAtStartup(isDefaultActive);
+					journalEdit(JournalOperation::SetActiveAtStartup, group, isDefaultActive ? 1 : 0);
+				}
 				ImGui::PopItemWidth();
 
 				if(!isKeyEditing)
@@ -1617,7 +2739,10 @@ static void displaySettings(reshade::api::effect_runtime* runtime)
 		}
 		for(const auto& group : toRemove)
 		{
+			journalEdit(JournalOperation::DeleteGroup, group);
 			std::erase(g_toggleGroups, group);
+			g_shaderDumpSelectionChanged = true;
+			g_keyBindingsChanged = true;
 		}
 
 		ImGui::Separator();
@@ -1627,6 +2752,7 @@ static void displaySettings(reshade::api::effect_runtime* runtime)
 			{
 				saveShaderTogglerIniFile();
 			}
+			displayConfigSaveStatus();
 		}
 	}
 }
@@ -1638,6 +2764,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 	{
 	case DLL_PROCESS_ATTACH:
 		{
+			const auto attachStartTime = std::chrono::steady_clock::now();
 			if(!reshade::register_addon(hModule))
 			{
 				return FALSE;
@@ -1650,6 +2777,12 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 			const std::filesystem::path basePath = dllPath.parent_path();																// <installpath>
 			const std::string& hashFileName = HASH_FILE_NAME;
 			g_iniFileName = (basePath / hashFileName).string();																			// <installpath>/shadertoggler.ini
+			g_journalFileName = basePath / JOURNAL_FILE_NAME;																			// <installpath>/shadertoggler.journal
+			g_snapshotFileName = basePath / SNAPSHOT_FILE_NAME;																			// <installpath>/shadertoggler.snapshot
+			g_shaderDumper.setDumpPath(basePath / RESHADE_ADDON_SHADER_SAVE_DIR);														// <installpath>/shaderdump
+			s_frame_capture.setOutput(basePath / RESHADE_ADDON_CAPTURE_SAVE_DIR, format_capture_event, write_capture_log_line);		// <installpath>/capture
+			g_memoryTracker.setCsvFileName(basePath / MEMORY_CSV_FILE_NAME);																// <installpath>/shadertoggler_memory.csv
+			g_uploadsFileName = basePath / UPLOADS_CSV_FILE_NAME;																		// <installpath>/shadertoggler_uploads.csv
 
 			reshade::register_event<reshade::addon_event::init_pipeline>(onInitPipeline);
 			reshade::register_event<reshade::addon_event::init_command_list>(onInitCommandList);
@@ -1673,6 +2806,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 
 			// added (coming from API_trace and used by DCS. other calls from API trace should miss for other games)
 			reshade::register_event<reshade::addon_event::push_descriptors>(on_push_descriptors);
+			reshade::register_event<reshade::addon_event::push_descriptors>(onPushDescriptors);
 			reshade::register_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(on_bind_render_targets_and_depth_stencil);
 			reshade::register_event<reshade::addon_event::bind_viewports>(on_bind_viewports);
 			reshade::register_event<reshade::addon_event::clear_render_target_view>(on_clear_render_target_view);
@@ -1680,6 +2814,9 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 			reshade::register_event<reshade::addon_event::bind_pipeline_states>(on_bind_pipeline_states);
 			reshade::register_event<reshade::addon_event::bind_vertex_buffers>(on_bind_vertex_buffers);
 			reshade::register_event<reshade::addon_event::bind_index_buffer>(on_bind_index_buffer);
+			reshade::register_event<reshade::addon_event::dispatch>(on_dispatch);
+			reshade::register_event<reshade::addon_event::begin_render_pass>(on_begin_render_pass);
+			reshade::register_event<reshade::addon_event::end_render_pass>(on_end_render_pass);
 
 			// coming from RenoDx
 			reshade::register_event<reshade::addon_event::init_device>(on_init_device);
@@ -1689,9 +2826,44 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 			reshade::register_event<reshade::addon_event::destroy_resource>(on_destroy_resource);
 			reshade::register_event<reshade::addon_event::init_resource_view>(on_init_resource_view);
 			reshade::register_event<reshade::addon_event::destroy_resource_view>(on_destroy_resource_view);
+			reshade::register_event<reshade::addon_event::init_sampler>(on_init_sampler);
+			reshade::register_event<reshade::addon_event::destroy_sampler>(on_destroy_sampler);
+			reshade::register_event<reshade::addon_event::update_buffer_region>(onUpdateBufferRegion);
+			reshade::register_event<reshade::addon_event::update_texture_region>(onUpdateTextureRegion);
+			reshade::register_event<reshade::addon_event::map_buffer_region>(onMapBufferRegion);
+			reshade::register_event<reshade::addon_event::copy_resource>(onCopyResource);
+			reshade::register_event<reshade::addon_event::copy_buffer_region>(onCopyBufferRegion);
+			reshade::register_event<reshade::addon_event::copy_buffer_to_texture>(onCopyBufferToTexture);
+			reshade::register_event<reshade::addon_event::copy_texture_region>(onCopyTextureRegion);
+			reshade::register_event<reshade::addon_event::copy_texture_to_buffer>(onCopyTextureToBuffer);
+			reshade::register_event<reshade::addon_event::init_command_queue>(onInitCommandQueue);
+			reshade::register_event<reshade::addon_event::destroy_command_queue>(onDestroyCommandQueue);
+			reshade::register_event<reshade::addon_event::execute_command_list>(onExecuteCommandList);
+			reshade::register_event<reshade::addon_event::dispatch>(onDispatch);
+			reshade::register_event<reshade::addon_event::barrier>(onBarrier);
+			reshade::register_event<reshade::addon_event::clear_render_target_view>(onClearRenderTargetView);
+			reshade::register_event<reshade::addon_event::clear_depth_stencil_view>(onClearDepthStencilView);
+			reshade::register_event<reshade::addon_event::clear_unordered_access_view_uint>(onClearUnorderedAccessViewUint);
+			reshade::register_event<reshade::addon_event::clear_unordered_access_view_float>(onClearUnorderedAccessViewFloat);
+			reshade::register_event<reshade::addon_event::begin_render_pass>(onBeginRenderPass);
 
 			reshade::register_overlay(nullptr, &displaySettings);
-			loadShaderTogglerIniFile();
+			// parsing the ini under the loader lock delays the process start: it's loaded on a thread (which only runs once the loader lock is
+			// released) and applied by the first hook which needs it, see ensureConfigLoaded.
+			HMODULE loadThreadModule = nullptr;
+			if(GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, reinterpret_cast<LPCWSTR>(&runConfigLoadThread), &loadThreadModule))
+			{
+				try
+				{
+					g_configLoadThread = std::thread(runConfigLoadThread, loadThreadModule);
+				}
+				catch(const std::system_error&)
+				{
+					// loaded by ensureConfigLoaded on the hook's thread instead. The module is still loading, this only drops the reference.
+					FreeLibrary(loadThreadModule);
+				}
+			}
+			g_processAttachMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - attachStartTime).count();
 
 		}
 		break;
@@ -1714,6 +2886,7 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 		reshade::unregister_event<reshade::addon_event::bind_descriptor_tables>(on_bind_descriptor_tables);
 
 		reshade::unregister_event<reshade::addon_event::push_descriptors>(on_push_descriptors);
+		reshade::unregister_event<reshade::addon_event::push_descriptors>(onPushDescriptors);
 		reshade::unregister_event<reshade::addon_event::bind_render_targets_and_depth_stencil>(on_bind_render_targets_and_depth_stencil);
 		reshade::unregister_event<reshade::addon_event::bind_viewports>(on_bind_viewports);
 		reshade::unregister_event<reshade::addon_event::clear_render_target_view>(on_clear_render_target_view);
@@ -1721,13 +2894,46 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 		reshade::unregister_event<reshade::addon_event::bind_pipeline_states>(on_bind_pipeline_states);
 		reshade::unregister_event<reshade::addon_event::bind_vertex_buffers>(on_bind_vertex_buffers);
 		reshade::unregister_event<reshade::addon_event::bind_index_buffer>(on_bind_index_buffer);
+		reshade::unregister_event<reshade::addon_event::dispatch>(on_dispatch);
+		reshade::unregister_event<reshade::addon_event::begin_render_pass>(on_begin_render_pass);
+		reshade::unregister_event<reshade::addon_event::end_render_pass>(on_end_render_pass);
 
 		reshade::unregister_event<reshade::addon_event::init_device>(on_init_device);
 		reshade::unregister_event<reshade::addon_event::destroy_device>(on_destroy_device);
 		reshade::unregister_event<reshade::addon_event::init_swapchain>(on_init_swapchain);
+		reshade::unregister_event<reshade::addon_event::init_resource>(on_init_resource);
+		reshade::unregister_event<reshade::addon_event::destroy_resource>(on_destroy_resource);
+		reshade::unregister_event<reshade::addon_event::init_resource_view>(on_init_resource_view);
+		reshade::unregister_event<reshade::addon_event::destroy_resource_view>(on_destroy_resource_view);
+		reshade::unregister_event<reshade::addon_event::init_sampler>(on_init_sampler);
+		reshade::unregister_event<reshade::addon_event::destroy_sampler>(on_destroy_sampler);
+		reshade::unregister_event<reshade::addon_event::update_buffer_region>(onUpdateBufferRegion);
+		reshade::unregister_event<reshade::addon_event::update_texture_region>(onUpdateTextureRegion);
+		reshade::unregister_event<reshade::addon_event::map_buffer_region>(onMapBufferRegion);
+		reshade::unregister_event<reshade::addon_event::copy_resource>(onCopyResource);
+		reshade::unregister_event<reshade::addon_event::copy_buffer_region>(onCopyBufferRegion);
+		reshade::unregister_event<reshade::addon_event::copy_buffer_to_texture>(onCopyBufferToTexture);
+		reshade::unregister_event<reshade::addon_event::copy_texture_region>(onCopyTextureRegion);
+		reshade::unregister_event<reshade::addon_event::copy_texture_to_buffer>(onCopyTextureToBuffer);
+		reshade::unregister_event<reshade::addon_event::init_command_queue>(onInitCommandQueue);
+		reshade::unregister_event<reshade::addon_event::destroy_command_queue>(onDestroyCommandQueue);
+		reshade::unregister_event<reshade::addon_event::execute_command_list>(onExecuteCommandList);
+		reshade::unregister_event<reshade::addon_event::dispatch>(onDispatch);
+		reshade::unregister_event<reshade::addon_event::barrier>(onBarrier);
+		reshade::unregister_event<reshade::addon_event::clear_render_target_view>(onClearRenderTargetView);
+		reshade::unregister_event<reshade::addon_event::clear_depth_stencil_view>(onClearDepthStencilView);
+		reshade::unregister_event<reshade::addon_event::clear_unordered_access_view_uint>(onClearUnorderedAccessViewUint);
+		reshade::unregister_event<reshade::addon_event::clear_unordered_access_view_float>(onClearUnorderedAccessViewFloat);
+		reshade::unregister_event<reshade::addon_event::begin_render_pass>(onBeginRenderPass);
 
 		reshade::unregister_overlay(nullptr, &displaySettings);
 		reshade::unregister_addon(hModule);
+		// not joined yet if no hook needed the config. It can't be joined under the loader lock. As the thread holds a reference on the module,
+		// this is either the thread itself releasing the last reference in runConfigLoadThread, or the process exiting.
+		if(g_configLoadThread.joinable())
+		{
+			g_configLoadThread.detach();
+		}
 		break;
 	}
 
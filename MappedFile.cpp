@@ -0,0 +1,119 @@
+/// read-only memory mapped file, usable in the addon and in the linux tools
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ShaderToggler
+{
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+
+	bool MappedFile::open(const std::filesystem::path& fileName)
+	{
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if(file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if(!GetFileSizeEx(file, &fileSize))
+		{
+			CloseHandle(file);
+			return false;
+		}
+		_fileHandle = file;
+		_isOpen = true;
+		if(fileSize.QuadPart == 0)
+		{
+			// can't map an empty file
+			return true;
+		}
+		_mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if(nullptr == _mappingHandle)
+		{
+			close();
+			return false;
+		}
+		_data = static_cast<const uint8_t*>(MapViewOfFile(_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if(nullptr == _data)
+		{
+			close();
+			return false;
+		}
+		_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+		_fileDescriptor = ::open(fileName.c_str(), O_RDONLY);
+		if(_fileDescriptor < 0)
+		{
+			return false;
+		}
+		struct stat fileStat;
+		if(fstat(_fileDescriptor, &fileStat) != 0)
+		{
+			close();
+			return false;
+		}
+		_isOpen = true;
+		if(fileStat.st_size == 0)
+		{
+			return true;
+		}
+		void* mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, _fileDescriptor, 0);
+		if(mapped == MAP_FAILED)
+		{
+			close();
+			return false;
+		}
+		_data = static_cast<const uint8_t*>(mapped);
+		_size = static_cast<size_t>(fileStat.st_size);
+#endif
+		return true;
+	}
+
+
+	void MappedFile::close()
+	{
+#ifdef _WIN32
+		if(nullptr != _data)
+		{
+			UnmapViewOfFile(_data);
+		}
+		if(nullptr != _mappingHandle)
+		{
+			CloseHandle(_mappingHandle);
+			_mappingHandle = nullptr;
+		}
+		if(nullptr != _fileHandle)
+		{
+			CloseHandle(_fileHandle);
+			_fileHandle = nullptr;
+		}
+#else
+		if(nullptr != _data)
+		{
+			munmap(const_cast<uint8_t*>(_data), _size);
+		}
+		if(_fileDescriptor >= 0)
+		{
+			::close(_fileDescriptor);
+			_fileDescriptor = -1;
+		}
+#endif
+		_data = nullptr;
+		_size = 0;
+		_isOpen = false;
+	}
+}
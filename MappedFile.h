@@ -0,0 +1,45 @@
+/// read-only memory mapped file, usable in the addon and in the linux tools
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// Maps a whole file read-only in memory. The view stays valid till close() is called or the instance is destroyed.
+	/// </summary>
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/// <summary>
+		/// Maps the file passed in. Returns false if the file can't be opened or mapped. An empty file is opened but has no data.
+		/// </summary>
+		/// <param name="fileName"></param>
+		/// <returns></returns>
+		bool open(const std::filesystem::path& fileName);
+		void close();
+
+		const uint8_t* data() const { return _data; }
+		size_t size() const { return _size; }
+		bool isOpen() const { return _isOpen; }
+
+	private:
+		const uint8_t* _data = nullptr;
+		size_t _size = 0;
+		bool _isOpen = false;
+#ifdef _WIN32
+		void* _fileHandle = nullptr;
+		void* _mappingHandle = nullptr;
+#else
+		int _fileDescriptor = -1;
+#endif
+	};
+}
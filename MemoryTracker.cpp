@@ -0,0 +1,449 @@
+/// running totals of the memory of the resources the game created, by type, format, usage, heap and size, for the overlay and a csv log
+
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace reshade::api;
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		int64_t getNow()
+		{
+			return std::chrono::steady_clock::now().time_since_epoch().count();
+		}
+
+		constexpr int64_t secondsToTicks(uint32_t seconds)
+		{
+			return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(seconds)).count();
+		}
+
+		std::FILE* openFile(const std::filesystem::path& fileName)
+		{
+#ifdef _WIN32
+			return _wfopen(fileName.c_str(), L"wb");
+#else
+			return std::fopen(fileName.c_str(), "wb");
+#endif
+		}
+
+		MemoryCategory getFormatCategory(format value)
+		{
+			switch(value)
+			{
+			case format::unknown:
+				return MemoryCategory::FormatNone;
+			case format::r8_typeless: case format::r8_uint: case format::r8_sint: case format::r8_unorm: case format::r8_snorm:
+			case format::a8_unorm: case format::l8_unorm: case format::l8a8_unorm:
+			case format::r8g8_typeless: case format::r8g8_uint: case format::r8g8_sint: case format::r8g8_unorm: case format::r8g8_snorm:
+			case format::r8g8b8a8_typeless: case format::r8g8b8a8_uint: case format::r8g8b8a8_sint: case format::r8g8b8a8_unorm:
+			case format::r8g8b8a8_unorm_srgb: case format::r8g8b8a8_snorm: case format::r8g8b8x8_unorm: case format::r8g8b8x8_unorm_srgb:
+			case format::b8g8r8a8_typeless: case format::b8g8r8a8_unorm: case format::b8g8r8a8_unorm_srgb:
+			case format::b8g8r8x8_typeless: case format::b8g8r8x8_unorm: case format::b8g8r8x8_unorm_srgb:
+				return MemoryCategory::Format8Bit;
+			case format::r10g10b10a2_typeless: case format::r10g10b10a2_uint: case format::r10g10b10a2_unorm: case format::r10g10b10a2_xr_bias:
+			case format::b10g10r10a2_typeless: case format::b10g10r10a2_uint: case format::b10g10r10a2_unorm:
+			case format::r11g11b10_float: case format::r9g9b9e5:
+			case format::b5g6r5_unorm: case format::b5g5r5a1_unorm: case format::b5g5r5x1_unorm: case format::b4g4r4a4_unorm: case format::a4b4g4r4_unorm:
+				return MemoryCategory::FormatPacked;
+			case format::r16_typeless: case format::r16_uint: case format::r16_sint: case format::r16_unorm: case format::r16_snorm: case format::r16_float:
+			case format::l16_unorm: case format::l16a16_unorm:
+			case format::r16g16_typeless: case format::r16g16_uint: case format::r16g16_sint: case format::r16g16_unorm: case format::r16g16_snorm:
+			case format::r16g16_float:
+			case format::r16g16b16a16_typeless: case format::r16g16b16a16_uint: case format::r16g16b16a16_sint: case format::r16g16b16a16_unorm:
+			case format::r16g16b16a16_snorm: case format::r16g16b16a16_float:
+				return MemoryCategory::Format16Bit;
+			case format::r32_typeless: case format::r32_uint: case format::r32_sint: case format::r32_float:
+			case format::r32g32_typeless: case format::r32g32_uint: case format::r32g32_sint: case format::r32g32_float:
+			case format::r32g32b32_typeless: case format::r32g32b32_uint: case format::r32g32b32_sint: case format::r32g32b32_float:
+			case format::r32g32b32a32_typeless: case format::r32g32b32a32_uint: case format::r32g32b32a32_sint: case format::r32g32b32a32_float:
+				return MemoryCategory::Format32Bit;
+			case format::bc1_typeless: case format::bc1_unorm: case format::bc1_unorm_srgb:
+			case format::bc2_typeless: case format::bc2_unorm: case format::bc2_unorm_srgb:
+			case format::bc3_typeless: case format::bc3_unorm: case format::bc3_unorm_srgb:
+			case format::bc4_typeless: case format::bc4_unorm: case format::bc4_snorm:
+			case format::bc5_typeless: case format::bc5_unorm: case format::bc5_snorm:
+			case format::bc6h_typeless: case format::bc6h_ufloat: case format::bc6h_sfloat:
+			case format::bc7_typeless: case format::bc7_unorm: case format::bc7_unorm_srgb:
+				return MemoryCategory::FormatBlockCompressed;
+			case format::s8_uint: case format::d16_unorm: case format::d16_unorm_s8_uint: case format::d24_unorm_x8_uint: case format::d24_unorm_s8_uint:
+			case format::d32_float: case format::d32_float_s8_uint:
+			case format::r24_g8_typeless: case format::r24_unorm_x8_uint: case format::x24_unorm_g8_uint:
+			case format::r32_g8_typeless: case format::r32_float_x8_uint: case format::x32_float_g8_uint:
+			case format::intz:
+				return MemoryCategory::FormatDepthStencil;
+			default:
+				return MemoryCategory::FormatOther;
+			}
+		}
+
+		MemoryCategory getUsageCategory(resource_usage usage)
+		{
+			if((usage & resource_usage::depth_stencil) != 0)
+			{
+				return MemoryCategory::UsageDepthStencil;
+			}
+			if((usage & resource_usage::render_target) != 0)
+			{
+				return MemoryCategory::UsageRenderTarget;
+			}
+			if((usage & resource_usage::unordered_access) != 0)
+			{
+				return MemoryCategory::UsageUnorderedAccess;
+			}
+			if((usage & resource_usage::constant_buffer) != 0)
+			{
+				return MemoryCategory::UsageConstantBuffer;
+			}
+			if((usage & (resource_usage::vertex_buffer | resource_usage::index_buffer)) != 0)
+			{
+				return MemoryCategory::UsageVertexIndexBuffer;
+			}
+			if((usage & resource_usage::shader_resource) != 0)
+			{
+				return MemoryCategory::UsageShaderResource;
+			}
+			return MemoryCategory::UsageOther;
+		}
+
+		MemoryCategory getHeapCategory(memory_heap heap)
+		{
+			switch(heap)
+			{
+			case memory_heap::gpu_only:
+				return MemoryCategory::HeapGpu;
+			case memory_heap::cpu_to_gpu:
+				return MemoryCategory::HeapUpload;
+			case memory_heap::gpu_to_cpu:
+			case memory_heap::cpu_only:
+				return MemoryCategory::HeapReadback;
+			default:
+				return MemoryCategory::HeapUnknown;
+			}
+		}
+
+		MemoryCategory getSizeCategory(uint64_t bytes)
+		{
+			if(bytes < 64 * 1024)
+			{
+				return MemoryCategory::SizeBelow64KB;
+			}
+			if(bytes < 1024 * 1024)
+			{
+				return MemoryCategory::SizeBelow1MB;
+			}
+			if(bytes < 16 * 1024 * 1024)
+			{
+				return MemoryCategory::SizeBelow16MB;
+			}
+			if(bytes < 64 * 1024 * 1024)
+			{
+				return MemoryCategory::SizeBelow64MB;
+			}
+			return MemoryCategory::SizeAbove64MB;
+		}
+
+		uint32_t getRowPitch(format value, uint32_t width)
+		{
+			const uint32_t rowPitch = format_row_pitch(value, width);
+			if(rowPitch != 0 || value == format::unknown)
+			{
+				return rowPitch;
+			}
+			// the depth formats format_row_pitch doesn't know
+			switch(value)
+			{
+			case format::s8_uint:
+				return width;
+			case format::d16_unorm_s8_uint:
+			case format::d24_unorm_x8_uint:
+			case format::intz:
+				return 4 * width;
+			default:
+				return 0;
+			}
+		}
+
+		uint64_t getRegionBytes(format value, uint32_t width, uint32_t height, uint32_t depth)
+		{
+			const bool isBlockCompressed = getFormatCategory(value) == MemoryCategory::FormatBlockCompressed;
+			const uint64_t rows = isBlockCompressed ? (height + 3) / 4 : height;
+			return static_cast<uint64_t>(getRowPitch(value, width)) * rows * depth;
+		}
+
+		uint32_t getLevelCount(const ResourceDescription& description)
+		{
+			if(description.levels != 0)
+			{
+				return description.levels;
+			}
+			// the full chain
+			uint32_t levels = 1;
+			const uint32_t depth = static_cast<resource_type>(description.type) == resource_type::texture_3d ? description.depthOrLayers : 1u;
+			for(uint32_t largest = std::max({ description.width, description.height, depth }); largest > 1; largest >>= 1)
+			{
+				++levels;
+			}
+			return levels;
+		}
+	}
+
+
+	MemoryTracker::~MemoryTracker()
+	{
+		if(nullptr != _csvFile)
+		{
+			std::fclose(_csvFile);
+		}
+	}
+
+
+	uint64_t MemoryTracker::estimateBytes(const ResourceDescription& description)
+	{
+		const resource_type type = static_cast<resource_type>(description.type);
+		if(type == resource_type::buffer)
+		{
+			return description.size;
+		}
+		const uint32_t levels = getLevelCount(description);
+		const uint32_t depthOrLayers = std::max<uint32_t>(description.depthOrLayers, 1);
+		uint64_t bytes = 0;
+		for(uint32_t level = 0; level < levels; ++level)
+		{
+			// the layers of an array all have the full chain, the slices of a 3d texture get fewer with every level
+			bytes += estimateSubresourceBytes(description, level, nullptr);
+		}
+		return type == resource_type::texture_3d ? bytes : bytes * depthOrLayers;
+	}
+
+
+	uint64_t MemoryTracker::estimateSubresourceBytes(const ResourceDescription& description, uint32_t subresource, const subresource_box* box)
+	{
+		const resource_type type = static_cast<resource_type>(description.type);
+		if(type == resource_type::buffer)
+		{
+			return description.size;
+		}
+		const format textureFormat = static_cast<format>(description.format);
+		const uint64_t samples = std::max<uint32_t>(description.samples, 1);
+		if(nullptr != box)
+		{
+			return getRegionBytes(textureFormat, box->width(), box->height(), box->depth()) * samples;
+		}
+		const uint32_t level = subresource % getLevelCount(description);
+		const uint32_t slices = type == resource_type::texture_3d ? std::max(static_cast<uint32_t>(description.depthOrLayers) >> level, 1u) : 1;
+		return getRegionBytes(textureFormat, std::max(description.width >> level, 1u), std::max(description.height >> level, 1u), slices) * samples;
+	}
+
+
+	void MemoryTracker::onPresent()
+	{
+		MemorySnapshot& snapshot = _snapshot;
+		std::array<int64_t, CategoryCount> bytes = {};
+		std::array<int64_t, CategoryCount> counts = {};
+		uint64_t allocatedBytes = 0;
+		uint64_t freedBytes = 0;
+		uint64_t allocationCount = 0;
+		uint64_t releaseCount = 0;
+		const auto merge = [&](const ThreadCounters& counters)
+		{
+			for(size_t i = 0; i < CategoryCount; ++i)
+			{
+				bytes[i] += counters.bytes[i].load(std::memory_order_relaxed);
+				counts[i] += counters.counts[i].load(std::memory_order_relaxed);
+			}
+			allocatedBytes += counters.allocatedBytes.load(std::memory_order_relaxed);
+			freedBytes += counters.freedBytes.load(std::memory_order_relaxed);
+			allocationCount += counters.allocationCount.load(std::memory_order_relaxed);
+			releaseCount += counters.releaseCount.load(std::memory_order_relaxed);
+		};
+		const uint32_t threadCount = _threadCount.load(std::memory_order_acquire);
+		for(uint32_t i = 0; i < threadCount; ++i)
+		{
+			merge(*_threadCounters[i]);
+		}
+		merge(_overflowCounters);
+
+		// a destroy counted on one thread can be merged before the create counted on another, the totals are only exact between frames
+		for(size_t i = 0; i < CategoryCount; ++i)
+		{
+			MemoryTotals& totals = snapshot.categories[i];
+			totals.bytes = bytes[i];
+			totals.count = counts[i];
+			totals.peakBytes = std::max(totals.peakBytes, totals.bytes);
+		}
+		++snapshot.frame;
+		snapshot.allocatedBytes = allocatedBytes - _lastAllocatedBytes;
+		snapshot.freedBytes = freedBytes - _lastFreedBytes;
+		snapshot.allocationCount = allocationCount - _lastAllocationCount;
+		snapshot.releaseCount = releaseCount - _lastReleaseCount;
+		_lastAllocatedBytes = allocatedBytes;
+		_lastFreedBytes = freedBytes;
+		_lastAllocationCount = allocationCount;
+		_lastReleaseCount = releaseCount;
+
+		const int64_t now = getNow();
+		if(_churnWindowStart == 0)
+		{
+			_churnWindowStart = now;
+		}
+		_churnWindowBytes += snapshot.allocatedBytes + snapshot.freedBytes;
+		++_churnWindowFrames;
+		if(now - _churnWindowStart >= secondsToTicks(1))
+		{
+			snapshot.churnBytesPerFrame = static_cast<double>(_churnWindowBytes) / static_cast<double>(_churnWindowFrames);
+			_churnWindowStart = now;
+			_churnWindowBytes = 0;
+			_churnWindowFrames = 0;
+		}
+
+		if(_csvIntervalSeconds > 0 && now - _lastCsvLine >= secondsToTicks(_csvIntervalSeconds))
+		{
+			if(_csvStart == 0)
+			{
+				_csvStart = now;
+			}
+			_lastCsvLine = now;
+			writeCsvLine(std::chrono::duration<double>(std::chrono::steady_clock::duration(now - _csvStart)).count());
+		}
+	}
+
+
+	void MemoryTracker::setCsvInterval(uint32_t seconds)
+	{
+		_csvIntervalSeconds = seconds;
+		_lastCsvLine = 0;
+		if(seconds == 0 && nullptr != _csvFile)
+		{
+			std::fclose(_csvFile);
+			_csvFile = nullptr;
+		}
+	}
+
+
+	MemoryTracker::ThreadCounters* MemoryTracker::registerThread()
+	{
+		std::unique_lock lock(_registerMutex);
+		const uint32_t threadCount = _threadCount.load(std::memory_order_relaxed);
+		if(threadCount >= MaxThreadCount)
+		{
+			return &_overflowCounters;
+		}
+		_threadCounters[threadCount] = std::make_unique<ThreadCounters>();
+		_threadCount.store(threadCount + 1, std::memory_order_release);
+		return _threadCounters[threadCount].get();
+	}
+
+
+	void MemoryTracker::add(const ResourceDescription& description, int64_t sign)
+	{
+		if(description.kind != RegisteredObjectKind::Resource)
+		{
+			return;
+		}
+		const uint64_t bytes = estimateBytes(description);
+		const resource_type type = static_cast<resource_type>(description.type);
+		const MemoryCategory categories[] =
+		{
+			MemoryCategory::Total,
+			static_cast<MemoryCategory>(static_cast<uint32_t>(MemoryCategory::TypeUnknown) + std::min(description.type, static_cast<uint8_t>(resource_type::surface))),
+			type == resource_type::buffer ? MemoryCategory::FormatNone : getFormatCategory(static_cast<format>(description.format)),
+			getUsageCategory(static_cast<resource_usage>(description.usage)),
+			getHeapCategory(static_cast<memory_heap>(description.heap)),
+			getSizeCategory(bytes),
+		};
+
+		ThreadCounters& counters = getThreadCounters();
+		for(const MemoryCategory category : categories)
+		{
+			counters.bytes[static_cast<size_t>(category)].fetch_add(sign * static_cast<int64_t>(bytes), std::memory_order_relaxed);
+			counters.counts[static_cast<size_t>(category)].fetch_add(sign, std::memory_order_relaxed);
+		}
+		if(sign > 0)
+		{
+			counters.allocatedBytes.fetch_add(bytes, std::memory_order_relaxed);
+			counters.allocationCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		else
+		{
+			counters.freedBytes.fetch_add(bytes, std::memory_order_relaxed);
+			counters.releaseCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+
+	void MemoryTracker::writeCsvLine(double seconds)
+	{
+		if(nullptr == _csvFile)
+		{
+			if(_csvFileName.empty())
+			{
+				return;
+			}
+			_csvFile = openFile(_csvFileName);
+			if(nullptr == _csvFile)
+			{
+				// not retried every frame
+				_csvIntervalSeconds = 0;
+				return;
+			}
+			std::fputs("seconds,frame", _csvFile);
+			for(size_t i = 0; i < CategoryCount; ++i)
+			{
+				std::fprintf(_csvFile, ",%s", getMemoryCategoryName(static_cast<MemoryCategory>(i)));
+			}
+			std::fputs(",peak,allocated_total,freed_total,churn_per_frame\n", _csvFile);
+		}
+
+		std::fprintf(_csvFile, "%.3f,%llu", seconds, static_cast<unsigned long long>(_snapshot.frame));
+		for(const MemoryTotals& totals : _snapshot.categories)
+		{
+			std::fprintf(_csvFile, ",%lld", static_cast<long long>(totals.bytes));
+		}
+		std::fprintf(_csvFile, ",%lld,%llu,%llu,%.0f\n", static_cast<long long>(_snapshot.get(MemoryCategory::Total).peakBytes),
+					 static_cast<unsigned long long>(_lastAllocatedBytes), static_cast<unsigned long long>(_lastFreedBytes), _snapshot.churnBytesPerFrame);
+		std::fflush(_csvFile);
+	}
+
+
+	const char* getMemoryCategoryName(MemoryCategory category)
+	{
+		switch(category)
+		{
+		case MemoryCategory::Total: return "total";
+		case MemoryCategory::TypeUnknown: return "type_unknown";
+		case MemoryCategory::TypeBuffer: return "buffer";
+		case MemoryCategory::TypeTexture1D: return "texture_1d";
+		case MemoryCategory::TypeTexture2D: return "texture_2d";
+		case MemoryCategory::TypeTexture3D: return "texture_3d";
+		case MemoryCategory::TypeSurface: return "surface";
+		case MemoryCategory::FormatNone: return "format_none";
+		case MemoryCategory::Format8Bit: return "format_8bit";
+		case MemoryCategory::FormatPacked: return "format_packed";
+		case MemoryCategory::Format16Bit: return "format_16bit";
+		case MemoryCategory::Format32Bit: return "format_32bit";
+		case MemoryCategory::FormatBlockCompressed: return "format_bc";
+		case MemoryCategory::FormatDepthStencil: return "format_depth";
+		case MemoryCategory::FormatOther: return "format_other";
+		case MemoryCategory::UsageDepthStencil: return "depth_stencil";
+		case MemoryCategory::UsageRenderTarget: return "render_target";
+		case MemoryCategory::UsageUnorderedAccess: return "unordered_access";
+		case MemoryCategory::UsageConstantBuffer: return "constant_buffer";
+		case MemoryCategory::UsageVertexIndexBuffer: return "vertex_index_buffer";
+		case MemoryCategory::UsageShaderResource: return "shader_resource";
+		case MemoryCategory::UsageOther: return "usage_other";
+		case MemoryCategory::HeapGpu: return "heap_gpu";
+		case MemoryCategory::HeapUpload: return "heap_upload";
+		case MemoryCategory::HeapReadback: return "heap_readback";
+		case MemoryCategory::HeapUnknown: return "heap_unknown";
+		case MemoryCategory::SizeBelow64KB: return "size_64kb";
+		case MemoryCategory::SizeBelow1MB: return "size_1mb";
+		case MemoryCategory::SizeBelow16MB: return "size_16mb";
+		case MemoryCategory::SizeBelow64MB: return "size_64mb";
+		case MemoryCategory::SizeAbove64MB: return "size_above_64mb";
+		default: return "?";
+		}
+	}
+}
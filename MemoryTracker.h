@@ -0,0 +1,185 @@
+/// running totals of the memory of the resources the game created, by type, format, usage, heap and size, for the overlay and a csv log
+
+#pragma once
+
+#include "ResourceRegistry.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// Categories a resource is counted in, one of each dimension. The names are in getMemoryCategoryName, the same order.
+	/// </summary>
+	enum class MemoryCategory : uint32_t
+	{
+		Total = 0,
+		// reshade::api::resource_type
+		TypeUnknown,
+		TypeBuffer,
+		TypeTexture1D,
+		TypeTexture2D,
+		TypeTexture3D,
+		TypeSurface,
+		// format family
+		FormatNone,				// buffers
+		Format8Bit,				// 8 bits per channel color, r8 to rgba8/bgra8
+		FormatPacked,			// 10/11 bit packed and 5/6 bit color
+		Format16Bit,
+		Format32Bit,
+		FormatBlockCompressed,
+		FormatDepthStencil,
+		FormatOther,
+		// the first usage the resource was created with, in this order
+		UsageDepthStencil,
+		UsageRenderTarget,
+		UsageUnorderedAccess,
+		UsageConstantBuffer,
+		UsageVertexIndexBuffer,
+		UsageShaderResource,
+		UsageOther,
+		// reshade::api::memory_heap
+		HeapGpu,
+		HeapUpload,
+		HeapReadback,			// gpu_to_cpu and cpu_only
+		HeapUnknown,			// unknown and custom
+		// estimated size
+		SizeBelow64KB,
+		SizeBelow1MB,
+		SizeBelow16MB,
+		SizeBelow64MB,
+		SizeAbove64MB,
+		Count,
+	};
+
+
+	struct MemoryTotals
+	{
+		int64_t bytes = 0;
+		int64_t count = 0;
+		int64_t peakBytes = 0;		// highest bytes seen at a present
+	};
+
+
+	/// <summary>
+	/// The merged counters, as of the last present.
+	/// </summary>
+	struct MemorySnapshot
+	{
+		std::array<MemoryTotals, static_cast<size_t>(MemoryCategory::Count)> categories;
+		uint64_t frame = 0;
+		uint64_t allocatedBytes = 0;		// created in the last frame
+		uint64_t freedBytes = 0;			// destroyed in the last frame
+		uint64_t allocationCount = 0;
+		uint64_t releaseCount = 0;
+		double churnBytesPerFrame = 0.0;	// created plus destroyed bytes per frame, averaged over the last second
+
+		const MemoryTotals& get(MemoryCategory category) const { return categories[static_cast<size_t>(category)]; }
+	};
+
+
+	/// <summary>
+	/// Counts the memory of the resources created and destroyed. Each thread adds to counters of its own, the present thread merges them
+	///	into the snapshot once per frame, so creating resources on several threads doesn't contend on shared counters. Texture sizes are
+	///	estimated from the desc: every mip level of every layer or depth slice, times the sample count. Placement, alignment and the driver's
+	///	own padding aren't known, the real use is higher, mostly for small textures.
+	/// </summary>
+	class MemoryTracker
+	{
+	public:
+		static constexpr uint32_t MaxThreadCount = 64;		// threads past this share one set of counters
+
+		~MemoryTracker();
+
+		static uint64_t estimateBytes(const ResourceDescription& description);
+		/// <summary>
+		/// Estimated bytes of box in the subresource of a texture, of the whole subresource without a box. The size for buffers.
+		/// </summary>
+		/// <param name="description"></param>
+		/// <param name="subresource"></param>
+		/// <param name="box">can be null</param>
+		/// <returns></returns>
+		static uint64_t estimateSubresourceBytes(const ResourceDescription& description, uint32_t subresource, const reshade::api::subresource_box* box);
+
+		void onCreate(const ResourceDescription& description) { add(description, 1); }
+		void onDestroy(const ResourceDescription& description) { add(description, -1); }
+		/// <summary>
+		/// Merges the counters of the threads into the snapshot, updates the peaks and the churn, and writes a line to the csv file when it's due.
+		///	Present thread only.
+		/// </summary>
+		void onPresent();
+		/// <summary>
+		/// Present thread only.
+		/// </summary>
+		const MemorySnapshot& getSnapshot() const { return _snapshot; }
+		/// <summary>
+		/// Sets where the csv is written. It's created on the first line written in the session.
+		/// </summary>
+		/// <param name="fileName"></param>
+		void setCsvFileName(const std::filesystem::path& fileName) { _csvFileName = fileName; }
+		const std::filesystem::path& getCsvFileName() const { return _csvFileName; }
+		/// <summary>
+		/// 0 stops writing the csv. Present thread only.
+		/// </summary>
+		/// <param name="seconds"></param>
+		void setCsvInterval(uint32_t seconds);
+		uint32_t getCsvInterval() const { return _csvIntervalSeconds; }
+
+	private:
+		static constexpr size_t CategoryCount = static_cast<size_t>(MemoryCategory::Count);
+
+		/// <summary>
+		/// Counters of one thread since the start, only that thread adds to them. The overflow counters are shared by the threads past MaxThreadCount.
+		/// </summary>
+		struct alignas(64) ThreadCounters
+		{
+			std::array<std::atomic<int64_t>, CategoryCount> bytes = {};
+			std::array<std::atomic<int64_t>, CategoryCount> counts = {};
+			std::atomic<uint64_t> allocatedBytes = 0;
+			std::atomic<uint64_t> freedBytes = 0;
+			std::atomic<uint64_t> allocationCount = 0;
+			std::atomic<uint64_t> releaseCount = 0;
+		};
+
+		ThreadCounters& getThreadCounters()
+		{
+			// one MemoryTracker per process, so the counters of a thread can be cached in a plain thread_local
+			thread_local ThreadCounters* threadCounters = nullptr;
+			if(nullptr == threadCounters)
+			{
+				threadCounters = registerThread();
+			}
+			return *threadCounters;
+		}
+		ThreadCounters* registerThread();
+		void add(const ResourceDescription& description, int64_t sign);
+		void writeCsvLine(double seconds);
+
+		std::array<std::unique_ptr<ThreadCounters>, MaxThreadCount> _threadCounters;
+		std::atomic<uint32_t> _threadCount = 0;		// counters [0, _threadCount) are registered, published with release
+		ThreadCounters _overflowCounters;
+		std::mutex _registerMutex;
+
+		// present thread
+		MemorySnapshot _snapshot;
+		uint64_t _lastAllocatedBytes = 0;
+		uint64_t _lastFreedBytes = 0;
+		uint64_t _lastAllocationCount = 0;
+		uint64_t _lastReleaseCount = 0;
+		int64_t _churnWindowStart = 0;			// steady_clock ticks
+		uint64_t _churnWindowBytes = 0;
+		uint64_t _churnWindowFrames = 0;
+		std::filesystem::path _csvFileName;
+		std::FILE* _csvFile = nullptr;
+		uint32_t _csvIntervalSeconds = 0;
+		int64_t _csvStart = 0;
+		int64_t _lastCsvLine = 0;
+	};
+
+	const char* getMemoryCategoryName(MemoryCategory category);
+}
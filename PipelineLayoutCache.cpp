@@ -0,0 +1,215 @@
+/// interning cache for the pipeline layouts created by the addon (CB injection layouts), so identical layouts are created once per device
+
+#include "PipelineLayoutCache.h"
+
+using namespace reshade::api;
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		void appendRange(std::vector<uint32_t>& key, const descriptor_range& range)
+		{
+			key.push_back(range.binding);
+			key.push_back(range.dx_register_index);
+			key.push_back(range.dx_register_space);
+			key.push_back(range.count);
+			key.push_back(static_cast<uint32_t>(range.visibility));
+			key.push_back(range.array_size);
+			key.push_back(static_cast<uint32_t>(range.type));
+		}
+	}
+
+
+	bool PipelineLayoutCache::acquire(device* device, uint32_t paramCount, const pipeline_layout_param* params, pipeline_layout* layout)
+	{
+		std::vector<uint32_t> key = createKey(paramCount, params);
+		const uint64_t keyHash = hashKey(device, key);
+
+		{
+			std::unique_lock lock(_cacheMutex);
+			if(addReference(device, keyHash, key, layout))
+			{
+				++_hitCount;
+				return true;
+			}
+		}
+
+		// created without the lock: the driver call would serialize every layout creation, and reshade raises the create events of the
+		// layout from inside it, which can come back into the cache.
+		++_missCount;
+		pipeline_layout newLayout = { 0 };
+		if(!device->create_pipeline_layout(paramCount, params, &newLayout))
+		{
+			return false;
+		}
+
+		std::unique_lock lock(_cacheMutex);
+		if(addReference(device, keyHash, key, layout))
+		{
+			// another thread created the same layout in the meantime, use that one.
+			lock.unlock();
+			device->destroy_pipeline_layout(newLayout);
+			return true;
+		}
+		_layoutsPerKeyHash[keyHash].push_back({ device, std::move(key), newLayout, 1 });
+		_layoutPerHandle[newLayout.handle] = keyHash;
+		*layout = newLayout;
+		return true;
+	}
+
+
+	void PipelineLayoutCache::release(device* device, pipeline_layout layout)
+	{
+		{
+			std::unique_lock lock(_cacheMutex);
+			const auto handleIt = _layoutPerHandle.find(layout.handle);
+			if(handleIt == _layoutPerHandle.end())
+			{
+				return;
+			}
+			const uint64_t keyHash = handleIt->second;
+			bool isLastReference = false;
+			for(auto& cachedLayout : _layoutsPerKeyHash[keyHash])
+			{
+				if(cachedLayout.device == device && cachedLayout.layout.handle == layout.handle)
+				{
+					isLastReference = --cachedLayout.refCount == 0;
+					break;
+				}
+			}
+			if(!isLastReference)
+			{
+				return;
+			}
+			removeLayout(keyHash, layout.handle);
+		}
+		// like the create, the destroy is done without the lock
+		device->destroy_pipeline_layout(layout);
+		++_destroyedCount;
+	}
+
+
+	void PipelineLayoutCache::releaseAll(device* device)
+	{
+		std::vector<pipeline_layout> toDestroy;
+		{
+			std::unique_lock lock(_cacheMutex);
+			std::vector<std::pair<uint64_t, uint64_t>> toRemove;
+			for(const auto& [keyHash, cachedLayouts] : _layoutsPerKeyHash)
+			{
+				for(const auto& cachedLayout : cachedLayouts)
+				{
+					if(cachedLayout.device == device)
+					{
+						toRemove.emplace_back(keyHash, cachedLayout.layout.handle);
+					}
+				}
+			}
+			for(const auto& [keyHash, layoutHandle] : toRemove)
+			{
+				removeLayout(keyHash, layoutHandle);
+				toDestroy.push_back({ layoutHandle });
+			}
+		}
+		for(const pipeline_layout layout : toDestroy)
+		{
+			device->destroy_pipeline_layout(layout);
+			++_destroyedCount;
+		}
+	}
+
+
+	bool PipelineLayoutCache::addReference(device* device, uint64_t keyHash, const std::vector<uint32_t>& key, pipeline_layout* layout)
+	{
+		// _cacheMutex is held by the caller
+		const auto candidates = _layoutsPerKeyHash.find(keyHash);
+		if(candidates == _layoutsPerKeyHash.end())
+		{
+			return false;
+		}
+		for(auto& cachedLayout : candidates->second)
+		{
+			if(cachedLayout.device == device && cachedLayout.key == key)
+			{
+				++cachedLayout.refCount;
+				*layout = cachedLayout.layout;
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	void PipelineLayoutCache::removeLayout(uint64_t keyHash, uint64_t layoutHandle)
+	{
+		// _cacheMutex is held by the caller. The layout itself is destroyed by the caller, after the lock is released.
+		std::vector<CachedLayout>& cachedLayouts = _layoutsPerKeyHash[keyHash];
+		for(auto it = cachedLayouts.begin(); it != cachedLayouts.end(); ++it)
+		{
+			if(it->layout.handle == layoutHandle)
+			{
+				cachedLayouts.erase(it);
+				break;
+			}
+		}
+		if(cachedLayouts.empty())
+		{
+			_layoutsPerKeyHash.erase(keyHash);
+		}
+		_layoutPerHandle.erase(layoutHandle);
+	}
+
+
+	std::vector<uint32_t> PipelineLayoutCache::createKey(uint32_t paramCount, const pipeline_layout_param* params)
+	{
+		// flattens the params to their values: ranges of descriptor tables are copied, so two arrays built in different memory compare equal.
+		std::vector<uint32_t> key;
+		key.reserve(paramCount * 8);
+		for(uint32_t paramIndex = 0; paramIndex < paramCount; ++paramIndex)
+		{
+			const pipeline_layout_param& param = params[paramIndex];
+			key.push_back(static_cast<uint32_t>(param.type));
+			switch(param.type)
+			{
+			case pipeline_layout_param_type::push_constants:
+				key.push_back(param.push_constants.binding);
+				key.push_back(param.push_constants.dx_register_index);
+				key.push_back(param.push_constants.dx_register_space);
+				key.push_back(param.push_constants.count);
+				key.push_back(static_cast<uint32_t>(param.push_constants.visibility));
+				break;
+			case pipeline_layout_param_type::descriptor_table:
+			case pipeline_layout_param_type::push_descriptors_with_ranges:
+				key.push_back(param.descriptor_table.count);
+				for(uint32_t rangeIndex = 0; rangeIndex < param.descriptor_table.count; ++rangeIndex)
+				{
+					appendRange(key, param.descriptor_table.ranges[rangeIndex]);
+				}
+				break;
+			default:
+				appendRange(key, param.push_descriptors);
+				break;
+			}
+		}
+		return key;
+	}
+
+
+	uint64_t PipelineLayoutCache::hashKey(device* device, const std::vector<uint32_t>& key)
+	{
+		// FNV-1a over the device pointer and the key values
+		uint64_t hash = 14695981039346656037ull;
+		const auto mix = [&hash](uint64_t value)
+			{
+				hash ^= value;
+				hash *= 1099511628211ull;
+			};
+		mix(reinterpret_cast<uint64_t>(device));
+		for(const uint32_t value : key)
+		{
+			mix(value);
+		}
+		return hash;
+	}
+}
@@ -0,0 +1,75 @@
+/// interning cache for the pipeline layouts created by the addon (CB injection layouts), so identical layouts are created once per device
+
+#pragma once
+
+#include <reshade_api_device.hpp>
+#include <reshade_api_pipeline.hpp>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// Hands out pipeline layouts created by the addon. Layouts are keyed on the device and a canonical form of the pipeline_layout_param array
+	///	(descriptor table ranges are compared by value, not by pointer), so requesting an identical layout again returns the existing one.
+	///	Layouts are ref counted: every successful acquire has to be paired with a release, the layout is destroyed when the last reference is
+	///	released. Thread safe, the layouts are created and destroyed outside the lock.
+	/// </summary>
+	class PipelineLayoutCache
+	{
+	public:
+		/// <summary>
+		/// Returns in layout a pipeline layout with the params passed in, creating it if there isn't one yet for this device. Returns false if
+		///	the layout couldn't be created.
+		/// </summary>
+		/// <param name="device"></param>
+		/// <param name="paramCount"></param>
+		/// <param name="params"></param>
+		/// <param name="layout"></param>
+		/// <returns></returns>
+		bool acquire(reshade::api::device* device, uint32_t paramCount, const reshade::api::pipeline_layout_param* params, reshade::api::pipeline_layout* layout);
+		/// <summary>
+		/// Releases a reference obtained through acquire. The layout is destroyed when it was the last reference. Layouts not created by the cache are ignored.
+		/// </summary>
+		/// <param name="device"></param>
+		/// <param name="layout"></param>
+		void release(reshade::api::device* device, reshade::api::pipeline_layout layout);
+		/// <summary>
+		/// Destroys all layouts of the device passed in, whatever their reference count. To be called when the device is destroyed.
+		/// </summary>
+		/// <param name="device"></param>
+		void releaseAll(reshade::api::device* device);
+
+		uint64_t getHitCount() const { return _hitCount; }
+		uint64_t getMissCount() const { return _missCount; }
+		uint64_t getDestroyedCount() const { return _destroyedCount; }
+		size_t getLayoutCount()
+		{
+			std::unique_lock lock(_cacheMutex);
+			return _layoutPerHandle.size();
+		}
+
+	private:
+		struct CachedLayout
+		{
+			reshade::api::device* device;
+			std::vector<uint32_t> key;
+			reshade::api::pipeline_layout layout;
+			uint32_t refCount;
+		};
+
+		static std::vector<uint32_t> createKey(uint32_t paramCount, const reshade::api::pipeline_layout_param* params);
+		static uint64_t hashKey(reshade::api::device* device, const std::vector<uint32_t>& key);
+		bool addReference(reshade::api::device* device, uint64_t keyHash, const std::vector<uint32_t>& key, reshade::api::pipeline_layout* layout);
+		void removeLayout(uint64_t keyHash, uint64_t layoutHandle);
+
+		std::mutex _cacheMutex;
+		std::unordered_map<uint64_t, std::vector<CachedLayout>> _layoutsPerKeyHash;		// key hash -> layouts with that hash (collisions share the vector)
+		std::unordered_map<uint64_t, uint64_t> _layoutPerHandle;						// layout handle -> key hash
+		std::atomic<uint64_t> _hitCount = 0;
+		std::atomic<uint64_t> _missCount = 0;
+		std::atomic<uint64_t> _destroyedCount = 0;
+	};
+}
@@ -0,0 +1,139 @@
+/// registry of the resources, views and samplers the game created, with a compact description of each, for the capture and the overlay
+
+#include "ResourceRegistry.h"
+#include <bit>
+#include <mutex>
+
+using namespace reshade::api;
+
+namespace ShaderToggler
+{
+	ResourceDescription ResourceRegistry::describeResource(const resource_desc& desc)
+	{
+		ResourceDescription description;
+		description.kind = RegisteredObjectKind::Resource;
+		description.type = static_cast<uint8_t>(desc.type);
+		description.usage = static_cast<uint32_t>(desc.usage);
+		description.heap = static_cast<uint8_t>(desc.heap);
+		if(desc.type == resource_type::buffer)
+		{
+			description.size = desc.buffer.size;
+		}
+		else
+		{
+			description.width = desc.texture.width;
+			description.height = desc.texture.height;
+			description.depthOrLayers = desc.texture.depth_or_layers;
+			description.levels = desc.texture.levels;
+			description.samples = static_cast<uint8_t>(desc.texture.samples);
+			description.format = static_cast<uint32_t>(desc.texture.format);
+		}
+		return description;
+	}
+
+
+	void ResourceRegistry::addResourceView(resource_view view, resource resource, resource_usage usage, const resource_view_desc& desc)
+	{
+		ResourceDescription description;
+		if(resource.handle != 0)
+		{
+			find(resource.handle, description);
+		}
+		description.kind = RegisteredObjectKind::ResourceView;
+		description.type = static_cast<uint8_t>(desc.type);
+		description.resource = resource.handle;
+		description.usage = static_cast<uint32_t>(usage);
+		if(desc.format != format::unknown)
+		{
+			description.format = static_cast<uint32_t>(desc.format);
+		}
+		if(desc.type == resource_view_type::buffer || desc.type == resource_view_type::acceleration_structure)
+		{
+			description.size = desc.buffer.size;
+		}
+		add(view.handle, description);
+	}
+
+
+	void ResourceRegistry::addSampler(sampler sampler)
+	{
+		ResourceDescription description;
+		description.kind = RegisteredObjectKind::Sampler;
+		add(sampler.handle, description);
+	}
+
+
+	void ResourceRegistry::remove(uint64_t handle)
+	{
+		Shard& shard = getShard(handle);
+		std::unique_lock lock(shard.mutex);
+		shard.descriptions.erase(handle);
+	}
+
+
+	bool ResourceRegistry::find(uint64_t handle, ResourceDescription& description) const
+	{
+		const Shard& shard = getShard(handle);
+		std::shared_lock lock(shard.mutex);
+		const auto entry = shard.descriptions.find(handle);
+		if(entry == shard.descriptions.end())
+		{
+			return false;
+		}
+		description = entry->second;
+		return true;
+	}
+
+
+	bool ResourceRegistry::contains(uint64_t handle) const
+	{
+		const Shard& shard = getShard(handle);
+		std::shared_lock lock(shard.mutex);
+		return shard.descriptions.find(handle) != shard.descriptions.end();
+	}
+
+
+	size_t ResourceRegistry::getCount() const
+	{
+		size_t count = 0;
+		for(const Shard& shard : _shards)
+		{
+			std::shared_lock lock(shard.mutex);
+			count += shard.descriptions.size();
+		}
+		return count;
+	}
+
+
+	size_t ResourceRegistry::getShardIndex(uint64_t handle)
+	{
+		// handles are aligned pointers or descriptor addresses a fixed stride apart, the multiply spreads them over the top bits
+		static_assert((ShardCount & (ShardCount - 1)) == 0, "ShardCount has to be a power of 2");
+		constexpr int shardBits = std::countr_zero(ShardCount);
+		return static_cast<size_t>((handle * 0x9E3779B97F4A7C15ull) >> (64 - shardBits));
+	}
+
+
+	void ResourceRegistry::add(uint64_t handle, const ResourceDescription& description)
+	{
+		if(handle == 0)
+		{
+			return;
+		}
+		Shard& shard = getShard(handle);
+		std::unique_lock lock(shard.mutex);
+		const auto entry = shard.descriptions.find(handle);
+		if(entry != shard.descriptions.end())
+		{
+			// the handle was reused without a destroy event reaching us, e.g. a D3D12 descriptor written again
+			entry->second = description;
+			return;
+		}
+		if((shard.descriptions.size() + 1) * EntryBytes > _shardBudget.load(std::memory_order_relaxed))
+		{
+			_rejectedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		shard.descriptions.emplace(handle, description);
+	}
+}
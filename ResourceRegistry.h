@@ -0,0 +1,101 @@
+/// registry of the resources, views and samplers the game created, with a compact description of each, for the capture and the overlay
+
+#pragma once
+
+#include <reshade_api_resource.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace ShaderToggler
+{
+	enum class RegisteredObjectKind : uint8_t
+	{
+		Resource = 0,
+		ResourceView,
+		Sampler,
+	};
+
+
+	/// <summary>
+	/// What is known of a registered handle. Views get the dimensions of their resource, so a view is described with one lookup.
+	/// </summary>
+	struct ResourceDescription
+	{
+		uint64_t size = 0;				// buffer size in bytes, for buffer views the size of the range (UINT64_MAX: the whole buffer)
+		uint64_t resource = 0;			// the resource of a view
+		uint32_t width = 0;				// textures, views of textures
+		uint32_t height = 0;
+		uint32_t format = 0;			// reshade::api::format, of the view for views
+		uint32_t usage = 0;				// reshade::api::resource_usage bits the resource was created with, the usage a view was created for
+		uint16_t depthOrLayers = 0;
+		uint16_t levels = 0;
+		uint8_t samples = 0;
+		uint8_t heap = 0;				// reshade::api::memory_heap of a resource
+		uint8_t type = 0;				// reshade::api::resource_type, or reshade::api::resource_view_type for views
+		RegisteredObjectKind kind = RegisteredObjectKind::Resource;
+	};
+
+
+	/// <summary>
+	/// Maps handles to their ResourceDescription, filled by the init and destroy hooks of resources, views and samplers. The handles are spread
+	///	over ShardCount shards, each with its own lock, so games creating resources on several threads at once rarely wait on each other, and
+	///	lookups from the command list hooks only take a shared lock.
+	///
+	///	The registry stays under a memory budget: a handle registered while its shard is at its part of the budget isn't stored and is counted
+	///	as rejected, lookups of it fail like those of unknown handles. Thread safe.
+	/// </summary>
+	class ResourceRegistry
+	{
+	public:
+		static constexpr size_t ShardCount = 64;
+		static constexpr size_t DefaultMemoryBudget = 64 * 1024 * 1024;
+		// what an entry costs in the unordered_map: the node with its next pointer and cached hash, and about one bucket pointer
+		static constexpr size_t EntryBytes = sizeof(uint64_t) + sizeof(ResourceDescription) + 3 * sizeof(void*);
+
+		static ResourceDescription describeResource(const reshade::api::resource_desc& desc);
+
+		void addResource(reshade::api::resource resource, const ResourceDescription& description) { add(resource.handle, description); }
+		void addResourceView(reshade::api::resource_view view, reshade::api::resource resource, reshade::api::resource_usage usage,
+							 const reshade::api::resource_view_desc& desc);
+		void addSampler(reshade::api::sampler sampler);
+		void remove(uint64_t handle);
+		/// <summary>
+		/// Copies the description of handle to description. Returns false if the handle isn't registered, or was rejected by the budget.
+		/// </summary>
+		/// <param name="handle"></param>
+		/// <param name="description"></param>
+		/// <returns></returns>
+		bool find(uint64_t handle, ResourceDescription& description) const;
+		bool contains(uint64_t handle) const;
+		/// <summary>
+		/// Applies to the handles registered afterwards, the ones registered already are kept.
+		/// </summary>
+		/// <param name="bytes"></param>
+		void setMemoryBudget(size_t bytes) { _shardBudget.store(bytes / ShardCount, std::memory_order_relaxed); }
+		size_t getMemoryBudget() const { return _shardBudget.load(std::memory_order_relaxed) * ShardCount; }
+
+		size_t getCount() const;
+		size_t getMemoryUsed() const { return getCount() * EntryBytes; }
+		uint64_t getRejectedCount() const { return _rejectedCount.load(std::memory_order_relaxed); }
+
+	private:
+		struct alignas(64) Shard
+		{
+			mutable std::shared_mutex mutex;
+			std::unordered_map<uint64_t, ResourceDescription> descriptions;
+		};
+
+		Shard& getShard(uint64_t handle) { return _shards[getShardIndex(handle)]; }
+		const Shard& getShard(uint64_t handle) const { return _shards[getShardIndex(handle)]; }
+		static size_t getShardIndex(uint64_t handle);
+		void add(uint64_t handle, const ResourceDescription& description);
+
+		std::array<Shard, ShardCount> _shards;
+		std::atomic<size_t> _shardBudget = DefaultMemoryBudget / ShardCount;
+		std::atomic<uint64_t> _rejectedCount = 0;
+	};
+}
@@ -0,0 +1,200 @@
+/// fast LZ block compressor for the shader dump. Byte oriented, LZ4 like sequences, no dependencies so the tools can use it on linux too.
+
+#include "ShaderCodeCompressor.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		constexpr size_t MIN_MATCH_LENGTH = 4;
+		constexpr size_t MAX_MATCH_OFFSET = 0xFFFF;
+		constexpr uint32_t HASH_TABLE_BITS = 14;
+		constexpr uint32_t NO_POSITION = 0xFFFFFFFF;
+
+		uint32_t read32(const uint8_t* source)
+		{
+			uint32_t value;
+			memcpy(&value, source, sizeof(value));
+			return value;
+		}
+
+
+		uint32_t hashSequence(uint32_t sequence)
+		{
+			return (sequence * 2654435761u) >> (32 - HASH_TABLE_BITS);
+		}
+
+
+		void writeLength(std::vector<uint8_t>& output, size_t length)
+		{
+			// the part of the length which didn't fit in the token nibble, 15 already subtracted by the caller.
+			while(length >= 255)
+			{
+				output.push_back(255);
+				length -= 255;
+			}
+			output.push_back(static_cast<uint8_t>(length));
+		}
+
+
+		void writeSequence(std::vector<uint8_t>& output, const uint8_t* literals, size_t literalCount, size_t matchOffset, size_t matchLength)
+		{
+			const size_t matchCode = matchLength > 0 ? matchLength - MIN_MATCH_LENGTH : 0;
+			const uint8_t token = static_cast<uint8_t>(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+			output.push_back(token);
+			if(literalCount >= 15)
+			{
+				writeLength(output, literalCount - 15);
+			}
+			output.insert(output.end(), literals, literals + literalCount);
+			if(matchLength == 0)
+			{
+				// last sequence
+				return;
+			}
+			output.push_back(static_cast<uint8_t>(matchOffset & 0xFF));
+			output.push_back(static_cast<uint8_t>(matchOffset >> 8));
+			if(matchCode >= 15)
+			{
+				writeLength(output, matchCode - 15);
+			}
+		}
+
+
+		bool readLength(const uint8_t*& input, const uint8_t* inputEnd, size_t& length)
+		{
+			uint8_t value;
+			do
+			{
+				if(input >= inputEnd)
+				{
+					return false;
+				}
+				value = *input++;
+				length += value;
+			} while(value == 255);
+			return true;
+		}
+	}
+
+
+	void compressShaderCode(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed)
+	{
+		compressed.clear();
+		compressed.reserve(sizeof(ShaderCodeCompressedHeader) + size + size / 255 + 16);
+		const ShaderCodeCompressedHeader header = { SHADER_CODE_COMPRESSED_MAGIC, static_cast<uint32_t>(size) };
+		compressed.resize(sizeof(header));
+		memcpy(compressed.data(), &header, sizeof(header));
+
+		static thread_local uint32_t hashTable[1 << HASH_TABLE_BITS];
+		std::fill(std::begin(hashTable), std::end(hashTable), NO_POSITION);
+
+		size_t position = 0;
+		size_t literalStart = 0;
+		while(position + MIN_MATCH_LENGTH <= size)
+		{
+			const uint32_t sequence = read32(data + position);
+			const uint32_t hash = hashSequence(sequence);
+			const uint32_t candidate = hashTable[hash];
+			hashTable[hash] = static_cast<uint32_t>(position);
+			if(candidate == NO_POSITION || position - candidate > MAX_MATCH_OFFSET || read32(data + candidate) != sequence)
+			{
+				// skip faster through data which doesn't compress
+				position += 1 + ((position - literalStart) >> 6);
+				continue;
+			}
+
+			size_t matchLength = MIN_MATCH_LENGTH;
+			while(position + matchLength < size && data[candidate + matchLength] == data[position + matchLength])
+			{
+				++matchLength;
+			}
+			writeSequence(compressed, data + literalStart, position - literalStart, position - candidate, matchLength);
+			position += matchLength;
+			literalStart = position;
+		}
+		writeSequence(compressed, data + literalStart, size - literalStart, 0, 0);
+	}
+
+
+	bool decompressShaderCode(const uint8_t* data, size_t size, std::vector<uint8_t>& decompressed)
+	{
+		if(!isCompressedShaderCode(data, size))
+		{
+			return false;
+		}
+		ShaderCodeCompressedHeader header;
+		memcpy(&header, data, sizeof(header));
+		if(header.rawSize / 255 > size)
+		{
+			// more than a sequence can expand to, corrupt header. Don't allocate it.
+			return false;
+		}
+		decompressed.resize(header.rawSize);
+
+		const uint8_t* input = data + sizeof(header);
+		const uint8_t* inputEnd = data + size;
+		uint8_t* const outputStart = decompressed.data();
+		uint8_t* output = outputStart;
+		uint8_t* const outputEnd = outputStart + header.rawSize;
+		while(input < inputEnd)
+		{
+			const uint8_t token = *input++;
+			size_t literalCount = token >> 4;
+			if(literalCount == 15 && !readLength(input, inputEnd, literalCount))
+			{
+				return false;
+			}
+			if(literalCount > static_cast<size_t>(inputEnd - input) || literalCount > static_cast<size_t>(outputEnd - output))
+			{
+				return false;
+			}
+			memcpy(output, input, literalCount);
+			input += literalCount;
+			output += literalCount;
+			if(input == inputEnd)
+			{
+				// last sequence has no match
+				break;
+			}
+
+			if(inputEnd - input < 2)
+			{
+				return false;
+			}
+			const size_t matchOffset = input[0] | (static_cast<size_t>(input[1]) << 8);
+			input += 2;
+			size_t matchLength = token & 0x0F;
+			if(matchLength == 15 && !readLength(input, inputEnd, matchLength))
+			{
+				return false;
+			}
+			matchLength += MIN_MATCH_LENGTH;
+			if(matchOffset == 0 || matchOffset > static_cast<size_t>(output - outputStart) || matchLength > static_cast<size_t>(outputEnd - output))
+			{
+				return false;
+			}
+			// the match can overlap the output written by itself, so copy byte by byte.
+			const uint8_t* match = output - matchOffset;
+			for(size_t i = 0; i < matchLength; ++i)
+			{
+				output[i] = match[i];
+			}
+			output += matchLength;
+		}
+		return output == outputEnd;
+	}
+
+
+	bool isCompressedShaderCode(const uint8_t* data, size_t size)
+	{
+		if(nullptr == data || size < sizeof(ShaderCodeCompressedHeader))
+		{
+			return false;
+		}
+		return read32(data) == SHADER_CODE_COMPRESSED_MAGIC;
+	}
+}
@@ -0,0 +1,46 @@
+/// fast LZ block compressor for the shader dump. Byte oriented, LZ4 like sequences, no dependencies so the tools can use it on linux too.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ShaderToggler
+{
+	constexpr uint32_t SHADER_CODE_COMPRESSED_MAGIC = 0x5A4C5353;		// 'SSLZ'
+
+	/// <summary>
+	/// Header in front of every compressed blob, so a blob can be decompressed without knowing where it came from.
+	///	Followed by sequences: a token byte (high nibble: literal count, low nibble: match length - 4, 15 means more length bytes follow),
+	///	the extra literal length bytes, the literals, a 16 bit little endian match offset and the extra match length bytes. The last
+	///	sequence has literals only and ends at the end of the blob.
+	/// </summary>
+	struct ShaderCodeCompressedHeader
+	{
+		uint32_t magic;
+		uint32_t rawSize;
+	};
+
+	static_assert(sizeof(ShaderCodeCompressedHeader) == 8, "ShaderCodeCompressedHeader is part of the file format");
+
+	/// <summary>
+	/// Compresses the data passed in into compressed, which is overwritten. Never fails; incompressible data grows by a few bytes.
+	/// </summary>
+	/// <param name="data"></param>
+	/// <param name="size"></param>
+	/// <param name="compressed"></param>
+	void compressShaderCode(const uint8_t* data, size_t size, std::vector<uint8_t>& compressed);
+	/// <summary>
+	/// Decompresses the blob passed in into decompressed, which is overwritten. Returns false if the blob isn't valid compressed data.
+	/// </summary>
+	/// <param name="data"></param>
+	/// <param name="size"></param>
+	/// <param name="decompressed"></param>
+	/// <returns></returns>
+	bool decompressShaderCode(const uint8_t* data, size_t size, std::vector<uint8_t>& decompressed);
+	/// <summary>
+	/// Returns true if the data passed in starts with a ShaderCodeCompressedHeader.
+	/// </summary>
+	bool isCompressedShaderCode(const uint8_t* data, size_t size);
+}
@@ -0,0 +1,389 @@
+/// single-file shader dump archive: an append-only data file (shaderdump.pak) and a sorted hash index (shaderdump.idx).
+/// Doesn't depend on reshade so it can be built on linux for the tools in the tools folder.
+
+#include "ShaderDumpArchive.h"
+#include "ShaderCodeCompressor.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		bool entryHashLess(const ShaderDumpIndexEntry& a, const ShaderDumpIndexEntry& b)
+		{
+			return a.shaderHash < b.shaderHash;
+		}
+
+
+		/// <summary>
+		/// Walks the records in the data passed in and calls func for each valid record. Returns the offset right after the last valid record.
+		/// </summary>
+		template<typename Func>
+		uint64_t walkRecords(const uint8_t* data, uint64_t dataSize, Func func)
+		{
+			uint64_t offset = sizeof(ShaderDumpArchiveHeader);
+			while(offset + sizeof(ShaderDumpRecordHeader) <= dataSize)
+			{
+				ShaderDumpRecordHeader record;
+				memcpy(&record, data + offset, sizeof(record));
+				if(record.magic != SHADER_DUMP_RECORD_MAGIC || record.size > dataSize - offset - sizeof(ShaderDumpRecordHeader))
+				{
+					break;
+				}
+				ShaderDumpIndexEntry entry;
+				entry.shaderHash = record.shaderHash;
+				entry.stage = static_cast<uint16_t>(record.stage);
+				entry.flags = static_cast<uint16_t>(record.flags);
+				entry.deviceApi = record.deviceApi;
+				entry.size = record.size;
+				entry.offset = offset + sizeof(ShaderDumpRecordHeader);
+				func(entry);
+				offset = entry.offset + record.size;
+			}
+			return offset;
+		}
+
+
+		bool hasValidArchiveHeader(const MappedFile& file)
+		{
+			if(file.size() < sizeof(ShaderDumpArchiveHeader))
+			{
+				return false;
+			}
+			ShaderDumpArchiveHeader header;
+			memcpy(&header, file.data(), sizeof(header));
+			return header.magic == SHADER_DUMP_ARCHIVE_MAGIC && header.version == SHADER_DUMP_ARCHIVE_VERSION;
+		}
+	}
+
+
+	ShaderDumpArchiveWriter::~ShaderDumpArchiveWriter()
+	{
+		close();
+	}
+
+
+	bool ShaderDumpArchiveWriter::open(const std::filesystem::path& folder)
+	{
+		close();
+		_dataFileName = folder / SHADER_DUMP_ARCHIVE_DATA_FILENAME;
+		_indexFileName = folder / SHADER_DUMP_ARCHIVE_INDEX_FILENAME;
+		_entries.clear();
+		_entryPerHash.clear();
+		_dataSize = 0;
+
+		std::error_code ec;
+		std::filesystem::create_directories(folder, ec);
+		if(!scanRecords())
+		{
+			return false;
+		}
+
+		_dataFile.open(_dataFileName, std::ios::in | std::ios::out | std::ios::binary);
+		return _dataFile.is_open();
+	}
+
+
+	bool ShaderDumpArchiveWriter::scanRecords()
+	{
+		std::error_code ec;
+		uint64_t validSize = 0;
+		uint64_t fileSize = 0;
+		{
+			MappedFile existing;
+			if(existing.open(_dataFileName) && hasValidArchiveHeader(existing))
+			{
+				fileSize = existing.size();
+				validSize = walkRecords(existing.data(), existing.size(), [this](const ShaderDumpIndexEntry& entry)
+					{
+						if(_entryPerHash.emplace(entry.shaderHash, _entries.size()).second)
+						{
+							_entries.push_back(entry);
+						}
+					});
+			}
+		}
+
+		if(validSize == 0)
+		{
+			// new archive, or not one we can read: start over.
+			std::ofstream newFile(_dataFileName, std::ios::binary | std::ios::trunc);
+			if(!newFile.is_open())
+			{
+				return false;
+			}
+			const ShaderDumpArchiveHeader header = { SHADER_DUMP_ARCHIVE_MAGIC, SHADER_DUMP_ARCHIVE_VERSION };
+			newFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			validSize = sizeof(header);
+			_isIndexDirty = true;
+		}
+		else if(validSize < fileSize)
+		{
+			// torn record at the end, cut it off so new records follow the last valid one.
+			std::filesystem::resize_file(_dataFileName, validSize, ec);
+		}
+
+		_dataSize = validSize;
+		if(!_isIndexDirty)
+		{
+			// only rewrite the index if it doesn't match the data file.
+			MappedFile index;
+			ShaderDumpIndexHeader header = {};
+			if(index.open(_indexFileName) && index.size() >= sizeof(header))
+			{
+				memcpy(&header, index.data(), sizeof(header));
+			}
+			_isIndexDirty = header.magic != SHADER_DUMP_INDEX_MAGIC || header.version != SHADER_DUMP_ARCHIVE_VERSION
+				|| header.entryCount != _entries.size() || header.dataSize != _dataSize;
+		}
+		return true;
+	}
+
+
+	void ShaderDumpArchiveWriter::close()
+	{
+		if(!_dataFile.is_open())
+		{
+			return;
+		}
+		if(_isIndexDirty)
+		{
+			writeIndex();
+		}
+		_dataFile.close();
+	}
+
+
+	bool ShaderDumpArchiveWriter::append(uint32_t shaderHash, uint32_t stage, uint32_t deviceApi, uint32_t flags, const uint8_t* code, uint32_t size)
+	{
+		if(!_dataFile.is_open())
+		{
+			return false;
+		}
+		if(contains(shaderHash))
+		{
+			return true;
+		}
+
+		const ShaderDumpRecordHeader record = { SHADER_DUMP_RECORD_MAGIC, shaderHash, stage, deviceApi, size, flags };
+		_dataFile.seekp(static_cast<std::streamoff>(_dataSize));
+		_dataFile.write(reinterpret_cast<const char*>(&record), sizeof(record));
+		_dataFile.write(reinterpret_cast<const char*>(code), size);
+		if(!_dataFile.good())
+		{
+			// leave the torn record, it's cut off at the next open. Next appends overwrite it.
+			_dataFile.clear();
+			return false;
+		}
+
+		ShaderDumpIndexEntry entry;
+		entry.shaderHash = shaderHash;
+		entry.stage = static_cast<uint16_t>(stage);
+		entry.flags = static_cast<uint16_t>(flags);
+		entry.deviceApi = deviceApi;
+		entry.size = size;
+		entry.offset = _dataSize + sizeof(ShaderDumpRecordHeader);
+		_entryPerHash.emplace(shaderHash, _entries.size());
+		_entries.push_back(entry);
+		_dataSize = entry.offset + size;
+		_isIndexDirty = true;
+		return true;
+	}
+
+
+	bool ShaderDumpArchiveWriter::writeIndex()
+	{
+		if(!_dataFile.is_open())
+		{
+			return false;
+		}
+		// the index must not point at data which isn't in the file yet.
+		_dataFile.flush();
+
+		std::vector<ShaderDumpIndexEntry> sortedEntries(_entries);
+		std::sort(sortedEntries.begin(), sortedEntries.end(), entryHashLess);
+
+		ShaderDumpIndexHeader header = {};
+		header.magic = SHADER_DUMP_INDEX_MAGIC;
+		header.version = SHADER_DUMP_ARCHIVE_VERSION;
+		header.entryCount = static_cast<uint32_t>(sortedEntries.size());
+		header.dataSize = _dataSize;
+
+		std::filesystem::path tempFileName = _indexFileName;
+		tempFileName += ".tmp";
+		{
+			std::ofstream indexFile(tempFileName, std::ios::binary | std::ios::trunc);
+			if(!indexFile.is_open())
+			{
+				return false;
+			}
+			indexFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			indexFile.write(reinterpret_cast<const char*>(sortedEntries.data()), sortedEntries.size() * sizeof(ShaderDumpIndexEntry));
+			if(!indexFile.good())
+			{
+				return false;
+			}
+		}
+		std::error_code ec;
+		std::filesystem::rename(tempFileName, _indexFileName, ec);
+		if(ec)
+		{
+			return false;
+		}
+		_isIndexDirty = false;
+		return true;
+	}
+
+
+	bool ShaderDumpArchiveReader::open(const std::filesystem::path& folder)
+	{
+		close();
+		if(!_dataFile.open(folder / SHADER_DUMP_ARCHIVE_DATA_FILENAME) || !hasValidArchiveHeader(_dataFile))
+		{
+			close();
+			return false;
+		}
+
+		ShaderDumpIndexHeader header = {};
+		if(_indexFile.open(folder / SHADER_DUMP_ARCHIVE_INDEX_FILENAME) && _indexFile.size() >= sizeof(header))
+		{
+			memcpy(&header, _indexFile.data(), sizeof(header));
+		}
+		const bool isIndexValid = header.magic == SHADER_DUMP_INDEX_MAGIC && header.version == SHADER_DUMP_ARCHIVE_VERSION
+			&& header.dataSize == _dataFile.size()
+			&& _indexFile.size() == sizeof(header) + static_cast<uint64_t>(header.entryCount) * sizeof(ShaderDumpIndexEntry);
+		if(!isIndexValid)
+		{
+			_indexFile.close();
+			return rebuildIndex();
+		}
+		// the mapping is page aligned and the header is 24 bytes, so the entries are 8 byte aligned.
+		_entries = reinterpret_cast<const ShaderDumpIndexEntry*>(_indexFile.data() + sizeof(header));
+		_entryCount = header.entryCount;
+		return true;
+	}
+
+
+	bool ShaderDumpArchiveReader::rebuildIndex()
+	{
+		std::unordered_map<uint32_t, size_t> entryPerHash;
+		walkRecords(_dataFile.data(), _dataFile.size(), [&](const ShaderDumpIndexEntry& entry)
+			{
+				if(entryPerHash.emplace(entry.shaderHash, _rebuiltEntries.size()).second)
+				{
+					_rebuiltEntries.push_back(entry);
+				}
+			});
+		std::sort(_rebuiltEntries.begin(), _rebuiltEntries.end(), entryHashLess);
+		_entries = _rebuiltEntries.data();
+		_entryCount = _rebuiltEntries.size();
+		return true;
+	}
+
+
+	void ShaderDumpArchiveReader::close()
+	{
+		_dataFile.close();
+		_indexFile.close();
+		_rebuiltEntries.clear();
+		_entries = nullptr;
+		_entryCount = 0;
+	}
+
+
+	const ShaderDumpIndexEntry* ShaderDumpArchiveReader::find(uint32_t shaderHash) const
+	{
+		ShaderDumpIndexEntry key = {};
+		key.shaderHash = shaderHash;
+		const ShaderDumpIndexEntry* found = std::lower_bound(begin(), end(), key, entryHashLess);
+		if(found == end() || found->shaderHash != shaderHash)
+		{
+			return nullptr;
+		}
+		return found;
+	}
+
+
+	const uint8_t* ShaderDumpArchiveReader::getCode(const ShaderDumpIndexEntry& entry) const
+	{
+		if(entry.offset + entry.size > _dataFile.size())
+		{
+			return nullptr;
+		}
+		return _dataFile.data() + entry.offset;
+	}
+
+
+	bool ShaderDumpArchiveReader::getDecompressedCode(const ShaderDumpIndexEntry& entry, std::vector<uint8_t>& code) const
+	{
+		const uint8_t* storedCode = getCode(entry);
+		if(nullptr == storedCode)
+		{
+			return false;
+		}
+		if((entry.flags & SHADER_DUMP_FLAG_COMPRESSED) == SHADER_DUMP_FLAG_COMPRESSED)
+		{
+			return decompressShaderCode(storedCode, entry.size, code);
+		}
+		code.assign(storedCode, storedCode + entry.size);
+		return true;
+	}
+
+
+	const char* getShaderDumpStageName(uint32_t stage)
+	{
+		switch(stage)
+		{
+		case 1: return "vertex";
+		case 2: return "hull";
+		case 3: return "domain";
+		case 4: return "geometry";
+		case 5: return "pixel";
+		case 6: return "compute";
+		case 20: return "amplification";
+		case 21: return "mesh";
+		case 22: return "raygen";
+		case 23: return "any_hit";
+		case 24: return "closest_hit";
+		case 25: return "miss";
+		case 26: return "intersection";
+		case 27: return "callable";
+		default: return "unknown";
+		}
+	}
+
+
+	const char* getShaderDumpApiName(uint32_t deviceApi)
+	{
+		switch(deviceApi)
+		{
+		case 0x9000: return "d3d9";
+		case 0xa000: return "d3d10";
+		case 0xb000: return "d3d11";
+		case 0xc000: return "d3d12";
+		case 0x10000: return "opengl";
+		case 0x20000: return "vulkan";
+		default: return "unknown";
+		}
+	}
+
+
+	const char* getShaderDumpFileExtension(uint32_t deviceApi, const uint8_t* code, size_t size)
+	{
+		uint32_t firstWord = 0;
+		if(size > sizeof(firstWord))
+		{
+			memcpy(&firstWord, code, sizeof(firstWord));
+		}
+		if(deviceApi == 0x20000 || (deviceApi == 0x10000 && firstWord == 0x07230203 /* SPIR-V magic value */))
+		{
+			return ".spv";	// Vulkan uses SPIR-V (and sometimes OpenGL does too)
+		}
+		if(deviceApi == 0x10000)
+		{
+			return ".glsl";	// OpenGL otherwise uses plain text GLSL
+		}
+		return ".cso";
+	}
+}
@@ -0,0 +1,179 @@
+/// single-file shader dump archive: an append-only data file (shaderdump.pak) and a sorted hash index (shaderdump.idx).
+/// Doesn't depend on reshade so it can be built on linux for the tools in the tools folder.
+
+#pragma once
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ShaderToggler
+{
+	constexpr uint32_t SHADER_DUMP_ARCHIVE_MAGIC = 0x4B505353;		// 'SSPK'
+	constexpr uint32_t SHADER_DUMP_RECORD_MAGIC = 0x43525353;		// 'SSRC'
+	constexpr uint32_t SHADER_DUMP_INDEX_MAGIC = 0x58495353;		// 'SSIX'
+	constexpr uint32_t SHADER_DUMP_ARCHIVE_VERSION = 1;
+	constexpr uint32_t SHADER_DUMP_FLAG_COMPRESSED = 0x1;			// the code is compressed, see ShaderCodeCompressor.h
+
+	constexpr const char* SHADER_DUMP_ARCHIVE_DATA_FILENAME = "shaderdump.pak";
+	constexpr const char* SHADER_DUMP_ARCHIVE_INDEX_FILENAME = "shaderdump.idx";
+
+	/// <summary>
+	/// Header at the start of shaderdump.pak. Followed by the records, each a ShaderDumpRecordHeader followed by the shader code.
+	/// </summary>
+	struct ShaderDumpArchiveHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+	};
+
+
+	/// <summary>
+	/// Header in front of every shader code blob in shaderdump.pak. Makes it possible to rebuild the index from the data file alone.
+	/// </summary>
+	struct ShaderDumpRecordHeader
+	{
+		uint32_t magic;
+		uint32_t shaderHash;
+		uint32_t stage;			// reshade::api::pipeline_subobject_type
+		uint32_t deviceApi;		// reshade::api::device_api
+		uint32_t size;			// stored size, so the compressed size for compressed code
+		uint32_t flags;			// SHADER_DUMP_FLAG_*
+	};
+
+
+	/// <summary>
+	/// Header at the start of shaderdump.idx. dataSize is the size of shaderdump.pak when the index was written, a reader finding a larger
+	///	pak file knows records were appended after the index was written.
+	/// </summary>
+	struct ShaderDumpIndexHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+		uint64_t dataSize;
+	};
+
+
+	/// <summary>
+	/// Entry in shaderdump.idx, entries are sorted on shaderHash. offset is the offset of the shader code (not the record header) in shaderdump.pak.
+	/// </summary>
+	struct ShaderDumpIndexEntry
+	{
+		uint32_t shaderHash;
+		uint16_t stage;
+		uint16_t flags;
+		uint32_t deviceApi;
+		uint32_t size;
+		uint64_t offset;
+	};
+
+	static_assert(sizeof(ShaderDumpArchiveHeader) == 8, "ShaderDumpArchiveHeader is part of the file format");
+	static_assert(sizeof(ShaderDumpRecordHeader) == 24, "ShaderDumpRecordHeader is part of the file format");
+	static_assert(sizeof(ShaderDumpIndexHeader) == 24, "ShaderDumpIndexHeader is part of the file format");
+	static_assert(sizeof(ShaderDumpIndexEntry) == 24, "ShaderDumpIndexEntry is part of the file format");
+
+
+	/// <summary>
+	/// Appends shader code to shaderdump.pak and writes shaderdump.idx. Not thread safe, it's used by the shader dump thread only.
+	/// </summary>
+	class ShaderDumpArchiveWriter
+	{
+	public:
+		~ShaderDumpArchiveWriter();
+
+		/// <summary>
+		/// Opens (or creates) the archive in the folder passed in. The entries are rebuilt by scanning the record headers in the data file, so
+		///	a missing or outdated index is fixed by the next writeIndex. A torn record at the end of the data file (e.g. a crash while writing)
+		///	is cut off.
+		/// </summary>
+		/// <param name="folder"></param>
+		/// <returns></returns>
+		bool open(const std::filesystem::path& folder);
+		/// <summary>
+		/// Writes the index if it's dirty and closes the data file.
+		/// </summary>
+		void close();
+		/// <summary>
+		/// Appends the shader code passed in. Returns false if the data couldn't be written. A hash already in the archive isn't written again.
+		///	flags is a combination of SHADER_DUMP_FLAG_*, code is stored as passed in.
+		/// </summary>
+		bool append(uint32_t shaderHash, uint32_t stage, uint32_t deviceApi, uint32_t flags, const uint8_t* code, uint32_t size);
+		/// <summary>
+		/// Writes the sorted index to a temp file and renames it over shaderdump.idx, so readers never see a half written index.
+		/// </summary>
+		bool writeIndex();
+
+		bool isOpen() const { return _dataFile.is_open(); }
+		bool isIndexDirty() const { return _isIndexDirty; }
+		bool contains(uint32_t shaderHash) const { return _entryPerHash.count(shaderHash) == 1; }
+		const std::vector<ShaderDumpIndexEntry>& getEntries() const { return _entries; }
+
+	private:
+		bool scanRecords();
+
+		std::filesystem::path _dataFileName;
+		std::filesystem::path _indexFileName;
+		std::fstream _dataFile;
+		uint64_t _dataSize = 0;
+		std::vector<ShaderDumpIndexEntry> _entries;		// in data file order
+		std::unordered_map<uint32_t, size_t> _entryPerHash;
+		bool _isIndexDirty = false;
+	};
+
+
+	/// <summary>
+	/// Read-only access to an archive. Both files are memory mapped, lookups are a binary search on the index. If the index is missing or
+	///	doesn't match the data file, the index is rebuilt in memory from the record headers.
+	/// </summary>
+	class ShaderDumpArchiveReader
+	{
+	public:
+		bool open(const std::filesystem::path& folder);
+		void close();
+
+		/// <summary>
+		/// Returns the entry for the hash passed in, or nullptr if the hash isn't in the archive.
+		/// </summary>
+		const ShaderDumpIndexEntry* find(uint32_t shaderHash) const;
+		/// <summary>
+		/// Returns a pointer to the shader code of the entry passed in, in the mapped data file. The code is still compressed if the entry has
+		///	SHADER_DUMP_FLAG_COMPRESSED set, use getDecompressedCode to get the original code for all entries.
+		/// </summary>
+		const uint8_t* getCode(const ShaderDumpIndexEntry& entry) const;
+		/// <summary>
+		/// Copies the original shader code of the entry passed in to code, decompressing it if needed. Returns false if the code isn't readable.
+		/// </summary>
+		bool getDecompressedCode(const ShaderDumpIndexEntry& entry, std::vector<uint8_t>& code) const;
+
+		const ShaderDumpIndexEntry* begin() const { return _entries; }
+		const ShaderDumpIndexEntry* end() const { return _entries + _entryCount; }
+		size_t size() const { return _entryCount; }
+		bool isIndexRebuilt() const { return !_rebuiltEntries.empty(); }
+
+	private:
+		bool rebuildIndex();
+
+		MappedFile _dataFile;
+		MappedFile _indexFile;
+		const ShaderDumpIndexEntry* _entries = nullptr;
+		size_t _entryCount = 0;
+		std::vector<ShaderDumpIndexEntry> _rebuiltEntries;
+	};
+
+
+	/// <summary>
+	/// Names used by the tools and the per-file layout. Values are the reshade::api enum values, kept here so the tools don't need reshade.
+	/// </summary>
+	const char* getShaderDumpStageName(uint32_t stage);
+	const char* getShaderDumpApiName(uint32_t deviceApi);
+	/// <summary>
+	/// Returns the file extension to use for the code passed in: .spv for SPIR-V, .glsl for OpenGL text, .cso otherwise.
+	/// </summary>
+	const char* getShaderDumpFileExtension(uint32_t deviceApi, const uint8_t* code, size_t size);
+}
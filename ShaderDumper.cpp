@@ -0,0 +1,448 @@
+/// background writer for the shader dump, replaces the synchronous save_shader_code() of the reshade shader_dump_addon example
+
+#include "ShaderDumper.h"
+#include "ShaderCodeCompressor.h"
+#include "crc32_hash.hpp"
+#include <chrono>
+#include <cwchar>
+#include <fstream>
+
+using namespace reshade::api;
+
+namespace ShaderToggler
+{
+	ShaderDumper::ShaderDumper(size_t maxQueuedJobs, size_t codeCacheBudget): _maxQueuedJobs(maxQueuedJobs), _codeCacheBudget(codeCacheBudget)
+	{
+	}
+
+
+	ShaderDumper::~ShaderDumper()
+	{
+		// runs at dll unload, under the loader lock: the thread can't be joined here. stop() should have been called before.
+		if(_worker.joinable())
+		{
+			{
+				std::unique_lock lock(_queueMutex);
+				_stopRequested = true;
+			}
+			_queueCondition.notify_all();
+			_worker.detach();
+		}
+	}
+
+
+	void ShaderDumper::setDumpPath(const std::filesystem::path& dumpPath)
+	{
+		std::unique_lock lock(_queueMutex);
+		_dumpPath = dumpPath;
+	}
+
+
+	void ShaderDumper::setDumpPolicy(ShaderDumpPolicy policy)
+	{
+		std::unique_lock lock(_queueMutex);
+		_policy = policy;
+		bool queued = false;
+		switch(policy)
+		{
+		case ShaderDumpPolicy::Off:
+			_codeCache.clear();
+			_codeCacheIndex.clear();
+			_codeCacheBytes = 0;
+			_hasDeferredCachedJobs = false;
+			break;
+		case ShaderDumpPolicy::All:
+			// everything seen so far is wanted now.
+			queued = queueCachedJobs();
+			break;
+		default:
+			// the selection is passed in by the caller through setSelectedHashes
+			break;
+		}
+		lock.unlock();
+		if(queued)
+		{
+			_queueCondition.notify_one();
+		}
+	}
+
+
+	void ShaderDumper::setSelectedHashes(std::unordered_set<uint32_t> selectedHashes)
+	{
+		std::unique_lock lock(_queueMutex);
+		_selectedHashes = std::move(selectedHashes);
+		const bool queued = queueCachedJobs();
+		lock.unlock();
+		if(queued)
+		{
+			_queueCondition.notify_one();
+		}
+	}
+
+
+	bool ShaderDumper::addShader(device_api deviceApi, pipeline_subobject_type stage, const shader_desc& desc)
+	{
+		const ShaderDumpPolicy policy = _policy;
+		if(policy == ShaderDumpPolicy::Off || desc.code_size == 0 || nullptr == desc.code)
+		{
+			return false;
+		}
+		const uint32_t shaderHash = compute_crc32(static_cast<const uint8_t*>(desc.code), desc.code_size);
+
+		std::unique_lock lock(_queueMutex);
+		if(_dumpedHashes.count(shaderHash) == 1 || _pendingHashes.count(shaderHash) == 1)
+		{
+			++_skippedCount;
+			return false;
+		}
+		const bool isSelected = policy == ShaderDumpPolicy::All || _selectedHashes.count(shaderHash) == 1;
+		if(!isSelected)
+		{
+			const auto cachedJob = _codeCacheIndex.find(shaderHash);
+			if(cachedJob != _codeCacheIndex.end())
+			{
+				// seen again, keep it longer.
+				_codeCache.splice(_codeCache.begin(), _codeCache, cachedJob->second);
+				return false;
+			}
+		}
+
+		ShaderDumpJob job;
+		job.shaderHash = shaderHash;
+		job.deviceApi = deviceApi;
+		job.stage = stage;
+		job.code.assign(static_cast<const uint8_t*>(desc.code), static_cast<const uint8_t*>(desc.code) + desc.code_size);
+		if(!isSelected)
+		{
+			cacheJob(std::move(job));
+			return false;
+		}
+		const bool queued = queueJob(std::move(job));
+		lock.unlock();
+
+		if(queued)
+		{
+			_queueCondition.notify_one();
+		}
+		return queued;
+	}
+
+
+	bool ShaderDumper::queueJob(ShaderDumpJob&& job)
+	{
+		// _queueMutex is held by the caller
+		if(_queue.size() >= _maxQueuedJobs)
+		{
+			// don't block the game thread, the shader will be queued again if another pipeline uses it.
+			++_droppedCount;
+			return false;
+		}
+		if(!_isRunning)
+		{
+			start();
+		}
+		_pendingHashes.emplace(job.shaderHash);
+		_queue.push_back(std::move(job));
+		++_queuedCount;
+		return true;
+	}
+
+
+	void ShaderDumper::cacheJob(ShaderDumpJob&& job)
+	{
+		// _queueMutex is held by the caller
+		const uint32_t shaderHash = job.shaderHash;
+		_codeCacheBytes += job.code.size();
+		_codeCache.push_front(std::move(job));
+		_codeCacheIndex[shaderHash] = _codeCache.begin();
+		while(_codeCacheBytes > _codeCacheBudget && !_codeCache.empty())
+		{
+			// least recently seen shaders go first. If they're selected later, they're dumped when a pipeline using them is created again.
+			_codeCacheBytes -= _codeCache.back().code.size();
+			_codeCacheIndex.erase(_codeCache.back().shaderHash);
+			_codeCache.pop_back();
+			++_evictedCount;
+		}
+	}
+
+
+	bool ShaderDumper::queueCachedJob(uint32_t shaderHash)
+	{
+		// _queueMutex is held by the caller. Removes the job from the cache when it's queued or already dumped. With the queue full it stays
+		// in the cache, queueCachedJobs() is called again by the dump thread once there's room.
+		const auto cachedJob = _codeCacheIndex.find(shaderHash);
+		if(cachedJob == _codeCacheIndex.end())
+		{
+			return false;
+		}
+		const bool isDumped = _dumpedHashes.count(shaderHash) == 1 || _pendingHashes.count(shaderHash) == 1;
+		if(!isDumped && _queue.size() >= _maxQueuedJobs)
+		{
+			_hasDeferredCachedJobs = true;
+			return false;
+		}
+		ShaderDumpJob job = std::move(*cachedJob->second);
+		_codeCacheBytes -= job.code.size();
+		_codeCache.erase(cachedJob->second);
+		_codeCacheIndex.erase(cachedJob);
+		if(isDumped)
+		{
+			return false;
+		}
+		return queueJob(std::move(job));
+	}
+
+
+	bool ShaderDumper::queueCachedJobs()
+	{
+		// _queueMutex is held by the caller. Queues the cached shaders the policy wants, till the queue is full.
+		_hasDeferredCachedJobs = false;
+		bool queued = false;
+		if(_policy == ShaderDumpPolicy::All)
+		{
+			while(!_codeCache.empty() && !_hasDeferredCachedJobs)
+			{
+				queued |= queueCachedJob(_codeCache.front().shaderHash);
+			}
+		}
+		else if(_policy == ShaderDumpPolicy::ToggleGroups || _policy == ShaderDumpPolicy::HuntedOrMarked)
+		{
+			for(const uint32_t shaderHash : _selectedHashes)
+			{
+				if(_hasDeferredCachedJobs)
+				{
+					break;
+				}
+				if(_codeCacheIndex.count(shaderHash) == 1)
+				{
+					queued |= queueCachedJob(shaderHash);
+				}
+			}
+		}
+		return queued;
+	}
+
+
+	void ShaderDumper::start()
+	{
+		// _queueMutex is held by the caller
+		_stopRequested = false;
+		_isRunning = true;
+		_worker = std::thread(&ShaderDumper::workerLoop, this);
+	}
+
+
+	void ShaderDumper::stop()
+	{
+		std::thread worker;
+		{
+			std::unique_lock lock(_queueMutex);
+			if(!_isRunning)
+			{
+				return;
+			}
+			_stopRequested = true;
+			// taken under the lock: the worker clears _isRunning when it exits, a job queued after that starts a new worker in _worker.
+			worker = std::move(_worker);
+		}
+		_queueCondition.notify_all();
+		if(worker.joinable())
+		{
+			worker.join();
+		}
+	}
+
+
+	void ShaderDumper::workerLoop()
+	{
+		// done once per thread start, so the directory checks aren't done per shader.
+		applyDumpLayout(_layout);
+
+		while(true)
+		{
+			ShaderDumpJob job;
+			{
+				std::unique_lock lock(_queueMutex);
+				const auto hasWork = [this] { return _stopRequested || !_queue.empty(); };
+				if(_archiveWriter.isIndexDirty())
+				{
+					// rewrite the pack index once the queue stays empty for a moment, not after every shader of a burst.
+					_queueCondition.wait_for(lock, std::chrono::seconds(1), hasWork);
+				}
+				else
+				{
+					_queueCondition.wait(lock, hasWork);
+				}
+				if(_queue.empty())
+				{
+					if(_stopRequested)
+					{
+						// everything is written. Decided under the lock, so a job is either queued before and written, or queued after and
+						// starts a new worker, which opens the archive again.
+						_archiveWriter.close();
+						_isRunning = false;
+						return;
+					}
+					lock.unlock();
+					if(_archiveWriter.isIndexDirty())
+					{
+						_archiveWriter.writeIndex();
+					}
+					continue;
+				}
+				job = std::move(_queue.front());
+				_queue.pop_front();
+				if(_hasDeferredCachedJobs)
+				{
+					// there's room again for the cached shaders that didn't fit when they were selected
+					queueCachedJobs();
+				}
+			}
+
+			const ShaderDumpLayout requestedLayout = _layout;
+			if(requestedLayout != _activeLayout)
+			{
+				applyDumpLayout(requestedLayout);
+			}
+
+			{
+				std::unique_lock lock(_queueMutex);
+				if(_dumpedHashes.count(job.shaderHash) == 1)
+				{
+					// dumped in an earlier session, the seeding wasn't done yet when it was queued.
+					_pendingHashes.erase(job.shaderHash);
+					++_skippedCount;
+					continue;
+				}
+			}
+
+			const bool written = writeJob(job);
+
+			std::unique_lock lock(_queueMutex);
+			_pendingHashes.erase(job.shaderHash);
+			if(written)
+			{
+				_dumpedHashes.emplace(job.shaderHash);
+				++_writtenCount;
+			}
+		}
+	}
+
+
+	void ShaderDumper::applyDumpLayout(ShaderDumpLayout layout)
+	{
+		std::filesystem::path dumpPath;
+		{
+			std::unique_lock lock(_queueMutex);
+			dumpPath = _dumpPath;
+		}
+		_activeLayout = layout;
+		if(layout == ShaderDumpLayout::Pack)
+		{
+			_archiveWriter.open(dumpPath);
+		}
+		else
+		{
+			_archiveWriter.close();
+		}
+		// the set of dumped shaders depends on the layout, start over with the ones of the new layout.
+		{
+			std::unique_lock lock(_queueMutex);
+			_dumpedHashes.clear();
+		}
+		seedDumpedHashes();
+	}
+
+
+	void ShaderDumper::seedDumpedHashes()
+	{
+		std::filesystem::path dumpPath;
+		{
+			std::unique_lock lock(_queueMutex);
+			dumpPath = _dumpPath;
+		}
+
+		std::error_code ec;
+		std::filesystem::create_directories(dumpPath, ec);
+
+		std::unordered_set<uint32_t> foundHashes;
+		if(_activeLayout == ShaderDumpLayout::Pack)
+		{
+			for(const auto& entry : _archiveWriter.getEntries())
+			{
+				foundHashes.emplace(entry.shaderHash);
+			}
+		}
+		else
+		{
+			// files are named 0x%08X.<extension>[.lz], see writeJobToFile
+			for(const auto& entry : std::filesystem::directory_iterator(dumpPath, ec))
+			{
+				const std::wstring fileName = entry.path().filename().wstring();
+				if(fileName.size() < 11 || fileName[0] != L'0' || (fileName[1] != L'x' && fileName[1] != L'X') || fileName[10] != L'.')
+				{
+					continue;
+				}
+				wchar_t* parseEnd = nullptr;
+				const unsigned long hash = wcstoul(fileName.c_str() + 2, &parseEnd, 16);
+				if(parseEnd == fileName.c_str() + 10)
+				{
+					foundHashes.emplace(static_cast<uint32_t>(hash));
+				}
+			}
+		}
+
+		std::unique_lock lock(_queueMutex);
+		_dumpedHashes.merge(foundHashes);
+	}
+
+
+	bool ShaderDumper::writeJob(const ShaderDumpJob& job)
+	{
+		const bool compress = _compressDumps;
+		if(compress)
+		{
+			const auto startTime = std::chrono::steady_clock::now();
+			compressShaderCode(job.code.data(), job.code.size(), _compressBuffer);
+			_compressionNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+			_compressedRawBytes += job.code.size();
+			_compressedStoredBytes += _compressBuffer.size();
+		}
+		const std::vector<uint8_t>& code = compress ? _compressBuffer : job.code;
+
+		if(_activeLayout == ShaderDumpLayout::Pack)
+		{
+			return _archiveWriter.append(job.shaderHash, static_cast<uint32_t>(job.stage), static_cast<uint32_t>(job.deviceApi),
+				compress ? SHADER_DUMP_FLAG_COMPRESSED : 0, code.data(), static_cast<uint32_t>(code.size()));
+		}
+		return writeJobToFile(job, code, compress);
+	}
+
+
+	bool ShaderDumper::writeJobToFile(const ShaderDumpJob& job, const std::vector<uint8_t>& code, bool isCompressed)
+	{
+		wchar_t hashString[11];
+		swprintf(hashString, 11, L"0x%08X", job.shaderHash);
+
+		std::filesystem::path filePath;
+		{
+			// setDumpPath can be called by the game thread while this one writes
+			std::unique_lock lock(_queueMutex);
+			filePath = _dumpPath;
+		}
+		filePath /= hashString;
+		filePath += getShaderDumpFileExtension(static_cast<uint32_t>(job.deviceApi), job.code.data(), job.code.size());
+		if(isCompressed)
+		{
+			filePath += ".lz";
+		}
+
+		std::ofstream file(filePath, std::ios::binary);
+		if(!file.is_open())
+		{
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(code.data()), code.size());
+		return file.good();
+	}
+}
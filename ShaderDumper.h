@@ -0,0 +1,185 @@
+/// background writer for the shader dump, replaces the synchronous save_shader_code() of the reshade shader_dump_addon example
+
+#pragma once
+
+#include <reshade_api_device.hpp>
+#include <reshade_api_pipeline.hpp>
+#include "ShaderDumpArchive.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// How the dumped shaders are stored in the dump folder.
+	/// </summary>
+	enum class ShaderDumpLayout : int
+	{
+		PerFile = 0,	// one 0x%08X.<extension> file per shader
+		Pack,			// all shaders appended to shaderdump.pak, with the sorted index shaderdump.idx. See ShaderDumpArchive.h
+	};
+
+
+	/// <summary>
+	/// Which shaders are dumped. With the selective policies the code of created shaders is kept in a bounded cache and written when the
+	///	shader gets selected (e.g. marked), so the shaders don't have to be recreated to be dumped.
+	/// </summary>
+	enum class ShaderDumpPolicy : int
+	{
+		Off = 0,
+		All,				// every shader of every created pipeline
+		ToggleGroups,		// shaders in any toggle group
+		HuntedOrMarked,		// the shaders currently hunted or marked
+	};
+
+
+	/// <summary>
+	/// A single shader code blob waiting to be written by the dump thread.
+	/// </summary>
+	struct ShaderDumpJob
+	{
+		uint32_t shaderHash = 0;
+		reshade::api::device_api deviceApi = reshade::api::device_api::d3d11;
+		reshade::api::pipeline_subobject_type stage = reshade::api::pipeline_subobject_type::unknown;
+		std::vector<uint8_t> code;
+	};
+
+
+	/// <summary>
+	/// Class which writes the shader code of created pipelines to the shaderdump folder on a background thread, following the ShaderDumpPolicy
+	///	set. The game thread only copies the
+	///	code into a bounded queue. Hashes already dumped, in this session or in an earlier one (found in the dump folder at start), are skipped.
+	///	If the queue is full the job is dropped instead of blocking the game thread; the hash isn't remembered so a later pipeline using the
+	///	same shader will queue it again. The shaders are written as separate files or appended to a single pack file, see ShaderDumpLayout.
+	/// </summary>
+	class ShaderDumper
+	{
+	public:
+		ShaderDumper(size_t maxQueuedJobs = 4096, size_t codeCacheBudget = 64 * 1024 * 1024);
+		~ShaderDumper();
+
+		/// <summary>
+		/// Sets the folder to dump the shaders to. Has to be called before the first addShader. The folder isn't touched here, that's done by the
+		///	dump thread when it's started.
+		/// </summary>
+		/// <param name="dumpPath"></param>
+		void setDumpPath(const std::filesystem::path& dumpPath);
+		/// <summary>
+		/// Sets the layout to use for shaders dumped from now on. The dump thread picks up the change with the next job. Shaders already dumped
+		///	in the other layout aren't converted.
+		/// </summary>
+		/// <param name="layout"></param>
+		void setDumpLayout(ShaderDumpLayout layout) { _layout = layout; }
+		ShaderDumpLayout getDumpLayout() const { return _layout; }
+		/// <summary>
+		/// If true, shaders dumped from now on are compressed by the dump thread (see ShaderCodeCompressor.h). In the per-file layout the
+		///	files get an extra .lz extension, in the pack layout the record is flagged as compressed.
+		/// </summary>
+		/// <param name="compress"></param>
+		void setCompressDumps(bool compress) { _compressDumps = compress; }
+		bool getCompressDumps() const { return _compressDumps; }
+		/// <summary>
+		/// Sets which shaders are dumped. Switching to All queues the shaders in the code cache, switching to Off empties the code cache. Cached
+		///	shaders that don't fit in the queue stay in the cache and are queued by the dump thread as the queue drains.
+		/// </summary>
+		/// <param name="policy"></param>
+		void setDumpPolicy(ShaderDumpPolicy policy);
+		ShaderDumpPolicy getDumpPolicy() const { return _policy; }
+		/// <summary>
+		/// Sets the shader hashes to dump with the selective policies, replacing the previous selection. Selected shaders found in the code
+		///	cache are queued right away, the others are queued when a pipeline using them is created.
+		/// </summary>
+		/// <param name="selectedHashes"></param>
+		void setSelectedHashes(std::unordered_set<uint32_t> selectedHashes);
+		/// <summary>
+		/// Handles the shader code of a created pipeline: queued for dumping when the policy says so, otherwise kept in the code cache with the
+		///	selective policies. Returns true if the code was queued, false if it was skipped (already dumped / queued), cached or dropped (queue full).
+		///	Starts the dump thread if it's not running.
+		/// </summary>
+		/// <param name="deviceApi"></param>
+		/// <param name="stage"></param>
+		/// <param name="desc"></param>
+		/// <returns></returns>
+		bool addShader(reshade::api::device_api deviceApi, reshade::api::pipeline_subobject_type stage, const reshade::api::shader_desc& desc);
+		/// <summary>
+		/// Waits till all queued jobs are written, then stops the dump thread. Must not be called from DllMain, as the thread exit needs the loader lock.
+		/// </summary>
+		void stop();
+
+		uint64_t getQueuedCount() const { return _queuedCount; }
+		uint64_t getWrittenCount() const { return _writtenCount; }
+		uint64_t getSkippedCount() const { return _skippedCount; }
+		uint64_t getDroppedCount() const { return _droppedCount; }
+		uint64_t getEvictedCount() const { return _evictedCount; }
+		uint64_t getCompressedRawBytes() const { return _compressedRawBytes; }
+		uint64_t getCompressedStoredBytes() const { return _compressedStoredBytes; }
+		uint64_t getCompressionNanoseconds() const { return _compressionNanoseconds; }
+		size_t getPendingCount()
+		{
+			std::unique_lock lock(_queueMutex);
+			return _queue.size();
+		}
+		size_t getCachedCount()
+		{
+			std::unique_lock lock(_queueMutex);
+			return _codeCacheIndex.size();
+		}
+		size_t getCachedBytes()
+		{
+			std::unique_lock lock(_queueMutex);
+			return _codeCacheBytes;
+		}
+
+	private:
+		void start();
+		bool queueJob(ShaderDumpJob&& job);
+		void cacheJob(ShaderDumpJob&& job);
+		bool queueCachedJob(uint32_t shaderHash);
+		bool queueCachedJobs();
+		void workerLoop();
+		void applyDumpLayout(ShaderDumpLayout layout);
+		void seedDumpedHashes();
+		bool writeJob(const ShaderDumpJob& job);
+		bool writeJobToFile(const ShaderDumpJob& job, const std::vector<uint8_t>& code, bool isCompressed);
+
+		std::filesystem::path _dumpPath;
+		std::atomic<ShaderDumpLayout> _layout = ShaderDumpLayout::PerFile;
+		std::atomic<bool> _compressDumps = false;
+		ShaderDumpLayout _activeLayout = ShaderDumpLayout::PerFile;		// layout used by the dump thread
+		ShaderDumpArchiveWriter _archiveWriter;								// only used by the dump thread
+		size_t _maxQueuedJobs;
+		std::deque<ShaderDumpJob> _queue;
+		std::unordered_set<uint32_t> _pendingHashes;	// hashes in the queue or being written
+		std::unordered_set<uint32_t> _dumpedHashes;		// hashes written in this session or found in the dump folder
+		std::atomic<ShaderDumpPolicy> _policy = ShaderDumpPolicy::All;
+		std::unordered_set<uint32_t> _selectedHashes;	// hashes to dump with the selective policies
+		std::list<ShaderDumpJob> _codeCache;			// code of shaders not selected (yet), most recently seen first
+		std::unordered_map<uint32_t, std::list<ShaderDumpJob>::iterator> _codeCacheIndex;
+		size_t _codeCacheBytes = 0;
+		size_t _codeCacheBudget;
+		bool _hasDeferredCachedJobs = false;			// cached shaders the policy wants were left in the cache, the queue was full
+		std::mutex _queueMutex;
+		std::condition_variable _queueCondition;
+		std::thread _worker;
+		bool _isRunning = false;			// cleared by the worker under _queueMutex when it exits
+		bool _stopRequested = false;
+
+		std::atomic<uint64_t> _queuedCount = 0;
+		std::atomic<uint64_t> _writtenCount = 0;
+		std::atomic<uint64_t> _skippedCount = 0;
+		std::atomic<uint64_t> _droppedCount = 0;
+		std::atomic<uint64_t> _evictedCount = 0;
+		std::atomic<uint64_t> _compressedRawBytes = 0;		// size of the shaders written compressed, before compression
+		std::atomic<uint64_t> _compressedStoredBytes = 0;	// size of the shaders written compressed, after compression
+		std::atomic<uint64_t> _compressionNanoseconds = 0;	// time spent in the compressor on the dump thread
+		std::vector<uint8_t> _compressBuffer;				// only used by the dump thread
+	};
+}
@@ -0,0 +1,157 @@
+/// compact text encoding of a set of shader hashes, used to store a toggle group's hashes in one ini key instead of one key per hash
+
+#include "ShaderHashList.h"
+#include <algorithm>
+#include <vector>
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		int decodeBase64Char(char c)
+		{
+			if(c >= 'A' && c <= 'Z') return c - 'A';
+			if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+			if(c >= '0' && c <= '9') return c - '0' + 52;
+			if(c == '+') return 62;
+			if(c == '/') return 63;
+			return -1;
+		}
+
+
+		void appendVarint(std::vector<uint8_t>& bytes, uint32_t value)
+		{
+			while(value >= 0x80)
+			{
+				bytes.push_back(static_cast<uint8_t>(value | 0x80));
+				value >>= 7;
+			}
+			bytes.push_back(static_cast<uint8_t>(value));
+		}
+
+
+		// base64 without '=' padding: CDataFile trims '=' from both ends of a value when it loads the file.
+		std::string encodeBase64(const std::vector<uint8_t>& bytes)
+		{
+			std::string encoded;
+			encoded.reserve((bytes.size() * 4 + 2) / 3);
+			for(size_t i = 0; i < bytes.size(); i += 3)
+			{
+				const size_t remaining = bytes.size() - i;
+				const uint32_t triple = (bytes[i] << 16) | (remaining > 1 ? bytes[i + 1] << 8 : 0) | (remaining > 2 ? bytes[i + 2] : 0);
+				encoded += BASE64_ALPHABET[(triple >> 18) & 0x3F];
+				encoded += BASE64_ALPHABET[(triple >> 12) & 0x3F];
+				if(remaining > 1)
+				{
+					encoded += BASE64_ALPHABET[(triple >> 6) & 0x3F];
+				}
+				if(remaining > 2)
+				{
+					encoded += BASE64_ALPHABET[triple & 0x3F];
+				}
+			}
+			return encoded;
+		}
+
+
+		bool decodeBase64(std::string_view encoded, std::vector<uint8_t>& bytes)
+		{
+			// a single character left over can't encode a byte
+			if(encoded.size() % 4 == 1)
+			{
+				return false;
+			}
+			bytes.reserve(encoded.size() * 3 / 4);
+			for(size_t i = 0; i < encoded.size(); i += 4)
+			{
+				const size_t characters = encoded.size() - i < 4 ? encoded.size() - i : 4;
+				uint32_t quad = 0;
+				for(size_t j = 0; j < 4; ++j)
+				{
+					const int sextet = j < characters ? decodeBase64Char(encoded[i + j]) : 0;
+					if(sextet < 0)
+					{
+						return false;
+					}
+					quad = (quad << 6) | static_cast<uint32_t>(sextet);
+				}
+				bytes.push_back(static_cast<uint8_t>(quad >> 16));
+				if(characters > 2)
+				{
+					bytes.push_back(static_cast<uint8_t>(quad >> 8));
+				}
+				if(characters > 3)
+				{
+					bytes.push_back(static_cast<uint8_t>(quad));
+				}
+			}
+			return true;
+		}
+	}
+
+
+	std::string encodeShaderHashList(const std::unordered_set<uint32_t>& hashes)
+	{
+		std::vector<uint32_t> sortedHashes(hashes.begin(), hashes.end());
+		return encodeShaderHashList(sortedHashes);
+	}
+
+
+	std::string encodeShaderHashList(std::vector<uint32_t>& hashes)
+	{
+		std::sort(hashes.begin(), hashes.end());
+
+		std::vector<uint8_t> bytes;
+		bytes.reserve(hashes.size() * 5);
+		uint32_t previousHash = 0;
+		for(const uint32_t hash : hashes)
+		{
+			appendVarint(bytes, hash - previousHash);
+			previousHash = hash;
+		}
+		return encodeBase64(bytes);
+	}
+
+
+	bool decodeShaderHashList(std::string_view encoded, std::unordered_set<uint32_t>& hashes)
+	{
+		std::vector<uint8_t> bytes;
+		if(!decodeBase64(encoded, bytes))
+		{
+			return false;
+		}
+
+		std::vector<uint32_t> decodedHashes;
+		decodedHashes.reserve(bytes.size() / 4);
+		uint64_t currentHash = 0;
+		size_t position = 0;
+		while(position < bytes.size())
+		{
+			uint64_t delta = 0;
+			int shift = 0;
+			uint8_t byte;
+			do
+			{
+				if(position >= bytes.size() || shift > 28)
+				{
+					return false;
+				}
+				byte = bytes[position++];
+				delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				shift += 7;
+			} while(byte & 0x80);
+
+			// every delta after the first is at least 1, the set has no duplicates
+			if((!decodedHashes.empty() && delta == 0) || currentHash + delta > UINT32_MAX)
+			{
+				return false;
+			}
+			currentHash += delta;
+			decodedHashes.push_back(static_cast<uint32_t>(currentHash));
+		}
+		hashes.insert(decodedHashes.begin(), decodedHashes.end());
+		return true;
+	}
+}
@@ -0,0 +1,36 @@
+/// compact text encoding of a set of shader hashes, used to store a toggle group's hashes in one ini key instead of one key per hash
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// Encodes the hashes passed in as base64 of the sorted hashes, delta encoded as LEB128 varints: the first value is the smallest hash, every
+	///	next value is the difference with the previous hash. Hashes are spread over the full 32 bit range, so a hash costs 3-5 bytes before
+	///	base64 instead of ~25 for a ShaderHash<i>=<decimal> line. The base64 has no padding, CDataFile trims trailing '=' from values.
+	///	An empty set gives an empty string.
+	/// </summary>
+	/// <param name="hashes"></param>
+	/// <returns></returns>
+	std::string encodeShaderHashList(const std::unordered_set<uint32_t>& hashes);
+	/// <summary>
+	/// Same as above, for hashes already copied to a vector (e.g. a ToggleGroupSnapshot). The vector is sorted in place, it has no duplicates.
+	/// </summary>
+	/// <param name="hashes"></param>
+	/// <returns></returns>
+	std::string encodeShaderHashList(std::vector<uint32_t>& hashes);
+	/// <summary>
+	/// Decodes a string produced by encodeShaderHashList and adds the hashes to hashes. Returns false (and leaves hashes untouched) if the
+	///	string isn't valid base64, a varint is truncated or longer than 32 bits, or the hashes overflow / aren't strictly increasing.
+	/// </summary>
+	/// <param name="encoded"></param>
+	/// <param name="hashes"></param>
+	/// <returns></returns>
+	bool decodeShaderHashList(std::string_view encoded, std::unordered_set<uint32_t>& hashes);
+}
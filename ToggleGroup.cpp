@@ -33,6 +33,7 @@
 #include "stdafx.h"
 #include "ToggleGroup.h"
 #include "KeyData.h"
+#include "ShaderHashList.h"
 
 namespace ShaderToggler
 {
@@ -111,50 +112,81 @@ namespace ShaderToggler
 	}
 
 
-	void ToggleGroup::setName(std::string newName)
+	std::unordered_set<uint32_t>* ToggleGroup::getShaderHashes(ShaderStage stage)
 	{
-		if(newName.size()<=0)
+		switch(stage)
 		{
-			return;
+		case ShaderStage::Pixel:
+			return &_pixelShaderHashes;
+		case ShaderStage::Vertex:
+			return &_vertexShaderHashes;
+		case ShaderStage::Compute:
+			return &_computeShaderHashes;
+		default:
+			return nullptr;
 		}
-		_name = newName;
 	}
 
 
-	void ToggleGroup::saveState(CDataFile& iniFile, int groupCounter) const
+	void ToggleGroup::setShaderHashMarked(ShaderStage stage, uint32_t shaderHash, bool isMarked)
 	{
-		const std::string sectionRoot = "Group" + std::to_string(groupCounter);
-		const std::string vertexHashesCategory = sectionRoot + "_VertexShaders";
-		const std::string pixelHashesCategory = sectionRoot + "_PixelShaders";
-		const std::string computeHashesCategory = sectionRoot + "_ComputeShaders";
-
-		int counter = 0;
-		for(const auto hash: _vertexShaderHashes)
+		std::unordered_set<uint32_t>* hashes = getShaderHashes(stage);
+		if(nullptr == hashes)
 		{
-			iniFile.SetUInt("ShaderHash" + std::to_string(counter), hash, "", vertexHashesCategory);
-			counter++;
+			return;
 		}
-		iniFile.SetUInt("AmountHashes", counter, "", vertexHashesCategory);
-
-		counter=0;
-		for(const auto hash: _pixelShaderHashes)
+		if(isMarked)
 		{
-			iniFile.SetUInt("ShaderHash" + std::to_string(counter), hash, "", pixelHashesCategory);
-			counter++;
+			hashes->emplace(shaderHash);
+		}
+		else
+		{
+			hashes->erase(shaderHash);
 		}
-		iniFile.SetUInt("AmountHashes", counter, "", pixelHashesCategory);
+	}
 
-		counter = 0;
-		for(const auto hash : _computeShaderHashes)
+
+	void ToggleGroup::setName(std::string newName)
+	{
+		if(newName.size()<=0)
 		{
-			iniFile.SetUInt("ShaderHash" + std::to_string(counter), hash, "", computeHashesCategory);
-			counter++;
+			return;
 		}
-		iniFile.SetUInt("AmountHashes", counter, "", computeHashesCategory);
+		_name = newName;
+	}
+
 
-		iniFile.SetValue("Name", _name, "", sectionRoot);
-		iniFile.SetUInt("ToggleKey", _keyData.getKeyForIniFile(), "", sectionRoot);
-		iniFile.SetBool("IsActiveAtStartup", _isActiveAtStartup, "", sectionRoot);
+	void ToggleGroup::saveState(CDataFile& iniFile, int groupCounter, bool writeLegacyHashKeys) const
+	{
+		ToggleGroupSnapshot snapshot = takeSnapshot();
+		saveSnapshot(iniFile, groupCounter, snapshot, writeLegacyHashKeys);
+	}
+
+
+	ToggleGroupSnapshot ToggleGroup::takeSnapshot() const
+	{
+		ToggleGroupSnapshot snapshot;
+		snapshot.name = _name;
+		snapshot.toggleKey = _keyData.getKeyForIniFile();
+		snapshot.isActiveAtStartup = _isActiveAtStartup;
+		snapshot.vertexShaderHashes.assign(_vertexShaderHashes.begin(), _vertexShaderHashes.end());
+		snapshot.pixelShaderHashes.assign(_pixelShaderHashes.begin(), _pixelShaderHashes.end());
+		snapshot.computeShaderHashes.assign(_computeShaderHashes.begin(), _computeShaderHashes.end());
+		return snapshot;
+	}
+
+
+	void ToggleGroup::saveSnapshot(CDataFile& iniFile, int groupCounter, ToggleGroupSnapshot& snapshot, bool writeLegacyHashKeys)
+	{
+		const std::string sectionRoot = "Group" + std::to_string(groupCounter);
+
+		saveHashes(iniFile, sectionRoot + "_VertexShaders", snapshot.vertexShaderHashes, writeLegacyHashKeys);
+		saveHashes(iniFile, sectionRoot + "_PixelShaders", snapshot.pixelShaderHashes, writeLegacyHashKeys);
+		saveHashes(iniFile, sectionRoot + "_ComputeShaders", snapshot.computeShaderHashes, writeLegacyHashKeys);
+
+		iniFile.SetValue("Name", snapshot.name, "", sectionRoot);
+		iniFile.SetUInt("ToggleKey", snapshot.toggleKey, "", sectionRoot);
+		iniFile.SetBool("IsActiveAtStartup", snapshot.isActiveAtStartup, "", sectionRoot);
 	}
 
 
@@ -162,72 +194,19 @@ namespace ShaderToggler
 	{
 		if(groupCounter<0)
 		{
-			int amount = iniFile.GetInt("AmountHashes", "PixelShaders");
-			for(int i = 0;i< amount;i++)
-			{
-				uint32_t hash = iniFile.GetUInt("ShaderHash" + std::to_string(i), "PixelShaders");
-				if(hash!=UINT_MAX)
-				{
-					_pixelShaderHashes.emplace(hash);
-				}
-			}
-			amount = iniFile.GetInt("AmountHashes", "VertexShaders");
-			for(int i = 0;i< amount;i++)
-			{
-				uint32_t hash = iniFile.GetUInt("ShaderHash" + std::to_string(i), "VertexShaders");
-				if(hash!=UINT_MAX)
-				{
-					_vertexShaderHashes.emplace(hash);
-				}
-			}
-			amount = iniFile.GetInt("AmountHashes", "ComputeShaders");
-			for(int i = 0; i < amount; i++)
-			{
-				uint32_t hash = iniFile.GetUInt("ShaderHash" + std::to_string(i), "ComputeShaders");
-				if(hash != UINT_MAX)
-				{
-					_computeShaderHashes.emplace(hash);
-				}
-			}
+			loadHashes(iniFile, "PixelShaders", _pixelShaderHashes);
+			loadHashes(iniFile, "VertexShaders", _vertexShaderHashes);
+			loadHashes(iniFile, "ComputeShaders", _computeShaderHashes);
 
 			// done
 			return;
 		}
 
 		const std::string sectionRoot = "Group" + std::to_string(groupCounter);
-		const std::string vertexHashesCategory = sectionRoot + "_VertexShaders";
-		const std::string pixelHashesCategory = sectionRoot + "_PixelShaders";
-		const std::string computeHashesCategory = sectionRoot + "_ComputeShaders";
 
-		int amountShaders = iniFile.GetInt("AmountHashes", vertexHashesCategory);
-		for(int i = 0;i< amountShaders;i++)
-		{
-			uint32_t hash = iniFile.GetUInt("ShaderHash" + std::to_string(i), vertexHashesCategory);
-			if(hash!=UINT_MAX)
-			{
-				_vertexShaderHashes.emplace(hash);
-			}
-		}
-
-		amountShaders = iniFile.GetInt("AmountHashes", pixelHashesCategory);
-		for(int i = 0;i< amountShaders;i++)
-		{
-			uint32_t hash = iniFile.GetUInt("ShaderHash" + std::to_string(i), pixelHashesCategory);
-			if(hash!=UINT_MAX)
-			{
-				_pixelShaderHashes.emplace(hash);
-			}
-		}
-
-		amountShaders = iniFile.GetInt("AmountHashes", computeHashesCategory);
-		for(int i = 0; i < amountShaders; i++)
-		{
-			uint32_t hash = iniFile.GetUInt("ShaderHash" + std::to_string(i), computeHashesCategory);
-			if(hash != UINT_MAX)
-			{
-				_computeShaderHashes.emplace(hash);
-			}
-		}
+		loadHashes(iniFile, sectionRoot + "_VertexShaders", _vertexShaderHashes);
+		loadHashes(iniFile, sectionRoot + "_PixelShaders", _pixelShaderHashes);
+		loadHashes(iniFile, sectionRoot + "_ComputeShaders", _computeShaderHashes);
 
 		_name = iniFile.GetValue("Name", sectionRoot);
 		if(_name.size()<=0)
@@ -246,4 +225,66 @@ namespace ShaderToggler
 		_isActiveAtStartup = iniFile.GetBool("IsActiveAtStartup", sectionRoot);
 		_isActive = _isActiveAtStartup;
 	}
+
+
+	void ToggleGroup::restoreState(std::string name, uint32_t toggleKey, bool isActiveAtStartup)
+	{
+		_name = name.size() > 0 ? name : "Default";
+		_keyData.setKeyFromIniFile(toggleKey);
+		_isActiveAtStartup = isActiveAtStartup;
+		_isActive = _isActiveAtStartup;
+	}
+
+
+	void ToggleGroup::setShaderHashes(ShaderStage stage, const uint32_t* hashes, size_t count)
+	{
+		std::unordered_set<uint32_t>* shaderHashes = getShaderHashes(stage);
+		if(nullptr == shaderHashes)
+		{
+			return;
+		}
+		shaderHashes->clear();
+		shaderHashes->reserve(count);
+		shaderHashes->insert(hashes, hashes + count);
+	}
+
+
+	void ToggleGroup::saveHashes(CDataFile& iniFile, const std::string& section, std::vector<uint32_t>& hashes, bool writeLegacyHashKeys)
+	{
+		iniFile.SetUInt("AmountHashes", static_cast<uint32_t>(hashes.size()), "", section);
+		if(!writeLegacyHashKeys)
+		{
+			// empty for an empty set, SetValue doesn't create keys with an empty value.
+			iniFile.SetValue("Hashes", encodeShaderHashList(hashes), "", section);
+			return;
+		}
+
+		int counter = 0;
+		for(const auto hash : hashes)
+		{
+			iniFile.SetUInt("ShaderHash" + std::to_string(counter), hash, "", section);
+			counter++;
+		}
+	}
+
+
+	void ToggleGroup::loadHashes(CDataFile& iniFile, const std::string& section, std::unordered_set<uint32_t>& hashes)
+	{
+		const std::string packedHashes = iniFile.GetValue("Hashes", section);
+		if(packedHashes.size() > 0 && decodeShaderHashList(packedHashes, hashes))
+		{
+			return;
+		}
+
+		// legacy format (and pre-1.0 ini files): one ShaderHash<i> key per hash
+		const int amount = iniFile.GetInt("AmountHashes", section);
+		for(int i = 0; i < amount; i++)
+		{
+			const uint32_t hash = iniFile.GetUInt("ShaderHash" + std::to_string(i), section);
+			if(hash != UINT_MAX)
+			{
+				hashes.emplace(hash);
+			}
+		}
+	}
 }
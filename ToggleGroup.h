@@ -33,12 +33,40 @@
 
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "CDataFile.h"
 #include "KeyData.h"
 
 namespace ShaderToggler
 {
+	/// <summary>
+	/// The shader stages a group holds hashes for.
+	/// </summary>
+	enum class ShaderStage : uint8_t
+	{
+		None = 0,
+		Pixel,
+		Vertex,
+		Compute,
+	};
+
+
+	/// <summary>
+	/// Copy of what ToggleGroup::saveState writes, taken on the UI thread to save on another thread. Cheap to take: the hash sets are copied
+	///	to vectors, not to new sets.
+	/// </summary>
+	struct ToggleGroupSnapshot
+	{
+		std::string name;
+		uint32_t toggleKey = 0;
+		bool isActiveAtStartup = false;
+		std::vector<uint32_t> vertexShaderHashes;
+		std::vector<uint32_t> pixelShaderHashes;
+		std::vector<uint32_t> computeShaderHashes;
+	};
+
+
 	class ToggleGroup
 	{
 	public:
@@ -51,21 +79,59 @@ namespace ShaderToggler
 		void setName(std::string newName);
 		/// <summary>
 		/// Writes the shader hashes, name and toggle key to the ini file specified, using a Group + groupCounter section.
+		/// The hashes of a stage are written packed in a single Hashes key (see ShaderHashList.h), unless writeLegacyHashKeys is set.
 		/// </summary>
 		/// <param name="iniFile"></param>
 		/// <param name="groupCounter"></param>
-		void saveState(CDataFile& iniFile, int groupCounter) const;
+		/// <param name="writeLegacyHashKeys">if true, write one ShaderHash<i> key per hash, readable by older versions</param>
+		void saveState(CDataFile& iniFile, int groupCounter, bool writeLegacyHashKeys = false) const;
+		/// <summary>
+		/// Returns a copy of the state saveState writes, see saveSnapshot.
+		/// </summary>
+		/// <returns></returns>
+		ToggleGroupSnapshot takeSnapshot() const;
+		/// <summary>
+		/// Writes a snapshot taken with takeSnapshot like saveState writes the group it was taken from. Doesn't touch the group, so it can run
+		///	on another thread while the group is edited. The hash vectors of the snapshot are sorted in place.
+		/// </summary>
+		/// <param name="iniFile"></param>
+		/// <param name="groupCounter"></param>
+		/// <param name="snapshot"></param>
+		/// <param name="writeLegacyHashKeys"></param>
+		static void saveSnapshot(CDataFile& iniFile, int groupCounter, ToggleGroupSnapshot& snapshot, bool writeLegacyHashKeys = false);
 		/// <summary>
 		/// Loads the shader hashes, name and toggle key from the ini file specified, using a Group + groupCounter section.
+		/// Both the packed Hashes key and the legacy ShaderHash<i> keys are read.
 		/// </summary>
 		/// <param name="iniFile"></param>
 		/// <param name="groupCounter">if -1, the ini file is in the pre-1.0 format</param>
 		void loadState(CDataFile& iniFile, int groupCounter);
+		/// <summary>
+		/// Sets the name, toggle key and startup state read back from the binary config snapshot, like loadState does from the ini.
+		/// </summary>
+		/// <param name="name"></param>
+		/// <param name="toggleKey">as stored in the ini, see KeyData::getKeyForIniFile</param>
+		/// <param name="isActiveAtStartup"></param>
+		void restoreState(std::string name, uint32_t toggleKey, bool isActiveAtStartup);
+		/// <summary>
+		/// Replaces the hashes of the stage passed in with the count hashes at hashes.
+		/// </summary>
+		/// <param name="stage"></param>
+		/// <param name="hashes"></param>
+		/// <param name="count"></param>
+		void setShaderHashes(ShaderStage stage, const uint32_t* hashes, size_t count);
 		void storeCollectedHashes(const std::unordered_set<uint32_t> pixelShaderHashes, const std::unordered_set<uint32_t> vertexShaderHashes, const std::unordered_set<uint32_t> computeShaderHashes);
 		bool isBlockedPixelShader(uint32_t shaderHash);
 		bool isBlockedVertexShader(uint32_t shaderHash);
 		bool isBlockedComputeShader(uint32_t shaderHash);
 		void clearHashes();
+		/// <summary>
+		/// Adds (isMarked) or removes a single shader hash of the stage passed in. Used to replay the marks of the edit journal.
+		/// </summary>
+		/// <param name="stage"></param>
+		/// <param name="shaderHash"></param>
+		/// <param name="isMarked"></param>
+		void setShaderHashMarked(ShaderStage stage, uint32_t shaderHash, bool isMarked);
 
 		void toggleActive() { _isActive = !_isActive;}
 		void setIsActiveAtStartup(bool newValue) { _isActiveAtStartup = newValue; }
@@ -82,7 +148,7 @@ namespace ShaderToggler
 		std::unordered_set<uint32_t> getPixelShaderHashes() const { return _pixelShaderHashes;}
 		std::unordered_set<uint32_t> getVertexShaderHashes() const { return _vertexShaderHashes;}
 		std::unordered_set<uint32_t> getComputeShaderHashes() const { return _computeShaderHashes; }
-		bool isToggleKeyPressed(const reshade::api::effect_runtime* runtime) { return _keyData.isKeyPressed(runtime);}
+		uint8_t getToggleKeyModifierMask() const { return _keyData.getModifierMask(); }
 		
 		bool operator==(const ToggleGroup& rhs)
 		{
@@ -90,6 +156,10 @@ namespace ShaderToggler
 		}
 
 	private:
+		std::unordered_set<uint32_t>* getShaderHashes(ShaderStage stage);
+		static void saveHashes(CDataFile& iniFile, const std::string& section, std::vector<uint32_t>& hashes, bool writeLegacyHashKeys);
+		static void loadHashes(CDataFile& iniFile, const std::string& section, std::unordered_set<uint32_t>& hashes);
+
 		int _id;
 		std::string	_name;
 		KeyData _keyData;
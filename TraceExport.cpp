@@ -0,0 +1,466 @@
+/// exports a frame capture as Chrome Trace Event JSON, for chrome://tracing, ui.perfetto.dev or Speedscope
+
+#include "TraceExport.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		constexpr uint32_t MaxRenderTargetCount = 8;		// D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT
+		constexpr size_t FlushSize = 1024 * 1024;
+
+		enum ShaderSlot
+		{
+			VertexSlot = 0,
+			PixelSlot,
+			ComputeSlot,
+			SlotCount
+		};
+
+
+		/// <summary>
+		/// What is bound on a command list, replayed from its events.
+		/// </summary>
+		struct CommandListState
+		{
+			uint32_t trackId = 0;
+			uint64_t pipelines[SlotCount] = {};
+			uint32_t shaderHashes[SlotCount] = {};
+			uint32_t renderTargetCount = 0;
+			uint64_t renderTargets[MaxRenderTargetCount] = {};
+			uint64_t depthStencil = 0;
+			const CaptureEvent* pendingEvent = nullptr;		// slice or instant written once the next event of the command list is known
+		};
+
+
+		const char* getIndirectCommandName(uint64_t type)
+		{
+			// reshade::api::indirect_command
+			switch(type)
+			{
+			case 1: return "draw_indirect";
+			case 2: return "draw_indexed_indirect";
+			case 3: return "dispatch_indirect";
+			case 4: return "dispatch_mesh_indirect";
+			case 5: return "dispatch_rays_indirect";
+			default: return "indirect";
+			}
+		}
+
+
+		bool isComputeWork(const CaptureEvent& event)
+		{
+			return event.eventId == CaptureEventId::Dispatch || (event.eventId == CaptureEventId::DrawOrDispatchIndirect && event.args[0] >= 3);
+		}
+
+
+		bool isSlice(CaptureEventId eventId)
+		{
+			switch(eventId)
+			{
+			case CaptureEventId::Draw:
+			case CaptureEventId::DrawIndexed:
+			case CaptureEventId::DrawOrDispatchIndirect:
+			case CaptureEventId::Dispatch:
+			case CaptureEventId::ClearRenderTargetView:
+			case CaptureEventId::ClearDepthStencilView:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+
+		bool isInstant(CaptureEventId eventId)
+		{
+			switch(eventId)
+			{
+			case CaptureEventId::BindPipeline:
+			case CaptureEventId::PipelineReplaced:
+			case CaptureEventId::InjectPushConstants:
+			case CaptureEventId::BindRenderTargets:
+			case CaptureEventId::BeginRenderPass:
+			case CaptureEventId::EndRenderPass:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+
+		/// <summary>
+		/// Appends the trace events to a string, written to the file every FlushSize bytes.
+		/// </summary>
+		class TraceWriter
+		{
+		public:
+			TraceWriter(std::ofstream& file, int64_t firstTimestamp, uint64_t ticksPerSecond) :
+				_file(file), _firstTimestamp(firstTimestamp), _microsecondsPerTick(1000000.0 / static_cast<double>(ticksPerSecond))
+			{
+				_json.reserve(FlushSize + 4096);
+			}
+
+			void beginEvent(const char* name, const char* phase, uint32_t trackId, int64_t timestamp)
+			{
+				_json += _isFirstEvent ? "\n" : ",\n";
+				_isFirstEvent = false;
+				_json += "{\"name\":\"";
+				_json += name;
+				_json += "\",\"ph\":\"";
+				_json += phase;
+				appendFormatted("\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", trackId, toMicroseconds(timestamp));
+			}
+			void addDuration(int64_t begin, int64_t end) { appendFormatted(",\"dur\":%.3f", end > begin ? toMicroseconds(end) - toMicroseconds(begin) : 0.0); }
+			void addInstantScope(const char* scope) { appendFormatted(",\"s\":\"%s\"", scope); }
+			void beginArgs() { _json += ",\"args\":{"; _isFirstArg = true; }
+			void addArg(const char* name, uint64_t value) { appendArgName(name); appendFormatted("%" PRIu64, value); }
+			void addArg(const char* name, int64_t value) { appendArgName(name); appendFormatted("%" PRId64, value); }
+			void addArg(const char* name, double value) { appendArgName(name); appendFormatted("%.3f", value); }
+			void addArg(const char* name, bool value) { appendArgName(name); _json += value ? "true" : "false"; }
+			void addArg(const char* name, const char* value) { appendArgName(name); _json += '"'; _json += value; _json += '"'; }
+			void addHandleArg(const char* name, uint64_t handle) { appendArgName(name); appendFormatted("\"0x%" PRIx64 "\"", handle); }
+			void addHashArg(const char* name, uint32_t hash) { appendArgName(name); appendFormatted("\"0x%08X\"", hash); }
+			void addHandleListArg(const char* name, const uint64_t* handles, uint32_t count)
+			{
+				appendArgName(name);
+				_json += '[';
+				for(uint32_t index = 0; index < count; ++index)
+				{
+					appendFormatted(index == 0 ? "\"0x%" PRIx64 "\"" : ",\"0x%" PRIx64 "\"", handles[index]);
+				}
+				_json += ']';
+			}
+			void endArgs() { _json += '}'; }
+			void endEvent()
+			{
+				_json += '}';
+				if(_json.size() >= FlushSize)
+				{
+					flush();
+				}
+			}
+
+			void append(const char* text) { _json += text; }
+			void flush()
+			{
+				_file.write(_json.data(), _json.size());
+				_json.clear();
+			}
+
+		private:
+			double toMicroseconds(int64_t timestamp) const { return static_cast<double>(timestamp - _firstTimestamp) * _microsecondsPerTick; }
+
+			void appendArgName(const char* name)
+			{
+				_json += _isFirstArg ? "\"" : ",\"";
+				_isFirstArg = false;
+				_json += name;
+				_json += "\":";
+			}
+
+			template<typename... Args>
+			void appendFormatted(const char* format, Args... args)
+			{
+				char text[64];
+				const int length = snprintf(text, sizeof(text), format, args...);
+				if(length > 0)
+				{
+					_json.append(text, std::min<size_t>(static_cast<size_t>(length), sizeof(text) - 1));
+				}
+			}
+
+			std::ofstream& _file;
+			std::string _json;
+			int64_t _firstTimestamp;
+			double _microsecondsPerTick;
+			bool _isFirstEvent = true;
+			bool _isFirstArg = true;
+		};
+
+
+		void writeBoundState(TraceWriter& writer, const CommandListState& state, bool isCompute)
+		{
+			static const char* pipelineArgNames[SlotCount] = { "vs_pipeline", "ps_pipeline", "cs_pipeline" };
+			static const char* hashArgNames[SlotCount] = { "vs_hash", "ps_hash", "cs_hash" };
+			const int firstSlot = isCompute ? ComputeSlot : VertexSlot;
+			const int lastSlot = isCompute ? ComputeSlot : PixelSlot;
+			for(int slot = firstSlot; slot <= lastSlot; ++slot)
+			{
+				if(state.pipelines[slot] != 0)
+				{
+					writer.addHandleArg(pipelineArgNames[slot], state.pipelines[slot]);
+				}
+				if(state.shaderHashes[slot] != 0)
+				{
+					writer.addHashArg(hashArgNames[slot], state.shaderHashes[slot]);
+				}
+			}
+			if(!isCompute)
+			{
+				writer.addHandleListArg("rtvs", state.renderTargets, state.renderTargetCount);
+				writer.addHandleArg("dsv", state.depthStencil);
+			}
+		}
+
+
+		/// <summary>
+		/// Writes a slice or instant event of a command list. end is the timestamp of the next event on the command list.
+		/// </summary>
+		void writeCommandListEvent(TraceWriter& writer, const CaptureEvent& event, const CommandListState& state, int64_t end)
+		{
+			const uint64_t* args = event.args;
+			const char* name = event.eventId == CaptureEventId::DrawOrDispatchIndirect ? getIndirectCommandName(args[0]) : getCaptureEventName(event.eventId);
+			const bool isSliceEvent = isSlice(event.eventId);
+			writer.beginEvent(name, isSliceEvent ? "X" : "i", state.trackId, event.timestamp);
+			if(isSliceEvent)
+			{
+				writer.addDuration(event.timestamp, end);
+			}
+			else
+			{
+				writer.addInstantScope("t");
+			}
+			writer.beginArgs();
+			switch(event.eventId)
+			{
+			case CaptureEventId::Draw:
+				writer.addArg("vertex_count", args[0]);
+				writer.addArg("instance_count", args[1]);
+				writer.addArg("first_vertex", args[2]);
+				writer.addArg("first_instance", args[3]);
+				writeBoundState(writer, state, false);
+				break;
+			case CaptureEventId::DrawIndexed:
+				writer.addArg("index_count", args[0]);
+				writer.addArg("instance_count", args[1]);
+				writer.addArg("first_index", args[2]);
+				writer.addArg("vertex_offset", static_cast<int64_t>(static_cast<int32_t>(args[3])));
+				writer.addArg("first_instance", args[4]);
+				writeBoundState(writer, state, false);
+				break;
+			case CaptureEventId::DrawOrDispatchIndirect:
+				writer.addHandleArg("buffer", args[1]);
+				writer.addArg("offset", args[2]);
+				writer.addArg("draw_count", args[3]);
+				writer.addArg("stride", args[4]);
+				writeBoundState(writer, state, isComputeWork(event));
+				break;
+			case CaptureEventId::Dispatch:
+				writer.addArg("group_count_x", args[0]);
+				writer.addArg("group_count_y", args[1]);
+				writer.addArg("group_count_z", args[2]);
+				writeBoundState(writer, state, true);
+				break;
+			case CaptureEventId::ClearRenderTargetView:
+				writer.addHandleArg("rtv", args[0]);
+				break;
+			case CaptureEventId::ClearDepthStencilView:
+				writer.addHandleArg("dsv", args[0]);
+				break;
+			case CaptureEventId::BindPipeline:
+				writer.addHandleArg("stages", args[0]);
+				writer.addHandleArg("pipeline", args[2]);
+				if(args[3] != 0 || args[4] != 0)
+				{
+					writer.addHashArg("ps_hash", static_cast<uint32_t>(args[3]));
+					writer.addHashArg("vs_hash", static_cast<uint32_t>(args[4]));
+				}
+				writer.addHashArg("shader_hash", static_cast<uint32_t>(args[1]));
+				break;
+			case CaptureEventId::PipelineReplaced:
+				writer.addHandleArg("pipeline", args[0]);
+				break;
+			case CaptureEventId::InjectPushConstants:
+				writer.addHandleArg("layout", args[0]);
+				break;
+			case CaptureEventId::BindRenderTargets:
+			case CaptureEventId::BeginRenderPass:
+				// the state has the render targets of the continued events as well
+				writer.addHandleListArg("rtvs", state.renderTargets, state.renderTargetCount);
+				writer.addHandleArg("dsv", state.depthStencil);
+				break;
+			default:
+				break;
+			}
+			writer.endArgs();
+			writer.endEvent();
+		}
+
+
+		void applyEvent(CommandListState& state, const CaptureEvent& event)
+		{
+			const uint64_t* args = event.args;
+			switch(event.eventId)
+			{
+			case CaptureEventId::BindPipeline:
+			{
+				// version 1 files and separate shader pipelines only have the one hash of the bound stage
+				const bool hasStageHashes = args[3] != 0 || args[4] != 0;
+				if(args[0] & CAPTURE_STAGE_VERTEX_SHADER)
+				{
+					state.pipelines[VertexSlot] = args[2];
+					state.shaderHashes[VertexSlot] = static_cast<uint32_t>(hasStageHashes ? args[4] : args[1]);
+				}
+				if(args[0] & CAPTURE_STAGE_PIXEL_SHADER)
+				{
+					state.pipelines[PixelSlot] = args[2];
+					state.shaderHashes[PixelSlot] = static_cast<uint32_t>(hasStageHashes ? args[3] : args[1]);
+				}
+				if(args[0] & CAPTURE_STAGE_COMPUTE_SHADER)
+				{
+					state.pipelines[ComputeSlot] = args[2];
+					state.shaderHashes[ComputeSlot] = static_cast<uint32_t>(args[1]);
+				}
+				break;
+			}
+			case CaptureEventId::BindRenderTargets:
+			case CaptureEventId::BeginRenderPass:
+				// the render pass has the cleared render targets in the upper bits of the count
+				state.renderTargetCount = std::min(static_cast<uint32_t>(args[0]), MaxRenderTargetCount);
+				state.depthStencil = args[1];
+				for(uint32_t index = 0; index < MaxRenderTargetCount; ++index)
+				{
+					state.renderTargets[index] = index < 3 ? args[2 + index] : 0;
+				}
+				break;
+			case CaptureEventId::BindRenderTargetsContinued:
+				for(uint64_t index = 0; index < 4; ++index)
+				{
+					if(args[0] + index < MaxRenderTargetCount)
+					{
+						state.renderTargets[args[0] + index] = args[1 + index];
+					}
+				}
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+
+	bool writeChromeTrace(const std::filesystem::path& fileName, const CaptureFileHeader& header, const CaptureEvent* events, size_t eventCount)
+	{
+		std::ofstream traceFile(fileName, std::ios::binary | std::ios::trunc);
+		if(!traceFile.is_open())
+		{
+			return false;
+		}
+		const int64_t firstTimestamp = eventCount > 0 ? events[0].timestamp : 0;
+		const int64_t lastTimestamp = eventCount > 0 ? events[eventCount - 1].timestamp : 0;
+		TraceWriter writer(traceFile, firstTimestamp, header.ticksPerSecond != 0 ? header.ticksPerSecond : 1000000000);
+
+		char text[128];
+		snprintf(text, sizeof(text), "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"capture\":%u,\"trigger\":\"%s\",\"dropped_events\":%" PRIu64 "},\"traceEvents\":[",
+				 header.captureIndex, getCaptureTriggerName(header.trigger), header.droppedEventCount);
+		writer.append(text);
+		snprintf(text, sizeof(text), "Capture %u (%s)", header.captureIndex, getCaptureTriggerName(header.trigger));
+		writer.beginEvent("process_name", "M", 0, firstTimestamp);
+		writer.beginArgs();
+		writer.addArg("name", text);
+		writer.endArgs();
+		writer.endEvent();
+		writer.beginEvent("thread_name", "M", 0, firstTimestamp);
+		writer.beginArgs();
+		writer.addArg("name", "Frames");
+		writer.endArgs();
+		writer.endEvent();
+
+		// track 0 are the frames, the command lists get tracks in the order of their first event
+		std::unordered_map<uint64_t, CommandListState> commandLists;
+		const CaptureEvent* frameBegin = nullptr;
+		uint32_t frameBeginCount = 0;
+		bool isFirstFrameEnd = true;
+		for(size_t eventIndex = 0; eventIndex < eventCount; ++eventIndex)
+		{
+			const CaptureEvent& event = events[eventIndex];
+			if(event.eventId == CaptureEventId::FrameBegin)
+			{
+				if(frameBeginCount == header.preTriggerFrameCount && header.trigger != CaptureTrigger::None)
+				{
+					snprintf(text, sizeof(text), "trigger: %s", getCaptureTriggerName(header.trigger));
+					writer.beginEvent(text, "i", 0, event.timestamp);
+					writer.addInstantScope("g");
+					writer.endEvent();
+				}
+				frameBegin = &event;
+				++frameBeginCount;
+				continue;
+			}
+			if(event.eventId == CaptureEventId::FrameEnd)
+			{
+				// the first frame can lack its begin if the frames kept before the trigger were trimmed
+				const int64_t begin = nullptr != frameBegin ? frameBegin->timestamp : firstTimestamp;
+				const bool isBeforeTrigger = nullptr != frameBegin ? frameBeginCount <= header.preTriggerFrameCount : isFirstFrameEnd && header.preTriggerFrameCount > 0;
+				snprintf(text, sizeof(text), "Frame %" PRIu64, event.args[0]);
+				writer.beginEvent(text, "X", 0, begin);
+				writer.addDuration(begin, event.timestamp);
+				writer.beginArgs();
+				writer.addArg("frame_time_ms", static_cast<double>(event.args[1]) / 1000000.0);
+				writer.addArg("before_trigger", isBeforeTrigger);
+				writer.endArgs();
+				writer.endEvent();
+				frameBegin = nullptr;
+				isFirstFrameEnd = false;
+				continue;
+			}
+
+			auto [commandListEntry, isNewCommandList] = commandLists.try_emplace(event.commandList);
+			CommandListState& state = commandListEntry->second;
+			if(isNewCommandList)
+			{
+				state.trackId = static_cast<uint32_t>(commandLists.size());
+				snprintf(text, sizeof(text), "command list 0x%" PRIx64, event.commandList);
+				writer.beginEvent("thread_name", "M", state.trackId, firstTimestamp);
+				writer.beginArgs();
+				writer.addArg("name", text);
+				writer.endArgs();
+				writer.endEvent();
+				writer.beginEvent("thread_sort_index", "M", state.trackId, firstTimestamp);
+				writer.beginArgs();
+				writer.addArg("sort_index", static_cast<uint64_t>(state.trackId));
+				writer.endArgs();
+				writer.endEvent();
+			}
+			if(event.eventId == CaptureEventId::BindRenderTargetsContinued)
+			{
+				// part of the bind before it
+				applyEvent(state, event);
+				continue;
+			}
+			if(nullptr != state.pendingEvent)
+			{
+				writeCommandListEvent(writer, *state.pendingEvent, state, event.timestamp);
+				state.pendingEvent = nullptr;
+			}
+			applyEvent(state, event);
+			if(isSlice(event.eventId) || isInstant(event.eventId))
+			{
+				state.pendingEvent = &event;
+			}
+		}
+		for(const auto& [commandList, state] : commandLists)
+		{
+			if(nullptr != state.pendingEvent)
+			{
+				writeCommandListEvent(writer, *state.pendingEvent, state, lastTimestamp);
+			}
+		}
+		if(nullptr != frameBegin)
+		{
+			// the capture ended before the frame did
+			writer.beginEvent("Frame (incomplete)", "X", 0, frameBegin->timestamp);
+			writer.addDuration(frameBegin->timestamp, lastTimestamp);
+			writer.endEvent();
+		}
+		writer.append("\n]}\n");
+		writer.flush();
+		return traceFile.good();
+	}
+}
@@ -0,0 +1,26 @@
+/// exports a frame capture as Chrome Trace Event JSON, for chrome://tracing, ui.perfetto.dev or Speedscope
+
+#pragma once
+
+#include "CaptureFormat.h"
+#include <cstddef>
+#include <filesystem>
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// Writes the events of a capture as a Chrome trace. The frames get a track of their own, each command list gets a track named after
+	///	its pointer. Draws, dispatches and clears are slices annotated with the pipelines, shader hashes and render targets bound on their
+	///	command list at that time. Pipeline binds, replaced pipelines, pushed constants and render target changes are instant events. The
+	///	other events are left out, they only end the slice before them.
+	///
+	///	The timestamps are when the hooks ran on the CPU: a slice lasts from its call to the next recorded call on its command list, it shows
+	///	where the game spent its time recording, not GPU time.
+	/// </summary>
+	/// <param name="fileName"></param>
+	/// <param name="header">ticks per second, trigger and frame counts of the capture</param>
+	/// <param name="events">sorted by timestamp, like in the capture file</param>
+	/// <param name="eventCount"></param>
+	/// <returns>false if the file couldn't be written</returns>
+	bool writeChromeTrace(const std::filesystem::path& fileName, const CaptureFileHeader& header, const CaptureEvent* events, size_t eventCount);
+}
@@ -0,0 +1,261 @@
+/// bytes and calls of the buffer and texture uploads and copies per frame, by kind and by the shaders bound when they were issued
+
+#include "UploadProfiler.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		std::FILE* openFile(const std::filesystem::path& fileName)
+		{
+#ifdef _WIN32
+			return _wfopen(fileName.c_str(), L"wb");
+#else
+			return std::fopen(fileName.c_str(), "wb");
+#endif
+		}
+	}
+
+
+	uint64_t UploadFrame::getBytes() const
+	{
+		uint64_t bytes = 0;
+		for(const UploadTotals& totals : kinds)
+		{
+			bytes += totals.bytes;
+		}
+		return bytes;
+	}
+
+
+	void UploadProfiler::onPresent()
+	{
+		if(!isEnabled())
+		{
+			return;
+		}
+
+		// the counters only grow, the frame is the difference to the session totals of the present before
+		++_historyFrameCount;
+		_frameShaders.clear();
+		UploadFrame session;
+		uint64_t unattributedCalls = 0;
+		const auto merge = [&](ThreadCounters& counters)
+		{
+			for(size_t i = 0; i < KindCount; ++i)
+			{
+				session.kinds[i].bytes += counters.bytes[i].load(std::memory_order_relaxed);
+				session.kinds[i].calls += counters.calls[i].load(std::memory_order_relaxed);
+			}
+			unattributedCalls += counters.unattributedCalls.load(std::memory_order_relaxed);
+			const uint32_t usedSlotCount = counters.usedSlotCount.load(std::memory_order_acquire);
+			for(uint32_t i = 0; i < usedSlotCount; ++i)
+			{
+				ShaderSlot& slot = counters.shaderSlots[counters.usedSlots[i]];
+				const uint64_t calls = slot.calls.load(std::memory_order_relaxed);
+				if(calls == slot.merged.calls)
+				{
+					continue;
+				}
+				const uint64_t bytes = slot.bytes.load(std::memory_order_relaxed);
+				// a shader combination counted on several threads is summed up from all of them
+				auto& entry = *_shaders.try_emplace(slot.shaders).first;
+				ShaderHistory& history = entry.second;
+				if(history.frameIndex != _historyFrameCount)
+				{
+					history.frameIndex = _historyFrameCount;
+					history.frame = UploadTotals();
+					_frameShaders.push_back(&entry);
+				}
+				history.frame.bytes += bytes - slot.merged.bytes;
+				history.frame.calls += calls - slot.merged.calls;
+				history.session.bytes += bytes - slot.merged.bytes;
+				history.session.calls += calls - slot.merged.calls;
+				slot.merged.bytes = bytes;
+				slot.merged.calls = calls;
+			}
+		};
+		const uint32_t threadCount = _threadCount.load(std::memory_order_acquire);
+		for(uint32_t i = 0; i < threadCount; ++i)
+		{
+			merge(*_threadCounters[i]);
+		}
+		merge(*_overflowCounters);
+		_unattributedCalls = unattributedCalls;
+
+		UploadFrame& frame = _history[_historyIndex];
+		for(size_t i = 0; i < KindCount; ++i)
+		{
+			frame.kinds[i].bytes = session.kinds[i].bytes - _sessionTotals.kinds[i].bytes;
+			frame.kinds[i].calls = session.kinds[i].calls - _sessionTotals.kinds[i].calls;
+		}
+		_sessionTotals = session;
+		_historyMegabytes[_historyIndex] = static_cast<float>(static_cast<double>(frame.getBytes()) / (1024.0 * 1024.0));
+		_historyIndex = (_historyIndex + 1) % HistoryFrameCount;
+
+		const size_t topShaderCount = std::min(_frameShaders.size(), TopShaderCount);
+		std::partial_sort(_frameShaders.begin(), _frameShaders.begin() + topShaderCount, _frameShaders.end(), [](const auto* left, const auto* right)
+			{
+				return left->second.frame.bytes > right->second.frame.bytes;
+			});
+		_topShaders.clear();
+		for(size_t i = 0; i < topShaderCount; ++i)
+		{
+			UploadShaderTotals totals;
+			totals.shaders = _frameShaders[i]->first;
+			totals.frame = _frameShaders[i]->second.frame;
+			totals.session = _frameShaders[i]->second.session;
+			_topShaders.push_back(totals);
+		}
+	}
+
+
+	bool UploadProfiler::exportCsv(const std::filesystem::path& fileName, std::string& error) const
+	{
+		std::FILE* historyFile = openFile(fileName);
+		if(nullptr == historyFile)
+		{
+			error = "Can't create " + fileName.string();
+			return false;
+		}
+		std::fputs("frame", historyFile);
+		for(size_t i = 0; i < KindCount; ++i)
+		{
+			const char* kindName = getUploadKindName(static_cast<UploadKind>(i));
+			std::fprintf(historyFile, ",%s_bytes,%s_calls", kindName, kindName);
+		}
+		std::fputs("\n", historyFile);
+		const uint64_t frameCount = std::min<uint64_t>(_historyFrameCount, HistoryFrameCount);
+		for(uint64_t i = 0; i < frameCount; ++i)
+		{
+			const UploadFrame& frame = _history[(_historyIndex + HistoryFrameCount - frameCount + i) % HistoryFrameCount];
+			std::fprintf(historyFile, "%llu", static_cast<unsigned long long>(_historyFrameCount - frameCount + i));
+			for(const UploadTotals& totals : frame.kinds)
+			{
+				std::fprintf(historyFile, ",%llu,%llu", static_cast<unsigned long long>(totals.bytes), static_cast<unsigned long long>(totals.calls));
+			}
+			std::fputs("\n", historyFile);
+		}
+		const bool isHistoryWritten = std::ferror(historyFile) == 0;
+		std::fclose(historyFile);
+		if(!isHistoryWritten)
+		{
+			error = "Can't write " + fileName.string();
+			return false;
+		}
+
+		std::filesystem::path shadersFileName = fileName;
+		shadersFileName.replace_filename(fileName.stem().string() + "_shaders" + fileName.extension().string());
+		std::FILE* shadersFile = openFile(shadersFileName);
+		if(nullptr == shadersFile)
+		{
+			error = "Can't create " + shadersFileName.string();
+			return false;
+		}
+		std::fputs("pixel_shader,vertex_shader,compute_shader,bytes,calls\n", shadersFile);
+		std::vector<std::pair<UploadShaders, UploadTotals>> shaders;
+		shaders.reserve(_shaders.size());
+		for(const auto& [key, history] : _shaders)
+		{
+			shaders.emplace_back(key, history.session);
+		}
+		std::sort(shaders.begin(), shaders.end(), [](const auto& left, const auto& right) { return left.second.bytes > right.second.bytes; });
+		for(const auto& [key, totals] : shaders)
+		{
+			std::fprintf(shadersFile, "%08X,%08X,%08X,%llu,%llu\n", key.pixelShaderHash, key.vertexShaderHash, key.computeShaderHash,
+						 static_cast<unsigned long long>(totals.bytes), static_cast<unsigned long long>(totals.calls));
+		}
+		const bool isShadersWritten = std::ferror(shadersFile) == 0;
+		std::fclose(shadersFile);
+		if(!isShadersWritten)
+		{
+			error = "Can't write " + shadersFileName.string();
+			return false;
+		}
+		return true;
+	}
+
+
+	uint64_t UploadProfiler::getShadersHash(const UploadShaders& shaders)
+	{
+		const uint64_t key = (static_cast<uint64_t>(shaders.pixelShaderHash) << 32 | shaders.vertexShaderHash) ^ (static_cast<uint64_t>(shaders.computeShaderHash) * 0xC2B2AE3D27D4EB4Full);
+		return key * 0x9E3779B97F4A7C15ull;
+	}
+
+
+	UploadProfiler::ThreadCounters* UploadProfiler::registerThread()
+	{
+		std::unique_lock lock(_registerMutex);
+		const uint32_t threadCount = _threadCount.load(std::memory_order_relaxed);
+		if(threadCount >= MaxThreadCount)
+		{
+			return _overflowCounters.get();
+		}
+		_threadCounters[threadCount] = std::make_unique<ThreadCounters>();
+		_threadCount.store(threadCount + 1, std::memory_order_release);
+		return _threadCounters[threadCount].get();
+	}
+
+
+	void UploadProfiler::add(UploadKind kind, uint64_t bytes, const UploadShaders& shaders)
+	{
+		ThreadCounters& counters = getThreadCounters();
+		counters.bytes[static_cast<size_t>(kind)].fetch_add(bytes, std::memory_order_relaxed);
+		counters.calls[static_cast<size_t>(kind)].fetch_add(1, std::memory_order_relaxed);
+		if(&counters == _overflowCounters.get())
+		{
+			// shared by several threads, the slots have a single writer
+			counters.unattributedCalls.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		// the top bits of the hash, the low bits of the shader hashes are mixed into them by the multiply
+		static_assert((ShaderSlotCount & (ShaderSlotCount - 1)) == 0, "ShaderSlotCount has to be a power of 2");
+		uint32_t index = static_cast<uint32_t>(getShadersHash(shaders) >> 40) & (ShaderSlotCount - 1);
+		for(uint32_t probe = 0; probe < MaxProbeCount; ++probe, index = (index + 1) & (ShaderSlotCount - 1))
+		{
+			ShaderSlot& slot = counters.shaderSlots[index];
+			if(!slot.isUsed)
+			{
+				slot.isUsed = true;
+				slot.shaders = shaders;
+				const uint32_t usedSlotCount = counters.usedSlotCount.load(std::memory_order_relaxed);
+				counters.usedSlots[usedSlotCount] = static_cast<uint16_t>(index);
+				counters.usedSlotCount.store(usedSlotCount + 1, std::memory_order_release);
+			}
+			else if(!(slot.shaders == shaders))
+			{
+				continue;
+			}
+			slot.bytes.fetch_add(bytes, std::memory_order_relaxed);
+			slot.calls.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		counters.unattributedCalls.fetch_add(1, std::memory_order_relaxed);
+	}
+
+
+	const char* getUploadKindName(UploadKind kind)
+	{
+		switch(kind)
+		{
+		case UploadKind::BufferUpdate:
+			return "buffer_update";
+		case UploadKind::TextureUpdate:
+			return "texture_update";
+		case UploadKind::BufferMap:
+			return "buffer_map";
+		case UploadKind::StagedCopy:
+			return "staged_copy";
+		case UploadKind::GpuCopy:
+			return "gpu_copy";
+		case UploadKind::Readback:
+			return "readback";
+		case UploadKind::Count:
+			break;
+		}
+		return "?";
+	}
+}
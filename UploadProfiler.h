@@ -0,0 +1,192 @@
+/// bytes and calls of the buffer and texture uploads and copies per frame, by kind and by the shaders bound when they were issued
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ShaderToggler
+{
+	enum class UploadKind : uint32_t
+	{
+		BufferUpdate = 0,		// update_buffer_region
+		TextureUpdate,			// update_texture_region
+		BufferMap,				// map_buffer_region for writing
+		StagedCopy,				// a copy from an upload heap resource
+		GpuCopy,				// a copy between gpu resources
+		Readback,				// a copy to a readback heap resource
+		Count,
+	};
+
+
+	/// <summary>
+	/// The shaders of the pipelines bound on the command list an upload was issued on, 0 for none or unknown.
+	/// </summary>
+	struct UploadShaders
+	{
+		uint32_t pixelShaderHash = 0;
+		uint32_t vertexShaderHash = 0;
+		uint32_t computeShaderHash = 0;
+
+		bool operator==(const UploadShaders& other) const
+		{
+			return pixelShaderHash == other.pixelShaderHash && vertexShaderHash == other.vertexShaderHash && computeShaderHash == other.computeShaderHash;
+		}
+	};
+
+
+	struct UploadTotals
+	{
+		uint64_t bytes = 0;
+		uint64_t calls = 0;
+	};
+
+
+	struct UploadFrame
+	{
+		std::array<UploadTotals, static_cast<size_t>(UploadKind::Count)> kinds;
+
+		const UploadTotals& get(UploadKind kind) const { return kinds[static_cast<size_t>(kind)]; }
+		uint64_t getBytes() const;
+	};
+
+
+	struct UploadShaderTotals
+	{
+		UploadShaders shaders;
+		UploadTotals frame;			// in the last frame
+		UploadTotals session;		// in all frames the profiler was on
+	};
+
+
+	/// <summary>
+	/// Upload profiler. The hooks call record(), which only adds to relaxed atomic counters of the calling thread: no lock and no allocation, a thread
+	///	gets its counters on its first upload. Per thread the shaders an upload is attributed to are counted in a fixed size open addressing table,
+	///	uploads with shaders that don't fit anymore are counted without them. The present thread merges the counters once per frame into the
+	///	frame totals, a history of HistoryFrameCount frames for the graph and the export, and the shaders with the most bytes. Only the
+	///	shaders with uploads in the frame are looked up.
+	///
+	///	Off by default, record() is a load and a compare then.
+	/// </summary>
+	class UploadProfiler
+	{
+	public:
+		static constexpr uint32_t MaxThreadCount = 64;				// threads past this share one set of counters
+		static constexpr uint32_t ShaderSlotCount = 4096;			// per thread, power of 2
+		static constexpr uint32_t HistoryFrameCount = 600;
+		static constexpr size_t TopShaderCount = 16;
+
+		void setEnabled(bool isEnabled) { _isEnabled.store(isEnabled, std::memory_order_relaxed); }
+		bool isEnabled() const { return _isEnabled.load(std::memory_order_relaxed); }
+		void record(UploadKind kind, uint64_t bytes, const UploadShaders& shaders)
+		{
+			if(isEnabled())
+			{
+				add(kind, bytes, shaders);
+			}
+		}
+		/// <summary>
+		/// Merges the counters of the threads into the frame. Present thread only, like the getters below.
+		/// </summary>
+		void onPresent();
+
+		const UploadFrame& getLastFrame() const { return _history[(_historyIndex + HistoryFrameCount - 1) % HistoryFrameCount]; }
+		const UploadFrame& getSessionTotals() const { return _sessionTotals; }
+		/// <summary>
+		/// The shaders with the most bytes in the last frame.
+		/// </summary>
+		const std::vector<UploadShaderTotals>& getTopShaders() const { return _topShaders; }
+		/// <summary>
+		/// Megabytes per frame, oldest first from getHistoryOffset() on, for ImGui::PlotHistogram.
+		/// </summary>
+		const float* getHistoryMegabytes() const { return _historyMegabytes.data(); }
+		int getHistoryOffset() const { return static_cast<int>(_historyIndex); }
+		uint64_t getUnattributedCount() const { return _unattributedCalls; }
+		/// <summary>
+		/// Writes the history as fileName, a line per frame, and the totals per shader as fileName with _shaders appended to the stem.
+		/// </summary>
+		/// <param name="fileName"></param>
+		/// <param name="error">set if false is returned</param>
+		/// <returns></returns>
+		bool exportCsv(const std::filesystem::path& fileName, std::string& error) const;
+
+	private:
+		static constexpr size_t KindCount = static_cast<size_t>(UploadKind::Count);
+		static constexpr uint32_t MaxProbeCount = 16;
+
+		struct ShaderSlot
+		{
+			UploadShaders shaders;					// written by the owning thread before the slot is published
+			bool isUsed = false;					// only read by the owning thread
+			std::atomic<uint64_t> bytes = 0;
+			std::atomic<uint64_t> calls = 0;
+			UploadTotals merged;					// present thread, bytes and calls merged into the totals of the shaders already
+		};
+
+		/// <summary>
+		/// Counters of one thread since the start, only that thread adds to them. The overflow counters are shared by the threads past
+		///	MaxThreadCount, their uploads aren't attributed to shaders.
+		/// </summary>
+		struct alignas(64) ThreadCounters
+		{
+			std::array<std::atomic<uint64_t>, KindCount> bytes = {};
+			std::array<std::atomic<uint64_t>, KindCount> calls = {};
+			std::atomic<uint64_t> unattributedCalls = 0;
+			std::array<ShaderSlot, ShaderSlotCount> shaderSlots;
+			std::array<uint16_t, ShaderSlotCount> usedSlots;				// indices of the used shaderSlots, in the order they were taken
+			std::atomic<uint32_t> usedSlotCount = 0;						// published with release after the slot is written
+		};
+
+		struct UploadShadersHash
+		{
+			size_t operator()(const UploadShaders& shaders) const { return static_cast<size_t>(getShadersHash(shaders)); }
+		};
+
+		struct ShaderHistory
+		{
+			UploadTotals session;
+			UploadTotals frame;
+			uint64_t frameIndex = 0;		// the frame counted in frame
+		};
+
+		static uint64_t getShadersHash(const UploadShaders& shaders);
+		ThreadCounters& getThreadCounters()
+		{
+			// one UploadProfiler per process, so the counters of a thread can be cached in a plain thread_local
+			thread_local ThreadCounters* threadCounters = nullptr;
+			if(nullptr == threadCounters)
+			{
+				threadCounters = registerThread();
+			}
+			return *threadCounters;
+		}
+		ThreadCounters* registerThread();
+		void add(UploadKind kind, uint64_t bytes, const UploadShaders& shaders);
+
+		std::atomic<bool> _isEnabled = false;
+		std::array<std::unique_ptr<ThreadCounters>, MaxThreadCount> _threadCounters;
+		std::atomic<uint32_t> _threadCount = 0;		// counters [0, _threadCount) are registered, published with release
+		std::unique_ptr<ThreadCounters> _overflowCounters = std::make_unique<ThreadCounters>();
+		std::mutex _registerMutex;
+
+		// present thread
+		UploadFrame _sessionTotals;
+		std::array<UploadFrame, HistoryFrameCount> _history;
+		std::array<float, HistoryFrameCount> _historyMegabytes = {};
+		uint32_t _historyIndex = 0;			// the next frame written
+		uint64_t _historyFrameCount = 0;	// frames recorded, the ones before HistoryFrameCount are overwritten
+		std::unordered_map<UploadShaders, ShaderHistory, UploadShadersHash> _shaders;
+		std::vector<std::pair<const UploadShaders, ShaderHistory>*> _frameShaders;		// the shaders with uploads in the frame merged, reused
+		std::vector<UploadShaderTotals> _topShaders;
+		uint64_t _unattributedCalls = 0;
+	};
+
+	const char* getUploadKindName(UploadKind kind);
+}
@@ -1,13 +1,15 @@
 /// create a pipleline_layout and initialize it to handle 1 constant buffer, code parts given by Crossire
 
 #include <reshade.hpp>
+#include "PipelineLayoutCache.h"
 
 using namespace reshade::api;
 
-// See if it should be better to have the layout global => no function to avoid pointer question...
+// The layout is interned in the cache passed in: calling this again for the same device returns the same layout instead of creating a new one.
+// Release it with layoutCache.release() when it's no longer used.
 
 reshade::api::pipeline_layout add_pipeline_layout(
-    device* device)
+    device* device, ShaderToggler::PipelineLayoutCache& layoutCache)
 {
 
     // create descriptor for a constant buffer in DX mapping starting from 0
@@ -19,8 +21,8 @@ reshade::api::pipeline_layout add_pipeline_layout(
 
     // create pipeline_layout using the descriptor
     const reshade::api::pipeline_layout_param params[1] = { srv_range };
-    reshade::api::pipeline_layout layout;
-    device->create_pipeline_layout(1, params, &layout);
+    reshade::api::pipeline_layout layout = { 0 };
+    layoutCache.acquire(device, 1, params, &layout);
 
     return layout;
 }
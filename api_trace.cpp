@@ -4,21 +4,21 @@
  */
 
 #include <reshade.hpp>
+#include "FrameCapture.h"
+#include "ResourceRegistry.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <iomanip>
 #include <sstream>
-#include <shared_mutex>
 #include <unordered_set>
 
 using namespace reshade::api;
 
 namespace
 {
-	bool s_do_capture = false;
-	std::shared_mutex s_mutex;
-	std::unordered_set<uint64_t> s_samplers;
-	std::unordered_set<uint64_t> s_resources;
-	std::unordered_set<uint64_t> s_resource_views;
-	std::unordered_set<uint64_t> s_pipelines;
+	ShaderToggler::FrameCapture s_frame_capture;
+	ShaderToggler::ResourceRegistry s_resource_registry;
 
 	inline auto to_string(shader_stage value)
 	{
@@ -501,172 +501,460 @@ inline auto to_string(reshade::api::resource_view_type value) {
 	}
 }
 
-static void on_push_descriptors(command_list*, shader_stage stages, pipeline_layout layout, uint32_t param_index, const descriptor_table_update& update)
+inline uint64_t pack_floats(float low, float high)
 {
-	if (!s_do_capture)
+	uint32_t low_bits, high_bits;
+	std::memcpy(&low_bits, &low, sizeof(low_bits));
+	std::memcpy(&high_bits, &high, sizeof(high_bits));
+	return static_cast<uint64_t>(high_bits) << 32 | low_bits;
+}
+
+inline float unpack_float(uint64_t bits)
+{
+	const uint32_t float_bits = static_cast<uint32_t>(bits);
+	float value;
+	std::memcpy(&value, &float_bits, sizeof(value));
+	return value;
+}
+
+/// <summary>
+/// Handles of 0 pass, and every handle once the registry rejected one for its memory budget.
+/// </summary>
+static bool is_registered(uint64_t handle)
+{
+	return handle == 0 || s_resource_registry.contains(handle) || s_resource_registry.getRejectedCount() > 0;
+}
+
+/// <summary>
+/// Writes a resource or view handle followed by its description from the registry, e.g. "0x1F2 [texture_2d 1920x1080 r8g8b8a8_unorm]".
+/// The capture is formatted after the frames were recorded, a handle destroyed since then is written without a description.
+/// </summary>
+static void write_handle(std::stringstream &s, uint64_t handle)
+{
+	s << (void *)handle;
+	ShaderToggler::ResourceDescription description;
+	if (handle == 0 || !s_resource_registry.find(handle, description))
 		return;
 
-#ifndef NDEBUG
-	{	const std::shared_lock<std::shared_mutex> lock(s_mutex);
+	switch (description.kind)
+	{
+	case ShaderToggler::RegisteredObjectKind::Resource:
+		s << " [" << to_string(static_cast<resource_type>(description.type));
+		break;
+	case ShaderToggler::RegisteredObjectKind::ResourceView:
+		s << " [" << to_string(static_cast<resource_view_type>(description.type));
+		break;
+	default:
+		return;
+	}
+	if (description.width != 0)
+		s << " " << description.width << "x" << description.height;
+	else if (description.size != 0 && description.size != UINT64_MAX)
+		s << " " << description.size << " bytes";
+	if (description.format != 0)
+		s << " " << to_string(static_cast<format>(description.format));
+	s << "]";
+}
+
+/// <summary>
+/// Formats a captured event as the line the synchronous capture used to log. Runs on the capture thread.
+/// </summary>
+static void format_capture_event(const ShaderToggler::CaptureEvent &event, std::string &line)
+{
+	using ShaderToggler::CaptureEventId;
+	const uint64_t *args = event.args;
+	std::stringstream s;
+	switch (event.eventId)
+	{
+	case CaptureEventId::FrameBegin:
+		s << "--- Frame " << args[0] << " ---";
+		break;
+	case CaptureEventId::FrameEnd:
+		s << "present() --- End Frame " << args[0] << ", " << std::fixed << std::setprecision(3) << static_cast<double>(args[1]) / 1000000.0 << " ms ---";
+		break;
+	case CaptureEventId::BindPipeline:
+		s << "bind_pipeline(" << to_string(static_cast<pipeline_stage>(args[0])) << " : " << (void *)args[1] << ", pipelineHandle: " << (void *)args[2] << ")";
+		break;
+	case CaptureEventId::PipelineReplaced:
+		s << "pipeline Pixel replaced (" << (void *)args[0] << ")";
+		break;
+	case CaptureEventId::InjectPushConstants:
+		s << "!!! push_constant !!!, layout =  " << (void *)args[0] << ";";
+		break;
+	case CaptureEventId::Draw:
+		s << "draw(" << args[0] << ", " << args[1] << ", " << args[2] << ", " << args[3] << ")";
+		break;
+	case CaptureEventId::DrawIndexed:
+		s << "draw_indexed(" << args[0] << ", " << args[1] << ", " << args[2] << ", " << static_cast<int32_t>(args[3]) << ", " << args[4] << ")";
+		break;
+	case CaptureEventId::DrawOrDispatchIndirect:
+		switch (static_cast<indirect_command>(args[0]))
+		{
+		case indirect_command::draw:
+			s << "draw_indirect(";
+			break;
+		case indirect_command::draw_indexed:
+			s << "draw_indexed_indirect(";
+			break;
+		case indirect_command::dispatch:
+			s << "dispatch_indirect(";
+			break;
+		case indirect_command::dispatch_mesh:
+			s << "dispatch_mesh_indirect(";
+			break;
+		case indirect_command::dispatch_rays:
+			s << "dispatch_rays_indirect(";
+			break;
+		default:
+			s << "draw_or_dispatch_indirect(";
+			break;
+		}
+		s << (void *)args[1] << ", " << args[2] << ", " << args[3] << ", " << args[4] << ")";
+		break;
+	case CaptureEventId::PushDescriptors:
+		s << "push_descriptors(" << to_string(static_cast<shader_stage>(args[0])) << ", " << (void *)args[1] << ", " << args[2] << ", { " << to_string(static_cast<descriptor_type>(args[3])) << ", " << (args[4] >> 32) << ", " << static_cast<uint32_t>(args[4]) << " })";
+		break;
+	case CaptureEventId::BindRenderTargets:
+		s << "bind_render_targets_and_depth_stencil(" << args[0] << ", { ";
+		for (uint64_t i = 0; i < args[0] && i < 3; ++i)
+		{
+			write_handle(s, args[2 + i]);
+			s << ", ";
+		}
+		if (args[0] > 3)
+			s << "... ";
+		s << " }, ";
+		write_handle(s, args[1]);
+		s << ")";
+		break;
+	case CaptureEventId::BindRenderTargetsContinued:
+		s << "  render targets " << args[0] << "+: { ";
+		for (uint64_t i = 1; i < 5; ++i)
+		{
+			write_handle(s, args[i]);
+			s << ", ";
+		}
+		s << " }";
+		break;
+	case CaptureEventId::BindViewports:
+		s << "bind_viewports(" << args[0] << ", " << args[1] << ", { ... })";
+		break;
+	case CaptureEventId::ClearRenderTargetView:
+		s << "clear_render_target_view(";
+		write_handle(s, args[0]);
+		s << ", { " << unpack_float(args[1]) << ", " << unpack_float(args[1] >> 32) << ", " << unpack_float(args[2]) << ", " << unpack_float(args[2] >> 32) << " })";
+		break;
+	case CaptureEventId::ClearDepthStencilView:
+		s << "clear_depth_stencil_view(";
+		write_handle(s, args[0]);
+		s << ", " << unpack_float(args[1]) << ", " << static_cast<uint32_t>(args[2]) << ")";
+		break;
+	case CaptureEventId::BindPipelineState:
+		s << "bind_pipeline_state(" << to_string(static_cast<dynamic_state>(args[0])) << ", " << args[1] << ")";
+		break;
+	case CaptureEventId::BindVertexBuffer:
+		s << "bind_vertex_buffer(" << args[0] << ", ";
+		write_handle(s, args[1]);
+		s << ", " << args[2] << ", " << args[3] << ")";
+		break;
+	case CaptureEventId::BindIndexBuffer:
+		s << "bind_index_buffer(";
+		write_handle(s, args[0]);
+		s << ", " << args[1] << ", " << args[2] << ")";
+		break;
+	case CaptureEventId::Dispatch:
+		s << "dispatch(" << args[0] << ", " << args[1] << ", " << args[2] << ")";
+		break;
+	case CaptureEventId::BeginRenderPass:
+		s << "begin_render_pass(" << static_cast<uint32_t>(args[0]) << ", { ";
+		for (uint64_t i = 0; i < static_cast<uint32_t>(args[0]) && i < 3; ++i)
+		{
+			write_handle(s, args[2 + i]);
+			s << ((args[0] >> (32 + i)) & 1 ? " (clear)" : "") << ", ";
+		}
+		if (static_cast<uint32_t>(args[0]) > 3)
+			s << "... ";
+		s << " }, ";
+		write_handle(s, args[1]);
+		s << ((args[0] >> 40) & 1 ? " (clear)" : "") << ")";
+		break;
+	case CaptureEventId::EndRenderPass:
+		s << "end_render_pass()";
+		break;
+	case CaptureEventId::ReadViews:
+		s << "  " << to_string(static_cast<descriptor_type>((args[0] >> 56) & 0xF)) << " " << to_string(static_cast<shader_stage>(static_cast<uint32_t>(args[0]))) << " " << ((args[0] >> 32) & 0xFFFFFF) << "+: { ";
+		for (uint64_t i = 1; i <= (args[0] >> 60); ++i)
+		{
+			write_handle(s, args[i]);
+			s << ", ";
+		}
+		s << " }";
+		break;
+	case CaptureEventId::ViewAlias:
+		s << "  view " << (void *)args[0] << " of resource " << (void *)args[1];
+		break;
+	default:
+		s << "unknown event " << static_cast<uint32_t>(event.eventId);
+		break;
+	}
+	line = s.str();
+}
+
+static void write_capture_log_line(const char *line)
+{
+	reshade::log_message(reshade::log_level::info, line);
+}
+
+/// <summary>
+/// Records the resource of a view the first time the view is used in a frame on this thread, so the capture tools can tell which views
+/// share a resource (a render target read as a texture later on). Only the first use allocates, for the set of views seen.
+/// </summary>
+static void record_view_alias(command_list *cmd_list, uint64_t view)
+{
+	thread_local uint32_t s_alias_frame_serial = 0;
+	thread_local std::unordered_set<uint64_t> s_aliased_views;
+	if (view == 0)
+		return;
+
+	const uint32_t frame_serial = s_frame_capture.getFrameSerial();
+	if (frame_serial != s_alias_frame_serial)
+	{
+		s_aliased_views.clear();
+		s_alias_frame_serial = frame_serial;
+	}
+	if (!s_aliased_views.insert(view).second)
+		return;
+
+	// the registry knows the resource of the views created since the add-on was loaded, the device is asked for the others
+	ShaderToggler::ResourceDescription description;
+	const uint64_t resource = s_resource_registry.find(view, description) && description.kind == ShaderToggler::RegisteredObjectKind::ResourceView ? description.resource
+		: cmd_list->get_device()->get_resource_from_view(resource_view { view }).handle;
+	s_frame_capture.record(ShaderToggler::CaptureEventId::ViewAlias, (uint64_t)cmd_list, view, resource);
+}
 
+/// <summary>
+/// Records the views of a descriptor update which are read (and written, for unordered access views), four per event.
+/// </summary>
+static void record_read_views(command_list *cmd_list, shader_stage stages, const descriptor_table_update &update)
+{
+	const auto view = [&update](uint32_t index) -> uint64_t
+	{
+		if (index >= update.count)
+			return 0;
+		if (update.type == descriptor_type::sampler_with_resource_view)
+			return static_cast<const sampler_with_resource_view *>(update.descriptors)[index].view.handle;
+		return static_cast<const resource_view *>(update.descriptors)[index].handle;
+	};
+	for (uint32_t i = 0; i < update.count; i += 4)
+	{
+		for (uint32_t j = i; j < i + 4 && j < update.count; ++j)
+			record_view_alias(cmd_list, view(j));
+		// a view of 0 within the count unbinds the slot
+		const uint64_t count = std::min(update.count - i, 4u);
+		s_frame_capture.record(ShaderToggler::CaptureEventId::ReadViews, (uint64_t)cmd_list,
+							   static_cast<uint32_t>(stages) | static_cast<uint64_t>(update.binding + i) << 32 | static_cast<uint64_t>(update.type) << 56 | count << 60,
+							   view(i), view(i + 1), view(i + 2), view(i + 3));
+	}
+}
+
+static void on_init_sampler(device *, const sampler_desc &, sampler sampler)
+{
+	s_resource_registry.addSampler(sampler);
+}
+
+static void on_destroy_sampler(device *, sampler sampler)
+{
+	s_resource_registry.remove(sampler.handle);
+}
+
+static void on_push_descriptors(command_list* cmd_list, shader_stage stages, pipeline_layout layout, uint32_t param_index, const descriptor_table_update& update)
+{
+	if (!s_frame_capture.isCapturing())
+		return;
+
+#ifndef NDEBUG
 	switch (update.type)
 	{
 	case descriptor_type::sampler:
 		for (uint32_t i = 0; i < update.count; ++i)
-			assert(static_cast<const sampler*>(update.descriptors)[i].handle == 0 || s_samplers.find(static_cast<const sampler*>(update.descriptors)[i].handle) != s_samplers.end());
+			assert(is_registered(static_cast<const sampler*>(update.descriptors)[i].handle));
 		break;
 	case descriptor_type::sampler_with_resource_view:
 		for (uint32_t i = 0; i < update.count; ++i)
-			assert(static_cast<const sampler_with_resource_view*>(update.descriptors)[i].view.handle == 0 || s_resource_views.find(static_cast<const sampler_with_resource_view*>(update.descriptors)[i].view.handle) != s_resource_views.end());
+			assert(is_registered(static_cast<const sampler_with_resource_view*>(update.descriptors)[i].view.handle));
 		break;
 	case descriptor_type::shader_resource_view:
 	case descriptor_type::unordered_access_view:
+#if RESHADE_API_VERSION >= 11
+	case descriptor_type::buffer_shader_resource_view:
+	case descriptor_type::buffer_unordered_access_view:
+#endif
 	case descriptor_type::acceleration_structure:
 		for (uint32_t i = 0; i < update.count; ++i)
-			assert(static_cast<const resource_view*>(update.descriptors)[i].handle == 0 || s_resource_views.find(static_cast<const resource_view*>(update.descriptors)[i].handle) != s_resource_views.end());
+			assert(is_registered(static_cast<const resource_view*>(update.descriptors)[i].handle));
 		break;
 	case descriptor_type::constant_buffer:
 		for (uint32_t i = 0; i < update.count; ++i)
-			assert(static_cast<const buffer_range*>(update.descriptors)[i].buffer.handle == 0 || s_resources.find(static_cast<const buffer_range*>(update.descriptors)[i].buffer.handle) != s_resources.end());
+			assert(is_registered(static_cast<const buffer_range*>(update.descriptors)[i].buffer.handle));
 		break;
 	default:
 		break;
 	}
-	}
 #endif
 
-	std::stringstream s;
-	s << "push_descriptors(" << to_string(stages) << ", " << (void*)layout.handle << ", " << param_index << ", { " << to_string(update.type) << ", " << update.binding << ", " << update.count << " })";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	s_frame_capture.record(ShaderToggler::CaptureEventId::PushDescriptors, (uint64_t)cmd_list, (uint64_t)stages, layout.handle, param_index, (uint64_t)update.type,
+						   static_cast<uint64_t>(update.binding) << 32 | update.count);
+	switch (update.type)
+	{
+	case descriptor_type::sampler_with_resource_view:
+	case descriptor_type::shader_resource_view:
+	case descriptor_type::unordered_access_view:
+#if RESHADE_API_VERSION >= 11
+	// since the texture and buffer views have their own types, compute passes communicating through structured buffers are linked by these
+	case descriptor_type::buffer_shader_resource_view:
+	case descriptor_type::buffer_unordered_access_view:
+#endif
+		record_read_views(cmd_list, stages, update);
+		break;
+	default:
+		break;
+	}
 }
 
-static void on_bind_render_targets_and_depth_stencil(command_list *, uint32_t count, const resource_view *rtvs, resource_view dsv)
+static void on_bind_render_targets_and_depth_stencil(command_list *cmd_list, uint32_t count, const resource_view *rtvs, resource_view dsv)
 {
-	if (!s_do_capture)
+	if (!s_frame_capture.isCapturing())
 		return;
 
 #ifndef NDEBUG
-	{	const std::shared_lock<std::shared_mutex> lock(s_mutex);
-
-		for (uint32_t i = 0; i < count; ++i)
-			assert(rtvs[i] == 0 || s_resource_views.find(rtvs[i].handle) != s_resource_views.end());
-		assert(dsv == 0 || s_resource_views.find(dsv.handle) != s_resource_views.end());
-	}
+	for (uint32_t i = 0; i < count; ++i)
+		assert(is_registered(rtvs[i].handle));
+	assert(is_registered(dsv.handle));
 #endif
 
-	std::stringstream s;
-	s << "bind_render_targets_and_depth_stencil(" << count << ", { ";
 	for (uint32_t i = 0; i < count; ++i)
-		s << (void *)rtvs[i].handle << ", ";
-	s << " }, " << (void *)dsv.handle << ")";
+		record_view_alias(cmd_list, rtvs[i].handle);
+	record_view_alias(cmd_list, dsv.handle);
+	const auto rtv = [count, rtvs](uint32_t index) { return index < count ? rtvs[index].handle : 0; };
+	s_frame_capture.record(ShaderToggler::CaptureEventId::BindRenderTargets, (uint64_t)cmd_list, count, dsv.handle, rtv(0), rtv(1), rtv(2));
+	for (uint32_t i = 3; i < count; i += 4)
+		s_frame_capture.record(ShaderToggler::CaptureEventId::BindRenderTargetsContinued, (uint64_t)cmd_list, i, rtv(i), rtv(i + 1), rtv(i + 2), rtv(i + 3));
+}
 
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+static void on_begin_render_pass(command_list *cmd_list, uint32_t count, const render_pass_render_target_desc *rts, const render_pass_depth_stencil_desc *ds)
+{
+	if (!s_frame_capture.isCapturing())
+		return;
+
+	uint64_t cleared = 0;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		record_view_alias(cmd_list, rts[i].view.handle);
+		if (rts[i].load_op == render_pass_load_op::clear && i < 8)
+			cleared |= 1ull << (32 + i);
+	}
+	const uint64_t dsv = ds != nullptr ? ds->view.handle : 0;
+	record_view_alias(cmd_list, dsv);
+	if (ds != nullptr && (ds->depth_load_op == render_pass_load_op::clear || ds->stencil_load_op == render_pass_load_op::clear))
+		cleared |= 1ull << 40;
+
+	const auto rtv = [count, rts](uint32_t index) { return index < count ? rts[index].view.handle : 0; };
+	s_frame_capture.record(ShaderToggler::CaptureEventId::BeginRenderPass, (uint64_t)cmd_list, count | cleared, dsv, rtv(0), rtv(1), rtv(2));
+	for (uint32_t i = 3; i < count; i += 4)
+		s_frame_capture.record(ShaderToggler::CaptureEventId::BindRenderTargetsContinued, (uint64_t)cmd_list, i, rtv(i), rtv(i + 1), rtv(i + 2), rtv(i + 3));
 }
 
-static void on_bind_viewports(command_list *, uint32_t first, uint32_t count, const viewport *viewports)
+static void on_end_render_pass(command_list *cmd_list)
 {
-	if (!s_do_capture)
+	if (!s_frame_capture.isCapturing())
 		return;
 
-	std::stringstream s;
-	s << "bind_viewports(" << first << ", " << count << ", { ... })";
+	s_frame_capture.record(ShaderToggler::CaptureEventId::EndRenderPass, (uint64_t)cmd_list);
+}
 
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+static void on_bind_viewports(command_list *cmd_list, uint32_t first, uint32_t count, const viewport *viewports)
+{
+	if (!s_frame_capture.isCapturing())
+		return;
+
+	s_frame_capture.record(ShaderToggler::CaptureEventId::BindViewports, (uint64_t)cmd_list, first, count);
 }
 
-static bool on_clear_render_target_view(command_list *, resource_view rtv, const float color[4], uint32_t, const rect *)
+static bool on_clear_render_target_view(command_list *cmd_list, resource_view rtv, const float color[4], uint32_t, const rect *)
 {
-	if (!s_do_capture)
+	if (!s_frame_capture.isCapturing())
 		return false;
 
 #ifndef NDEBUG
-	{	const std::shared_lock<std::shared_mutex> lock(s_mutex);
-
-		assert(s_resource_views.find(rtv.handle) != s_resource_views.end());
-	}
+	assert(rtv.handle != 0 && is_registered(rtv.handle));
 #endif
 
-	std::stringstream s;
-	s << "clear_render_target_view(" << (void *)rtv.handle << ", { " << color[0] << ", " << color[1] << ", " << color[2] << ", " << color[3] << " })";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	record_view_alias(cmd_list, rtv.handle);
+	s_frame_capture.record(ShaderToggler::CaptureEventId::ClearRenderTargetView, (uint64_t)cmd_list, rtv.handle, pack_floats(color[0], color[1]), pack_floats(color[2], color[3]));
 
 	return false;
 }
 
-static bool on_clear_depth_stencil_view(command_list *, resource_view dsv, const float *depth, const uint8_t *stencil, uint32_t, const rect *)
+static bool on_clear_depth_stencil_view(command_list *cmd_list, resource_view dsv, const float *depth, const uint8_t *stencil, uint32_t, const rect *)
 {
-	if (!s_do_capture)
+	if (!s_frame_capture.isCapturing())
 		return false;
 
 #ifndef NDEBUG
-	{	const std::shared_lock<std::shared_mutex> lock(s_mutex);
-
-		assert(s_resource_views.find(dsv.handle) != s_resource_views.end());
-	}
+	assert(dsv.handle != 0 && is_registered(dsv.handle));
 #endif
 
-	std::stringstream s;
-	s << "clear_depth_stencil_view(" << (void *)dsv.handle << ", " << (depth != nullptr ? *depth : 0.0f) << ", " << (stencil != nullptr ? *stencil : 0) << ")";
-
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+	record_view_alias(cmd_list, dsv.handle);
+	s_frame_capture.record(ShaderToggler::CaptureEventId::ClearDepthStencilView, (uint64_t)cmd_list, dsv.handle,
+						   (depth != nullptr ? 1ull << 32 | pack_floats(*depth, 0.0f) : 0), (stencil != nullptr ? 1ull << 32 | *stencil : 0));
 
 	return false;
 }
 
-static void on_bind_pipeline_states(command_list *, uint32_t count, const dynamic_state *states, const uint32_t *values)
+static void on_bind_pipeline_states(command_list *cmd_list, uint32_t count, const dynamic_state *states, const uint32_t *values)
 {
-	if (!s_do_capture)
+	if (!s_frame_capture.isCapturing())
 		return;
 
 	for (uint32_t i = 0; i < count; ++i)
-	{
-		std::stringstream s;
-		s << "bind_pipeline_state(" << to_string(states[i]) << ", " << values[i] << ")";
-		reshade::log_message(reshade::log_level::info, s.str().c_str());
-	}
+		s_frame_capture.record(ShaderToggler::CaptureEventId::BindPipelineState, (uint64_t)cmd_list, (uint64_t)states[i], values[i]);
 }
 
 
-static void on_bind_vertex_buffers(command_list *, uint32_t first, uint32_t count, const resource *buffers, const uint64_t *offsets, const uint32_t *strides)
+static void on_bind_vertex_buffers(command_list *cmd_list, uint32_t first, uint32_t count, const resource *buffers, const uint64_t *offsets, const uint32_t *strides)
 {
-	if (!s_do_capture)
+	if (!s_frame_capture.isCapturing())
 		return;
 
 #ifndef NDEBUG
-	{	const std::shared_lock<std::shared_mutex> lock(s_mutex);
-
-		for (uint32_t i = 0; i < count; ++i)
-			assert(buffers[i].handle == 0 || s_resources.find(buffers[i].handle) != s_resources.end());
-	}
+	for (uint32_t i = 0; i < count; ++i)
+		assert(is_registered(buffers[i].handle));
 #endif
 
 	for (uint32_t i = 0; i < count; ++i)
-	{
-		std::stringstream s;
-		s << "bind_vertex_buffer(" << (first + i) << ", " << (void *)buffers[i].handle << ", " << (offsets != nullptr ? offsets[i] : 0) << ", " << (strides != nullptr ? strides[i] : 0) << ")";
-		reshade::log_message(reshade::log_level::info, s.str().c_str());
-	}
+		s_frame_capture.record(ShaderToggler::CaptureEventId::BindVertexBuffer, (uint64_t)cmd_list, first + i, buffers[i].handle, (offsets != nullptr ? offsets[i] : 0), (strides != nullptr ? strides[i] : 0));
 }
 
 
-static void on_bind_index_buffer(command_list *, resource buffer, uint64_t offset, uint32_t index_size)
+static void on_bind_index_buffer(command_list *cmd_list, resource buffer, uint64_t offset, uint32_t index_size)
 {
-	if (!s_do_capture)
+	if (!s_frame_capture.isCapturing())
 		return;
 
 #ifndef NDEBUG
-	{	const std::shared_lock<std::shared_mutex> lock(s_mutex);
-
-		assert(buffer.handle == 0 || s_resources.find(buffer.handle) != s_resources.end());
-	}
+	assert(is_registered(buffer.handle));
 #endif
 
-	std::stringstream s;
-	s << "bind_index_buffer(" << (void *)buffer.handle << ", " << offset << ", " << index_size << ")";
+	s_frame_capture.record(ShaderToggler::CaptureEventId::BindIndexBuffer, (uint64_t)cmd_list, buffer.handle, offset, index_size);
+}
 
-	reshade::log_message(reshade::log_level::info, s.str().c_str());
+static bool on_dispatch(command_list *cmd_list, uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
+{
+	if (!s_frame_capture.isCapturing())
+		return false;
+
+	s_frame_capture.record(ShaderToggler::CaptureEventId::Dispatch, (uint64_t)cmd_list, group_count_x, group_count_y, group_count_z);
+	return false;
 }
 
 
@@ -15,9 +15,16 @@ struct __declspec(uuid("a2d72286-a857-4e4a-8ca1-ef42faf4e340")) global_shared
 	// working : float array containing the constant buffer to be injected
 	// float cb_inject_values[CBSIZE] = { 1.0, 2.0, 3.0, 4.0 };
 	//to test : struct
-	struct ShaderInjectData cb_inject_values;
+	struct ShaderInjectData cb_inject_values = SHADER_INJECT_DEFAULTS;
 	uint64_t cb_inject_size = CBSIZE;
 
+	// persistent constant buffer holding cb_inject_values, uploaded at most once per frame (when cb_inject_dirty is set) and bound with push_descriptors.
+	// If it couldn't be created, cb_inject_values is pushed with push_constants instead.
+	reshade::api::device* cb_inject_device = nullptr;
+	reshade::api::resource cb_inject_buffer = { 0 };
+	reshade::api::pipeline_layout cb_inject_buffer_layout = { 0 };
+	bool cb_inject_dirty = false;
+
 	// reference of unique DX11 pipeline_layout -if push_descriptor not working or of a new dedicated pipeline layout if push_constant
 	reshade::api::pipeline_layout saved_pipeline_layout;
 
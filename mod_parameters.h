@@ -1,22 +1,55 @@
-// size of the constant buffer containing all mod parameters, to be injected in shaders
-const int CBSIZE = 4;
+// parameters injected in the shaders through cb13. Included by the addon (C++) and by the injected shaders (HLSL), so keep it valid for both.
+//
+// The parameter block is described once in SHADER_INJECT_PARAMETERS, everything else is generated from it:
+// - the ShaderInjectData struct, identical in C++ and in HLSL
+// - the cb13 cbuffer declaration for HLSL
+// - the layout checks (C++, compile time)
+// - the defaults and the UI in the addon
+//
+// Columns: type, name, offset, default, min, max, label, format
+//	type	float or int. Only 32 bit scalars, so the HLSL cbuffer packing is the same as the C++ struct layout.
+//	offset	offset in 32 bit values from the start of the block. Checked against the struct layout at compile time.
+//	label	shown in the addon UI. Use "" for a parameter which isn't shown (e.g. unused padding).
+//	format	ImGui format string for the slider.
+// The block has to be a multiple of 16 bytes (a float4 register), pad it with unused values.
 
-// CB number to be injected in the shaders
-const int CBINDEX = 13;
+#define SHADER_INJECT_PARAMETERS(PARAMETER) \
+	PARAMETER(float, colorFlag,	0, 0.0f, 0.0f, 5.0f, "# of draws to differentiate", "ratio = %.0f") \
+	PARAMETER(float, unused1,	1, 0.0f, 0.0f, 1.0f, "", "%.3f") \
+	PARAMETER(float, unused2,	2, 0.0f, 0.0f, 1.0f, "", "%.3f") \
+	PARAMETER(float, unused3,	3, 0.0f, 0.0f, 1.0f, "", "%.3f")
 
+#define SHADER_INJECT_DECLARE_FIELD(type, name, offset, defaultValue, minValue, maxValue, label, format) type name;
 
-// Must be 32bit aligned
-// Should be 4x32
 struct ShaderInjectData {
-	float colorFlag;
-	float unused1;
-	float unused2;
-	float unused3;
+	SHADER_INJECT_PARAMETERS(SHADER_INJECT_DECLARE_FIELD)
 };
 
-/* 
-#ifndef __cplusplus
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+
+// number of 32 bit values in the constant buffer containing all mod parameters, to be injected in shaders
+constexpr int CBSIZE = sizeof(ShaderInjectData) / sizeof(uint32_t);
+
+// CB number to be injected in the shaders, has to match the register of the HLSL cbuffer below
+constexpr int CBINDEX = 13;
+
+#define SHADER_INJECT_CHECK_FIELD(type, name, offset, defaultValue, minValue, maxValue, label, format) \
+	static_assert(sizeof(type) == sizeof(uint32_t), "parameter " #name ": only 32 bit scalars are supported"); \
+	static_assert(offsetof(ShaderInjectData, name) == (offset) * sizeof(uint32_t), "parameter " #name ": offset doesn't match the struct layout"); \
+	static_assert((offsetof(ShaderInjectData, name) % 16) + sizeof(type) <= 16, "parameter " #name ": crosses a 16 byte register boundary");
+SHADER_INJECT_PARAMETERS(SHADER_INJECT_CHECK_FIELD)
+static_assert(sizeof(ShaderInjectData) % 16 == 0, "ShaderInjectData must be a multiple of 16 bytes, pad it with unused parameters");
+static_assert(CBINDEX == 13, "the HLSL cbuffer below is declared with register(b13)");
+
+#define SHADER_INJECT_DEFAULT_VALUE(type, name, offset, defaultValue, minValue, maxValue, label, format) defaultValue,
+constexpr ShaderInjectData SHADER_INJECT_DEFAULTS = { SHADER_INJECT_PARAMETERS(SHADER_INJECT_DEFAULT_VALUE) };
+
+#else
+
 cbuffer cb13 : register(b13) {
 	ShaderInjectData injectedData : packoffset(c0);
 }
-#endif */
+
+#endif
@@ -1,13 +1,8 @@
 // constant red 
 
-// shader injection in cb13
+// shader injection in cb13, the cbuffer (injectedData) is declared by mod_parameters.h
 #include "H:\utils\Repos\ShaderHunter\mod_parameters.h"
 
-cbuffer cb13 : register(b13)
-{
-    ShaderInjectData injectedData : packoffset(c0);
-}
-
 
 void main(
   float4 v0 : SV_POSITION0,
@@ -0,0 +1,208 @@
+/// measures what recording a hook call costs the game thread with the frame capture, against the synchronous capture it replaced.
+/// build on linux: g++ -std=c++20 -O2 -I.. CaptureBenchmark.cpp ../FrameCapture.cpp ../TraceExport.cpp -o capturebenchmark -pthread
+/// usage:
+///		capturebenchmark [<folder>] [--events N] [--threads N]
+/// The old capture formatted each event with a stringstream and logged the line under a mutex, flushed, on the game thread: that's replayed
+/// into <folder>/synchronous.log. FrameCapture::record is timed on one thread over several frames (steady state, the ring is allocated by
+/// the first frame) and on several threads at once in a single frame, whose capture is written to <folder> and checked for drops. The
+/// threads of that frame record their first events, their times include the allocation of their ring.
+/// Last, a burst well above a real frame's rate shows the ring overflow: the events past RingCapacity are dropped and counted.
+
+#include "FrameCapture.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace ShaderToggler;
+
+namespace
+{
+	constexpr uint32_t SteadyFrameCount = 5;
+	constexpr uint64_t BurstEventCount = 100000;
+
+	std::mutex g_logMutex;
+	std::ofstream g_logFile;
+	uint64_t g_loggedLineCount = 0;
+
+
+	/// <summary>
+	/// What reshade::log_message did for the synchronous capture: a line under a mutex, flushed.
+	/// </summary>
+	void writeLogLine(const char* line)
+	{
+		std::unique_lock lock(g_logMutex);
+		g_logFile << line << '\n';
+		g_logFile.flush();
+	}
+
+
+	void countLogLine(const char*)
+	{
+		++g_loggedLineCount;
+	}
+
+
+	void formatDraw(const CaptureEvent& event, std::string& line)
+	{
+		std::stringstream stream;
+		stream << "draw(" << event.args[0] << ", " << event.args[1] << ", " << event.args[2] << ", " << event.args[3] << ")";
+		line = stream.str();
+	}
+
+
+	double getNanosecondsPerEvent(std::chrono::steady_clock::time_point startTime, uint64_t eventCount)
+	{
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count() / static_cast<double>(eventCount);
+	}
+
+
+	/// <summary>
+	/// Waits till the capture thread wrote captureCount captures and is ready for the next one, a trigger while it's busy is dropped.
+	/// </summary>
+	CaptureStatistics waitForCapture(FrameCapture& capture, uint32_t captureCount)
+	{
+		while(capture.getStatistics().captureCount < captureCount || capture.isBusy())
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return capture.getStatistics();
+	}
+
+
+	int printUsage()
+	{
+		fprintf(stderr, "usage:\n"
+				"\tcapturebenchmark [<folder>] [--events N] [--threads N]\n"
+				"\t\t<folder> gets the synchronous log and the captures, the current folder if not given.\n"
+				"\t\t--events: events per thread and frame, default 10000, at most %u so a frame fits in a ring.\n"
+				"\t\t--threads: recording threads of the multi threaded frame, default 4.\n", FrameCapture::RingCapacity);
+		return 1;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path folder = ".";
+	uint64_t eventCount = 10000;
+	uint32_t threadCount = 4;
+	for(int argIndex = 1; argIndex < argc; ++argIndex)
+	{
+		if(strcmp(argv[argIndex], "--events") == 0 && argIndex + 1 < argc)
+		{
+			eventCount = std::clamp<uint64_t>(strtoull(argv[++argIndex], nullptr, 10), 1, FrameCapture::RingCapacity);
+		}
+		else if(strcmp(argv[argIndex], "--threads") == 0 && argIndex + 1 < argc)
+		{
+			threadCount = std::clamp<uint32_t>(static_cast<uint32_t>(strtoul(argv[++argIndex], nullptr, 10)), 1, FrameCapture::MaxThreadCount - 1);
+		}
+		else if(argv[argIndex][0] == '-')
+		{
+			return printUsage();
+		}
+		else
+		{
+			folder = argv[argIndex];
+		}
+	}
+	std::error_code ec;
+	std::filesystem::create_directories(folder, ec);
+
+	// the synchronous capture, one line per event
+	g_logFile.open(folder / "synchronous.log", std::ios::trunc);
+	if(!g_logFile.is_open())
+	{
+		fprintf(stderr, "Can't create %s\n", (folder / "synchronous.log").string().c_str());
+		return 1;
+	}
+	auto startTime = std::chrono::steady_clock::now();
+	for(uint64_t i = 0; i < eventCount; ++i)
+	{
+		std::stringstream stream;
+		stream << "draw(" << i << ", " << 1 << ", " << 0 << ", " << 0 << ")";
+		writeLogLine(stream.str().c_str());
+	}
+	const double synchronousNanoseconds = getNanosecondsPerEvent(startTime, eventCount);
+	g_logFile.close();
+
+	FrameCapture capture;
+	capture.setOutput(folder, formatDraw, countLogLine);
+	capture.setCaptureOutput(CaptureOutput::File);
+
+	// one thread, a capture per frame. The best frame, the first one allocates the ring.
+	double steadyNanoseconds = 1e30;
+	for(uint32_t frame = 0; frame < SteadyFrameCount; ++frame)
+	{
+		capture.requestCapture(CaptureTrigger::Key);
+		capture.onPresent();
+		startTime = std::chrono::steady_clock::now();
+		for(uint64_t i = 0; i < eventCount; ++i)
+		{
+			capture.record(CaptureEventId::Draw, 1, i, 1, 0, 0);
+		}
+		steadyNanoseconds = std::min(steadyNanoseconds, getNanosecondsPerEvent(startTime, eventCount));
+		capture.onPresent();
+		waitForCapture(capture, frame + 1);
+	}
+
+	// several threads recording into the same frame, written as a binary capture and to the log
+	capture.setCaptureOutput(CaptureOutput::LogAndFile);
+	capture.requestCapture(CaptureTrigger::Key);
+	capture.onPresent();
+	std::vector<double> threadNanoseconds(threadCount);
+	std::vector<std::thread> threads;
+	for(uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+	{
+		threads.emplace_back([&, threadIndex]
+			{
+				const auto threadStartTime = std::chrono::steady_clock::now();
+				for(uint64_t i = 0; i < eventCount; ++i)
+				{
+					capture.record(CaptureEventId::Draw, 0x1000 + threadIndex, i, 1, 0, 0);
+				}
+				threadNanoseconds[threadIndex] = getNanosecondsPerEvent(threadStartTime, eventCount);
+			});
+	}
+	for(auto& thread : threads)
+	{
+		thread.join();
+	}
+	capture.onPresent();
+	const CaptureStatistics threadedStatistics = waitForCapture(capture, SteadyFrameCount + 1);
+
+	// a burst on one thread faster than the capture thread drains
+	capture.setCaptureOutput(CaptureOutput::File);
+	capture.requestCapture(CaptureTrigger::Key);
+	capture.onPresent();
+	startTime = std::chrono::steady_clock::now();
+	for(uint64_t i = 0; i < BurstEventCount; ++i)
+	{
+		capture.record(CaptureEventId::Draw, 1, i);
+	}
+	const double burstMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	capture.onPresent();
+	const CaptureStatistics burstStatistics = waitForCapture(capture, SteadyFrameCount + 2);
+	capture.stop();
+
+	printf("synchronous capture (format + flushed log line): %8.1f ns/event\n", synchronousNanoseconds);
+	printf("FrameCapture::record, one thread, steady state:  %8.1f ns/event\n", steadyNanoseconds);
+	for(uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+	{
+		printf("FrameCapture::record, thread %u of %u:            %8.1f ns/event\n", threadIndex + 1, threadCount, threadNanoseconds[threadIndex]);
+	}
+	printf("%u threads x %llu events: %llu captured, %llu dropped, %llu log lines, written in %.1f ms to %s\n", threadCount,
+		   static_cast<unsigned long long>(eventCount), static_cast<unsigned long long>(threadedStatistics.eventCount),
+		   static_cast<unsigned long long>(threadedStatistics.droppedEventCount), static_cast<unsigned long long>(g_loggedLineCount),
+		   threadedStatistics.writeMilliseconds, threadedStatistics.fileName.c_str());
+	printf("burst of %llu events in %.1f ms: %llu captured, %llu dropped\n", static_cast<unsigned long long>(BurstEventCount), burstMilliseconds,
+		   static_cast<unsigned long long>(burstStatistics.eventCount), static_cast<unsigned long long>(burstStatistics.droppedEventCount));
+	// every draw of the threaded frame is expected in the capture, next to the FrameBegin events
+	return threadedStatistics.droppedEventCount == 0 && threadedStatistics.eventCount >= threadCount * eventCount ? 0 : 1;
+}
@@ -0,0 +1,676 @@
+/// reports the frame structure of a .stcap file written by the frame capture of the addon, and converts it to a Chrome trace.
+/// build on linux: g++ -std=c++20 -O2 -I.. CaptureTool.cpp PassGraph.cpp ../TraceExport.cpp ../MappedFile.cpp -o capturetool -pthread
+/// usage:
+///		capturetool report <file.stcap> [--top N] [--threads N]
+///		capturetool passes <file.stcap> [--overdraw N] [--dot file.dot]
+///		capturetool trace <file.stcap> [file.json]
+/// Reads version 1 and 2 capture files. The file is mapped, not read into memory: the report only keeps its counters, so captures of
+/// hundreds of MB are fine. The command lists are split over the threads, each thread replays the events of its command lists in order
+/// and the counters are merged at the end. passes groups the draws into render passes and links them, see PassGraph.h.
+
+#include "CaptureFormat.h"
+#include "MappedFile.h"
+#include "PassGraph.h"
+#include "TraceExport.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace ShaderToggler;
+
+namespace
+{
+	constexpr uint32_t MaxRenderTargetCount = 8;
+	constexpr uint32_t StageSlotCount = 32;			// a slot per pipeline_stage bit
+	constexpr uint32_t ComputeShaderSlot = std::countr_zero(CAPTURE_STAGE_COMPUTE_SHADER);
+
+	enum ShaderStageColumn
+	{
+		VertexColumn = 0,
+		PixelColumn,
+		ComputeColumn,
+	};
+
+	const char* STAGE_COLUMN_NAMES[] = { "vertex", "pixel", "compute" };
+
+
+	struct ShaderCounters
+	{
+		uint64_t drawCount = 0;
+		uint64_t dispatchCount = 0;
+		uint64_t vertexCount = 0;		// vertices or indices times instances of the direct draws
+	};
+
+
+	/// <summary>
+	/// A bind is redundant if it binds what is bound already, and unused if it's replaced before a draw or dispatch used it.
+	/// </summary>
+	struct BindCounters
+	{
+		uint64_t callCount = 0;
+		uint64_t redundantCount = 0;
+		uint64_t unusedCount = 0;
+
+		void add(const BindCounters& other)
+		{
+			callCount += other.callCount;
+			redundantCount += other.redundantCount;
+			unusedCount += other.unusedCount;
+		}
+	};
+
+
+	struct CommandListCounters
+	{
+		uint64_t eventCount = 0;
+		uint64_t drawCount = 0;
+		uint64_t dispatchCount = 0;
+		uint64_t clearCount = 0;
+		uint64_t pipelineStateCount = 0;
+		uint64_t vertexBufferCount = 0;
+		uint64_t indexBufferCount = 0;
+		uint64_t descriptorPushCount = 0;
+		BindCounters pipelineBinds;
+		BindCounters renderTargetBinds;
+		BindCounters viewportBinds;
+	};
+
+
+	/// <summary>
+	/// What is bound on a command list, replayed from its events.
+	/// </summary>
+	struct CommandListState
+	{
+		CommandListCounters counters;
+		uint64_t pipelines[StageSlotCount] = {};
+		bool isPipelineUsed[StageSlotCount] = {};
+		uint32_t vertexShaderHash = 0;
+		uint32_t pixelShaderHash = 0;
+		uint32_t computeShaderHash = 0;
+		uint32_t renderTargetCount = 0;
+		uint64_t renderTargets[MaxRenderTargetCount] = {};
+		uint64_t depthStencil = 0;
+		bool hasRenderTargets = false;
+		bool isRenderTargetUsed = true;
+		uint64_t viewportFirst = 0;
+		uint64_t viewportCount = 0;
+		bool isViewportUsed = true;
+	};
+
+
+	struct RenderTargetCounters
+	{
+		uint64_t drawCount = 0;
+		bool isDepthStencil = false;
+	};
+
+
+	/// <summary>
+	/// The counters of one thread, merged into the first one.
+	/// </summary>
+	struct CaptureReport
+	{
+		std::unordered_map<uint64_t, ShaderCounters> shaders;		// column << 32 | shader hash
+		std::unordered_map<uint64_t, CommandListState> commandLists;
+		std::unordered_map<uint64_t, RenderTargetCounters> renderTargets;
+
+		void merge(CaptureReport& other)
+		{
+			for(const auto& [key, counters] : other.shaders)
+			{
+				ShaderCounters& total = shaders[key];
+				total.drawCount += counters.drawCount;
+				total.dispatchCount += counters.dispatchCount;
+				total.vertexCount += counters.vertexCount;
+			}
+			// each command list is replayed by one thread only
+			commandLists.merge(other.commandLists);
+			for(const auto& [view, counters] : other.renderTargets)
+			{
+				RenderTargetCounters& total = renderTargets[view];
+				total.drawCount += counters.drawCount;
+				total.isDepthStencil = counters.isDepthStencil;
+			}
+		}
+	};
+
+
+	uint32_t getShardIndex(uint64_t commandList, uint32_t shardCount)
+	{
+		// the pointers are aligned, mix the bits before the modulo
+		return static_cast<uint32_t>(((commandList >> 4) * 0x9E3779B97F4A7C15ull) >> 32) % shardCount;
+	}
+
+
+	void countShaderWork(CaptureReport& report, ShaderStageColumn column, uint32_t shaderHash, bool isDispatch, uint64_t vertexCount)
+	{
+		ShaderCounters& counters = report.shaders[static_cast<uint64_t>(column) << 32 | shaderHash];
+		if(isDispatch)
+		{
+			counters.dispatchCount++;
+		}
+		else
+		{
+			counters.drawCount++;
+			counters.vertexCount += vertexCount;
+		}
+	}
+
+
+	void countDraw(CaptureReport& report, CommandListState& state, uint64_t vertexCount)
+	{
+		state.counters.drawCount++;
+		countShaderWork(report, VertexColumn, state.vertexShaderHash, false, vertexCount);
+		countShaderWork(report, PixelColumn, state.pixelShaderHash, false, vertexCount);
+		for(uint32_t slot = 0; slot < StageSlotCount; ++slot)
+		{
+			if(slot != ComputeShaderSlot)
+			{
+				state.isPipelineUsed[slot] = true;
+			}
+		}
+		state.isRenderTargetUsed = true;
+		state.isViewportUsed = true;
+		for(uint32_t index = 0; index < state.renderTargetCount; ++index)
+		{
+			if(state.renderTargets[index] != 0)
+			{
+				report.renderTargets[state.renderTargets[index]].drawCount++;
+			}
+		}
+		if(state.depthStencil != 0)
+		{
+			RenderTargetCounters& counters = report.renderTargets[state.depthStencil];
+			counters.drawCount++;
+			counters.isDepthStencil = true;
+		}
+	}
+
+
+	void countDispatch(CaptureReport& report, CommandListState& state)
+	{
+		state.counters.dispatchCount++;
+		countShaderWork(report, ComputeColumn, state.computeShaderHash, true, 0);
+		state.isPipelineUsed[ComputeShaderSlot] = true;
+	}
+
+
+	void bindPipeline(CommandListState& state, const uint64_t* args)
+	{
+		BindCounters& binds = state.counters.pipelineBinds;
+		binds.callCount++;
+		uint64_t stages = args[0] & 0xFFFFFFFF;
+		bool isRedundant = stages != 0;
+		bool isUnused = false;
+		while(stages != 0)
+		{
+			const uint32_t slot = std::countr_zero(stages);
+			stages &= stages - 1;
+			isRedundant &= state.pipelines[slot] == args[2];
+			// the first bind of a slot in the capture can't have replaced an unused one
+			isUnused |= state.pipelines[slot] != 0 && !state.isPipelineUsed[slot];
+			state.pipelines[slot] = args[2];
+			state.isPipelineUsed[slot] = false;
+		}
+		binds.redundantCount += isRedundant ? 1 : 0;
+		binds.unusedCount += isUnused && !isRedundant ? 1 : 0;
+
+		// version 1 files and separate shader pipelines only have the one hash of the bound stage
+		const bool hasStageHashes = args[3] != 0 || args[4] != 0;
+		if(args[0] & CAPTURE_STAGE_VERTEX_SHADER)
+		{
+			state.vertexShaderHash = static_cast<uint32_t>(hasStageHashes ? args[4] : args[1]);
+		}
+		if(args[0] & CAPTURE_STAGE_PIXEL_SHADER)
+		{
+			state.pixelShaderHash = static_cast<uint32_t>(hasStageHashes ? args[3] : args[1]);
+		}
+		if(args[0] & CAPTURE_STAGE_COMPUTE_SHADER)
+		{
+			state.computeShaderHash = static_cast<uint32_t>(args[1]);
+		}
+	}
+
+
+	void bindRenderTargets(CommandListState& state, const uint64_t* args)
+	{
+		BindCounters& binds = state.counters.renderTargetBinds;
+		binds.callCount++;
+		const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(args[0], MaxRenderTargetCount));
+		uint64_t renderTargets[MaxRenderTargetCount] = {};
+		for(uint32_t index = 0; index < 3; ++index)
+		{
+			renderTargets[index] = args[2 + index];
+		}
+		// the render targets past the third are in the continued events: those binds aren't compared
+		const bool isRedundant = state.hasRenderTargets && count == state.renderTargetCount && args[1] == state.depthStencil &&
+			std::equal(renderTargets, renderTargets + std::min(count, 3u), state.renderTargets) && count <= 3;
+		binds.redundantCount += isRedundant ? 1 : 0;
+		binds.unusedCount += state.hasRenderTargets && !state.isRenderTargetUsed && !isRedundant ? 1 : 0;
+		state.renderTargetCount = count;
+		state.depthStencil = args[1];
+		std::copy(renderTargets, renderTargets + MaxRenderTargetCount, state.renderTargets);
+		state.hasRenderTargets = true;
+		state.isRenderTargetUsed = false;
+	}
+
+
+	void bindViewports(CommandListState& state, const uint64_t* args)
+	{
+		// the viewports themselves aren't captured: only a bind replaced before a draw is known to be wasted
+		BindCounters& binds = state.counters.viewportBinds;
+		binds.callCount++;
+		binds.unusedCount += !state.isViewportUsed && args[0] == state.viewportFirst && args[1] == state.viewportCount ? 1 : 0;
+		state.viewportFirst = args[0];
+		state.viewportCount = args[1];
+		state.isViewportUsed = false;
+	}
+
+
+	/// <summary>
+	/// Replays the events of the command lists of one shard.
+	/// </summary>
+	void aggregateShard(const CaptureEvent* events, size_t eventCount, uint32_t shardIndex, uint32_t shardCount, CaptureReport& report)
+	{
+		for(size_t eventIndex = 0; eventIndex < eventCount; ++eventIndex)
+		{
+			const CaptureEvent& event = events[eventIndex];
+			if(event.eventId == CaptureEventId::FrameBegin || event.eventId == CaptureEventId::FrameEnd || getShardIndex(event.commandList, shardCount) != shardIndex)
+			{
+				continue;
+			}
+			CommandListState& state = report.commandLists[event.commandList];
+			CommandListCounters& counters = state.counters;
+			const uint64_t* args = event.args;
+			counters.eventCount++;
+			switch(event.eventId)
+			{
+			case CaptureEventId::BindPipeline:
+				bindPipeline(state, args);
+				break;
+			case CaptureEventId::BindRenderTargets:
+				bindRenderTargets(state, args);
+				break;
+			case CaptureEventId::BindRenderTargetsContinued:
+				for(uint64_t index = 0; index < 4; ++index)
+				{
+					if(args[0] + index < MaxRenderTargetCount)
+					{
+						state.renderTargets[args[0] + index] = args[1 + index];
+					}
+				}
+				break;
+			case CaptureEventId::BindViewports:
+				bindViewports(state, args);
+				break;
+			case CaptureEventId::Draw:
+				countDraw(report, state, args[0] * args[1]);
+				break;
+			case CaptureEventId::DrawIndexed:
+				countDraw(report, state, args[0] * args[1]);
+				break;
+			case CaptureEventId::DrawOrDispatchIndirect:
+				// reshade::api::indirect_command: draw, draw_indexed, then the dispatches
+				if(args[0] >= 3)
+				{
+					countDispatch(report, state);
+				}
+				else
+				{
+					countDraw(report, state, 0);
+				}
+				break;
+			case CaptureEventId::Dispatch:
+				countDispatch(report, state);
+				break;
+			case CaptureEventId::ClearRenderTargetView:
+			case CaptureEventId::ClearDepthStencilView:
+				counters.clearCount++;
+				break;
+			case CaptureEventId::BindPipelineState:
+				counters.pipelineStateCount++;
+				break;
+			case CaptureEventId::BindVertexBuffer:
+				counters.vertexBufferCount++;
+				break;
+			case CaptureEventId::BindIndexBuffer:
+				counters.indexBufferCount++;
+				break;
+			case CaptureEventId::PushDescriptors:
+				counters.descriptorPushCount++;
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+
+	template<typename Map, typename Compare>
+	std::vector<typename Map::const_iterator> sortEntries(const Map& map, Compare compare)
+	{
+		std::vector<typename Map::const_iterator> entries;
+		entries.reserve(map.size());
+		for(auto entry = map.begin(); entry != map.end(); ++entry)
+		{
+			entries.push_back(entry);
+		}
+		// ties by key, so the report doesn't depend on the thread count
+		std::sort(entries.begin(), entries.end(), [&compare](const auto& a, const auto& b)
+			{
+				return compare(a->second, b->second) || (!compare(b->second, a->second) && a->first < b->first);
+			});
+		return entries;
+	}
+
+
+	void printBindCounters(const char* name, const BindCounters& binds, bool hasRedundant)
+	{
+		if(hasRedundant)
+		{
+			printf("%-40s  %10" PRIu64 "  %10" PRIu64 "  %10" PRIu64 "\n", name, binds.callCount, binds.redundantCount, binds.unusedCount);
+		}
+		else
+		{
+			printf("%-40s  %10" PRIu64 "  %10s  %10" PRIu64 "\n", name, binds.callCount, "-", binds.unusedCount);
+		}
+	}
+
+
+	void printReport(const CaptureFileHeader& header, const CaptureEvent* events, size_t eventCount, const CaptureReport& report, size_t topCount)
+	{
+		uint32_t frameCount = 0;
+		for(size_t eventIndex = 0; eventIndex < eventCount; ++eventIndex)
+		{
+			frameCount += events[eventIndex].eventId == CaptureEventId::FrameBegin ? 1 : 0;
+		}
+		const double durationMilliseconds = eventCount > 1 && header.ticksPerSecond != 0 ?
+			static_cast<double>(events[eventCount - 1].timestamp - events[0].timestamp) * 1000.0 / static_cast<double>(header.ticksPerSecond) : 0.0;
+		printf("version %u, capture %u (%s), %zu events, %" PRIu64 " dropped, %u threads, %u frames (%u before the trigger), %.3f ms\n\n", header.version,
+			   header.captureIndex, getCaptureTriggerName(header.trigger), eventCount, header.droppedEventCount, header.threadCount, frameCount,
+			   header.preTriggerFrameCount, durationMilliseconds);
+
+		printf("shaders by draws and dispatches (hash 0x00000000: not known to the addon)\n");
+		printf("%-10s  %-8s  %10s  %10s  %14s\n", "hash", "stage", "draws", "dispatches", "vertices");
+		const auto shaders = sortEntries(report.shaders, [](const ShaderCounters& a, const ShaderCounters& b) { return a.drawCount + a.dispatchCount > b.drawCount + b.dispatchCount; });
+		for(size_t index = 0; index < shaders.size() && index < topCount; ++index)
+		{
+			const ShaderCounters& counters = shaders[index]->second;
+			printf("0x%08X  %-8s  %10" PRIu64 "  %10" PRIu64 "  %14" PRIu64 "\n", static_cast<uint32_t>(shaders[index]->first), STAGE_COLUMN_NAMES[shaders[index]->first >> 32],
+				   counters.drawCount, counters.dispatchCount, counters.vertexCount);
+		}
+		if(shaders.size() > topCount)
+		{
+			printf("... %zu more\n", shaders.size() - topCount);
+		}
+
+		BindCounters pipelineBinds;
+		BindCounters renderTargetBinds;
+		BindCounters viewportBinds;
+		for(const auto& [commandList, state] : report.commandLists)
+		{
+			pipelineBinds.add(state.counters.pipelineBinds);
+			renderTargetBinds.add(state.counters.renderTargetBinds);
+			viewportBinds.add(state.counters.viewportBinds);
+		}
+		printf("\nbinds (redundant: binds what is bound already, unused: replaced before a draw or dispatch)\n");
+		printf("%-40s  %10s  %10s  %10s\n", "call", "calls", "redundant", "unused");
+		printBindCounters("bind_pipeline", pipelineBinds, true);
+		printBindCounters("bind_render_targets_and_depth_stencil", renderTargetBinds, true);
+		printBindCounters("bind_viewports", viewportBinds, false);
+
+		printf("\nstate changes per command list\n");
+		printf("%-18s  %10s  %8s  %10s  %9s  %9s  %9s  %8s  %8s  %8s  %11s  %6s\n", "command list", "events", "draws", "dispatches", "pipelines", "rt binds", "viewports",
+			   "states", "vbuffers", "ibuffers", "descriptors", "clears");
+		const auto commandLists = sortEntries(report.commandLists, [](const CommandListState& a, const CommandListState& b) { return a.counters.eventCount > b.counters.eventCount; });
+		for(size_t index = 0; index < commandLists.size() && index < topCount; ++index)
+		{
+			const CommandListCounters& counters = commandLists[index]->second.counters;
+			printf("0x%016" PRIx64 "  %10" PRIu64 "  %8" PRIu64 "  %10" PRIu64 "  %9" PRIu64 "  %9" PRIu64 "  %9" PRIu64 "  %8" PRIu64 "  %8" PRIu64 "  %8" PRIu64 "  %11" PRIu64 "  %6" PRIu64 "\n",
+				   commandLists[index]->first, counters.eventCount, counters.drawCount, counters.dispatchCount, counters.pipelineBinds.callCount, counters.renderTargetBinds.callCount,
+				   counters.viewportBinds.callCount, counters.pipelineStateCount, counters.vertexBufferCount, counters.indexBufferCount, counters.descriptorPushCount, counters.clearCount);
+		}
+		if(commandLists.size() > topCount)
+		{
+			printf("... %zu more\n", commandLists.size() - topCount);
+		}
+
+		printf("\nrender targets by draws\n");
+		printf("%-18s  %-4s  %10s\n", "view", "kind", "draws");
+		const auto renderTargets = sortEntries(report.renderTargets, [](const RenderTargetCounters& a, const RenderTargetCounters& b) { return a.drawCount > b.drawCount; });
+		for(size_t index = 0; index < renderTargets.size() && index < topCount; ++index)
+		{
+			printf("0x%016" PRIx64 "  %-4s  %10" PRIu64 "\n", renderTargets[index]->first, renderTargets[index]->second.isDepthStencil ? "dsv" : "rtv", renderTargets[index]->second.drawCount);
+		}
+		if(renderTargets.size() > topCount)
+		{
+			printf("... %zu more\n", renderTargets.size() - topCount);
+		}
+	}
+
+
+	int printUsage()
+	{
+		fprintf(stderr, "usage:\n  capturetool report <file.stcap> [--top N] [--threads N]\n  capturetool passes <file.stcap> [--overdraw N] [--dot file.dot]\n"
+				"  capturetool trace <file.stcap> [file.json]\n");
+		return 1;
+	}
+
+
+	/// <summary>
+	/// Maps a capture file and checks its header. A file cut short keeps its complete events.
+	/// </summary>
+	bool openCapture(const char* fileName, MappedFile& captureFile, CaptureFileHeader& header, const CaptureEvent*& events, size_t& eventCount)
+	{
+		if(!captureFile.open(fileName) || captureFile.size() < sizeof(CaptureFileHeader))
+		{
+			fprintf(stderr, "%s: can't read the file\n", fileName);
+			return false;
+		}
+		std::memcpy(&header, captureFile.data(), sizeof(header));
+		if(header.magic != CAPTURE_FILE_MAGIC || header.version == 0 || header.version > CAPTURE_FILE_VERSION)
+		{
+			fprintf(stderr, "%s: not a capture file of version 1 to %u\n", fileName, CAPTURE_FILE_VERSION);
+			return false;
+		}
+		if(header.version < 2)
+		{
+			header.trigger = CaptureTrigger::Key;
+			header.preTriggerFrameCount = 0;
+			header.frameCount = 1;
+		}
+		const size_t storedEventCount = (captureFile.size() - sizeof(CaptureFileHeader)) / sizeof(CaptureEvent);
+		eventCount = static_cast<size_t>(header.eventCount);
+		if(storedEventCount < eventCount)
+		{
+			fprintf(stderr, "%s: %" PRIu64 " events in the header, the file has %zu\n", fileName, header.eventCount, storedEventCount);
+			eventCount = storedEventCount;
+		}
+		// the header is 48 bytes and the mapping page aligned, the events are read in place
+		events = reinterpret_cast<const CaptureEvent*>(captureFile.data() + sizeof(CaptureFileHeader));
+		return true;
+	}
+
+
+	int reportCapture(const CaptureFileHeader& header, const CaptureEvent* events, size_t eventCount, size_t topCount, uint32_t threadCount)
+	{
+		const auto startTime = std::chrono::steady_clock::now();
+		std::vector<CaptureReport> reports(threadCount);
+		std::vector<std::thread> threads;
+		for(uint32_t threadIndex = 1; threadIndex < threadCount; ++threadIndex)
+		{
+			threads.emplace_back(aggregateShard, events, eventCount, threadIndex, threadCount, std::ref(reports[threadIndex]));
+		}
+		aggregateShard(events, eventCount, 0, threadCount, reports[0]);
+		for(auto& thread : threads)
+		{
+			thread.join();
+		}
+		for(uint32_t threadIndex = 1; threadIndex < threadCount; ++threadIndex)
+		{
+			reports[0].merge(reports[threadIndex]);
+		}
+		const double aggregateMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		printReport(header, events, eventCount, reports[0], topCount);
+		fflush(stdout);
+		fprintf(stderr, "\naggregated %zu events on %u threads in %.1f ms\n", eventCount, threadCount, aggregateMilliseconds);
+		return 0;
+	}
+
+
+	void printResources(const char* name, const std::vector<uint64_t>& resources)
+	{
+		printf("  %-8s", name);
+		for(const uint64_t resource : resources)
+		{
+			printf(" 0x%" PRIx64, resource);
+		}
+		printf("\n");
+	}
+
+
+	int reportPasses(const CaptureEvent* events, size_t eventCount, const PassGraphSettings& settings, const char* dotFileName)
+	{
+		PassGraph graph;
+		graph.build(events, eventCount, settings);
+		const std::vector<RenderPass>& passes = graph.getPasses();
+		const std::vector<PassEdge>& edges = graph.getEdges();
+		printf("%zu passes, %zu links\n", passes.size(), edges.size());
+		for(uint32_t passIndex = 0; passIndex < passes.size(); ++passIndex)
+		{
+			const RenderPass& pass = passes[passIndex];
+			printf("\n#%u %s, command list 0x%" PRIx64 ", %u %s%s\n", passIndex, pass.isCompute ? "compute" : "graphics", pass.commandList,
+				   pass.isCompute ? pass.dispatchCount : pass.drawCount, pass.isCompute ? "dispatches" : "draws", pass.isConsumed ? "" : ", output not consumed");
+			printResources("writes", pass.outputs);
+			printResources("reads", pass.inputs);
+			for(const PassEdge& edge : edges)
+			{
+				if(edge.to == passIndex)
+				{
+					printf("  %-8s #%u 0x%" PRIx64 "\n", edge.kind == PassEdge::Kind::Read ? "after" : "loads", edge.from, edge.resource);
+				}
+			}
+		}
+
+		const std::vector<uint32_t> overdrawCandidates = graph.getOverdrawCandidates();
+		printf("\noverdraw candidates (no depth stencil, %u draws or more): %zu\n", settings.overdrawDrawCount, overdrawCandidates.size());
+		for(const uint32_t passIndex : overdrawCandidates)
+		{
+			printf("  #%u, %u draws\n", passIndex, passes[passIndex].drawCount);
+		}
+		const std::vector<EmptyClear>& emptyClears = graph.getEmptyClears();
+		printf("\nempty clears (cleared again or the capture ended before anything used them): %zu\n", emptyClears.size());
+		const int64_t firstTimestamp = eventCount > 0 ? events[0].timestamp : 0;
+		for(const EmptyClear& clear : emptyClears)
+		{
+			printf("  %s 0x%" PRIx64 ", command list 0x%" PRIx64 ", at tick %" PRId64 "\n", clear.isDepthStencil ? "dsv" : "rtv", clear.resource, clear.commandList,
+				   clear.timestamp - firstTimestamp);
+		}
+		const std::vector<uint32_t> unconsumedPasses = graph.getUnconsumedPasses();
+		printf("\npasses whose output is never consumed (the back buffer passes of the last frame are expected): %zu\n", unconsumedPasses.size());
+		for(const uint32_t passIndex : unconsumedPasses)
+		{
+			printf("  #%u\n", passIndex);
+		}
+
+		if(nullptr != dotFileName)
+		{
+			FILE* dotFile = fopen(dotFileName, "w");
+			if(nullptr == dotFile)
+			{
+				fprintf(stderr, "%s: can't write the file\n", dotFileName);
+				return 1;
+			}
+			graph.writeDot(dotFile);
+			fclose(dotFile);
+		}
+		return 0;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	if(argc < 3)
+	{
+		return printUsage();
+	}
+	MappedFile captureFile;
+	CaptureFileHeader header;
+	const CaptureEvent* events = nullptr;
+	size_t eventCount = 0;
+	if(strcmp(argv[1], "report") == 0)
+	{
+		size_t topCount = 20;
+		uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+		for(int argIndex = 3; argIndex + 1 < argc; argIndex += 2)
+		{
+			if(strcmp(argv[argIndex], "--top") == 0)
+			{
+				topCount = strtoull(argv[argIndex + 1], nullptr, 10);
+			}
+			else if(strcmp(argv[argIndex], "--threads") == 0)
+			{
+				threadCount = std::clamp<uint32_t>(static_cast<uint32_t>(strtoul(argv[argIndex + 1], nullptr, 10)), 1, 256);
+			}
+			else
+			{
+				return printUsage();
+			}
+		}
+		if(!openCapture(argv[2], captureFile, header, events, eventCount))
+		{
+			return 1;
+		}
+		return reportCapture(header, events, eventCount, topCount, threadCount);
+	}
+	if(strcmp(argv[1], "passes") == 0)
+	{
+		PassGraphSettings settings;
+		const char* dotFileName = nullptr;
+		for(int argIndex = 3; argIndex + 1 < argc; argIndex += 2)
+		{
+			if(strcmp(argv[argIndex], "--overdraw") == 0)
+			{
+				settings.overdrawDrawCount = static_cast<uint32_t>(strtoul(argv[argIndex + 1], nullptr, 10));
+			}
+			else if(strcmp(argv[argIndex], "--dot") == 0)
+			{
+				dotFileName = argv[argIndex + 1];
+			}
+			else
+			{
+				return printUsage();
+			}
+		}
+		if(!openCapture(argv[2], captureFile, header, events, eventCount))
+		{
+			return 1;
+		}
+		return reportPasses(events, eventCount, settings, dotFileName);
+	}
+	if(strcmp(argv[1], "trace") == 0)
+	{
+		if(!openCapture(argv[2], captureFile, header, events, eventCount))
+		{
+			return 1;
+		}
+		std::filesystem::path traceFileName = argc >= 4 ? std::filesystem::path(argv[3]) : std::filesystem::path(argv[2]).replace_extension(".json");
+		if(!writeChromeTrace(traceFileName, header, events, eventCount))
+		{
+			fprintf(stderr, "%s: can't write the trace\n", traceFileName.string().c_str());
+			return 1;
+		}
+		printf("%s: %zu events\n", traceFileName.string().c_str(), eventCount);
+		return 0;
+	}
+	return printUsage();
+}
@@ -0,0 +1,193 @@
+/// measures loading a large ShaderToggler.ini: CDataFile::Load and the key lookups ToggleGroup::loadState does on it.
+/// build on linux: g++ -std=c++20 -O2 -I.. IniLoadBenchmark.cpp ../CDataFile.cpp ../MappedFile.cpp -o iniloadbenchmark
+/// usage:
+///		iniloadbenchmark [<folder>] [--groups N] [--hashes N] [--runs N]
+/// Writes <folder>/IniLoadBenchmark.ini with --groups toggle groups of --hashes pixel shader hashes each, in the legacy format: one
+/// ShaderHash<i> key per hash, which is what made the linear key scans quadratic. The file is written by CDataFile like the addon writes it.
+/// Then loads it --runs times, each time timing Load and the lookups of loadShaderTogglerConfig and ToggleGroup::loadState (a
+/// GetValue("Hashes") for the packed list, AmountHashes and every ShaderHash<i> of the three stages, the name, toggle key and startup
+/// state of the group), and prints the best run. Returns 1 if the hashes read back aren't the ones written.
+
+#include "CDataFile.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace
+{
+	const char* const StageSections[] = { "_VertexShaders", "_PixelShaders", "_ComputeShaders" };
+
+
+	uint32_t getHash(int groupIndex, int hashIndex)
+	{
+		// an odd multiplier is a bijection, the hashes of a group are distinct
+		return static_cast<uint32_t>(hashIndex) * 2654435761u + static_cast<uint32_t>(groupIndex) * 40503u;
+	}
+
+
+	double getMilliseconds(std::chrono::steady_clock::time_point startTime)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+
+	bool writeIni(const std::string& fileName, int groupCount, int hashCount)
+	{
+		CDataFile iniFile;
+		iniFile.SetInt("AmountGroups", groupCount, "", "General");
+		for(int groupIndex = 0; groupIndex < groupCount; ++groupIndex)
+		{
+			const std::string sectionRoot = "Group" + std::to_string(groupIndex);
+			iniFile.SetUInt("AmountHashes", 0, "", sectionRoot + "_VertexShaders");
+			iniFile.SetUInt("AmountHashes", static_cast<uint32_t>(hashCount), "", sectionRoot + "_PixelShaders");
+			for(int hashIndex = 0; hashIndex < hashCount; ++hashIndex)
+			{
+				iniFile.SetUInt("ShaderHash" + std::to_string(hashIndex), getHash(groupIndex, hashIndex), "", sectionRoot + "_PixelShaders");
+			}
+			iniFile.SetUInt("AmountHashes", 0, "", sectionRoot + "_ComputeShaders");
+			iniFile.SetValue("Name", "Group " + std::to_string(groupIndex), "", sectionRoot);
+			iniFile.SetUInt("ToggleKey", 0x14, "", sectionRoot);
+			iniFile.SetBool("IsActiveAtStartup", false, "", sectionRoot);
+		}
+		iniFile.SetFileName(fileName);
+		return iniFile.Save();
+	}
+
+
+	/// <summary>
+	/// The lookups of loadShaderTogglerConfig and ToggleGroup::loadState, legacy path. Returns the sum of the hashes read, hashCount how many.
+	/// </summary>
+	uint64_t readGroups(CDataFile& iniFile, uint64_t& hashCount)
+	{
+		uint64_t hashSum = 0;
+		hashCount = 0;
+		const int groupCount = iniFile.GetInt("AmountGroups", "General");
+		for(int groupIndex = 0; groupIndex < groupCount; ++groupIndex)
+		{
+			const std::string sectionRoot = "Group" + std::to_string(groupIndex);
+			for(const char* stageSection : StageSections)
+			{
+				const std::string section = sectionRoot + stageSection;
+				if(iniFile.GetValue("Hashes", section).size() > 0)
+				{
+					continue;
+				}
+				const int amount = iniFile.GetInt("AmountHashes", section);
+				for(int i = 0; i < amount; i++)
+				{
+					const uint32_t hash = iniFile.GetUInt("ShaderHash" + std::to_string(i), section);
+					if(hash != UINT_MAX)
+					{
+						hashSum += hash;
+						++hashCount;
+					}
+				}
+			}
+			hashSum += iniFile.GetValue("Name", sectionRoot).size();
+			hashSum += iniFile.GetUInt("ToggleKey", sectionRoot);
+			hashSum += iniFile.GetBool("IsActiveAtStartup", sectionRoot) ? 1 : 0;
+		}
+		return hashSum;
+	}
+
+
+	int printUsage()
+	{
+		fprintf(stderr, "usage:\n"
+				"\tiniloadbenchmark [<folder>] [--groups N] [--hashes N] [--runs N]\n"
+				"\t\t<folder> gets IniLoadBenchmark.ini, the current folder if not given.\n"
+				"\t\t--groups: toggle groups, default 100.\n"
+				"\t\t--hashes: pixel shader hashes per group, default 2000.\n"
+				"\t\t--runs: loads timed, the best is printed, default 5.\n");
+		return 1;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path folder = ".";
+	int groupCount = 100;
+	int hashCount = 2000;
+	int runCount = 5;
+	for(int argIndex = 1; argIndex < argc; ++argIndex)
+	{
+		if(strcmp(argv[argIndex], "--groups") == 0 && argIndex + 1 < argc)
+		{
+			groupCount = std::clamp(atoi(argv[++argIndex]), 1, 10000);
+		}
+		else if(strcmp(argv[argIndex], "--hashes") == 0 && argIndex + 1 < argc)
+		{
+			hashCount = std::clamp(atoi(argv[++argIndex]), 1, 100000);
+		}
+		else if(strcmp(argv[argIndex], "--runs") == 0 && argIndex + 1 < argc)
+		{
+			runCount = std::clamp(atoi(argv[++argIndex]), 1, 100);
+		}
+		else if(argv[argIndex][0] == '-')
+		{
+			return printUsage();
+		}
+		else
+		{
+			folder = argv[argIndex];
+		}
+	}
+	std::error_code ec;
+	std::filesystem::create_directories(folder, ec);
+	const std::string fileName = (folder / "IniLoadBenchmark.ini").string();
+
+	auto startTime = std::chrono::steady_clock::now();
+	if(!writeIni(fileName, groupCount, hashCount))
+	{
+		fprintf(stderr, "Can't write %s\n", fileName.c_str());
+		return 1;
+	}
+	const double writeMilliseconds = getMilliseconds(startTime);
+
+	uint64_t expectedSum = 0;
+	for(int groupIndex = 0; groupIndex < groupCount; ++groupIndex)
+	{
+		for(int hashIndex = 0; hashIndex < hashCount; ++hashIndex)
+		{
+			expectedSum += getHash(groupIndex, hashIndex);
+		}
+		expectedSum += ("Group " + std::to_string(groupIndex)).size() + 0x14;
+	}
+
+	double loadMilliseconds = 1e30;
+	double lookupMilliseconds = 1e30;
+	bool isValid = true;
+	int keyCount = 0;
+	for(int run = 0; run < runCount; ++run)
+	{
+		CDataFile iniFile;
+		startTime = std::chrono::steady_clock::now();
+		if(!iniFile.Load(fileName))
+		{
+			fprintf(stderr, "Can't load %s\n", fileName.c_str());
+			return 1;
+		}
+		loadMilliseconds = std::min(loadMilliseconds, getMilliseconds(startTime));
+		startTime = std::chrono::steady_clock::now();
+		uint64_t readCount = 0;
+		const uint64_t hashSum = readGroups(iniFile, readCount);
+		lookupMilliseconds = std::min(lookupMilliseconds, getMilliseconds(startTime));
+		isValid &= hashSum == expectedSum && readCount == static_cast<uint64_t>(groupCount) * hashCount;
+		keyCount = iniFile.KeyCount();
+	}
+
+	printf("%d groups x %d hashes, %d keys, %llu bytes, written in %.1f ms\n", groupCount, hashCount, keyCount,
+		   static_cast<unsigned long long>(std::filesystem::file_size(fileName, ec)), writeMilliseconds);
+	printf("best of %d: Load %.1f ms, loadState lookups %.1f ms\n", runCount, loadMilliseconds, lookupMilliseconds);
+	if(!isValid)
+	{
+		fprintf(stderr, "the hashes read back aren't the ones written\n");
+	}
+	return isValid ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/// measures the parse throughput of CDataFile::Load and the allocations it makes, and checks Load + Save gives the file back unchanged.
+/// build on linux: g++ -std=c++20 -O2 -I.. IniParseBenchmark.cpp ../CDataFile.cpp ../MappedFile.cpp ../ShaderHashList.cpp -o iniparsebenchmark
+/// usage:
+///		iniparsebenchmark [<folder>] [--groups N] [--hashes N] [--runs N]
+/// Writes two ShaderToggler.ini files into <folder> with CDataFile, like the addon writes them: IniParseLegacy.ini with one ShaderHash<i>
+/// key per hash, and IniParsePacked.ini with the hashes of a section in one packed Hashes key (see ShaderHashList.h). Each has --groups
+/// groups of --hashes pixel shader hashes and 50 vertex shader hashes. Load is timed --runs times per file, the best run is printed in ms
+/// and MB/s. The allocations made by Load are counted by the operator new below. Last, every file is loaded and saved over itself, which has
+/// to give the same bytes. Returns 1 if a file can't be written or loaded, or changed on the save.
+
+#include "CDataFile.h"
+#include "ShaderHashList.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace ShaderToggler;
+
+namespace
+{
+	constexpr int VertexShaderHashCount = 50;
+
+	uint64_t g_allocationCount = 0;
+
+
+	std::unordered_set<uint32_t> getHashes(int groupIndex, int hashCount, uint32_t stageSeed)
+	{
+		std::unordered_set<uint32_t> hashes;
+		hashes.reserve(hashCount);
+		for(int hashIndex = 0; hashIndex < hashCount; ++hashIndex)
+		{
+			hashes.insert(static_cast<uint32_t>(hashIndex) * 2654435761u + static_cast<uint32_t>(groupIndex) * 40503u + stageSeed);
+		}
+		return hashes;
+	}
+
+
+	void setHashes(CDataFile& iniFile, const std::string& section, const std::unordered_set<uint32_t>& hashes, bool writeLegacyHashKeys)
+	{
+		iniFile.SetUInt("AmountHashes", static_cast<uint32_t>(hashes.size()), "", section);
+		if(!writeLegacyHashKeys)
+		{
+			iniFile.SetValue("Hashes", encodeShaderHashList(hashes), "", section);
+			return;
+		}
+		int counter = 0;
+		for(const uint32_t hash : hashes)
+		{
+			iniFile.SetUInt("ShaderHash" + std::to_string(counter), hash, "", section);
+			counter++;
+		}
+	}
+
+
+	/// <summary>
+	/// Writes the groups the way saveShaderTogglerIniFile and ToggleGroup::saveSnapshot do.
+	/// </summary>
+	bool writeIni(const std::string& fileName, int groupCount, int hashCount, bool writeLegacyHashKeys)
+	{
+		CDataFile iniFile;
+		iniFile.SetInt("AmountGroups", groupCount, "", "General");
+		iniFile.SetBool("WriteLegacyHashKeys", writeLegacyHashKeys, "", "General");
+		iniFile.SetSectionComment("General", "written by iniparsebenchmark");
+		for(int groupIndex = 0; groupIndex < groupCount; ++groupIndex)
+		{
+			const std::string sectionRoot = "Group" + std::to_string(groupIndex);
+			setHashes(iniFile, sectionRoot + "_VertexShaders", getHashes(groupIndex, VertexShaderHashCount, 0x9E3779B9u), writeLegacyHashKeys);
+			setHashes(iniFile, sectionRoot + "_PixelShaders", getHashes(groupIndex, hashCount, 0), writeLegacyHashKeys);
+			iniFile.SetUInt("AmountHashes", 0, "", sectionRoot + "_ComputeShaders");
+			iniFile.SetValue("Name", "Group " + std::to_string(groupIndex), "", sectionRoot);
+			iniFile.SetUInt("ToggleKey", 0x14, "", sectionRoot);
+			iniFile.SetBool("IsActiveAtStartup", false, "", sectionRoot);
+		}
+		iniFile.SetFileName(fileName);
+		return iniFile.Save();
+	}
+
+
+	bool readFile(const std::string& fileName, std::string& content)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if(!file.is_open())
+		{
+			return false;
+		}
+		content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+
+	/// <summary>
+	/// Times Load on fileName runCount times and prints the best run. Returns false if the file can't be loaded or Load + Save changes it.
+	/// </summary>
+	bool measureFile(const std::string& fileName, int runCount)
+	{
+		std::string original;
+		if(!readFile(fileName, original))
+		{
+			fprintf(stderr, "Can't read %s\n", fileName.c_str());
+			return false;
+		}
+		double bestMilliseconds = 1e30;
+		uint64_t allocationCount = 0;
+		int keyCount = 0;
+		for(int run = 0; run < runCount; ++run)
+		{
+			CDataFile iniFile;
+			const uint64_t firstAllocation = g_allocationCount;
+			const auto startTime = std::chrono::steady_clock::now();
+			if(!iniFile.Load(fileName))
+			{
+				fprintf(stderr, "Can't load %s\n", fileName.c_str());
+				return false;
+			}
+			bestMilliseconds = std::min(bestMilliseconds, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+			allocationCount = g_allocationCount - firstAllocation;
+			keyCount = iniFile.KeyCount();
+		}
+
+		// saved over the file it was loaded from, Save writes it again in full. The constructor loads the file and keeps its name for Save.
+		bool isUnchanged = false;
+		{
+			CDataFile iniFile(fileName);
+			std::string saved;
+			isUnchanged = iniFile.Save() && readFile(fileName, saved) && saved == original;
+		}
+
+		const double megabytes = static_cast<double>(original.size()) / 1e6;
+		printf("%-20s %6.2f MB, %7d keys: Load %8.2f ms, %7.1f MB/s, %8llu allocations, Load + Save %s\n",
+			   std::filesystem::path(fileName).filename().string().c_str(), megabytes, keyCount, bestMilliseconds,
+			   megabytes / (bestMilliseconds / 1000.0), static_cast<unsigned long long>(allocationCount), isUnchanged ? "unchanged" : "CHANGED");
+		return isUnchanged;
+	}
+
+
+	int printUsage()
+	{
+		fprintf(stderr, "usage:\n"
+				"\tiniparsebenchmark [<folder>] [--groups N] [--hashes N] [--runs N]\n"
+				"\t\t<folder> gets IniParseLegacy.ini and IniParsePacked.ini, the current folder if not given.\n"
+				"\t\t--groups: toggle groups, default 100.\n"
+				"\t\t--hashes: pixel shader hashes per group, default 2000.\n"
+				"\t\t--runs: loads timed per file, the best is printed, default 5.\n");
+		return 1;
+	}
+}
+
+
+void* operator new(size_t size)
+{
+	++g_allocationCount;
+	if(void* memory = malloc(size != 0 ? size : 1))
+	{
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path folder = ".";
+	int groupCount = 100;
+	int hashCount = 2000;
+	int runCount = 5;
+	for(int argIndex = 1; argIndex < argc; ++argIndex)
+	{
+		if(strcmp(argv[argIndex], "--groups") == 0 && argIndex + 1 < argc)
+		{
+			groupCount = std::clamp(atoi(argv[++argIndex]), 1, 10000);
+		}
+		else if(strcmp(argv[argIndex], "--hashes") == 0 && argIndex + 1 < argc)
+		{
+			hashCount = std::clamp(atoi(argv[++argIndex]), 1, 100000);
+		}
+		else if(strcmp(argv[argIndex], "--runs") == 0 && argIndex + 1 < argc)
+		{
+			runCount = std::clamp(atoi(argv[++argIndex]), 1, 100);
+		}
+		else if(argv[argIndex][0] == '-')
+		{
+			return printUsage();
+		}
+		else
+		{
+			folder = argv[argIndex];
+		}
+	}
+	std::error_code ec;
+	std::filesystem::create_directories(folder, ec);
+
+	bool isValid = true;
+	for(const bool writeLegacyHashKeys : { true, false })
+	{
+		const std::string fileName = (folder / (writeLegacyHashKeys ? "IniParseLegacy.ini" : "IniParsePacked.ini")).string();
+		if(!writeIni(fileName, groupCount, hashCount, writeLegacyHashKeys))
+		{
+			fprintf(stderr, "Can't write %s\n", fileName.c_str());
+			return 1;
+		}
+		isValid &= measureFile(fileName, runCount);
+	}
+	return isValid ? 0 : 1;
+}
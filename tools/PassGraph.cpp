@@ -0,0 +1,340 @@
+/// rebuilds the render passes of a frame capture and links them by the resources they write and read, for capturetool
+
+#include "PassGraph.h"
+#include <algorithm>
+#include <cinttypes>
+
+namespace ShaderToggler
+{
+	namespace
+	{
+		constexpr uint32_t MaxRenderTargetCount = 8;
+		constexpr uint64_t DESCRIPTOR_TYPE_UNORDERED_ACCESS_VIEW = 3;			// reshade::api::descriptor_type, texture_unordered_access_view in newer headers
+		constexpr uint64_t DESCRIPTOR_TYPE_BUFFER_UNORDERED_ACCESS_VIEW = 5;	// buffer_unordered_access_view, headers which split the views by resource type
+		constexpr uint32_t SHADER_STAGE_COMPUTE = 0x20;					// reshade::api::shader_stage
+
+		void addUnique(std::vector<uint64_t>& resources, uint64_t resource)
+		{
+			if(std::find(resources.begin(), resources.end(), resource) == resources.end())
+			{
+				resources.push_back(resource);
+			}
+		}
+	}
+
+
+	void PassGraph::build(const CaptureEvent* events, size_t eventCount, const PassGraphSettings& settings)
+	{
+		_settings = settings;
+		_passes.clear();
+		_edges.clear();
+		_emptyClears.clear();
+		_viewResources.clear();
+		_commandLists.clear();
+		_resources.clear();
+
+		for(size_t eventIndex = 0; eventIndex < eventCount; ++eventIndex)
+		{
+			const CaptureEvent& event = events[eventIndex];
+			const uint64_t* args = event.args;
+			if(event.eventId == CaptureEventId::FrameBegin)
+			{
+				// passes don't span frames
+				for(auto& [commandList, state] : _commandLists)
+				{
+					state.currentPass = -1;
+				}
+				continue;
+			}
+			if(event.eventId == CaptureEventId::ViewAlias)
+			{
+				_viewResources[args[0]] = args[1];
+				continue;
+			}
+
+			CommandListState& state = _commandLists[event.commandList];
+			switch(event.eventId)
+			{
+			case CaptureEventId::BindRenderTargets:
+			case CaptureEventId::BeginRenderPass:
+				state.renderTargetCount = std::min(static_cast<uint32_t>(args[0]), MaxRenderTargetCount);
+				state.depthStencil = args[1];
+				for(uint32_t index = 0; index < MaxRenderTargetCount; ++index)
+				{
+					state.renderTargets[index] = index < 3 ? args[2 + index] : 0;
+				}
+				if(event.eventId == CaptureEventId::BeginRenderPass)
+				{
+					// a render pass is a pass of its own even with the targets of the one before. The views past the third are in the continued
+					// events, their clears aren't known.
+					state.currentPass = -1;
+					for(uint32_t index = 0; index < 3; ++index)
+					{
+						if((args[0] >> (32 + index)) & 1)
+						{
+							clearResource(event.commandList, args[2 + index], event.timestamp, false);
+						}
+					}
+					if((args[0] >> 40) & 1)
+					{
+						clearResource(event.commandList, args[1], event.timestamp, true);
+					}
+				}
+				break;
+			case CaptureEventId::BindRenderTargetsContinued:
+				for(uint64_t index = 0; index < 4; ++index)
+				{
+					if(args[0] + index < MaxRenderTargetCount)
+					{
+						state.renderTargets[args[0] + index] = args[1 + index];
+					}
+				}
+				break;
+			case CaptureEventId::EndRenderPass:
+				state.currentPass = -1;
+				break;
+			case CaptureEventId::ReadViews:
+				bindViews(state, args);
+				break;
+			case CaptureEventId::ClearRenderTargetView:
+				clearResource(event.commandList, args[0], event.timestamp, false);
+				break;
+			case CaptureEventId::ClearDepthStencilView:
+				clearResource(event.commandList, args[0], event.timestamp, true);
+				break;
+			case CaptureEventId::Draw:
+			case CaptureEventId::DrawIndexed:
+				addWork(state, event.commandList, event.timestamp, false);
+				break;
+			case CaptureEventId::DrawOrDispatchIndirect:
+				// reshade::api::indirect_command: draw, draw_indexed, then the dispatches
+				addWork(state, event.commandList, event.timestamp, args[0] >= 3);
+				break;
+			case CaptureEventId::Dispatch:
+				addWork(state, event.commandList, event.timestamp, true);
+				break;
+			default:
+				break;
+			}
+		}
+
+		for(const auto& [resource, resourceState] : _resources)
+		{
+			if(!resourceState.isClearUsed)
+			{
+				_emptyClears.push_back(resourceState.clear);
+			}
+		}
+		std::sort(_emptyClears.begin(), _emptyClears.end(), [](const EmptyClear& a, const EmptyClear& b) { return a.timestamp < b.timestamp; });
+	}
+
+
+	std::vector<uint32_t> PassGraph::getOverdrawCandidates() const
+	{
+		std::vector<uint32_t> passIndices;
+		for(uint32_t passIndex = 0; passIndex < _passes.size(); ++passIndex)
+		{
+			const RenderPass& pass = _passes[passIndex];
+			if(!pass.isCompute && !pass.hasDepthStencil && pass.drawCount >= _settings.overdrawDrawCount)
+			{
+				passIndices.push_back(passIndex);
+			}
+		}
+		return passIndices;
+	}
+
+
+	std::vector<uint32_t> PassGraph::getUnconsumedPasses() const
+	{
+		std::vector<uint32_t> passIndices;
+		for(uint32_t passIndex = 0; passIndex < _passes.size(); ++passIndex)
+		{
+			if(!_passes[passIndex].isConsumed && !_passes[passIndex].outputs.empty())
+			{
+				passIndices.push_back(passIndex);
+			}
+		}
+		return passIndices;
+	}
+
+
+	void PassGraph::writeDot(FILE* file) const
+	{
+		fprintf(file, "digraph passes {\n\tnode [shape=box, fontname=\"monospace\"];\n");
+		for(uint32_t passIndex = 0; passIndex < _passes.size(); ++passIndex)
+		{
+			const RenderPass& pass = _passes[passIndex];
+			fprintf(file, "\tp%u [label=\"#%u %s\\n%u %s\\ncommand list 0x%" PRIx64 "\"%s];\n", passIndex, passIndex, pass.isCompute ? "compute" : "graphics",
+					pass.isCompute ? pass.dispatchCount : pass.drawCount, pass.isCompute ? "dispatches" : "draws", pass.commandList,
+					!pass.isConsumed && !pass.outputs.empty() ? ", color=red" : "");
+		}
+		for(const PassEdge& edge : _edges)
+		{
+			fprintf(file, "\tp%u -> p%u [label=\"0x%" PRIx64 "\"%s];\n", edge.from, edge.to, edge.resource, edge.kind == PassEdge::Kind::Load ? ", style=dashed" : "");
+		}
+		fprintf(file, "}\n");
+	}
+
+
+	uint64_t PassGraph::getResource(uint64_t view) const
+	{
+		const auto viewResource = _viewResources.find(view);
+		return viewResource != _viewResources.end() && viewResource->second != 0 ? viewResource->second : view;
+	}
+
+
+	void PassGraph::clearResource(uint64_t commandList, uint64_t view, int64_t timestamp, bool isDepthStencil)
+	{
+		if(view == 0)
+		{
+			return;
+		}
+		const uint64_t resource = getResource(view);
+		ResourceState& resourceState = _resources[resource];
+		if(!resourceState.isClearUsed)
+		{
+			_emptyClears.push_back(resourceState.clear);
+		}
+		resourceState.isCleared = true;
+		resourceState.isClearUsed = false;
+		resourceState.clear = { commandList, resource, timestamp, isDepthStencil };
+
+		// draws after the clear start a new pass, the content of the one before is gone
+		CommandListState& state = _commandLists[commandList];
+		if(state.currentPass >= 0)
+		{
+			const std::vector<uint64_t>& outputs = _passes[state.currentPass].outputs;
+			if(std::find(outputs.begin(), outputs.end(), resource) != outputs.end())
+			{
+				state.currentPass = -1;
+			}
+		}
+	}
+
+
+	void PassGraph::bindViews(CommandListState& state, const uint64_t* args)
+	{
+		const uint32_t stages = static_cast<uint32_t>(args[0]);
+		const uint64_t firstBinding = (args[0] >> 32) & 0xFFFFFF;
+		const uint64_t descriptorType = (args[0] >> 56) & 0xF;
+		const bool isWritten = descriptorType == DESCRIPTOR_TYPE_UNORDERED_ACCESS_VIEW || descriptorType == DESCRIPTOR_TYPE_BUFFER_UNORDERED_ACCESS_VIEW;
+		const uint64_t viewCount = std::min<uint64_t>(args[0] >> 60, 4);
+		// a binding of another stage than compute is used by the draws. Shader resource and unordered access views have their own slots.
+		auto& views = stages == SHADER_STAGE_COMPUTE ? state.computeViews : state.graphicsViews;
+		for(uint64_t index = 0; index < viewCount; ++index)
+		{
+			const uint64_t key = static_cast<uint64_t>(stages) << 32 | (firstBinding + index) << 1 | (isWritten ? 1 : 0);
+			if(args[1 + index] != 0)
+			{
+				views[key] = { args[1 + index], isWritten };
+			}
+			else
+			{
+				views.erase(key);
+			}
+		}
+	}
+
+
+	uint32_t PassGraph::addWork(CommandListState& state, uint64_t commandList, int64_t timestamp, bool isCompute)
+	{
+		std::vector<uint64_t> outputs;
+		std::vector<uint64_t> inputs;
+		const auto& views = isCompute ? state.computeViews : state.graphicsViews;
+		for(const auto& [key, boundView] : views)
+		{
+			addUnique(boundView.isWritten ? outputs : inputs, getResource(boundView.view));
+		}
+		if(!isCompute)
+		{
+			for(uint32_t index = 0; index < state.renderTargetCount; ++index)
+			{
+				if(state.renderTargets[index] != 0)
+				{
+					addUnique(outputs, getResource(state.renderTargets[index]));
+				}
+			}
+			if(state.depthStencil != 0)
+			{
+				addUnique(outputs, getResource(state.depthStencil));
+			}
+		}
+		std::sort(outputs.begin(), outputs.end());
+
+		// a draw continues the pass while the outputs are the same, dispatches in a row are one pass
+		bool isNewPass = state.currentPass < 0 || _passes[state.currentPass].isCompute != isCompute;
+		if(!isNewPass && !isCompute)
+		{
+			std::vector<uint64_t> passOutputs = _passes[state.currentPass].outputs;
+			std::sort(passOutputs.begin(), passOutputs.end());
+			isNewPass = passOutputs != outputs;
+		}
+		if(isNewPass)
+		{
+			state.currentPass = static_cast<int32_t>(_passes.size());
+			RenderPass& pass = _passes.emplace_back();
+			pass.commandList = commandList;
+			pass.isCompute = isCompute;
+			pass.hasDepthStencil = !isCompute && state.depthStencil != 0;
+			pass.begin = timestamp;
+		}
+		const uint32_t passIndex = static_cast<uint32_t>(state.currentPass);
+		RenderPass& pass = _passes[passIndex];
+		pass.end = timestamp;
+		pass.drawCount += isCompute ? 0 : 1;
+		pass.dispatchCount += isCompute ? 1 : 0;
+		for(const uint64_t resource : inputs)
+		{
+			// a resource bound as render target and texture at once is a feedback loop, D3D unbinds the texture
+			if(std::find(outputs.begin(), outputs.end(), resource) == outputs.end())
+			{
+				addUnique(_passes[passIndex].inputs, resource);
+				readResource(passIndex, resource);
+			}
+		}
+		for(const uint64_t resource : outputs)
+		{
+			addUnique(_passes[passIndex].outputs, resource);
+			writeResource(passIndex, resource);
+		}
+		return passIndex;
+	}
+
+
+	void PassGraph::readResource(uint32_t passIndex, uint64_t resource)
+	{
+		ResourceState& resourceState = _resources[resource];
+		resourceState.isClearUsed = true;
+		if(resourceState.lastWriter >= 0 && !resourceState.isCleared && resourceState.lastWriter != static_cast<int32_t>(passIndex) &&
+		   resourceState.lastReader != static_cast<int32_t>(passIndex))
+		{
+			addEdge(static_cast<uint32_t>(resourceState.lastWriter), passIndex, resource, PassEdge::Kind::Read);
+			resourceState.lastReader = static_cast<int32_t>(passIndex);
+		}
+	}
+
+
+	void PassGraph::writeResource(uint32_t passIndex, uint64_t resource)
+	{
+		ResourceState& resourceState = _resources[resource];
+		resourceState.isClearUsed = true;
+		if(resourceState.lastWriter == static_cast<int32_t>(passIndex))
+		{
+			return;
+		}
+		if(resourceState.lastWriter >= 0 && !resourceState.isCleared)
+		{
+			addEdge(static_cast<uint32_t>(resourceState.lastWriter), passIndex, resource, PassEdge::Kind::Load);
+		}
+		resourceState.lastWriter = static_cast<int32_t>(passIndex);
+		resourceState.lastReader = -1;
+		resourceState.isCleared = false;
+	}
+
+
+	void PassGraph::addEdge(uint32_t from, uint32_t to, uint64_t resource, PassEdge::Kind kind)
+	{
+		_edges.push_back({ from, to, resource, kind });
+		_passes[from].isConsumed = true;
+	}
+}
@@ -0,0 +1,145 @@
+/// rebuilds the render passes of a frame capture and links them by the resources they write and read, for capturetool
+
+#pragma once
+
+#include "CaptureFormat.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+namespace ShaderToggler
+{
+	/// <summary>
+	/// Draws on one command list into the same render targets and depth stencil, or consecutive dispatches.
+	/// </summary>
+	struct RenderPass
+	{
+		uint64_t commandList = 0;
+		bool isCompute = false;
+		bool hasDepthStencil = false;
+		bool isConsumed = false;			// a later pass read one of the outputs, or drew on top of it without clearing it first
+		int64_t begin = 0;					// first draw or dispatch
+		int64_t end = 0;					// last draw or dispatch
+		uint32_t drawCount = 0;
+		uint32_t dispatchCount = 0;
+		std::vector<uint64_t> outputs;		// resources written: render targets and depth stencil, or unordered access views
+		std::vector<uint64_t> inputs;		// resources read by the draws or dispatches
+	};
+
+
+	struct PassEdge
+	{
+		enum class Kind
+		{
+			Read,		// the later pass reads the resource
+			Load,		// the later pass draws on top of the resource's content
+		};
+
+		uint32_t from = 0;
+		uint32_t to = 0;
+		uint64_t resource = 0;
+		Kind kind = Kind::Read;
+	};
+
+
+	/// <summary>
+	/// A clear whose result nothing drew to or read before the resource was cleared again or the capture ended.
+	/// </summary>
+	struct EmptyClear
+	{
+		uint64_t commandList = 0;
+		uint64_t resource = 0;
+		int64_t timestamp = 0;
+		bool isDepthStencil = false;
+	};
+
+
+	struct PassGraphSettings
+	{
+		uint32_t overdrawDrawCount = 8;		// passes without a depth stencil and at least this many draws are overdraw candidates
+	};
+
+
+	/// <summary>
+	/// Groups the draws of a capture into passes and links the passes. Views are mapped to their resources with the ViewAlias events, so
+	///	a render target read as a texture links the pass which rendered it to the one reading it. Older captures have no aliases, the views
+	///	are taken as the resources then, which misses those links.
+	///
+	///	The events are taken in timestamp order, which is the order the command lists were recorded in, not the order the GPU ran them.
+	///	The views read are only known for descriptors pushed by the game (D3D9 to D3D11, push descriptors in D3D12 and Vulkan), not for
+	///	descriptor tables. Texture and buffer shader resource and unordered access views are followed, buffers bound as constant buffers or
+	///	shader storage buffers (a buffer range, not a view) aren't: passes communicating only through those aren't linked.
+	/// </summary>
+	class PassGraph
+	{
+	public:
+		void build(const CaptureEvent* events, size_t eventCount, const PassGraphSettings& settings);
+
+		const std::vector<RenderPass>& getPasses() const { return _passes; }
+		const std::vector<PassEdge>& getEdges() const { return _edges; }
+		const std::vector<EmptyClear>& getEmptyClears() const { return _emptyClears; }
+		/// <summary>
+		/// Graphics passes without a depth stencil and with at least PassGraphSettings::overdrawDrawCount draws: every draw shades all its pixels.
+		/// </summary>
+		std::vector<uint32_t> getOverdrawCandidates() const;
+		/// <summary>
+		/// Passes none of whose outputs were consumed by the end of the capture. The passes of the last frame rendering to the back buffer
+		///	are among them, their output is presented.
+		/// </summary>
+		std::vector<uint32_t> getUnconsumedPasses() const;
+		/// <summary>
+		/// Writes the graph in the Graphviz dot format. Unconsumed passes are red, loads dashed.
+		/// </summary>
+		void writeDot(FILE* file) const;
+
+	private:
+		struct BoundView
+		{
+			uint64_t view = 0;
+			bool isWritten = false;		// an unordered access view
+		};
+
+		/// <summary>
+		/// What is bound on a command list, replayed from its events.
+		/// </summary>
+		struct CommandListState
+		{
+			uint32_t renderTargetCount = 0;
+			uint64_t renderTargets[8] = {};
+			uint64_t depthStencil = 0;
+			std::unordered_map<uint64_t, BoundView> graphicsViews;		// shader_stage << 32 | binding -> view used by the draws
+			std::unordered_map<uint64_t, BoundView> computeViews;		// the same for the dispatches
+			int32_t currentPass = -1;			// the pass draws or dispatches are added to while the outputs don't change
+		};
+
+		/// <summary>
+		/// The pass which wrote a resource last, and the clear since then.
+		/// </summary>
+		struct ResourceState
+		{
+			int32_t lastWriter = -1;
+			int32_t lastReader = -1;		// the pass with the read edge from lastWriter, so it's added once
+			bool isCleared = false;			// cleared after the last write: a later write doesn't load the content of the last writer
+			bool isClearUsed = true;
+			EmptyClear clear;
+		};
+
+		uint64_t getResource(uint64_t view) const;
+		void clearResource(uint64_t commandList, uint64_t view, int64_t timestamp, bool isDepthStencil);
+		void bindViews(CommandListState& state, const uint64_t* args);
+		uint32_t addWork(CommandListState& state, uint64_t commandList, int64_t timestamp, bool isCompute);
+		void readResource(uint32_t passIndex, uint64_t resource);
+		void writeResource(uint32_t passIndex, uint64_t resource);
+		void addEdge(uint32_t from, uint32_t to, uint64_t resource, PassEdge::Kind kind);
+
+		PassGraphSettings _settings;
+		std::vector<RenderPass> _passes;
+		std::vector<PassEdge> _edges;
+		std::vector<EmptyClear> _emptyClears;
+		std::unordered_map<uint64_t, uint64_t> _viewResources;
+		std::unordered_map<uint64_t, CommandListState> _commandLists;
+		std::unordered_map<uint64_t, ResourceState> _resources;
+	};
+}
@@ -0,0 +1,268 @@
+/// checks PassGraph on synthetic event streams: the passes, their Read and Load links, empty clears, frame splitting and unconsumed passes.
+/// build on linux: g++ -std=c++20 -O2 -I.. PassGraphTest.cpp PassGraph.cpp -o passgraphtest
+/// usage:
+///		passgraphtest
+/// Each case builds the events the hooks of api_trace.cpp record for a small frame, runs PassGraph::build on them and checks the graph.
+/// Prints the failed checks, returns 1 if there were any.
+
+#include "PassGraph.h"
+#include <cstdio>
+#include <initializer_list>
+#include <vector>
+
+using namespace ShaderToggler;
+
+namespace
+{
+	constexpr uint64_t CommandList = 0x100;
+	constexpr uint64_t OtherCommandList = 0x200;
+	constexpr uint64_t StagePixel = 0x10;				// reshade::api::shader_stage
+	constexpr uint64_t StageCompute = 0x20;
+	constexpr uint64_t DescriptorShaderResourceView = 2;		// reshade::api::descriptor_type
+	constexpr uint64_t DescriptorBufferShaderResourceView = 4;
+	constexpr uint64_t DescriptorBufferUnorderedAccessView = 5;
+
+	uint32_t g_failedCount = 0;
+
+
+	void check(bool isValid, const char* testName, const char* description)
+	{
+		if(!isValid)
+		{
+			printf("FAILED %s: %s\n", testName, description);
+			++g_failedCount;
+		}
+	}
+
+
+	/// <summary>
+	/// Events in recording order, one timestamp tick apart.
+	/// </summary>
+	class EventStream
+	{
+	public:
+		void add(CaptureEventId eventId, uint64_t commandList, std::initializer_list<uint64_t> args = {})
+		{
+			CaptureEvent& event = _events.emplace_back();
+			event.timestamp = static_cast<int64_t>(_events.size());
+			event.commandList = commandList;
+			event.eventId = eventId;
+			event.reserved = 0;
+			event.threadIndex = 0;
+			uint32_t argIndex = 0;
+			for(const uint64_t arg : args)
+			{
+				event.args[argIndex++] = arg;
+			}
+			for(; argIndex < 5; ++argIndex)
+			{
+				event.args[argIndex] = 0;
+			}
+		}
+		void frameBegin(uint64_t frameIndex) { add(CaptureEventId::FrameBegin, 0, { frameIndex }); }
+		void alias(uint64_t view, uint64_t resource) { add(CaptureEventId::ViewAlias, CommandList, { view, resource }); }
+		void bindRenderTarget(uint64_t commandList, uint64_t renderTarget, uint64_t depthStencil = 0)
+		{
+			add(CaptureEventId::BindRenderTargets, commandList, { renderTarget != 0 ? 1u : 0u, depthStencil, renderTarget });
+		}
+		void readView(uint64_t commandList, uint64_t stages, uint64_t binding, uint64_t descriptorType, uint64_t view)
+		{
+			add(CaptureEventId::ReadViews, commandList, { stages | binding << 32 | descriptorType << 56 | 1ull << 60, view });
+		}
+		void clearRenderTarget(uint64_t commandList, uint64_t view) { add(CaptureEventId::ClearRenderTargetView, commandList, { view }); }
+		void draw(uint64_t commandList) { add(CaptureEventId::Draw, commandList, { 3, 1, 0, 0 }); }
+		void dispatch(uint64_t commandList) { add(CaptureEventId::Dispatch, commandList, { 8, 8, 1 }); }
+
+		PassGraph build() const
+		{
+			PassGraph graph;
+			graph.build(_events.data(), _events.size(), PassGraphSettings());
+			return graph;
+		}
+
+	private:
+		std::vector<CaptureEvent> _events;
+	};
+
+
+	bool hasEdge(const PassGraph& graph, uint32_t from, uint32_t to, uint64_t resource, PassEdge::Kind kind)
+	{
+		for(const PassEdge& edge : graph.getEdges())
+		{
+			if(edge.from == from && edge.to == to && edge.resource == resource && edge.kind == kind)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	/// <summary>
+	/// A render target cleared and drawn to, then read through a shader resource view of the same texture by a pass drawing elsewhere. A
+	///	third render target is cleared and never used.
+	/// </summary>
+	void testReadThroughViewAlias()
+	{
+		const char* name = "read through a view alias";
+		EventStream stream;
+		stream.frameBegin(0);
+		stream.alias(0xA1, 0x1000);		// render target view of the texture
+		stream.alias(0xA2, 0x1000);		// shader resource view of the same texture
+		stream.alias(0xB1, 0x2000);
+		stream.alias(0xC1, 0x3000);
+		stream.bindRenderTarget(CommandList, 0xA1);
+		stream.clearRenderTarget(CommandList, 0xA1);
+		stream.draw(CommandList);
+		stream.draw(CommandList);
+		stream.bindRenderTarget(CommandList, 0xB1);
+		stream.readView(CommandList, StagePixel, 0, DescriptorShaderResourceView, 0xA2);
+		stream.draw(CommandList);
+		stream.clearRenderTarget(CommandList, 0xC1);
+		const PassGraph graph = stream.build();
+
+		check(graph.getPasses().size() == 2, name, "2 passes");
+		check(graph.getPasses().size() == 2 && graph.getPasses()[0].drawCount == 2 && graph.getPasses()[1].drawCount == 1, name, "2 draws, then 1");
+		check(graph.getEdges().size() == 1 && hasEdge(graph, 0, 1, 0x1000, PassEdge::Kind::Read), name, "one Read edge of the texture, not of the view");
+		check(graph.getEmptyClears().size() == 1 && graph.getEmptyClears()[0].resource == 0x3000 && !graph.getEmptyClears()[0].isDepthStencil, name,
+			  "the unused clear is empty, the used one isn't");
+		const std::vector<uint32_t> unconsumed = graph.getUnconsumedPasses();
+		check(unconsumed.size() == 1 && unconsumed[0] == 1, name, "only the last pass is unconsumed");
+	}
+
+
+	/// <summary>
+	/// Drawing on top of a render target written by an earlier pass loads its content, unless it was cleared in between.
+	/// </summary>
+	void testLoadAndClear()
+	{
+		const char* name = "load and clear";
+		EventStream stream;
+		stream.frameBegin(0);
+		stream.bindRenderTarget(CommandList, 0x1000);
+		stream.draw(CommandList);						// pass 0 writes 0x1000
+		stream.bindRenderTarget(CommandList, 0x2000);
+		stream.draw(CommandList);						// pass 1 writes 0x2000
+		stream.bindRenderTarget(CommandList, 0x1000);
+		stream.draw(CommandList);						// pass 2 draws on top of pass 0
+		stream.bindRenderTarget(CommandList, 0x2000);
+		stream.clearRenderTarget(CommandList, 0x2000);
+		stream.draw(CommandList);						// pass 3 starts over on 0x2000
+		const PassGraph graph = stream.build();
+
+		check(graph.getPasses().size() == 4, name, "4 passes");
+		check(hasEdge(graph, 0, 2, 0x1000, PassEdge::Kind::Load), name, "Load edge from the pass drawn on top of");
+		check(graph.getEdges().size() == 1, name, "no edge across the clear");
+		const std::vector<uint32_t> unconsumed = graph.getUnconsumedPasses();
+		check(unconsumed.size() == 3 && unconsumed[0] == 1 && unconsumed[1] == 2 && unconsumed[2] == 3, name, "the cleared over pass is unconsumed");
+		check(graph.getEmptyClears().empty(), name, "no empty clears");
+	}
+
+
+	/// <summary>
+	/// Draws with the same render target are one pass within a frame, a FrameBegin ends it.
+	/// </summary>
+	void testFrameBeginSplitsPasses()
+	{
+		const char* name = "frame begin splits passes";
+		EventStream stream;
+		stream.frameBegin(0);
+		stream.bindRenderTarget(CommandList, 0x1000);
+		stream.draw(CommandList);
+		stream.draw(CommandList);
+		stream.frameBegin(1);
+		stream.draw(CommandList);
+		const PassGraph graph = stream.build();
+
+		check(graph.getPasses().size() == 2, name, "2 passes");
+		check(graph.getPasses().size() == 2 && graph.getPasses()[0].drawCount == 2 && graph.getPasses()[1].drawCount == 1, name, "2 draws, then 1");
+		check(graph.getEdges().size() == 1 && hasEdge(graph, 0, 1, 0x1000, PassEdge::Kind::Load), name, "the next frame loads the render target");
+	}
+
+
+	/// <summary>
+	/// The cleared bits of BeginRenderPass clear the render targets and the depth stencil, and a render pass is a pass of its own.
+	/// </summary>
+	void testBeginRenderPassClears()
+	{
+		const char* name = "begin render pass clears";
+		EventStream stream;
+		stream.frameBegin(0);
+		stream.bindRenderTarget(CommandList, 0x1000);
+		stream.draw(CommandList);														// pass 0 writes 0x1000
+		// render target 0 and the depth stencil cleared
+		stream.add(CaptureEventId::BeginRenderPass, CommandList, { 1 | 1ull << 32 | 1ull << 40, 0xD000, 0x1000 });
+		stream.draw(CommandList);														// pass 1
+		stream.add(CaptureEventId::EndRenderPass, CommandList);
+		// the same targets loaded: a pass of its own, linked to the one before
+		stream.add(CaptureEventId::BeginRenderPass, CommandList, { 1, 0xD000, 0x1000 });
+		stream.draw(CommandList);														// pass 2
+		stream.add(CaptureEventId::EndRenderPass, CommandList);
+		// cleared and nothing drawn
+		stream.add(CaptureEventId::BeginRenderPass, CommandList, { 1 | 1ull << 32 | 1ull << 40, 0xD000, 0x1000 });
+		stream.add(CaptureEventId::EndRenderPass, CommandList);
+		const PassGraph graph = stream.build();
+
+		check(graph.getPasses().size() == 3, name, "3 passes");
+		check(graph.getPasses().size() == 3 && graph.getPasses()[1].hasDepthStencil, name, "the render pass has the depth stencil");
+		check(!hasEdge(graph, 0, 1, 0x1000, PassEdge::Kind::Load), name, "no Load edge across the cleared render target");
+		check(hasEdge(graph, 1, 2, 0x1000, PassEdge::Kind::Load) && hasEdge(graph, 1, 2, 0xD000, PassEdge::Kind::Load), name,
+			  "Load edges of both targets into the loading render pass");
+		check(graph.getEdges().size() == 2, name, "2 edges");
+		const std::vector<EmptyClear>& emptyClears = graph.getEmptyClears();
+		check(emptyClears.size() == 2, name, "the clears of the last render pass are empty");
+		bool hasDepthStencilClear = false;
+		bool hasRenderTargetClear = false;
+		for(const EmptyClear& clear : emptyClears)
+		{
+			hasDepthStencilClear |= clear.resource == 0xD000 && clear.isDepthStencil;
+			hasRenderTargetClear |= clear.resource == 0x1000 && !clear.isDepthStencil;
+		}
+		check(hasDepthStencilClear && hasRenderTargetClear, name, "an empty depth stencil clear and an empty render target clear");
+		const std::vector<uint32_t> unconsumed = graph.getUnconsumedPasses();
+		check(unconsumed.size() == 2 && unconsumed[0] == 0 && unconsumed[1] == 2, name, "the pass cleared over and the last pass are unconsumed");
+	}
+
+
+	/// <summary>
+	/// A dispatch writing a structured buffer through a buffer unordered access view, read by a dispatch on another command list through a
+	///	buffer shader resource view.
+	/// </summary>
+	void testComputeThroughBuffers()
+	{
+		const char* name = "compute through buffers";
+		EventStream stream;
+		stream.frameBegin(0);
+		stream.alias(0xE1, 0x5000);		// unordered access view of the buffer
+		stream.alias(0xE2, 0x5000);		// shader resource view of the buffer
+		stream.readView(CommandList, StageCompute, 0, DescriptorBufferUnorderedAccessView, 0xE1);
+		stream.dispatch(CommandList);
+		stream.dispatch(CommandList);
+		stream.readView(OtherCommandList, StageCompute, 0, DescriptorBufferShaderResourceView, 0xE2);
+		stream.dispatch(OtherCommandList);
+		const PassGraph graph = stream.build();
+
+		check(graph.getPasses().size() == 2, name, "2 passes");
+		check(graph.getPasses().size() == 2 && graph.getPasses()[0].isCompute && graph.getPasses()[0].dispatchCount == 2, name,
+			  "dispatches in a row are one compute pass");
+		check(graph.getEdges().size() == 1 && hasEdge(graph, 0, 1, 0x5000, PassEdge::Kind::Read), name, "Read edge of the buffer");
+		check(graph.getUnconsumedPasses().empty(), name, "the reading pass writes nothing, the writing one is consumed");
+	}
+}
+
+
+int main()
+{
+	testReadThroughViewAlias();
+	testLoadAndClear();
+	testFrameBeginSplitsPasses();
+	testBeginRenderPassClears();
+	testComputeThroughBuffers();
+	if(g_failedCount > 0)
+	{
+		printf("%u checks failed\n", g_failedCount);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
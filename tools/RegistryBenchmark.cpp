@@ -0,0 +1,292 @@
+/// measures the sharded ResourceRegistry under contention, against the same map split over other shard counts, and checks its memory budget.
+/// build on linux: g++ -std=c++20 -O2 -fpermissive -I.. -I../Include RegistryBenchmark.cpp ../ResourceRegistry.cpp -o registrybenchmark -pthread
+/// usage:
+///		registrybenchmark [--operations N] [--threads N]
+/// Each thread registers views, looks each one up twice (once a hit, once a miss) and destroys them 64 creates later, like a game streaming
+/// resources in while the command list hooks describe what's bound. The work is split over 1, 2, 4 ... --threads threads. ShardedMap is the
+/// layout of the registry (a shared_mutex and an unordered_map per shard, picked by the same multiplicative hash) with the shard count as a
+/// parameter, so ShardCount can be checked against fewer and more shards; 1 shard is the single lock the registry replaced. The registry
+/// column is slower than its 64 shards by the lookup of the view's resource. -fpermissive is for the reshade headers, written for msvc.
+/// The budget is checked with handles like D3D12 descriptors (a fixed stride apart) and like heap pointers: the registry should keep close
+/// to budget / EntryBytes handles before it rejects the first one, else the handles don't spread evenly over the shards.
+
+#include "ResourceRegistry.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace ShaderToggler;
+using namespace reshade::api;
+
+namespace
+{
+	constexpr uint64_t DestroyDistance = 64;		// creates between the create and the destroy of a view
+
+
+	template<size_t ShardCount>
+	class ShardedMap
+	{
+	public:
+		void add(uint64_t handle, const ResourceDescription& description)
+		{
+			Shard& shard = _shards[getShardIndex(handle)];
+			std::unique_lock lock(shard.mutex);
+			shard.descriptions[handle] = description;
+		}
+		void remove(uint64_t handle)
+		{
+			Shard& shard = _shards[getShardIndex(handle)];
+			std::unique_lock lock(shard.mutex);
+			shard.descriptions.erase(handle);
+		}
+		bool find(uint64_t handle, ResourceDescription& description) const
+		{
+			const Shard& shard = _shards[getShardIndex(handle)];
+			std::shared_lock lock(shard.mutex);
+			const auto entry = shard.descriptions.find(handle);
+			if(entry == shard.descriptions.end())
+			{
+				return false;
+			}
+			description = entry->second;
+			return true;
+		}
+
+	private:
+		struct alignas(64) Shard
+		{
+			mutable std::shared_mutex mutex;
+			std::unordered_map<uint64_t, ResourceDescription> descriptions;
+		};
+
+		static size_t getShardIndex(uint64_t handle)
+		{
+			if constexpr(ShardCount == 1)
+			{
+				return 0;
+			}
+			else
+			{
+				return static_cast<size_t>((handle * 0x9E3779B97F4A7C15ull) >> (64 - std::countr_zero(ShardCount)));
+			}
+		}
+
+		std::array<Shard, ShardCount> _shards;
+	};
+
+
+	/// <summary>
+	/// ResourceRegistry with the interface of ShardedMap.
+	/// </summary>
+	class RegistryMap
+	{
+	public:
+		void add(uint64_t handle, const ResourceDescription&)
+		{
+			_registry.addResourceView({ handle }, { 0x1000 }, resource_usage::shader_resource, resource_view_desc(format::r8g8b8a8_unorm));
+		}
+		void remove(uint64_t handle) { _registry.remove(handle); }
+		bool find(uint64_t handle, ResourceDescription& description) const { return _registry.find(handle, description); }
+
+	private:
+		ResourceRegistry _registry;
+	};
+
+
+	/// <summary>
+	/// Runs the create / lookup / destroy mix of operationCount creates split over threadCount threads on a new map, returns the milliseconds.
+	/// </summary>
+	template<typename Map>
+	double runContention(uint32_t threadCount, uint64_t operationCount)
+	{
+		auto map = std::make_unique<Map>();
+		const uint64_t perThreadCount = operationCount / threadCount;
+		uint64_t hitCount = 0;
+		std::mutex hitMutex;
+		const auto startTime = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for(uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+		{
+			threads.emplace_back([&, threadIndex]
+				{
+					// descriptor handles of a heap per thread, 16 bytes apart
+					const uint64_t base = 0x10000000ull * (threadIndex + 1);
+					ResourceDescription description;
+					uint64_t threadHitCount = 0;
+					for(uint64_t i = 0; i < perThreadCount; ++i)
+					{
+						const uint64_t handle = base + i * 16;
+						map->add(handle, description);
+						threadHitCount += map->find(handle, description) ? 1 : 0;
+						threadHitCount += map->find(handle + 0x8000000ull, description) ? 1 : 0;
+						if(i >= DestroyDistance)
+						{
+							map->remove(handle - DestroyDistance * 16);
+						}
+					}
+					std::unique_lock lock(hitMutex);
+					hitCount += threadHitCount;
+				});
+		}
+		for(auto& thread : threads)
+		{
+			thread.join();
+		}
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		if(hitCount != perThreadCount * threadCount)
+		{
+			fprintf(stderr, "%llu lookups hit, expected %llu\n", static_cast<unsigned long long>(hitCount), static_cast<unsigned long long>(perThreadCount * threadCount));
+		}
+		return milliseconds;
+	}
+
+
+	/// <summary>
+	/// Registers handles firstHandle + i * stride under budget till one is rejected, returns how many were kept till then.
+	/// </summary>
+	size_t fillToFirstRejection(size_t budget, uint64_t firstHandle, uint64_t stride, size_t& keptCount, uint64_t& rejectedCount)
+	{
+		ResourceRegistry registry;
+		registry.setMemoryBudget(budget);
+		const resource_desc texture(256, 256, 1, 1, format::bc1_unorm, 1, memory_heap::gpu_only, resource_usage::shader_resource);
+		const ResourceDescription description = ResourceRegistry::describeResource(texture);
+		const size_t tryCount = budget / ResourceRegistry::EntryBytes * 2;
+		size_t firstRejection = 0;
+		for(size_t i = 0; i < tryCount; ++i)
+		{
+			registry.addResource({ firstHandle + i * stride }, description);
+			if(firstRejection == 0 && registry.getRejectedCount() > 0)
+			{
+				firstRejection = registry.getCount();
+			}
+		}
+		keptCount = registry.getCount();
+		rejectedCount = registry.getRejectedCount();
+		return firstRejection;
+	}
+
+
+	/// <summary>
+	/// The descriptions the hooks rely on: a view gets the dimensions of its resource, buffers their size, removed handles are gone.
+	/// </summary>
+	bool checkDescriptions()
+	{
+		ResourceRegistry registry;
+		const resource_desc texture(1920, 1080, 1, 1, format::r8g8b8a8_unorm, 1, memory_heap::gpu_only, resource_usage::render_target);
+		registry.addResource({ 0x1000 }, ResourceRegistry::describeResource(texture));
+		registry.addResourceView({ 0x2000 }, { 0x1000 }, resource_usage::render_target, resource_view_desc(format::r8g8b8a8_unorm_srgb));
+		registry.addResource({ 0x3000 }, ResourceRegistry::describeResource(resource_desc(65536, memory_heap::cpu_to_gpu, resource_usage::constant_buffer)));
+		registry.addSampler({ 0x4000 });
+		bool isValid = true;
+		ResourceDescription description;
+		if(!registry.find(0x2000, description) || description.kind != RegisteredObjectKind::ResourceView || description.resource != 0x1000 ||
+		   description.width != 1920 || description.height != 1080 || description.format != static_cast<uint32_t>(format::r8g8b8a8_unorm_srgb))
+		{
+			fprintf(stderr, "the view isn't described with its resource\n");
+			isValid = false;
+		}
+		if(!registry.find(0x3000, description) || description.size != 65536)
+		{
+			fprintf(stderr, "the buffer isn't described with its size\n");
+			isValid = false;
+		}
+		if(!registry.find(0x4000, description) || description.kind != RegisteredObjectKind::Sampler)
+		{
+			fprintf(stderr, "the sampler isn't registered\n");
+			isValid = false;
+		}
+		registry.remove(0x1000);
+		if(registry.contains(0x1000) || !registry.contains(0x2000) || registry.getCount() != 3)
+		{
+			fprintf(stderr, "removing the resource removed the wrong handles\n");
+			isValid = false;
+		}
+		return isValid;
+	}
+
+
+	int printUsage()
+	{
+		fprintf(stderr, "usage:\n"
+				"\tregistrybenchmark [--operations N] [--threads N]\n"
+				"\t\t--operations: views created per run, split over the threads, default 400000.\n"
+				"\t\t--threads: the most threads, runs with 1, 2, 4 ... up to it, default 8.\n");
+		return 1;
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	uint64_t operationCount = 400000;
+	uint32_t maxThreadCount = 8;
+	for(int argIndex = 1; argIndex + 1 < argc; argIndex += 2)
+	{
+		if(strcmp(argv[argIndex], "--operations") == 0)
+		{
+			operationCount = std::max<uint64_t>(strtoull(argv[argIndex + 1], nullptr, 10), 1024);
+		}
+		else if(strcmp(argv[argIndex], "--threads") == 0)
+		{
+			maxThreadCount = std::clamp<uint32_t>(static_cast<uint32_t>(strtoul(argv[argIndex + 1], nullptr, 10)), 1, 256);
+		}
+		else
+		{
+			return printUsage();
+		}
+	}
+	if(argc % 2 == 0)
+	{
+		return printUsage();
+	}
+
+	const bool isValid = checkDescriptions();
+
+	printf("%llu creates, %llu lookups and about %llu destroys per run, hardware threads: %u\n", static_cast<unsigned long long>(operationCount),
+		   static_cast<unsigned long long>(operationCount * 2), static_cast<unsigned long long>(operationCount), std::thread::hardware_concurrency());
+	printf("threads     1 shard    4 shards   16 shards   64 shards  256 shards    registry  (ms)\n");
+	for(uint32_t threadCount = 1; threadCount <= maxThreadCount; threadCount *= 2)
+	{
+		printf("%7u %11.1f %11.1f %11.1f %11.1f %11.1f %11.1f\n", threadCount,
+			   runContention<ShardedMap<1>>(threadCount, operationCount), runContention<ShardedMap<4>>(threadCount, operationCount),
+			   runContention<ShardedMap<16>>(threadCount, operationCount), runContention<ShardedMap<64>>(threadCount, operationCount),
+			   runContention<ShardedMap<256>>(threadCount, operationCount), runContention<RegistryMap>(threadCount, operationCount));
+	}
+
+	printf("entry: %zu bytes, shards: %zu\n", ResourceRegistry::EntryBytes, ResourceRegistry::ShardCount);
+	struct HandlePattern
+	{
+		const char* name;
+		uint64_t firstHandle;
+		uint64_t stride;
+	};
+	const HandlePattern patterns[] = {
+		{ "descriptors 32 bytes apart", 0x7ff000000000ull, 32 },
+		{ "descriptors 64 bytes apart", 0x7ff000000000ull, 64 },
+		{ "heap pointers 4 KB apart", 0x1d4a0000000ull, 4096 },
+	};
+	for(const size_t budget : { size_t(1) << 20, size_t(16) << 20, ResourceRegistry::DefaultMemoryBudget })
+	{
+		const size_t capacity = budget / ResourceRegistry::EntryBytes;
+		for(const HandlePattern& pattern : patterns)
+		{
+			size_t keptCount = 0;
+			uint64_t rejectedCount = 0;
+			const size_t firstRejection = fillToFirstRejection(budget, pattern.firstHandle, pattern.stride, keptCount, rejectedCount);
+			printf("budget %3zu MB, %-28s: first rejection at %zu of %zu (%.1f%%), %zu kept, %llu rejected\n", budget >> 20, pattern.name,
+				   firstRejection, capacity, 100.0 * static_cast<double>(firstRejection) / static_cast<double>(capacity), keptCount,
+				   static_cast<unsigned long long>(rejectedCount));
+		}
+	}
+	return isValid ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/// lists and extracts the shaders in a shaderdump.pak / shaderdump.idx archive written by the addon in the 'single pack file' dump layout.
+/// Also decompresses the .lz files written by the 'one file per shader' dump layout with compression enabled.
+/// build on linux: g++ -std=c++17 -O2 -I.. ShaderPackTool.cpp ../ShaderDumpArchive.cpp ../ShaderCodeCompressor.cpp ../MappedFile.cpp -o shaderpacktool
+/// usage:
+///		shaderpacktool list <dumpfolder>
+///		shaderpacktool extract <dumpfolder> <0xHASH | all> [outputfolder]
+///		shaderpacktool decompress <file.lz>...
+/// Extracted shaders get the same 0x%08X.<extension> names as the 'one file per shader' dump layout, compressed shaders are decompressed.
+/// decompress writes each file next to the input, without the .lz extension.
+
+#include "ShaderCodeCompressor.h"
+#include "ShaderDumpArchive.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+using namespace ShaderToggler;
+
+static int printUsage()
+{
+	fprintf(stderr, "usage:\n  shaderpacktool list <dumpfolder>\n  shaderpacktool extract <dumpfolder> <0xHASH | all> [outputfolder]\n  shaderpacktool decompress <file.lz>...\n");
+	return 1;
+}
+
+
+static bool writeFile(const std::filesystem::path& fileName, const std::vector<uint8_t>& code)
+{
+	std::ofstream file(fileName, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(code.data()), code.size());
+	if(!file.good())
+	{
+		fprintf(stderr, "%s: can't write the file\n", fileName.string().c_str());
+		return false;
+	}
+	return true;
+}
+
+
+static bool extractEntry(const ShaderDumpArchiveReader& archive, const ShaderDumpIndexEntry& entry, const std::filesystem::path& outputFolder, std::vector<uint8_t>& code)
+{
+	if(!archive.getDecompressedCode(entry, code))
+	{
+		fprintf(stderr, "0x%08X: record is outside the data file or can't be decompressed\n", entry.shaderHash);
+		return false;
+	}
+	char fileName[32];
+	snprintf(fileName, sizeof(fileName), "0x%08X%s", entry.shaderHash, getShaderDumpFileExtension(entry.deviceApi, code.data(), code.size()));
+	return writeFile(outputFolder / fileName, code);
+}
+
+
+static int listArchive(const ShaderDumpArchiveReader& archive)
+{
+	printf("%-10s  %-14s  %-7s  %10s  %12s  %s\n", "hash", "stage", "api", "size", "offset", "flags");
+	uint64_t totalSize = 0;
+	for(const ShaderDumpIndexEntry& entry : archive)
+	{
+		printf("0x%08X  %-14s  %-7s  %10u  %12" PRIu64 "  %s\n", entry.shaderHash, getShaderDumpStageName(entry.stage),
+			getShaderDumpApiName(entry.deviceApi), entry.size, entry.offset, (entry.flags & SHADER_DUMP_FLAG_COMPRESSED) ? "lz" : "");
+		totalSize += entry.size;
+	}
+	printf("%zu shaders, %" PRIu64 " bytes stored%s\n", archive.size(), totalSize, archive.isIndexRebuilt() ? " (index rebuilt from the data file)" : "");
+	return 0;
+}
+
+
+static int extractFromArchive(const ShaderDumpArchiveReader& archive, const char* what, const std::filesystem::path& outputFolder)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(outputFolder, ec);
+
+	std::vector<uint8_t> code;
+	if(strcmp(what, "all") == 0)
+	{
+		size_t extracted = 0;
+		for(const ShaderDumpIndexEntry& entry : archive)
+		{
+			extracted += extractEntry(archive, entry, outputFolder, code) ? 1 : 0;
+		}
+		printf("%zu of %zu shaders extracted\n", extracted, archive.size());
+		return extracted == archive.size() ? 0 : 1;
+	}
+
+	char* parseEnd = nullptr;
+	const unsigned long shaderHash = strtoul(what, &parseEnd, 16);
+	if(parseEnd == what || *parseEnd != '\0')
+	{
+		return printUsage();
+	}
+	const ShaderDumpIndexEntry* entry = archive.find(static_cast<uint32_t>(shaderHash));
+	if(nullptr == entry)
+	{
+		fprintf(stderr, "0x%08lX isn't in the archive\n", shaderHash);
+		return 1;
+	}
+	return extractEntry(archive, *entry, outputFolder, code) ? 0 : 1;
+}
+
+
+static int decompressFiles(int fileCount, char** fileNames)
+{
+	// one file at a time, so the memory used stays at the size of the largest shader.
+	int failed = 0;
+	std::vector<uint8_t> code;
+	for(int i = 0; i < fileCount; ++i)
+	{
+		const std::filesystem::path inputName = fileNames[i];
+		MappedFile input;
+		if(inputName.extension() != ".lz" || !input.open(inputName) || !decompressShaderCode(input.data(), input.size(), code))
+		{
+			fprintf(stderr, "%s: not a compressed shader dump\n", fileNames[i]);
+			++failed;
+			continue;
+		}
+		std::filesystem::path outputName = inputName;
+		outputName.replace_extension();
+		failed += writeFile(outputName, code) ? 0 : 1;
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+
+int main(int argc, char** argv)
+{
+	if(argc < 3)
+	{
+		return printUsage();
+	}
+	if(strcmp(argv[1], "decompress") == 0)
+	{
+		return decompressFiles(argc - 2, argv + 2);
+	}
+	ShaderDumpArchiveReader archive;
+	if(!archive.open(argv[2]))
+	{
+		fprintf(stderr, "%s: no readable %s found\n", argv[2], SHADER_DUMP_ARCHIVE_DATA_FILENAME);
+		return 1;
+	}
+	if(strcmp(argv[1], "list") == 0)
+	{
+		return listArchive(archive);
+	}
+	if(strcmp(argv[1], "extract") == 0 && argc >= 4)
+	{
+		return extractFromArchive(archive, argv[3], argc >= 5 ? argv[4] : ".");
+	}
+	return printUsage();
+}